@@ -15,6 +15,10 @@
 //                                                                          //
 //////////////////////////////////////////////////////////////////////////////
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* needed for 'clone()' and other Linux-specific APIs */
+#endif // _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,9 +35,25 @@
 #include <dirent.h>
 #include <fnmatch.h>
 #include <sys/wait.h>
+#include <sys/resource.h> /* for 'wait4()' and 'struct rusage' */
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/param.h> // for MAXPATHLEN and PATH_MAX (also includes limits.h in some cases)
+#include <sys/mman.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h> /* for the fork server */
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sched.h> /* for 'clone()' */
+#include <sys/syscall.h> /* for 'syscall()' and SYS_pidfd_open */
+#include <sys/epoll.h> /* for the reaper thread */
+#include <sys/eventfd.h>
+#include <linux/futex.h> /* for WB_MUTEX and WB_COND */
+#endif // __linux__
+#ifdef __SSE2__
+#include <emmintrin.h> /* for the newline scan */
+#endif // __SSE2__
 
 #include "ForkMe.h"
 
@@ -57,6 +77,7 @@ void warning_message(const char *szFormat, ...);
 
 // CONDITIONAL BUILD OPTIONS
 #define NO_SHARED_LIB_SUPPORT /* when statically linking on Linux, you should enable this */
+//#define WB_SPAWN_TRACE /* per-phase timing histograms for starting and running processes, see WBSpawnTraceGet() */
 
 
 #ifdef WIN32
@@ -77,6 +98,18 @@ struct timeval tv;
          + (WB_UINT64)tv.tv_usec;
 }
 
+// monotonic time in microseconds, for timeouts and intervals.  On Linux this is a vDSO call, not a system call
+
+static WB_UINT64 __WBMonotonicTime(void)
+{
+struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (WB_UINT64)ts.tv_sec * (WB_UINT64)1000000
+         + (WB_UINT64)(ts.tv_nsec / 1000);
+}
+
 void WBDelay(uint32_t uiDelay)  // approximate delay for specified period (in microseconds).  may be interruptible
 {
 //#ifdef HAVE_NANOSLEEP
@@ -104,6 +137,292 @@ struct timespec tsp;
 }
 
 
+// SPAWN TRACING - with WB_SPAWN_TRACE defined (see CONDITIONAL BUILD OPTIONS) each phase of starting and
+// running a process is timed in nanoseconds, and added to a histogram for that phase.  The histograms are
+// only updated with atomic adds (and a compare-and-swap for the maximum), so there's no lock.  There are 8
+// buckets for each power of 2, so a percentile is within 1/8 of the actual value.  Without WB_SPAWN_TRACE
+// the WB_TRACE_xxx macros are empty, and WBSpawnTraceGet() etc. report that tracing is not available.
+
+#ifdef WB_SPAWN_TRACE
+
+#define WB_TRACE_SUB_BITS 3 /* 8 buckets for each power of 2 */
+#define WB_TRACE_BUCKETS (64 << WB_TRACE_SUB_BITS)
+
+typedef struct __WB_TRACE_HISTOGRAM__
+{
+  WB_UINT64 ullCount, ullTotal, ullMax;
+  WB_UINT64 aullBucket[WB_TRACE_BUCKETS];
+} WB_TRACE_HISTOGRAM;
+
+static WB_TRACE_HISTOGRAM axTraceHistogram[WB_SPAWN_PHASE_COUNT];
+
+// the time that the child called 'execve' (vfork and clone backends).  The child shares the parent's memory
+// and its thread pointer, so it assigns the parent thread's copy of this while the parent is suspended.
+
+static __thread WB_UINT64 ullTraceExec;
+
+static WB_UINT64 __WBTraceTime(void)
+{
+struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (WB_UINT64)ts.tv_sec * (WB_UINT64)1000000000
+         + (WB_UINT64)ts.tv_nsec;
+}
+
+static int __WBTraceBucket(WB_UINT64 ullValue)
+{
+int iBit;
+
+
+  if(ullValue < (1 << WB_TRACE_SUB_BITS))
+  {
+    return (int)ullValue;
+  }
+
+  iBit = 63 - __builtin_clzll(ullValue); // the highest bit that's set (at least WB_TRACE_SUB_BITS)
+
+  return ((iBit - WB_TRACE_SUB_BITS + 1) << WB_TRACE_SUB_BITS)
+         + (int)((ullValue >> (iBit - WB_TRACE_SUB_BITS)) & ((1 << WB_TRACE_SUB_BITS) - 1));
+}
+
+static WB_UINT64 __WBTraceBucketMax(int iBucket) // the largest value that goes into 'iBucket'
+{
+int iShift;
+
+
+  if(iBucket < (1 << WB_TRACE_SUB_BITS))
+  {
+    return (WB_UINT64)iBucket;
+  }
+
+  iShift = (iBucket >> WB_TRACE_SUB_BITS) - 1;
+
+  return (((WB_UINT64)((1 << WB_TRACE_SUB_BITS) + (iBucket & ((1 << WB_TRACE_SUB_BITS) - 1)) + 1)) << iShift) - 1;
+}
+
+static void __WBTraceRecord(int iPhase, WB_UINT64 ullStart, WB_UINT64 ullEnd)
+{
+WB_TRACE_HISTOGRAM *pH = &(axTraceHistogram[iPhase]);
+WB_UINT64 ullValue, ullMax;
+
+
+  if(!ullStart || ullEnd < ullStart) // the phase never started
+  {
+    return;
+  }
+
+  ullValue = ullEnd - ullStart;
+
+  __atomic_fetch_add(&(pH->aullBucket[__WBTraceBucket(ullValue)]), 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&(pH->ullTotal), ullValue, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&(pH->ullCount), 1, __ATOMIC_RELAXED);
+
+  ullMax = __atomic_load_n(&(pH->ullMax), __ATOMIC_RELAXED);
+
+  while(ullValue > ullMax &&
+        !__atomic_compare_exchange_n(&(pH->ullMax), &ullMax, ullValue, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  { }
+}
+
+// the parent's time in the spawn backend is split at the child's 'execve' call, when it's known
+
+static void __WBTraceSpawn(WB_UINT64 ullStart, WB_UINT64 ullEnd)
+{
+WB_UINT64 ullExec = ullTraceExec;
+
+
+  if(ullExec > ullStart && ullExec <= ullEnd)
+  {
+    __WBTraceRecord(WB_SPAWN_PHASE_FORK, ullStart, ullExec);
+    __WBTraceRecord(WB_SPAWN_PHASE_EXEC, ullExec, ullEnd);
+  }
+  else // posix_spawn, or the fork server
+  {
+    __WBTraceRecord(WB_SPAWN_PHASE_FORK, ullStart, ullEnd);
+  }
+}
+
+#define WB_TRACE_DECLARE(X) WB_UINT64 X = 0;
+#define WB_TRACE_STAMP(X) ((X) = __WBTraceTime())
+#define WB_TRACE_RECORD(PHASE,START,END) __WBTraceRecord(PHASE, START, END)
+#define WB_TRACE_SPAWN_BEGIN(X) ((X) = __WBTraceTime(), ullTraceExec = 0)
+#define WB_TRACE_SPAWN_END(START,OK) ((OK) ? __WBTraceSpawn(START, __WBTraceTime()) : (void)0)
+#define WB_TRACE_CHILD_EXEC() (ullTraceExec = __WBTraceTime())
+#define WB_TRACE_CAPTURE(X) __WBCaptureTrace(X)
+#define WB_TRACE_CAPTURE_REAPED(X) __WBCaptureTraceReaped(X)
+
+#else // WB_SPAWN_TRACE
+
+#define WB_TRACE_DECLARE(X)
+#define WB_TRACE_STAMP(X)
+#define WB_TRACE_RECORD(PHASE,START,END)
+#define WB_TRACE_SPAWN_BEGIN(X)
+#define WB_TRACE_SPAWN_END(START,OK)
+#define WB_TRACE_CHILD_EXEC()
+#define WB_TRACE_CAPTURE(X)
+#define WB_TRACE_CAPTURE_REAPED(X)
+
+#endif // WB_SPAWN_TRACE
+
+const char * WBSpawnTracePhaseName(int iPhase)
+{
+static const char * const aszNames[WB_SPAWN_PHASE_COUNT] =
+  { "search", "setup", "fork", "exec", "first output", "exit", "total" };
+
+
+  if(iPhase < 0 || iPhase >= WB_SPAWN_PHASE_COUNT)
+  {
+    return NULL;
+  }
+
+  return aszNames[iPhase];
+}
+
+int WBSpawnTraceGet(int iPhase, WB_SPAWN_PHASE_STATS *pStats)
+{
+#ifdef WB_SPAWN_TRACE
+WB_TRACE_HISTOGRAM *pH;
+WB_UINT64 aullBucket[WB_TRACE_BUCKETS];
+WB_UINT64 ullCount, ullSum, ullP50, ullP99;
+int i1;
+#endif // WB_SPAWN_TRACE
+
+
+  if(iPhase < 0 || iPhase >= WB_SPAWN_PHASE_COUNT || !pStats)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  memset(pStats, 0, sizeof(*pStats));
+
+#ifdef WB_SPAWN_TRACE
+
+  pH = &(axTraceHistogram[iPhase]);
+
+  // the percentiles come from a copy of the buckets, so that they're consistent with each other
+
+  for(i1=0, ullCount=0; i1 < WB_TRACE_BUCKETS; i1++)
+  {
+    aullBucket[i1] = __atomic_load_n(&(pH->aullBucket[i1]), __ATOMIC_RELAXED);
+    ullCount += aullBucket[i1];
+  }
+
+  pStats->ullCount = ullCount;
+  pStats->ullTotal = __atomic_load_n(&(pH->ullTotal), __ATOMIC_RELAXED);
+  pStats->ullMax = __atomic_load_n(&(pH->ullMax), __ATOMIC_RELAXED);
+
+  if(!ullCount)
+  {
+    return 0;
+  }
+
+  ullP50 = (ullCount + 1) / 2; // the rank of each percentile (rounded up)
+  ullP99 = (ullCount * 99 + 99) / 100;
+
+  for(i1=0, ullSum=0; i1 < WB_TRACE_BUCKETS; i1++)
+  {
+    ullSum += aullBucket[i1];
+
+    if(!pStats->ullP50 && ullSum >= ullP50)
+    {
+      pStats->ullP50 = __WBTraceBucketMax(i1);
+    }
+
+    if(ullSum >= ullP99)
+    {
+      pStats->ullP99 = __WBTraceBucketMax(i1);
+      break;
+    }
+  }
+
+  if(pStats->ullP50 > pStats->ullMax) // the top of a bucket can be larger than anything in it
+  {
+    pStats->ullP50 = pStats->ullMax;
+  }
+
+  if(pStats->ullP99 > pStats->ullMax)
+  {
+    pStats->ullP99 = pStats->ullMax;
+  }
+
+  return 0;
+
+#else // WB_SPAWN_TRACE
+
+  errno = ENOSYS;
+  return -1;
+
+#endif // WB_SPAWN_TRACE
+}
+
+void WBSpawnTraceReset(void)
+{
+#ifdef WB_SPAWN_TRACE
+int i1, i2;
+
+
+  for(i1=0; i1 < WB_SPAWN_PHASE_COUNT; i1++)
+  {
+    for(i2=0; i2 < WB_TRACE_BUCKETS; i2++)
+    {
+      __atomic_store_n(&(axTraceHistogram[i1].aullBucket[i2]), 0, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&(axTraceHistogram[i1].ullCount), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(axTraceHistogram[i1].ullTotal), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(axTraceHistogram[i1].ullMax), 0, __ATOMIC_RELAXED);
+  }
+#endif // WB_SPAWN_TRACE
+}
+
+int WBSpawnTraceDump(char *pBuf, size_t cbBuf)
+{
+WB_SPAWN_PHASE_STATS xStats;
+size_t cbRval;
+int i1, iLen;
+
+
+  if(!pBuf && cbBuf)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  iLen = snprintf(pBuf, cbBuf, "%-13s %10s %10s %10s %10s %10s\n", "phase (usec)", "count", "mean", "p50", "p99", "max");
+
+  if(iLen < 0)
+  {
+    return -1;
+  }
+
+  for(i1=0, cbRval=(size_t)iLen; i1 < WB_SPAWN_PHASE_COUNT; i1++)
+  {
+    if(WBSpawnTraceGet(i1, &xStats))
+    {
+      return -1; // not available
+    }
+
+    iLen = snprintf(cbRval < cbBuf ? pBuf + cbRval : NULL, cbRval < cbBuf ? cbBuf - cbRval : 0,
+                    "%-13s %10llu %10.1f %10.1f %10.1f %10.1f\n", WBSpawnTracePhaseName(i1),
+                    (unsigned long long)xStats.ullCount,
+                    xStats.ullCount ? (double)xStats.ullTotal / xStats.ullCount / 1000.0 : 0.0,
+                    xStats.ullP50 / 1000.0, xStats.ullP99 / 1000.0, xStats.ullMax / 1000.0);
+
+    if(iLen < 0)
+    {
+      return -1;
+    }
+
+    cbRval += iLen;
+  }
+
+  return (int)cbRval;
+}
+
+
 
 char *WBCopyString(const char *pSrc)
 {
@@ -305,153 +624,417 @@ int iRval;
   return iRval;
 }
 
-char * WBSearchPath(const char *szFileName)
+#ifndef WIN32
+
+// PATH CACHE - executable lookups, keyed by the contents of PATH and the program name
+//
+// A 'generation' holds the directories parsed from one PATH string along with their modification
+// times, and a hash table of the programs that were found in them.  Readers never lock anything;
+// a cache hit costs a 'getenv', a string compare, and a hash lookup.  Entries are only ever added
+// (at the head of a bucket, with a compare-and-swap) and never freed, so a reader can't see one go
+// away.  Every WB_PATH_CACHE_RECHECK microseconds, one caller re-checks the directory modification
+// times, and if any have changed, it bumps the 'epoch', which invalidates every entry that was
+// found before then.  Entries that are looked up again and still resolve to the same file get the
+// new epoch, so the cache only grows when a lookup actually resolves to something different.
+// When PATH changes, a new generation is built, and the old one is retired (but not freed).
+
+#define WB_PATH_CACHE_BUCKETS 128 /* must be a power of 2 */
+#define WB_PATH_CACHE_RECHECK 1000000 /* microseconds between directory modification time checks */
+
+typedef struct __WB_PATH_CACHE_ENTRY__
 {
-char *pRval = NULL;
-const char *p1, *pCur, *pPath;
-#if 0
-char *p2;
-#endif // 0
+  struct __WB_PATH_CACHE_ENTRY__ * volatile pNext;
+  unsigned int uiHash;
+  volatile WB_UINT32 uiEpoch; // the directory epoch when this was last resolved
+  const char *szName;         // the program name (points into the same allocation)
+  char szPath[1];             // the full path (the name follows it)
+} WB_PATH_CACHE_ENTRY;
+
+typedef struct __WB_PATH_CACHE_DIR__
+{
+  char *szDir;                // the directory name, with a trailing '/'
+  int cbDir;
+  struct timespec tsMTime;    // modification time when last checked, zero if it didn't exist
+} WB_PATH_CACHE_DIR;
 
+typedef struct __WB_PATH_CACHE__
+{
+  struct __WB_PATH_CACHE__ *pRetired; // previous generations (a reader might still be using them)
+  char *szPATH;                      // the PATH string this was built from
+  int nDirs;
+  int iFirstRelative;                // results from this directory onward depend on the current directory, so they aren't cached
+  WB_PATH_CACHE_DIR *pDirs;
+  volatile WB_UINT32 uiEpoch;         // incremented whenever a directory's modification time changes
+  volatile WB_UINT64 ullNextCheck;    // __WBMonotonicTime() for the next directory check
+  WB_PATH_CACHE_ENTRY * volatile apBucket[WB_PATH_CACHE_BUCKETS];
+} WB_PATH_CACHE;
+
+static WB_PATH_CACHE * volatile pPathCache = NULL;
+static pthread_mutex_t mtxPathCache = PTHREAD_MUTEX_INITIALIZER; // writers only
+
+static unsigned int __WBPathCacheHash(const char *szName)
+{
+unsigned int uiRval = 2166136261U; // FNV-1a
 
-  if(0 > WBStat(szFileName, NULL)) // file does not exist?
+  while(*szName)
   {
-    if(*szFileName == '/') // absolute path
-    {
-no_stat:
-      WB_ERROR_PRINT("%s - File does not exist: \"%s\"\n", __FUNCTION__, szFileName);
-      return NULL;
-    }
+    uiRval = (uiRval ^ (unsigned char)*(szName++)) * 16777619U;
+  }
 
-    // check PATH environment variable, and locate first match
+  return uiRval;
+}
 
-    pRval = WBAlloc(2 * PATH_MAX + strlen(szFileName));
+static void __WBPathCacheDirTime(WB_PATH_CACHE_DIR *pDir, struct timespec *pTS)
+{
+struct stat sF;
 
-    if(pRval)
-    {
-      pPath = getenv("PATH"); // not malloc'd, but should not modify
-      if(pPath)
-      {
-        pCur = pPath;
+  if(!stat(pDir->szDir, &sF))
+  {
+    *pTS = sF.st_mtim;
+  }
+  else
+  {
+    pTS->tv_sec = 0;
+    pTS->tv_nsec = 0;
+  }
+}
 
-        while(*pCur)
-        {
-          *pRval = 0; // reset
+// build a new generation for 'szPATH'.  NOTE:  'mtxPathCache' must be locked by the caller
 
-          p1 = pCur;
-          while(*p1 && *p1 != ':')
-          {
-            p1++;
-          }
+static WB_PATH_CACHE * __WBPathCacheBuild(const char *szPATH)
+{
+WB_PATH_CACHE *pRval;
+const char *p1, *pCur;
+char *p2;
+int i1, nDirs, cbDir;
 
-          if((p1 - pCur) + 2 < 2 * PATH_MAX) // only if not a buffer overrun
-          {
-            // build path name
-            memcpy(pRval, pCur, p1 - pCur);
 
-            if(pRval[(p1 - pCur) - 1] != '/')
-            {
-              pRval[(p1 - pCur)] = '/';
-              strcpy(pRval + (p1 - pCur) + 1, szFileName);
-            }
-            else
-            {
-              strcpy(pRval + (p1 - pCur), szFileName);
-            }
+  for(p1=szPATH, nDirs=1; *p1; p1++)
+  {
+    if(*p1 == ':')
+    {
+      nDirs++;
+    }
+  }
 
-//            fprintf(stderr, "TEMPORARY:  trying \"%s\"\n", pRval);
+  // one allocation - header, directory array, then the strings
 
-            if(!WBStat(pRval, NULL))
-            {
-              return pRval; // FOUND!
-            }
-          }
+  pRval = (WB_PATH_CACHE *)WBAlloc(sizeof(*pRval) + nDirs * sizeof(WB_PATH_CACHE_DIR)
+                                   + 2 * (strlen(szPATH) + 1) + 2 * nDirs);
+  if(!pRval)
+  {
+    return NULL;
+  }
 
-          if(*p1)
-          {
-            p1++;
-          }
+  memset(pRval, 0, sizeof(*pRval));
 
-          pCur = p1;
-        }
-      }
+  pRval->pDirs = (WB_PATH_CACHE_DIR *)(pRval + 1);
+  pRval->szPATH = (char *)(pRval->pDirs + nDirs);
+  strcpy(pRval->szPATH, szPATH);
 
-      pPath = pCur = p1 = NULL; // make sure I NULL them out (prevent pointer re-use)
+  p2 = pRval->szPATH + strlen(szPATH) + 1;
+  pRval->iFirstRelative = nDirs;
 
-#if 0
-      // if I get here I should check ONE MORE TIME at the location of X11workbench in case
-      // it was installed into a non-standard path someplace and I need one of its utilities
+  for(pCur=szPATH, i1=0; i1 < nDirs; i1++)
+  {
+    for(p1=pCur; *p1 && *p1 != ':'; p1++)
+    {
+    }
 
-      p2 = WBCopyString(GetStartupAppName());
-      if(p2)
-      {
-        if(*p2 && strlen(p2) < 2 * PATH_MAX) // so I don't overflow
-        {
-          p1 = strrchr(p2, '/'); // find the last '/'
-          if(p1)
-          {
-            p2[p1 - p2 + 1] = 0; // terminate with 0 byte (p1 is const)
-          }
-          else
-          {
-            WBFree(p2);
-            p2 = NULL;
-          }
-        }
-        else
-        {
-          WBFree(p2);
-          p2 = NULL;
-        }
-      }
-#endif // 0
-      p1 = NULL; // prevents pointer re-use
+    cbDir = p1 - pCur;
 
-#if 0
-      if(p2)
-      {
-        strcpy(pRval, p2);         // the path for X11workbench's install directory
-        strcat(pRval, szFileName); // use path of X11workbench executable with szFileName
-      }
-      else // could not find, nor get path info
-#endif // 0
-      {
-        WBFree(pRval);
-        pRval = NULL;
-      }
+    if(!cbDir) // an empty entry means the current directory
+    {
+      *(p2++) = '.';
+      cbDir = 1;
+    }
+    else
+    {
+      memcpy(p2, pCur, cbDir);
+      p2 += cbDir;
     }
 
-    if(!pRval || 0 > WBStat(pRval, NULL))
+    pRval->pDirs[i1].szDir = p2 - cbDir;
+
+    if(p2[-1] != '/')
     {
-      if(pRval)
-      {
-        WBFree(pRval);
-      }
+      *(p2++) = '/';
+      cbDir++;
+    }
 
-      goto no_stat;
+    *(p2++) = 0;
+
+    pRval->pDirs[i1].cbDir = cbDir;
+
+    if(*(pRval->pDirs[i1].szDir) != '/' && pRval->iFirstRelative == nDirs)
+    {
+      pRval->iFirstRelative = i1;
     }
-  }
-  else
-  {
-    pRval = WBCopyString(szFileName); // file exists, so return as-is
+
+    __WBPathCacheDirTime(&(pRval->pDirs[i1]), &(pRval->pDirs[i1].tsMTime));
+
+    pCur = *p1 ? p1 + 1 : p1;
   }
 
+  pRval->nDirs = nDirs;
+  pRval->ullNextCheck = __WBMonotonicTime() + WB_PATH_CACHE_RECHECK;
+
   return pRval;
 }
 
+// return the generation for the current PATH, or NULL if there is no PATH (or no memory)
 
-char * WBTempFile0(const char *szExt)
-{
-char *pRval = NULL;
-const char *szDir = NULL;
-int i1;
-WB_FILE_HANDLE h1;
-union
+static WB_PATH_CACHE * __WBPathCacheGet(void)
 {
-  WB_UINT64 ullTime;
-  unsigned short sA[4];
-} uX;
-static const char szH[16]="0123456789ABCDEF";
+WB_PATH_CACHE *pRval;
+const char *pPATH;
+struct timespec ts;
+int i1, bChanged;
+
+
+  pPATH = getenv("PATH"); // not malloc'd, but should not modify
+
+  if(!pPATH)
+  {
+    return NULL;
+  }
+
+  pRval = __atomic_load_n(&pPathCache, __ATOMIC_ACQUIRE);
+
+  if(WB_UNLIKELY(!pRval || strcmp(pRval->szPATH, pPATH)))
+  {
+    pthread_mutex_lock(&mtxPathCache);
+
+    pRval = pPathCache;
+
+    if(!pRval || strcmp(pRval->szPATH, pPATH)) // check again, now that I own the lock
+    {
+      pRval = __WBPathCacheBuild(pPATH);
+
+      if(pRval)
+      {
+        pRval->pRetired = pPathCache;
+        __atomic_store_n(&pPathCache, pRval, __ATOMIC_RELEASE);
+      }
+    }
+
+    pthread_mutex_unlock(&mtxPathCache);
+
+    return pRval;
+  }
+
+  // periodically, check the directory modification times.  if someone else is doing it, don't wait
+
+  if(WB_UNLIKELY(__WBMonotonicTime() >= pRval->ullNextCheck) &&
+     !pthread_mutex_trylock(&mtxPathCache))
+  {
+    if(__WBMonotonicTime() >= pRval->ullNextCheck)
+    {
+      for(i1=0, bChanged=0; i1 < pRval->nDirs; i1++)
+      {
+        __WBPathCacheDirTime(&(pRval->pDirs[i1]), &ts);
+
+        if(ts.tv_sec != pRval->pDirs[i1].tsMTime.tv_sec ||
+           ts.tv_nsec != pRval->pDirs[i1].tsMTime.tv_nsec)
+        {
+          pRval->pDirs[i1].tsMTime = ts;
+          bChanged = 1;
+        }
+      }
+
+      if(bChanged)
+      {
+        __sync_add_and_fetch(&(pRval->uiEpoch), 1);
+      }
+
+      pRval->ullNextCheck = __WBMonotonicTime() + WB_PATH_CACHE_RECHECK;
+    }
+
+    pthread_mutex_unlock(&mtxPathCache);
+  }
+
+  return pRval;
+}
+
+// find 'szName' (which has no '/' in it) in PATH.  The return value is NOT allocated; it belongs
+// to the cache and remains valid for the life of the process.  Returns NULL if it was not found.
+// 'szBuf' must be at least PATH_MAX bytes, and is used (and returned) for results that can't be cached.
+
+static const char * __WBPathCacheLookup(const char *szName, char *szBuf)
+{
+WB_PATH_CACHE *pCache;
+WB_PATH_CACHE_ENTRY *pE, *pOld;
+WB_PATH_CACHE_ENTRY * volatile *ppBucket;
+unsigned int uiHash;
+WB_UINT32 uiEpoch;
+int i1, cbName;
+
+
+  pCache = __WBPathCacheGet();
+
+  if(!pCache)
+  {
+    return NULL;
+  }
+
+  uiHash = __WBPathCacheHash(szName);
+  uiEpoch = __atomic_load_n(&(pCache->uiEpoch), __ATOMIC_ACQUIRE);
+  ppBucket = &(pCache->apBucket[uiHash & (WB_PATH_CACHE_BUCKETS - 1)]);
+
+  pOld = NULL;
+
+  for(pE = __atomic_load_n(ppBucket, __ATOMIC_ACQUIRE); pE; pE = pE->pNext)
+  {
+    if(pE->uiHash == uiHash && !strcmp(pE->szName, szName))
+    {
+      if(pE->uiEpoch == uiEpoch)
+      {
+        return pE->szPath; // cache hit
+      }
+
+      if(!pOld)
+      {
+        pOld = pE; // the most recent (stale) result
+      }
+    }
+  }
+
+  // not cached, or stale.  search the directories in order
+
+  cbName = strlen(szName);
+
+  for(i1=0; i1 < pCache->nDirs; i1++)
+  {
+    if(pCache->pDirs[i1].cbDir + cbName >= PATH_MAX)
+    {
+      continue;
+    }
+
+    memcpy(szBuf, pCache->pDirs[i1].szDir, pCache->pDirs[i1].cbDir);
+    strcpy(szBuf + pCache->pDirs[i1].cbDir, szName);
+
+    if(!WBStat(szBuf, NULL))
+    {
+      break; // FOUND!
+    }
+  }
+
+  if(i1 >= pCache->nDirs)
+  {
+    return NULL;
+  }
+
+  if(i1 >= pCache->iFirstRelative)
+  {
+    return szBuf; // relative to the current directory, so it can't be cached
+  }
+
+  if(pOld && !strcmp(pOld->szPath, szBuf))
+  {
+    // same result as before, so just bring it up to date.  If the epoch changed while I was
+    // looking, this leaves it stale, which is harmless.
+
+    __sync_val_compare_and_swap(&(pOld->uiEpoch), pOld->uiEpoch, uiEpoch);
+
+    return pOld->szPath;
+  }
+
+  pE = (WB_PATH_CACHE_ENTRY *)WBAlloc(sizeof(*pE) + strlen(szBuf) + cbName + 1);
+
+  if(!pE)
+  {
+    return szBuf;
+  }
+
+  strcpy(pE->szPath, szBuf);
+  pE->szName = pE->szPath + strlen(szBuf) + 1;
+  strcpy((char *)pE->szName, szName);
+  pE->uiHash = uiHash;
+  pE->uiEpoch = uiEpoch;
+
+  // newest first, so that stale entries for the same name are found after it
+
+  do
+  {
+    pE->pNext = __atomic_load_n(ppBucket, __ATOMIC_ACQUIRE);
+  } while(!__sync_bool_compare_and_swap(ppBucket, pE->pNext, pE));
+
+  return pE->szPath;
+}
+
+#endif // !WIN32
+
+// locate 'szFileName' the way WBRunAsyncPipeV() needs it.  The return value is either 'szFileName',
+// a pointer into the PATH cache, or 'szBuf' (at least PATH_MAX bytes); none of them need to be free'd
+
+static const char * __WBSearchPathInternal(const char *szFileName, char *szBuf)
+{
+const char *pRval;
+
+
+#ifndef WIN32
+  if(!strchr(szFileName, '/')) // a plain program name, so check PATH first
+  {
+    pRval = __WBPathCacheLookup(szFileName, szBuf);
+
+    if(pRval)
+    {
+      return pRval;
+    }
+  }
+#endif // !WIN32
+
+  if(!WBStat(szFileName, NULL)) // file exists, so return as-is
+  {
+    return szFileName;
+  }
+
+#ifndef WIN32
+  if(*szFileName != '/' && strchr(szFileName, '/')) // a relative path, which might be in PATH
+  {
+    pRval = __WBPathCacheLookup(szFileName, szBuf);
+
+    if(pRval)
+    {
+      return pRval;
+    }
+  }
+#endif // !WIN32
+
+  WB_ERROR_PRINT("%s - File does not exist: \"%s\"\n", __FUNCTION__, szFileName);
+
+  return NULL;
+}
+
+char * WBSearchPath(const char *szFileName)
+{
+const char *pRval;
+char szBuf[PATH_MAX];
+
+
+  pRval = __WBSearchPathInternal(szFileName, szBuf);
+
+  if(!pRval)
+  {
+    return NULL;
+  }
+
+  return WBCopyString(pRval);
+}
+
+
+char * WBTempFile0(const char *szExt)
+{
+char *pRval = NULL;
+const char *szDir = NULL;
+int i1;
+WB_FILE_HANDLE h1;
+union
+{
+  WB_UINT64 ullTime;
+  unsigned short sA[4];
+} uX;
+static const char szH[16]="0123456789ABCDEF";
 
 
 #ifdef WIN32
@@ -520,7 +1103,7 @@ static const char szH[16]="0123456789ABCDEF";
 #ifdef WIN32
 #error windows code not written yet
 #else // !WIN32
-      h1 = open(pRval, O_CREAT | O_EXCL | O_RDWR, 0644); // create file, using '644' permissions, fail if exists
+      h1 = open(pRval, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644); // create file, using '644' permissions, fail if exists
 
       if(h1 < 0) // error
       {
@@ -578,314 +1161,289 @@ char *pRval = WBTempFile0(szExt);
 // EXTERNAL APPLICATION EXECUTION
 ///////////////////////////////////
 
-WB_PROCESS_ID WBRunAsyncPipeV(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
-                              const char *szAppName, va_list va)
-{
-const char *pArg;//, *pPath;
-char *pCur, *p1, *pAppName = NULL;
-#ifdef WIN32
-STARTUPINFO si;
-PROCESS_INFORMATION pi;
-#else // !WIN32
-char **argv;
-int i1, nItems, cbItems;
-va_list va2;
-#endif // WIN32
-WB_PROCESS_ID hRval = WB_INVALID_PROCESS_ID;
-WB_FILE_HANDLE hIn, hOut, hErr;
+#ifdef __linux__
+#define WB_SPAWN_CLONE_STACK_SIZE (16384 + PATH_MAX) /* child only needs enough stack for dup2, setsid, execve */
+#endif // __linux__
 
+static volatile int iSpawnBackend = WB_SPAWN_BACKEND_DEFAULT;
 
-  // NOTE:  to avoid zombies, must assign SIGCHLD to 'SIG_IGN' or process them correctly
-  //        (this is done in 'WBInit')
+#ifndef WIN32
 
-  hIn = hOut = hErr = WB_INVALID_FILE_HANDLE; // by convention (WIN32 needs this anyway)
+// obtain a 'pidfd' for a child process, which becomes readable when the process exits.
+// returns WB_INVALID_FILE_HANDLE when the kernel (or headers) do not support it.
 
-  // FIRST, locate 'szAppName'
+static WB_FILE_HANDLE __WBPidfdOpen(WB_PROCESS_ID idProcess)
+{
+#if defined(__linux__) && defined(SYS_pidfd_open)
+int iRval;
 
-  pAppName = WBSearchPath(szAppName);
+  iRval = (int)syscall(SYS_pidfd_open, (pid_t)idProcess, 0);
 
-  if(hStdIn == WB_INVALID_FILE_HANDLE) // re-dir to/from /dev/null
+  if(iRval >= 0)
   {
-#ifndef WIN32
-    hIn = open("/dev/null", O_RDONLY, 0);
-#else // WIN32
-    SECURITY_DESCRIPTOR *pSD = (SECURITY_DESCRIPTOR *)WBAlloc(SECURITY_DESCRIPTOR_MIN_LENGTH);
+    fcntl(iRval, F_SETFD, FD_CLOEXEC); // pidfd_open already does this, but just in case
+    return iRval;
+  }
+#endif // __linux__, SYS_pidfd_open
 
-    if(pSD)
-    {
-      SECURITY_ATTRIBUTES sa;
+  return WB_INVALID_FILE_HANDLE;
+}
 
-      InitializeSecurityDescriptor(pSD,SECURITY_DESCRIPTOR_REVISION);
+#endif // !WIN32
 
-      sa.nLength = sizeof(sa);
-      sa.lpSecurityDescriptor = pSD;
-      sa.bInheritHandle = TRUE; // what a pain
+int WBSetSpawnBackend(int iBackend)
+{
+int iRval;
 
-      hIn = CreateFile("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                       &sa, OPEN_EXISTING, NULL, NULL);
-      WBFree(pSD);
-    }
-#endif // WIN32
-  }
-  else
+  switch(iBackend)
   {
-#ifndef WIN32
-    hIn = dup(hStdIn);
-#else // WIN32
-    if(!DuplicateHandle(GetCurrentProcess(), hStdIn,
-                        GetCurrentProcess(), &hIn, GENERIC_READ,
-                        TRUE, 0))
-    {
-      hIn = WB_INVALID_FILE_HANDLE;
-    }
-#endif // WIN32
+    case WB_SPAWN_BACKEND_DEFAULT:
+    case WB_SPAWN_BACKEND_VFORK:
+      break;
+
+    case WB_SPAWN_BACKEND_POSIX_SPAWN:
+#ifndef POSIX_SPAWN_SETSID
+      return -1; // not supported by this C library
+#endif // POSIX_SPAWN_SETSID
+      break;
+
+    case WB_SPAWN_BACKEND_CLONE:
+#ifndef __linux__
+      return -1; // Linux only
+#endif // __linux__
+      break;
+
+    default:
+      return -1;
   }
 
-  if(hStdOut == WB_INVALID_FILE_HANDLE) // re-dir to/from /dev/null
-  {
+  iRval = iSpawnBackend;
+  iSpawnBackend = iBackend;
+
+  return iRval;
+}
+
+int WBGetSpawnBackend(void)
+{
+  return iSpawnBackend;
+}
+
 #ifndef WIN32
-    hOut = open("/dev/null", O_WRONLY, 0);
-#else // WIN32
-    SECURITY_DESCRIPTOR *pSD = (SECURITY_DESCRIPTOR *)WBAlloc(SECURITY_DESCRIPTOR_MIN_LENGTH);
 
-    if(pSD)
-    {
-      SECURITY_ATTRIBUTES sa;
+// what the child does to itself just before 'execve' - resource limits, moving into a cgroup, and
+// keeping extra file descriptors open.  This runs in a 'vfork' (or CLONE_VM) child, so it can only
+// use async-signal-safe system calls.  The parent opens the cgroup's 'cgroup.procs' file, and the
+// child writes "0" to it, which moves the writing process.  That way the program is in the cgroup
+// before it ever runs.
 
-      InitializeSecurityDescriptor(pSD,SECURITY_DESCRIPTOR_REVISION);
+typedef struct __WB_SPAWN_SETUP__
+{
+  int nLimits;                            // number of entries in 'aiResource' and 'aLimits'
+  int aiResource[WB_RUN_MAX_LIMITS];      // RLIMIT_xxx
+  struct rlimit aLimits[WB_RUN_MAX_LIMITS];
+  WB_FILE_HANDLE hCgroupProcs;            // 'cgroup.procs' for the cgroup, or WB_INVALID_FILE_HANDLE
+  int nKeepFDs;                           // number of entries in 'ahKeepFD'
+  WB_FILE_HANDLE ahKeepFD[WB_RUN_MAX_KEEP_FDS]; // descriptors the program inherits (sorted, all above stderr)
+  int bCaller;                            // non-zero if the caller's state (below) applies - for the fork server
+  WB_FILE_HANDLE hCwd;                    // the caller's working directory (O_PATH), for 'fchdir'
+  mode_t uiUmask;                         // the caller's umask
+  sigset_t sigIgnore;                     // signals the caller ignores (every other signal is SIG_DFL)
+} WB_SPAWN_SETUP;
+
+#define WB_SPAWN_CLOSE_FALLBACK_MAX 65536 /* without 'close_range', close descriptors up to this (or RLIMIT_NOFILE) */
+
+// returns zero on success, or an errno value
+
+static int __WBSpawnChildSetup(const WB_SPAWN_SETUP *pSetup)
+{
+int i1;
 
-      sa.nLength = sizeof(sa);
-      sa.lpSecurityDescriptor = pSD;
-      sa.bInheritHandle = TRUE; // what a pain
 
-      hOut = CreateFile("NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                        &sa, OPEN_EXISTING, NULL, NULL);
-      WBFree(pSD);
+  if(!pSetup)
+  {
+    return 0;
+  }
+
+  if(pSetup->bCaller)
+  {
+    if(fchdir(pSetup->hCwd))
+    {
+      return errno;
     }
-#endif // WIN32
+
+    umask(pSetup->uiUmask);
   }
-  else
+
+  for(i1=0; i1 < pSetup->nLimits; i1++)
   {
-#ifndef WIN32
-    hOut = dup(hStdOut);
-#else // WIN32
-    if(!DuplicateHandle(GetCurrentProcess(), hStdOut,
-                        GetCurrentProcess(), &hOut, GENERIC_WRITE,
-                        TRUE, 0))
+    if(setrlimit(pSetup->aiResource[i1], &(pSetup->aLimits[i1])))
     {
-      hOut = WB_INVALID_FILE_HANDLE;
+      return errno;
     }
-#endif // WIN32
   }
 
-  if(hStdErr == WB_INVALID_FILE_HANDLE) // re-dir to/from /dev/null
+  if(pSetup->hCgroupProcs != WB_INVALID_FILE_HANDLE &&
+     write(pSetup->hCgroupProcs, "0", 1) != 1)
   {
-#ifndef WIN32
-    hErr = open("/dev/null", O_WRONLY, 0);
-#else // WIN32
-    SECURITY_DESCRIPTOR *pSD = (SECURITY_DESCRIPTOR *)WBAlloc(SECURITY_DESCRIPTOR_MIN_LENGTH);
+    return errno ? errno : EIO;
+  }
 
-    if(pSD)
+  for(i1=0; i1 < pSetup->nKeepFDs; i1++)
+  {
+    if(fcntl(pSetup->ahKeepFD[i1], F_SETFD, 0)) // clear FD_CLOEXEC so that the program gets it
     {
-      SECURITY_ATTRIBUTES sa;
-
-      InitializeSecurityDescriptor(pSD,SECURITY_DESCRIPTOR_REVISION);
-
-      sa.nLength = sizeof(sa);
-      sa.lpSecurityDescriptor = pSD;
-      sa.bInheritHandle = TRUE; // what a pain
-
-      hErr = CreateFile("NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                        &sa, OPEN_EXISTING, NULL, NULL);
-      WBFree(pSD);
-    }
-#endif // WIN32
-  }
-  else
-  {
-#ifndef WIN32
-    hErr = dup(hStdErr);
-#else // WIN32
-    if(!DuplicateHandle(GetCurrentProcess(), hStdErr,
-                        GetCurrentProcess(), &hErr, GENERIC_WRITE,
-                        TRUE, 0))
-    {
-      hErr = WB_INVALID_FILE_HANDLE;
+      return errno;
     }
-#endif // WIN32
   }
 
-  // if file handle duplication fails, exit now with an error
-
-  if(hIn == WB_INVALID_FILE_HANDLE ||
-     hOut == WB_INVALID_FILE_HANDLE ||
-     hErr == WB_INVALID_FILE_HANDLE)
-  {
-//    WB_ERROR_PRINT("TEMPORARY:  %s hIn=%d hOut=%d hErr=%d\n", __FUNCTION__, hIn, hOut, hErr);
+  return 0;
+}
 
-    if(hIn != WB_INVALID_FILE_HANDLE)
-    {
-#ifndef WIN32
-      close(hIn);
-#else // WIN32
-      CloseHandle(hIn);
-#endif // WIN32
-    }
-    if(hOut != WB_INVALID_FILE_HANDLE)
-    {
-#ifndef WIN32
-      close(hOut);
-#else // WIN32
-      CloseHandle(hOut);
-#endif // WIN32
-    }
-    if(hErr != WB_INVALID_FILE_HANDLE)
-    {
-#ifndef WIN32
-      close(hErr);
-#else // WIN32
-      CloseHandle(hErr);
-#endif // WIN32
-    }
+static void __WBSpawnChildCloseRange(unsigned int uiFirst, unsigned int uiLast)
+{
+struct rlimit rl;
+unsigned int ui1;
 
-    if(pAppName != szAppName)
-    {
-      WBFree(pAppName);
-    }
 
-    return WB_INVALID_FILE_HANDLE;
+  if(uiFirst > uiLast)
+  {
+    return;
   }
 
-#ifdef WIN32
-
-  memset(&si, 0, sizeof(si));
-  memset(&pi, 0, sizeof(pi));
-
-  si.cb = sizeof(si);
-
-  si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-  si.hStdInput = hIn;
-  si.hStdOutput = hOut;
-  si.hStdError = hErr;
-
-  // make sure it is hidden
-  si.wShowWindow = SW_HIDE;
-
+#if defined(__linux__) && defined(SYS_close_range)
+  if(!syscall(SYS_close_range, uiFirst, uiLast, 0)) // Linux 5.9 or later
+  {
+    return;
+  }
+#endif // __linux__, SYS_close_range
 
-  // get application name from path
+  // one at a time, which is a lot slower
 
-  p1 = _tcsrchr((TCHAR *)pAppName, '\\');
-  if(p1)
+  if(getrlimit(RLIMIT_NOFILE, &rl) || rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > WB_SPAWN_CLOSE_FALLBACK_MAX)
   {
-    pCur = CopyString(p1 + 1); // just the name
+    rl.rlim_cur = WB_SPAWN_CLOSE_FALLBACK_MAX;
   }
-  else
+
+  for(ui1=uiFirst; ui1 <= uiLast && ui1 < (unsigned int)rl.rlim_cur; ui1++)
   {
-    pCur = CopyString(pAppName);
+    close((int)ui1);
   }
+}
 
-  // build the command line
+// close every descriptor above stderr, except for the setup's 'ahKeepFD' list and 'hExec' (which
+// is close-on-exec, so it goes away with the 'execveat').  Everything the library opens is O_CLOEXEC,
+// but the rest of the program (and the libraries it uses) might not be, and a child that inherits
+// the write end of somebody else's pipe delays their EOF until it exits.
 
-  while(1)
+static void __WBSpawnChildCloseFDs(const WB_SPAWN_SETUP *pSetup, WB_FILE_HANDLE hExec)
+{
+unsigned int uiFirst = 3, uiKeep;
+int i1, nKeep, bExec;
+
+
+  nKeep = pSetup ? pSetup->nKeepFDs : 0;
+  bExec = hExec != WB_INVALID_FILE_HANDLE;
+
+  for(i1=0; i1 < nKeep || bExec; )
   {
-    pArg = va_arg(va, const TCHAR *);
-    if(!pArg)
+    if(bExec && (i1 >= nKeep || hExec < pSetup->ahKeepFD[i1])) // both lists are in order
     {
-      break;
+      uiKeep = (unsigned int)hExec;
+      bExec = 0;
+    }
+    else
+    {
+      uiKeep = (unsigned int)pSetup->ahKeepFD[i1++];
     }
 
-    CatString(&pCur, _T(" "));
-    CatString(&pCur, pArg); // caller must add quotes as needed
+    if(uiKeep >= uiFirst)
+    {
+      __WBSpawnChildCloseRange(uiFirst, uiKeep - 1);
+
+      uiFirst = uiKeep + 1;
+    }
   }
 
-  if(CreateProcess(pAppName, pCur, NULL, NULL, TRUE, NORMAL_PRIORITY_CLASS,
-                    NULL, NULL, &si, &pi))  // it worked?
-  {
-      // wait for process to complete before continuing...
+  __WBSpawnChildCloseRange(uiFirst, ~0U);
+}
 
-//        SetCursor(LoadCursor(NULL, IDC_WAIT));
-    hRval.uiProcessID = pi.dwProcessId;
-    hRval.hProcess = pi.hProcess;
-    hRval.iCachedExitCode = -1;
+// run the program.  With an executable handle, 'execveat' (or 'fexecve') uses the descriptor, so
+// the path isn't resolved again.  If that fails, for whatever reason, the path is used instead.
 
-    WaitForInputIdle(pi.hProcess, 1000); // wait up to 1 sec to help it run
-  }
-  else
+static void __WBSpawnChildExec(const char *pAppName, WB_FILE_HANDLE hExec, char * const *argv, char * const *envp)
+{
+  WB_TRACE_CHILD_EXEC(); // the parent is suspended until the 'exec' (vfork, clone), so it's safe to write this
+
+  if(hExec != WB_INVALID_FILE_HANDLE)
   {
-    hRval = INVALID_PROCESS_ID;
+#if defined(__linux__) && defined(SYS_execveat)
+    syscall(SYS_execveat, hExec, "", argv, envp, AT_EMPTY_PATH); // Linux 3.19 or later
+#else // __linux__, SYS_execveat
+    fexecve(hExec, argv, envp);
+#endif // __linux__, SYS_execveat
   }
 
-  free(pCur);
-  pCur = NULL;
-
-  CloseHandle(hIn);
-  CloseHandle(hOut);
-  CloseHandle(hErr);
+  execve(pAppName, argv, envp);
+}
 
-#else // WIN32
+// The vfork and clone children share the parent's memory, and (at first) its signal handlers.  A handler that
+// runs in the child could corrupt the suspended parent's memory, or overflow the small clone stack, so the parent
+// blocks every signal before it creates the child, and the child sets each handler back to SIG_DFL while they're
+// still blocked.  'ignored' signals stay ignored, as they would after 'execve'.  Then the child restores the
+// caller's signal mask just before 'execve', and the parent restores it once the child has started (this is
+// what glibc's 'posix_spawn' does).  For the fork server, 'pIgnore' is the set of signals its caller ignores,
+// which replaces the fork server's own.
 
-  // count arguments, determine memory requirement
+static void __WBSpawnChildResetSignals(const sigset_t *pIgnore)
+{
+struct sigaction sa;
+void (*pHandler)(int);
+int iSig;
 
-  nItems = 0;
-  cbItems = 2 * sizeof(char *) + strlen(szAppName) + 1;
-  va_copy(va2, va);
 
-  while(1)
+  for(iSig=1; iSig < NSIG; iSig++)
   {
-    pArg = va_arg(va2, const char *);
-    if(!pArg)
+    if(sigaction(iSig, NULL, &sa))
     {
-      break;
+      continue; // not a valid signal (or one the C library reserves)
     }
 
-    cbItems += strlen(pArg) + 1 + sizeof(char *);
-    nItems++;
-  }
-
-  argv = (char **)WBAlloc(64 + cbItems);
-  if(!argv)
-  {
-    close(hIn);
-    close(hOut);
-    close(hErr);
-
-    if(pAppName != szAppName)
+    if(pIgnore && sigismember(pIgnore, iSig) == 1)
     {
-      WBFree(pAppName);
+      pHandler = SIG_IGN;
+    }
+    else if(sa.sa_handler == SIG_IGN && !pIgnore)
+    {
+      continue;
+    }
+    else
+    {
+      pHandler = SIG_DFL;
     }
 
-//    WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (1)\n", __FUNCTION__);
-    return WB_INVALID_FILE_HANDLE;
-  }
-
-  pCur = (char *)(argv + nItems + 2); // enough room for argument pointers
+    if(sa.sa_handler != pHandler)
+    {
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = pHandler;
 
-  p1 = strrchr(szAppName, '/');
-  if(p1)
-  {
-    strcpy(pCur, p1 + 1); // just the name
-  }
-  else
-  {
-    strcpy(pCur, szAppName);
+      sigaction(iSig, &sa, NULL);
+    }
   }
+}
 
-  argv[0] = pCur;
-  pCur += strlen(pCur) + 1;
-
-  for(i1=1; i1 <= nItems; i1++)
-  {
-    pArg = va_arg(va, const char *);
+// the original method - 'vfork()' then dup2, setsid, execve in the child
 
-    strcpy(pCur, pArg);
-    argv[i1] = pCur;
-    pCur += strlen(pCur) + 1;
-  }
+static WB_PROCESS_ID __WBSpawnVFork(const char *pAppName, WB_FILE_HANDLE hExec, char * const *argv, char * const *envp,
+                                    WB_FILE_HANDLE hIn, WB_FILE_HANDLE hOut, WB_FILE_HANDLE hErr,
+                                    const WB_SPAWN_SETUP *pSetup)
+{
+WB_PROCESS_ID hRval;
+sigset_t sigAll, sigOld;
+int iErr;
 
-  argv[nItems + 1] = NULL;
 
-  // now that I have a valid 'argv' I can spawn the process.
-  // I will return the PID so that the caller can wait on it
+  sigfillset(&sigAll);
+  pthread_sigmask(SIG_BLOCK, &sigAll, &sigOld); // see __WBSpawnChildResetSignals
 
   hRval = vfork();
 
@@ -894,21 +1452,38 @@ WB_FILE_HANDLE hIn, hOut, hErr;
     // vfork jumps here FIRST and temporarily suspends the calling thread
     // it also does NOT make a copy of memory so I must treat it as 'read only'
 
+    __WBSpawnChildResetSignals(pSetup && pSetup->bCaller ? &(pSetup->sigIgnore) : NULL);
+
     if(dup2(hIn, 0) != -1 && dup2(hOut, 1) != -1 && dup2(hErr, 2) != -1) // stdin, stdout, stderr
     {
       static const char szMsg[]="ERROR: 'execve()' failure\n";
-      extern char **environ; // this is what the man page says to do (it's part of libc)
-
-      // TODO:  customize environment?
 
       signal(SIGHUP, SIG_IGN); // ignore 'HUP' signal before 'setsid' call ['daemon()' does this]
       setsid(); // so that I am my own process group (NOTE doing this might make it impossible to get the exit status... must verify everywhere)
       signal(SIGHUP, SIG_DFL); // restore default handling of 'HUP' ['daemon()' does this]
 
-      execve(pAppName, argv, environ); // NOTE:  execute clears all existing signal handlers back to 'default' but retains 'ignored' signals
+      if(__WBSpawnChildSetup(pSetup))
+      {
+        static const char szMsg2[]="ERROR: resource limit or cgroup failure\n";
+        write(2, szMsg2, sizeof(szMsg2) - 1);
+
+        close(hIn);
+        close(hOut);
+        close(hErr);
 
-      write(2, szMsg, sizeof(szMsg) - 1); // stderr is still 'the old one' at this point
-      fsync(2);
+        _exit(127); // same as a shell that can't run the program
+      }
+      else
+      {
+        __WBSpawnChildCloseFDs(pSetup, hExec);
+
+        pthread_sigmask(SIG_SETMASK, &sigOld, NULL);
+
+        __WBSpawnChildExec(pAppName, hExec, argv, envp); // NOTE:  execute clears all existing signal handlers back to 'default' but retains 'ignored' signals
+
+        write(2, szMsg, sizeof(szMsg) - 1); // stderr is still 'the old one' at this point
+        fsync(2);
+      }
 
       // TODO:  if execve fails, should I forcibly close the duplicated handles??
 //      close(0);
@@ -928,874 +1503,9839 @@ WB_FILE_HANDLE hIn, hOut, hErr;
     _exit(-1); // should never get here, but this must be done if execve fails
   }
 
-  // once I've forked, I don't have to worry about copied memory or shared memory
-  // and it's safe to free the allocated 'argv' array.
+  iErr = errno;
+  pthread_sigmask(SIG_SETMASK, &sigOld, NULL);
+  errno = iErr;
+
+  return hRval;
+}
 
-  WBFree(argv);
+#ifdef POSIX_SPAWN_SETSID
 
-  close(hIn);
-  close(hOut);
-  close(hErr);
+// 'posix_spawn()' with file actions.  Modern C libraries implement this with CLONE_VM|CLONE_VFORK
+// (or equivalent) so the parent's page tables are never copied, and 'execve' errors are reported
+// directly to the caller rather than through the child's exit code.
+
+static WB_PROCESS_ID __WBSpawnPosixSpawn(const char *pAppName, char * const *argv, char * const *envp,
+                                         WB_FILE_HANDLE hIn, WB_FILE_HANDLE hOut, WB_FILE_HANDLE hErr)
+{
+posix_spawn_file_actions_t fa;
+posix_spawnattr_t attr;
+pid_t pid;
+int iErr;
 
-#endif // WIN32
 
-  if(pAppName != szAppName)
+  if(posix_spawn_file_actions_init(&fa))
   {
-    WBFree(pAppName);
+    return WB_INVALID_PROCESS_ID;
   }
 
+  if(posix_spawnattr_init(&attr))
+  {
+    posix_spawn_file_actions_destroy(&fa);
+    return WB_INVALID_PROCESS_ID;
+  }
 
-  return hRval;
+  iErr = posix_spawn_file_actions_adddup2(&fa, hIn, 0);
+  if(!iErr)
+  {
+    iErr = posix_spawn_file_actions_adddup2(&fa, hOut, 1);
+  }
+  if(!iErr)
+  {
+    iErr = posix_spawn_file_actions_adddup2(&fa, hErr, 2);
+  }
+#ifdef __GLIBC_PREREQ
+#if __GLIBC_PREREQ(2, 34)
+  if(!iErr)
+  {
+    iErr = posix_spawn_file_actions_addclosefrom_np(&fa, 3); // like __WBSpawnChildCloseFDs
+  }
+#endif // __GLIBC_PREREQ(2, 34)
+#endif // __GLIBC_PREREQ
+  if(!iErr)
+  {
+    iErr = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID); // so that I am my own process group, like the vfork method
+  }
+  if(!iErr)
+  {
+    iErr = posix_spawn(&pid, pAppName, &fa, &attr, argv, envp);
+  }
+
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&fa);
+
+  if(iErr)
+  {
+    errno = iErr;
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  return pid;
 }
 
+#endif // POSIX_SPAWN_SETSID
 
-WB_PROCESS_ID WBRunAsync(const char *szAppName, ...)
+#ifdef __linux__
+
+// 'clone()' with CLONE_VM|CLONE_VFORK.  The child shares memory with the parent (like vfork) and
+// runs on a small stack that lives in the calling thread's stack frame.  That's safe because the
+// calling thread is suspended until the child calls 'execve' or exits.
+
+typedef struct __WB_CLONE_PARAMS__
 {
-WB_PROCESS_ID idRval;
-va_list va;
+  const char *pAppName;
+  WB_FILE_HANDLE hExec;   // executable handle descriptor, or WB_INVALID_FILE_HANDLE
+  char * const *argv;
+  char * const *envp;
+  WB_FILE_HANDLE hIn, hOut, hErr;
+  const WB_SPAWN_SETUP *pSetup; // may be NULL
+  const sigset_t *pSigMask; // the caller's signal mask, restored by the child just before 'execve'
+  volatile int iErr; // assigned by the child if 'execve' fails (shared memory)
+} WB_CLONE_PARAMS;
+
+static int __WBCloneChild(void *pData)
+{
+WB_CLONE_PARAMS *pParams = (WB_CLONE_PARAMS *)pData;
+int iErr;
 
-  va_start(va, szAppName);
 
-  idRval = WBRunAsyncPipeV(WB_INVALID_FILE_HANDLE, WB_INVALID_FILE_HANDLE,
-                           WB_INVALID_FILE_HANDLE, szAppName, va);
+  // signals are blocked until just before 'execve'
 
-  va_end(va);
+  __WBSpawnChildResetSignals(pParams->pSetup && pParams->pSetup->bCaller ? &(pParams->pSetup->sigIgnore) : NULL);
 
-  if(idRval == WB_INVALID_FILE_HANDLE)
+  if(dup2(pParams->hIn, 0) == -1 || dup2(pParams->hOut, 1) == -1 || dup2(pParams->hErr, 2) == -1)
   {
-    WB_ERROR_PRINT("Unable to run '%s'\n", szAppName);
+    pParams->iErr = errno;
+    _exit(127);
   }
-//  else
-//  {
-//    WB_ERROR_PRINT("Running '%s' - pid=%d\n", szAppName, idRval);
-//  }
 
-  return idRval;
-}
+  // NOTE:  without CLONE_SIGHAND the signal dispositions are a copy, so this does not affect the parent
 
-WB_PROCESS_ID WBRunAsyncPipe(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
-                             const char *szAppName, ...)
-{
-WB_PROCESS_ID idRval;
-va_list va;
+  signal(SIGHUP, SIG_IGN); // ignore 'HUP' signal before 'setsid' call ['daemon()' does this]
+  setsid();
+  signal(SIGHUP, SIG_DFL);
 
-  va_start(va, szAppName);
+  iErr = __WBSpawnChildSetup(pParams->pSetup);
 
-  idRval = WBRunAsyncPipeV(hStdIn, hStdOut, hStdErr, szAppName, va);
+  if(iErr)
+  {
+    pParams->iErr = iErr;
+    _exit(127);
+  }
 
-  va_end(va);
+  __WBSpawnChildCloseFDs(pParams->pSetup, pParams->hExec);
 
-  return idRval;
-}
+  pthread_sigmask(SIG_SETMASK, pParams->pSigMask, NULL);
 
+  __WBSpawnChildExec(pParams->pAppName, pParams->hExec, pParams->argv, pParams->envp);
 
-#define WBRUNRESULT_BUFFER_MINSIZE 65536
-#define WBRUNRESULT_BYTES_TO_READ 256
+  pParams->iErr = errno ? errno : ENOEXEC; // tell the parent why
+  _exit(127);
 
-static char * WBRunResultInternal(WB_FILE_HANDLE hStdIn, WB_INT32 *pExitCode, const char *szAppName, va_list va)
+  return 127; // should never get here
+}
+
+static WB_PROCESS_ID __WBSpawnClone(const char *pAppName, WB_FILE_HANDLE hExec, char * const *argv, char * const *envp,
+                                    WB_FILE_HANDLE hIn, WB_FILE_HANDLE hOut, WB_FILE_HANDLE hErr,
+                                    WB_FILE_HANDLE *phPidFD, const WB_SPAWN_SETUP *pSetup)
 {
-WB_PROCESS_ID idRval;
-#ifdef WIN32
-DWORD cb1;
-#endif // WIN32
-WB_FILE_HANDLE hP[2]; // [0] is read end, [1] is write end
-char *p1, *p2, *pRval;
-int i2, iRunning;
-#ifndef WIN32
-int i1, iStat;
-#endif // WIN32
-/*unsigned*/ int cbBuf;
-
-
-  cbBuf = WBRUNRESULT_BUFFER_MINSIZE;
-  pRval = WBAlloc(cbBuf);
+WB_CLONE_PARAMS xParams;
+sigset_t sigAll, sigOld;
+pid_t pid;
+int iStat, iErr;
+union
+{
+  char cStack[WB_SPAWN_CLONE_STACK_SIZE];
+  long long llAlign; // make sure the stack is properly aligned
+} uStack;
+
+
+  xParams.pAppName = pAppName;
+  xParams.hExec = hExec;
+  xParams.argv = argv;
+  xParams.envp = envp;
+  xParams.hIn = hIn;
+  xParams.hOut = hOut;
+  xParams.hErr = hErr;
+  xParams.pSetup = pSetup;
+  xParams.pSigMask = &sigOld;
+  xParams.iErr = 0;
+
+  sigfillset(&sigAll);
+  pthread_sigmask(SIG_BLOCK, &sigAll, &sigOld); // see __WBSpawnChildResetSignals
+
+  // the stack grows downward on every architecture Linux runs this on (except hppa, which isn't relevant)
+  pid = -1;
+
+#ifdef CLONE_PIDFD
+  if(phPidFD) // the kernel assigns the pidfd atomically, so there's no pid re-use race (Linux 5.2 or later)
+  {
+    pid = clone(__WBCloneChild, uStack.cStack + sizeof(uStack.cStack) - 16,
+                CLONE_VM | CLONE_VFORK | CLONE_PIDFD | SIGCHLD, &xParams, phPidFD);
+  }
 
-  if(!pRval)
+  if(pid < 0 && (!phPidFD || errno == EINVAL)) // no pidfd needed, or CLONE_PIDFD isn't supported
+#endif // CLONE_PIDFD
   {
-    return NULL;
+    pid = clone(__WBCloneChild, uStack.cStack + sizeof(uStack.cStack) - 16,
+                CLONE_VM | CLONE_VFORK | SIGCHLD, &xParams);
   }
 
-  // use WBRunAsyncPipeV to create a process, with all stdout piped to a char * buffer capture
-  // stdin and stderr still piped to/from /dev/null
+  iErr = errno;
+  pthread_sigmask(SIG_SETMASK, &sigOld, NULL);
+  errno = iErr;
 
-  // create an anonymous pipe.  hP[0] is the INPUT pipe, hP[1] is the OUTPUT pipe
-  // this is important in windows.  for POSIX it doesn't really matter which one you use,
-  // but by convention [0] will be input, [1] will be output
+  if(pid < 0)
+  {
+    if(errno == EINVAL)
+    {
+      errno = ENOSYS; // so the caller can tell this apart from an error in the child, and use another method
+    }
 
-  hP[0] = hP[1] = WB_INVALID_FILE_HANDLE;
+    return WB_INVALID_PROCESS_ID;
+  }
 
-#ifdef WIN32 /* the WINDOWS way */
-  if(!CreatePipe(&(hP[0]), &(hP[1]), NULL, 0))
-#else // !WIN32 (everybody else)
-  if(0 > pipe(hP))
-#endif // WIN32
+  if(xParams.iErr) // 'execve' (or the setup) failed, so reap the child and report the error
   {
-    WBFree(pRval);
-//    WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (2)\n", __FUNCTION__);
-    return NULL;
-  }
+    if(phPidFD && *phPidFD != WB_INVALID_FILE_HANDLE)
+    {
+      close(*phPidFD);
+      *phPidFD = WB_INVALID_FILE_HANDLE;
+    }
 
-#ifdef WIN32 /* the WINDOWS way */
-  SetHandleInformation(hP[1], HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
-#endif // WIN32
+    waitpid(pid, &iStat, 0);
+    errno = xParams.iErr;
 
-  idRval = WBRunAsyncPipeV(hStdIn, hP[1], // the 'write' end is passed as stdout
-                           WB_INVALID_FILE_HANDLE, szAppName, va);
+    return WB_INVALID_PROCESS_ID;
+  }
 
-  if(WB_PROCESS_ID_INVALID(idRval))
-  {
-//    WB_ERROR_PRINT("TEMPORARY:  %s failed to run \"%s\" errno=%d\n", __FUNCTION__, szAppName, errno);
+  return pid;
+}
 
-#ifdef WIN32 /* the WINDOWS way */
-    CloseHandle(hP[0]);
-    CloseHandle(hP[1]);
-#else // !WIN32 (everybody else)
-    close(hP[0]);
-    close(hP[1]);
-#endif // WIN32
+#endif // __linux__
 
-    return NULL;
-  }
+// spawn 'pAppName' with stdin/stdout/stderr re-directed to hIn/hOut/hErr using the selected backend.
+// the file handles are NOT closed by this function.  if 'phPidFD' is not NULL, it receives a pidfd
+// for the new process (or WB_INVALID_FILE_HANDLE if pidfds are not supported).  If 'pSetup' is
+// not NULL, the child applies it before calling 'execve'.  If 'hExec' is not WB_INVALID_FILE_HANDLE
+// it's an executable handle's descriptor for 'pAppName', which the child runs with 'execveat'.
 
-#ifndef WIN32
-  close(hP[1]); // by convention, this will 'widow' the read end of the pipe once the process is done with it
-  hP[1] = INVALID_HANDLE_VALUE;
+static WB_PROCESS_ID __WBSpawnProcess(const char *pAppName, WB_FILE_HANDLE hExec, char * const *argv, char * const *envp,
+                                      WB_FILE_HANDLE hIn, WB_FILE_HANDLE hOut, WB_FILE_HANDLE hErr,
+                                      WB_FILE_HANDLE *phPidFD, const WB_SPAWN_SETUP *pSetup)
+{
+WB_PROCESS_ID hRval;
+int iBackend = iSpawnBackend;
 
-  fcntl(hP[0], F_SETFL, O_NONBLOCK); // set non-blocking I/O
-#endif // WIN32
 
-  // so long as the process is alive, read data from the pipe and stuff it into the output buffer
-  // (the buffer will need to be reallocated periodically if it fills up)
+  if(phPidFD)
+  {
+    *phPidFD = WB_INVALID_FILE_HANDLE;
+  }
 
-  p1 = pRval;
-  *p1 = 0;       // always do this
-  iRunning = 1;  // iRunning will be used as a flag to indicate the process exited.
+  if(!pAppName)
+  {
+    errno = ENOENT;
+    return WB_INVALID_PROCESS_ID;
+  }
 
-  while(1)
+  if(iBackend == WB_SPAWN_BACKEND_DEFAULT)
   {
-    i2 = WBRUNRESULT_BYTES_TO_READ; // number of bytes to read at one time
-    if((p1 - pRval) + i2 >= cbBuf) // enough room for it?
-    {
-      i2 = cbBuf - (p1 - pRval);
-      if(i2 < WBRUNRESULT_BYTES_TO_READ / 8) // time to re-allocate
-      {
-        p2 = WBReAlloc(pRval, cbBuf + WBRUNRESULT_BUFFER_MINSIZE / 2);
-        if(!p2)
-        {
-          WBFree(pRval);
-          pRval = NULL;
+#if defined(POSIX_SPAWN_SETSID)
+    iBackend = WB_SPAWN_BACKEND_POSIX_SPAWN;
+#elif defined(__linux__)
+    iBackend = WB_SPAWN_BACKEND_CLONE;
+#else
+    iBackend = WB_SPAWN_BACKEND_VFORK;
+#endif // POSIX_SPAWN_SETSID, __linux__
+  }
 
-//          WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (4)\n", __FUNCTION__);
-          break;
-        }
+  if((pSetup || hExec != WB_INVALID_FILE_HANDLE) && iBackend == WB_SPAWN_BACKEND_POSIX_SPAWN)
+  {
+    // 'posix_spawn' can't run anything in the child (or run a descriptor), so use a backend that can
 
-        cbBuf += WBRUNRESULT_BUFFER_MINSIZE / 2;
-        p1 = p2 + (p1 - pRval);
-        pRval = p2;
-        i2 = WBRUNRESULT_BYTES_TO_READ;
-      }
-    }
+#ifdef __linux__
+    iBackend = WB_SPAWN_BACKEND_CLONE;
+#else // __linux__
+    iBackend = WB_SPAWN_BACKEND_VFORK;
+#endif // __linux__
+  }
 
-    // if no data available I'll return immediately
-#ifdef WIN32 /* the Windows way */
-    cb1 = 0;
+#ifdef POSIX_SPAWN_SETSID
+  if(iBackend == WB_SPAWN_BACKEND_POSIX_SPAWN)
+  {
+    hRval = __WBSpawnPosixSpawn(pAppName, argv, envp, hIn, hOut, hErr);
 
-    if(!PeekNamedPipe(hP[0], NULL, 0, NULL, &cb1, NULL))
+    if(!WB_PROCESS_ID_INVALID(hRval) || (errno != ENOSYS && errno != EINVAL))
     {
-      DWORD dwErr;
-check_pipe_no_data_avail:
+      goto spawn_done;
+    }
 
-      dwErr = GetLastError();
+    // fall through to 'vfork' when it's not supported
+  }
+#endif // POSIX_SPAWN_SETSID
 
-      if(!iRunning)
-      {
-        break; // assume end of file, process ended, bail out now
-      }
+#ifdef __linux__
+  if(iBackend == WB_SPAWN_BACKEND_CLONE)
+  {
+    hRval = __WBSpawnClone(pAppName, hExec, argv, envp, hIn, hOut, hErr, phPidFD, pSetup);
 
-      if(dwErr == ERROR_MORE_DATA || dwErr == ERROR_PIPE_BUSY || dwErr == ERROR_IO_PENDING
-         || dwErr == ERROR_NO_MORE_ITEMS/* EAGAIN */ )
-      {
-        Sleep(10); // wait 1/2 msec
-      }
-      else
-      {
-        break; // an error of some kind, so bail out [pipe closed?]
-      }
-    }
-    else if(!cb1)
-    {
-      if(!iRunning)
-        break; // end of file
-    }
-    else if(!ReadFile(hP[0], p1, i2, &cb1, NULL))
+    if(!WB_PROCESS_ID_INVALID(hRval) || errno != ENOSYS)
     {
-      goto check_pipe_no_data_avail;
-    }
-    else if(!cb1)  // this just might be an error
-    {
-      if(!iRunning)
-        break; // end of file
-    }
-    else
-    {
-      p1 += cb1; // point past the # of bytes I just read in
-      *p1 = 0; // by convention [to make sure the string is ALWAYS terminated with a 0-byte]
+      goto spawn_done;
     }
+  }
+#endif // __linux__
 
-    if(iRunning) // only if "still running"
-    {
-      // for waitpid(), if WNOHANG is specified and there are no stopped, continued or exited children, 0 is returned
+  hRval = __WBSpawnVFork(pAppName, hExec, argv, envp, hIn, hOut, hErr, pSetup);
 
-      if(GetProcessState(idRval, pExitCode) <= 0) // ended or error
-      {
-        iRunning = 0; // my flag that it's not running
-      }
+spawn_done:
 
-      Sleep(10); // so I don't 'spin' and IO completes at end of process
-    }
+  if(phPidFD && *phPidFD == WB_INVALID_FILE_HANDLE && !WB_PROCESS_ID_INVALID(hRval))
+  {
+    // the child has not been reaped yet (I'm its parent) so its pid can't have been re-used
+    // unless SIGCHLD is being ignored.
+
+    *phPidFD = __WBPidfdOpen(hRval);
   }
 
-  // always kill the process at this point (in case there was an error)
+  return hRval;
+}
 
-  Sleep(10); // wait 10 msec - prevents certain problems
 
-  if(hP[1] != INVALID_HANDLE_VALUE)
-    CloseHandle(hP[1]); // done with the pipes - close them now
-  if(hP[0] != INVALID_HANDLE_VALUE)
-    CloseHandle(hP[0]);
 
-#else // !WIN32 - everybody else
+// FORK SERVER - a small helper process that spawns processes on my behalf
+//
+// Every spawn method still has to deal with the parent's page tables, signal state, and so on,
+// and the cost of that grows with the size of the parent.  When WBForkServerStart() is called
+// early (while the process is still small), it forks a helper that does nothing but spawn
+// processes.  Each request is a message on a SOCK_SEQPACKET control socket, which carries the
+// stdin/stdout/stderr handles, the caller's working directory (an O_PATH descriptor for 'fchdir'),
+// and a 'reply' socket via SCM_RIGHTS.  The request also has the caller's umask, signal mask, and
+// ignored signals, so the child starts the same way it would without the fork server.  The argument and environment
+// strings follow on the reply socket, followed by the helper's reply (process ID or errno), and
+// then the child's 'wait' status once the helper has reaped it.  That makes the reply socket work
+// like a pidfd - it becomes readable when the process exits - so the process table keeps it in
+// place of one.
+
+#define WB_FORK_SERVER_MAX_DATA 0x4000000 /* sanity limit for the argument and environment strings */
+
+typedef struct __WB_FORK_SERVER_REQUEST__
+{
+  WB_UINT32 nArgs;        // number of 'argv' strings
+  WB_UINT32 nEnv;         // number of 'envp' strings
+  WB_UINT32 cbData;       // total bytes for the path, 'argv', and 'envp' strings (zero byte terminated)
+  WB_UINT32 bSetup;       // non-zero if 'xSetup' applies
+  WB_UINT32 bCgroup;      // non-zero if a 6th handle (the 'cgroup.procs' file) is attached
+  sigset_t sigMask;       // the caller's signal mask
+  WB_SPAWN_SETUP xSetup;  // resource limits for the child, and the caller's umask and ignored signals ('hCgroupProcs' and 'hCwd' are ignored)
+} WB_FORK_SERVER_REQUEST;
+
+typedef struct __WB_FORK_SERVER_REPLY__
+{
+  WB_INT32 idProcess;     // the process ID, or -1 on error
+  WB_INT32 iStatus;       // 'errno' in the first reply when idProcess is -1, the raw 'wait' status in the second
+  struct rusage xUsage;   // resource usage, in the second reply
+} WB_FORK_SERVER_REPLY;
 
-    i1 = read(hP[0], p1, i2);
+typedef struct __WB_FORK_SERVER_CHILD__
+{
+  pid_t idProcess;
+  WB_FILE_HANDLE hReply;  // where the 'wait' status goes
+} WB_FORK_SERVER_CHILD;
 
-    if(i1 <= 0)
-    {
-      if(!iRunning)
-      {
-        if(i1 == 0)
-        {
-          break; // end of file, process ended, bail out now
-        }
-//        else // this could be caused by the process forking, and the program failing to run
-//        {
-//          // TODO:  allow a few retries, then bail??
-//
-//          break; // for now, bail out on this as well.  should still get "all of it" in the output
-//        }
-      }
+static pthread_mutex_t mtxForkServer = PTHREAD_MUTEX_INITIALIZER;
+static WB_FILE_HANDLE hForkServer = WB_INVALID_FILE_HANDLE; // my end of the control socket
 
-      if(errno == EAGAIN)
-      {
-        WBDelay(500); // wait 1/2 msec
-      }
-      else
-      {
-        break; // an error of some kind, so bail out [pipe closed?]
-      }
+// read or write exactly 'cbData' bytes, retrying on EINTR.  returns zero on success
+
+static int __WBForkServerIO(WB_FILE_HANDLE hSocket, void *pData, size_t cbData, int bWrite)
+{
+char *p1 = (char *)pData;
+ssize_t cb;
+
+
+  while(cbData > 0)
+  {
+    if(bWrite)
+    {
+      cb = send(hSocket, p1, cbData, MSG_NOSIGNAL); // the other end may have closed it
     }
     else
     {
-      p1 += i1; // point past the # of bytes I just read in
-      *p1 = 0; // by convention [to make sure the string is ALWAYS terminated with a 0-byte]
+      cb = read(hSocket, p1, cbData);
     }
 
-    if(iRunning) // only if "still running"
+    if(cb < 0 && errno == EINTR)
     {
-      // for waitpid(), if WNOHANG is specified and there are no stopped, continued or exited children, 0 is returned
-
-      if(waitpid(idRval, &iStat, WNOHANG) && // note this might return non-zero for stopped or continued processes
-         WIFEXITED(iStat))                   // so test if process exits also.
-      {
-        iRunning = 0; // my flag that it's not running
-        WBDelay(5000); // wait for a bit to make sure the I/O completes
-      }
-      else
+      continue;
+    }
+    else if(cb <= 0)
+    {
+      if(!cb)
       {
-        WBDelay(500); // so I don't 'spin'
+        errno = EPIPE; // premature EOF
       }
+
+      return -1;
     }
+
+    p1 += cb;
+    cbData -= cb;
   }
 
-  // always kill the process at this point (in case there was an error)
+  return 0;
+}
 
-  kill(idRval, SIGKILL); // not so nice way but oh well
-  WBDelay(5000); // wait 5msec
+// read the child's 'wait' status from its reply socket.  returns 1 if it has exited (and assigns
+// *piStatus and *pUsage), 0 if still running (only when 'bBlock' is zero), or -1 if the fork server went away
 
-  close(hP[0]); // done with the pipe - close it now
+static int __WBForkServerStatus(WB_FILE_HANDLE hReply, int *piStatus, struct rusage *pUsage, int bBlock)
+{
+WB_FORK_SERVER_REPLY xReply;
+struct pollfd xPoll;
 
-#endif // WIN32
 
-//  WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (4) pRval=%p *pRval=%c\n", __FUNCTION__, pRval, (char)(pRval ? *pRval : 0));
+  if(!bBlock)
+  {
+    xPoll.fd = hReply;
+    xPoll.events = POLLIN;
+    xPoll.revents = 0;
 
-  return pRval;
+    if(poll(&xPoll, 1, 0) <= 0)
+    {
+      return 0;
+    }
+  }
+
+  if(__WBForkServerIO(hReply, &xReply, sizeof(xReply), 0))
+  {
+    errno = ECHILD; // the status is lost
+    return -1;
+  }
+
+  *piStatus = xReply.iStatus;
+  *pUsage = xReply.xUsage;
+
+  return 1;
 }
 
-int WBGetProcessState(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode)
+static void __WBForkServerSigChld(int iSig)
 {
-#ifdef WIN32
-  int iRval = -1;
-  HANDLE hProcess = idProcess.hProcess; //OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, idProcess);
-  DWORD dwWait, dwTemp = -1;
+  (void)iSig; // nothing to do - this only interrupts 'ppoll()' in the server loop
+}
 
-  if(pExitCode)
-    *pExitCode = -1;;
+// handle one request from the control socket.  returns -1 when the control socket has been closed
 
-  if(hProcess == INVALID_HANDLE_VALUE)
+static int __WBForkServerRequest(WB_FILE_HANDLE hCtl, WB_FORK_SERVER_CHILD **ppChildren,
+                                 int *pnChildren, int *pnMax)
+{
+WB_FORK_SERVER_REQUEST xReq;
+WB_FORK_SERVER_REPLY xReply;
+struct msghdr msg;
+struct iovec iov;
+struct cmsghdr *pCmsg;
+union
+{
+  struct cmsghdr cmsg;
+  char cBuf[CMSG_SPACE(6 * sizeof(int))];
+} uCtl;
+WB_FILE_HANDLE ahFD[6];
+char *pData, *pEnd, *p1, **ppArgv;
+sigset_t sigTemp;
+ssize_t cb;
+WB_UINT32 ui1;
+int i1, nFD;
+
+
+  memset(&msg, 0, sizeof(msg));
+
+  iov.iov_base = &xReq;
+  iov.iov_len = sizeof(xReq);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = uCtl.cBuf;
+  msg.msg_controllen = sizeof(uCtl.cBuf);
+
+  do
   {
-    if(idProcess.uiProcessID != 0) // for now this indicates valid.  process 0 is inaccessible
-      return idProcess.iCachedExitCode; // return cached value
+    cb = recvmsg(hCtl, &msg, MSG_CMSG_CLOEXEC);
+  } while(cb < 0 && errno == EINTR);
 
-    return -1;
+  if(cb <= 0)
+  {
+    return -1; // EOF (or an error I can't recover from)
   }
 
-  dwWait = WaitForMultipleObjects(1, &hProcess, FALSE, 10);
+  nFD = 0;
 
-  if(dwWait == WAIT_TIMEOUT)
-  {
-    iRval = 1; // still running
-  }
-  else if(dwWait == WAIT_OBJECT_0) // process has stopped
-  {
-    iRval = 0;
-  }
-  else // if(dwWait == WAIT_ABANDONED_0)
+  for(pCmsg = CMSG_FIRSTHDR(&msg); pCmsg; pCmsg = CMSG_NXTHDR(&msg, pCmsg))
   {
-    iRval = -1;  // like 'quit' baby, quit!
+    if(pCmsg->cmsg_level == SOL_SOCKET && pCmsg->cmsg_type == SCM_RIGHTS)
+    {
+      nFD = (pCmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+      if(nFD > 6)
+      {
+        nFD = 6; // should never happen
+      }
+
+      memcpy(ahFD, CMSG_DATA(pCmsg), nFD * sizeof(int));
+    }
   }
 
-  if(!iRval)
+  if(cb != sizeof(xReq) || nFD != (xReq.bCgroup ? 6 : 5) || (msg.msg_flags & MSG_CTRUNC) ||
+     xReq.cbData > WB_FORK_SERVER_MAX_DATA || xReq.nArgs + xReq.nEnv > xReq.cbData ||
+     xReq.xSetup.nLimits < 0 || xReq.xSetup.nLimits > WB_RUN_MAX_LIMITS ||
+     (xReq.bSetup && xReq.xSetup.nKeepFDs)) // the fork server is never used with 'keep' descriptors
   {
-    if(GetExitCodeProcess(hProcess, &dwTemp))
-    {
-      if(pExitCode)
-        *pExitCode = dwTemp;
-      idProcess.iCachedExitCode = dwTemp;
-    }
-    else
+    for(i1=0; i1 < nFD; i1++)
     {
-      iRval = -1; // oops
+      close(ahFD[i1]);
     }
 
-    CloseHandle(idProcess.hProcess); // clean up
-    idProcess.hProcess = INVALID_HANDLE_VALUE; //  because I closed it
+    return 0; // ignore garbage
   }
 
-//  CloseHandle(hProcess);
-  return iRval;
-
-#else // WIN32
-  int iStat, iRval;
-
-  // for waitpid(), if WNOHANG is specified and there are no stopped, continued or exited children, 0 is returned
+  memset(&xReply, 0, sizeof(xReply));
+  xReply.idProcess = -1;
+  xReply.iStatus = ENOMEM;
 
-  iStat = 0;
-  iRval = waitpid(idProcess, &iStat, WNOHANG); // note this might return non-zero for stopped or continued processes
+  pData = (char *)WBAlloc(xReq.cbData + 1);
+  ppArgv = (char **)WBAlloc(sizeof(char *) * (xReq.nArgs + xReq.nEnv + 2));
 
-  if(iRval > 0 && (iRval == (int)idProcess || (int)idProcess == -1 || (int)idProcess == 0))
+  if(pData && ppArgv)
   {
-    if(WIFEXITED(iStat))                   // test if process exits also.
+    xReply.iStatus = EINVAL;
+
+    if(!__WBForkServerIO(ahFD[0], pData, xReq.cbData, 0))
     {
-      if(pExitCode)
+      pData[xReq.cbData] = 0; // so the last string is always terminated
+      pEnd = pData + xReq.cbData;
+
+      // path, then 'argv' (NULL terminated), then 'envp' (NULL terminated)
+
+      p1 = pData + strlen(pData) + 1;
+
+      for(ui1=0; ui1 < xReq.nArgs + xReq.nEnv && p1 < pEnd; ui1++)
       {
-        *pExitCode = (WB_INT32)WEXITSTATUS(iStat);
+        ppArgv[ui1 < xReq.nArgs ? ui1 : ui1 + 1] = p1;
+        p1 += strlen(p1) + 1;
       }
 
-      return 0; // not running
+      if(ui1 == xReq.nArgs + xReq.nEnv)
+      {
+        ppArgv[xReq.nArgs] = NULL;
+        ppArgv[xReq.nArgs + xReq.nEnv + 1] = NULL;
+
+        // the child gets the caller's signal mask, not mine (which has SIGCHLD blocked)
+
+        pthread_sigmask(SIG_SETMASK, &(xReq.sigMask), &sigTemp);
+
+        if(!xReq.bSetup)
+        {
+          xReq.xSetup.nLimits = 0;
+          xReq.xSetup.nKeepFDs = 0;
+        }
+
+        xReq.xSetup.hCgroupProcs = xReq.bCgroup ? ahFD[5] : WB_INVALID_FILE_HANDLE;
+        xReq.xSetup.bCaller = 1;
+        xReq.xSetup.hCwd = ahFD[4];
+
+        xReply.idProcess = __WBSpawnProcess(pData, WB_INVALID_FILE_HANDLE, ppArgv, ppArgv + xReq.nArgs + 1,
+                                            ahFD[1], ahFD[2], ahFD[3], NULL, &(xReq.xSetup));
+        xReply.iStatus = errno;
+
+        pthread_sigmask(SIG_SETMASK, &sigTemp, NULL);
+
+        if(WB_PROCESS_ID_INVALID(xReply.idProcess))
+        {
+          xReply.idProcess = -1;
+        }
+        else
+        {
+          xReply.iStatus = 0;
+        }
+      }
     }
+  }
 
-    return 1; // still running
+  if(pData)
+  {
+    WBFree(pData);
   }
 
-  if(iRval > 0)
+  if(ppArgv)
   {
-    WB_ERROR_PRINT("ERROR:  %s - waitpid returns %d, but does not match %d\n",
-                   __FUNCTION__, iRval, (int)idProcess);
+    WBFree(ppArgv);
   }
 
-  return -1; // error
-#endif // WIN32
-}
+  close(ahFD[1]); // the child has its own copies now
+  close(ahFD[2]);
+  close(ahFD[3]);
+  close(ahFD[4]);
 
-char *WBRunResult(const char *szAppName, ...)
-{
-char *pRval;
-va_list va;
+  if(xReq.bCgroup)
+  {
+    close(ahFD[5]);
+  }
 
+  __WBForkServerIO(ahFD[0], &xReply, sizeof(xReply), 1); // if this fails, the status is still reaped
 
-  va_start(va, szAppName);
+  if(xReply.idProcess <= 0)
+  {
+    close(ahFD[0]);
+    return 0;
+  }
 
-  pRval = WBRunResultInternal(WB_INVALID_FILE_HANDLE, NULL, szAppName, va);
+  if(*pnChildren >= *pnMax)
+  {
+    WB_FORK_SERVER_CHILD *pNew;
 
-  va_end(va);
+    pNew = (WB_FORK_SERVER_CHILD *)WBReAlloc(*ppChildren, sizeof(**ppChildren) * (*pnMax + 64));
 
-  return pRval;
+    if(!pNew)
+    {
+      close(ahFD[0]); // the caller will see EOF instead of a status
+      return 0;
+    }
+
+    *ppChildren = pNew;
+    *pnMax += 64;
+  }
+
+  (*ppChildren)[*pnChildren].idProcess = xReply.idProcess;
+  (*ppChildren)[*pnChildren].hReply = ahFD[0];
+  (*pnChildren)++;
+
+  return 0;
 }
 
-char *WBRunResult2(const char *szAppName, ...)
+// the fork server's main loop.  It runs until the control socket is closed and all of the
+// processes it started have been reaped.  SIGCHLD is blocked except while waiting in 'ppoll()'
+// so that a child exiting can never be missed.
+
+static void __WBForkServerMain(WB_FILE_HANDLE hCtl)
 {
-char *pRval;
-int32_t nExitCode;
-va_list va;
+WB_FORK_SERVER_CHILD *pChildren = NULL;
+WB_FORK_SERVER_REPLY xReply;
+struct sigaction sa;
+struct pollfd xPoll;
+sigset_t sigChld, sigOrig, sigWait;
+int i1, iStat, nChildren = 0, nMax = 0, bEOF = 0;
+long lMax;
+pid_t pid;
 
 
-  va_start(va, szAppName);
+  setsid(); // keep terminal signals (like ^C) meant for the caller away from me
 
-  pRval = WBRunResultInternal(INVALID_HANDLE_VALUE, &nExitCode, szAppName, va);
+  // close everything I inherited except the control socket and stdin/stdout/stderr, so
+  // that it can't leak into the processes I start
 
-  if(pRval && nExitCode)
-  {
-//    fprintf(stderr, "%s - %s ended with error code %d\n", __FUNCTION__, szAppName, nExitCode);
-//    fflush(stderr);
+  lMax = sysconf(_SC_OPEN_MAX);
 
-    free(pRval);
-    pRval = NULL;
+  if(lMax <= 0 || lMax > 65536)
+  {
+    lMax = 65536;
   }
 
-  va_end(va);
-
-  return pRval;
-}
+  for(i1=3; i1 < lMax; i1++)
+  {
+    if(i1 != hCtl)
+    {
+      close(i1);
+    }
+  }
 
-#ifdef WIN32
-struct __RunResult3_worker_thread_params
-{
-  volatile HANDLE hStdin[2];  // pipe for STDIN
-  const void * pStdin;
-  int cbStdin;
-  volatile HANDLE hThread;
-  volatile unsigned int dwThreadID;
-  volatile int bStateFlag; // 0 = not running, 1 = running, -1 force stop
-};
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = __WBForkServerSigChld; // SIGCHLD might be set to 'SIG_IGN', which would prevent 'waitpid'
+  sa.sa_flags = SA_NOCLDSTOP;
+  sigemptyset(&sa.sa_mask);
 
-static unsigned int __stdcall __RunResult3_worker_thread(void *pData)
-{
-int i2;
-const BYTE *p1;
-DWORD cb1, cbData;
-HANDLE hTemp;
-struct __RunResult3_worker_thread_params *pParams = (struct __RunResult3_worker_thread_params *)pData;
+  sigemptyset(&sigChld);
+  sigaddset(&sigChld, SIGCHLD);
 
-  // so long as the process is alive, write data to the pipe
-#define RUNRESULT3_BUFFER_LENGTH 256
-  pParams->bStateFlag = 1; // indicates I'm running
+  pthread_sigmask(SIG_BLOCK, &sigChld, &sigOrig);
+  sigaction(SIGCHLD, &sa, NULL);
 
-  p1 = (const BYTE *)pParams->pStdin;
-  cbData = pParams->cbStdin;
+  sigWait = sigOrig;
+  sigdelset(&sigWait, SIGCHLD);
 
-  while(cbData && pParams->dwThreadID)
+  while(1)
   {
-    cb1 = 0;
-     // if buffer empty, fill it
-#if 0
-    if(!PeekNamedPipe(pParams->hStdin[0], NULL, 0, NULL, &cb1, NULL))
+    while((pid = wait4(-1, &iStat, WNOHANG, &(xReply.xUsage))) > 0)
     {
-      goto check_pipe_io_error;
+      for(i1=0; i1 < nChildren; i1++)
+      {
+        if(pChildren[i1].idProcess == pid)
+        {
+          xReply.idProcess = pid;
+          xReply.iStatus = iStat;
+
+          __WBForkServerIO(pChildren[i1].hReply, &xReply, sizeof(xReply), 1);
+          close(pChildren[i1].hReply);
+
+          pChildren[i1] = pChildren[--nChildren]; // order doesn't matter
+          break;
+        }
+      }
     }
-    else if(cb1 > RUNRESULT3_BUFFER_LENGTH / 2)
+
+    if(bEOF && !nChildren)
     {
-      Sleep(20);
+      break;
     }
-    else
-#endif // 0
-    {
-      i2 = RUNRESULT3_BUFFER_LENGTH - cb1; // available write space
-      if(i2 > (int)cbData)
-        i2 = cbData;
 
-      if(!WriteFile(pParams->hStdin[1], p1, i2, &cb1, NULL))
-      {
-        DWORD dwErr;
-check_pipe_io_error:
+    xPoll.fd = hCtl;
+    xPoll.events = POLLIN;
+    xPoll.revents = 0;
 
-        dwErr = GetLastError();
+    if(ppoll(&xPoll, bEOF ? 0 : 1, NULL, &sigWait) <= 0)
+    {
+      continue; // EINTR, most likely from SIGCHLD
+    }
 
-        if(dwErr == ERROR_MORE_DATA || dwErr == ERROR_PIPE_BUSY || dwErr == ERROR_IO_PENDING
-           || dwErr == ERROR_NO_MORE_ITEMS/* EAGAIN */ )
-        {
-          Sleep(10); // wait 1/2 msec
-        }
-        else
-        {
-          break; // an error of some kind, so bail out [pipe closed?]
-        }
-      }
-      else if(!cb1)  // this just might be an error
-      {
-        // TODO: anything?
-        Sleep(50);
-      }
-      else
+    if(xPoll.revents & POLLIN)
+    {
+      if(__WBForkServerRequest(hCtl, &pChildren, &nChildren, &nMax) < 0)
       {
-        p1 += cb1; // point past the # of bytes I just read in
-        cbData -= cb1;
+        bEOF = 1;
       }
     }
+    else if(xPoll.revents)
+    {
+      bEOF = 1; // POLLHUP or POLLERR
+    }
   }
 
-  Sleep(10); // wait 10 msec
+  _exit(0);
+}
 
-  // close my end of the pipe
-  hTemp = pParams->hStdin[1];
-  pParams->hStdin[1] = INVALID_HANDLE_VALUE;
-  CloseHandle(hTemp);
+// the caller's umask and ignored signals, from /proc/self/status (Linux 4.7 or later for 'Umask').  Reading
+// the umask with 'umask()' means changing it for a moment, which would affect other threads.  Returns
+// zero on success; otherwise the fork server can't reproduce the caller's state, so it isn't used.
 
-  hTemp = pParams->hStdin[0];
-  pParams->hStdin[0] = INVALID_HANDLE_VALUE;
-  CloseHandle(hTemp);
+static int __WBForkServerCallerState(WB_FORK_SERVER_REQUEST *pReq)
+{
+char tbuf[4096], *p1;
+unsigned long long ullIgnore;
+unsigned int uiUmask;
+ssize_t cb;
+int hFile, iSig, bUmask = 0, bIgnore = 0;
+
+
+  pthread_sigmask(SIG_BLOCK, NULL, &(pReq->sigMask)); // this thread's signal mask
+
+  hFile = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+
+  if(hFile < 0)
+  {
+    return -1;
+  }
+
+  do
+  {
+    cb = read(hFile, tbuf, sizeof(tbuf) - 1);
+  } while(cb < 0 && errno == EINTR);
+
+  close(hFile);
+
+  if(cb <= 0)
+  {
+    return -1;
+  }
+
+  tbuf[cb] = 0;
+
+  for(p1=tbuf; p1 && *p1; p1 = strchr(p1, '\n'), p1 = p1 ? p1 + 1 : NULL)
+  {
+    if(!strncmp(p1, "Umask:", 6))
+    {
+      bUmask = sscanf(p1 + 6, "%o", &uiUmask) == 1;
+    }
+    else if(!strncmp(p1, "SigIgn:", 7))
+    {
+      bIgnore = sscanf(p1 + 7, "%llx", &ullIgnore) == 1;
+    }
+  }
+
+  if(!bUmask || !bIgnore)
+  {
+    return -1;
+  }
+
+  pReq->xSetup.uiUmask = (mode_t)uiUmask;
+
+  sigemptyset(&(pReq->xSetup.sigIgnore));
+
+  for(iSig=1; iSig <= 64 && iSig < NSIG; iSig++) // bit 0 is signal 1
+  {
+    if(ullIgnore & (1ULL << (iSig - 1)))
+    {
+      sigaddset(&(pReq->xSetup.sigIgnore), iSig);
+    }
+  }
 
-  // mark as 'exited'
-  pParams->bStateFlag = -1; // indicates I'm ending
-  _endthreadex(0);
   return 0;
 }
-#endif // WIN32
 
+// send a spawn request to the fork server.  On success, *phReply is the reply socket, which
+// becomes readable when the process exits.  If the fork server is not running (or has gone away)
+// errno is ENOSYS, and the caller should spawn the process itself.
 
-char *RunResult3(const void *pStdin, int cbStdin, const char *szAppName, ...) // windows-specific
+static WB_PROCESS_ID __WBForkServerSpawn(const char *pAppName, char * const *argv, char * const *envp,
+                                         WB_FILE_HANDLE hIn, WB_FILE_HANDLE hOut, WB_FILE_HANDLE hErr,
+                                         WB_FILE_HANDLE *phReply, const WB_SPAWN_SETUP *pSetup)
 {
-#ifdef WIN32
-char *pRval;
-INT32 nExitCode;
-va_list va;
-struct __RunResult3_worker_thread_params xParams = {{INVALID_HANDLE_VALUE,INVALID_HANDLE_VALUE},
-                                                    NULL, 0, INVALID_HANDLE_VALUE, 0, 0 };
+WB_FORK_SERVER_REQUEST xReq;
+WB_FORK_SERVER_REPLY xReply;
+struct msghdr msg;
+struct iovec iov;
+struct cmsghdr *pCmsg;
+union
+{
+  struct cmsghdr cmsg;
+  char cBuf[CMSG_SPACE(6 * sizeof(int))];
+} uCtl;
+WB_FILE_HANDLE hS[2], ahFD[6], hCwd;
+char *pData, *p1;
+size_t cbData, cb1;
+ssize_t cb;
+int i1;
 
 
-  va_start(va, szAppName);
+  *phReply = WB_INVALID_FILE_HANDLE;
 
-  // create a pipe and worker thread for stdin using pStdin and cbStdin
+  if(hForkServer == WB_INVALID_FILE_HANDLE) // quick check without the lock
+  {
+    errno = ENOSYS;
+    return WB_INVALID_PROCESS_ID;
+  }
 
-  if(!CreatePipe((HANDLE *)&(xParams.hStdin[0]), (HANDLE *)&(xParams.hStdin[1]), NULL, 0))
+  // serialize the path, 'argv', and 'envp'
+
+  memset(&xReq, 0, sizeof(xReq));
+  cbData = strlen(pAppName) + 1;
+
+  for(i1=0; argv[i1]; i1++)
   {
-//    WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (2)\n", __FUNCTION__);
-    return NULL;
+    cbData += strlen(argv[i1]) + 1;
+    xReq.nArgs++;
   }
 
-  SetHandleInformation(xParams.hStdin[0], HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+  for(i1=0; envp && envp[i1]; i1++)
+  {
+    cbData += strlen(envp[i1]) + 1;
+    xReq.nEnv++;
+  }
 
-  // start worker thread
-  xParams.hThread = (HANDLE)_beginthreadex(NULL, 65536, __RunResult3_worker_thread,
-                                           &xParams, 0,//CREATE_SUSPENDED,
-                                           (unsigned int *)&xParams.dwThreadID);
+  if(cbData > WB_FORK_SERVER_MAX_DATA)
+  {
+    errno = ENOSYS; // let the caller do it
+    return WB_INVALID_PROCESS_ID;
+  }
 
-  if(xParams.hThread == WB_INVALID_HANDLE_VALUE)
+  xReq.cbData = (WB_UINT32)cbData;
+
+  pData = (char *)WBAlloc(cbData);
+
+  if(!pData)
   {
-//    WB_ERROR_PRINT("* ERROR * - unable to create thread, %d (%x) (a)\n",
-//                   GetLastError(), GetLastError());
-    goto error_exit;
+    errno = ENOMEM;
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  p1 = pData;
+
+  cb1 = strlen(pAppName) + 1;
+  memcpy(p1, pAppName, cb1);
+  p1 += cb1;
+
+  for(i1=0; argv[i1]; i1++)
+  {
+    cb1 = strlen(argv[i1]) + 1;
+    memcpy(p1, argv[i1], cb1);
+    p1 += cb1;
+  }
+
+  for(i1=0; envp && envp[i1]; i1++)
+  {
+    cb1 = strlen(envp[i1]) + 1;
+    memcpy(p1, envp[i1], cb1);
+    p1 += cb1;
+  }
+
+  if(pSetup)
+  {
+    xReq.bSetup = 1;
+    xReq.xSetup = *pSetup;
+  }
+
+  // the child must start in my working directory, with my umask and signal state, not the fork server's
+
+  hCwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+  if(hCwd < 0 || __WBForkServerCallerState(&xReq))
+  {
+    if(hCwd >= 0)
+    {
+      close(hCwd);
+    }
+
+    WBFree(pData);
+
+    errno = ENOSYS; // let the caller do it
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, hS))
+  {
+    close(hCwd);
+    WBFree(pData);
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  ahFD[0] = hS[1];
+  ahFD[1] = hIn;
+  ahFD[2] = hOut;
+  ahFD[3] = hErr;
+  ahFD[4] = hCwd;
+  ahFD[5] = WB_INVALID_FILE_HANDLE;
+
+  if(pSetup && pSetup->hCgroupProcs != WB_INVALID_FILE_HANDLE)
+  {
+    xReq.bCgroup = 1;
+    ahFD[5] = pSetup->hCgroupProcs;
   }
 
-  xParams.pStdin = pStdin;
-  xParams.cbStdin = cbStdin;
+  memset(&msg, 0, sizeof(msg));
+  memset(&uCtl, 0, sizeof(uCtl));
+
+  iov.iov_base = &xReq;
+  iov.iov_len = sizeof(xReq);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = uCtl.cBuf;
+  msg.msg_controllen = sizeof(uCtl.cBuf);
+
+  pCmsg = CMSG_FIRSTHDR(&msg);
+  pCmsg->cmsg_level = SOL_SOCKET;
+  pCmsg->cmsg_type = SCM_RIGHTS;
+  pCmsg->cmsg_len = CMSG_LEN((xReq.bCgroup ? 6 : 5) * sizeof(int));
+  memcpy(CMSG_DATA(pCmsg), ahFD, (xReq.bCgroup ? 6 : 5) * sizeof(int));
+
+  msg.msg_controllen = CMSG_SPACE((xReq.bCgroup ? 6 : 5) * sizeof(int));
+
+  pthread_mutex_lock(&mtxForkServer);
+
+  if(hForkServer == WB_INVALID_FILE_HANDLE)
+  {
+    cb = -1;
+  }
+  else
+  {
+    do
+    {
+      cb = sendmsg(hForkServer, &msg, MSG_NOSIGNAL);
+    } while(cb < 0 && errno == EINTR);
+
+    if(cb < 0) // the fork server has gone away, so stop using it
+    {
+      WB_ERROR_PRINT("ERROR:  %s - fork server is not responding, errno=%d\n", __FUNCTION__, errno);
+
+      close(hForkServer);
+      hForkServer = WB_INVALID_FILE_HANDLE;
+    }
+  }
+
+  pthread_mutex_unlock(&mtxForkServer);
+
+  close(hS[1]); // the fork server has its own copy (if the message was sent)
+  close(hCwd);
+
+  if(cb < 0 ||
+     __WBForkServerIO(hS[0], pData, cbData, 1) ||
+     __WBForkServerIO(hS[0], &xReply, sizeof(xReply), 0))
+  {
+    WBFree(pData);
+    close(hS[0]);
+
+    errno = ENOSYS;
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  WBFree(pData);
+
+  if(xReply.idProcess <= 0)
+  {
+    close(hS[0]);
+
+    errno = xReply.iStatus;
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  *phReply = hS[0];
+
+  return (WB_PROCESS_ID)xReply.idProcess;
+}
+
+int WBForkServerStart(void)
+{
+WB_FILE_HANDLE hS[2];
+pid_t pid;
+int iStat;
+
+
+  pthread_mutex_lock(&mtxForkServer);
+
+  if(hForkServer != WB_INVALID_FILE_HANDLE)
+  {
+    pthread_mutex_unlock(&mtxForkServer);
+    return 0; // already running
+  }
+
+  if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, hS))
+  {
+    pthread_mutex_unlock(&mtxForkServer);
+    return -1;
+  }
+
+  pid = fork();
+
+  if(!pid)
+  {
+    // fork again, so that the server is re-parented to 'init' and never becomes my zombie.
+    // If this fork fails, the control socket is closed when I exit, and the first request
+    // will find that out.
+
+    close(hS[0]);
+
+    if(!fork())
+    {
+      __WBForkServerMain(hS[1]); // does not return
+    }
+
+    _exit(0);
+  }
+
+  close(hS[1]);
+
+  if(pid < 0)
+  {
+    close(hS[0]);
+
+    pthread_mutex_unlock(&mtxForkServer);
+    return -1;
+  }
+
+  while(waitpid(pid, &iStat, 0) < 0 && errno == EINTR)
+  {
+    // ECHILD if SIGCHLD is being ignored, which is fine
+  }
+
+  hForkServer = hS[0];
+
+  pthread_mutex_unlock(&mtxForkServer);
+
+  return 0;
+}
+
+void WBForkServerStop(void)
+{
+  pthread_mutex_lock(&mtxForkServer);
+
+  if(hForkServer != WB_INVALID_FILE_HANDLE)
+  {
+    close(hForkServer); // it exits once the processes it started have been reaped
+    hForkServer = WB_INVALID_FILE_HANDLE;
+  }
+
+  pthread_mutex_unlock(&mtxForkServer);
+}
+
+
+// PROCESS ACCOUNTING - resource usage totals for each program name
+//
+// When enabled with WBProcessStatsEnable(), each process that is started gets a small 'pending'
+// entry (keyed by the process ID) that points to the totals for its program name.  When the
+// process is reaped (by anything in this library) its 'wait4' resource usage is added to those
+// totals, and the pending entry goes back on a free list.  The per-program records are never
+// freed, so a pending entry can safely point to one, and nothing is allocated in the steady state.
+
+#define WB_PROCESS_STATS_TABLE_SIZE 64 /* program names, must be a power of 2 */
+#define WB_PROCESS_PENDING_TABLE_SIZE 256 /* processes, must be a power of 2 */
+
+typedef struct __WB_PROCESS_STATS_RECORD__
+{
+  struct __WB_PROCESS_STATS_RECORD__ *pNext;
+  WB_PROCESS_STATS xStats;
+  char szName[1];             // the program name (allocated with the structure)
+} WB_PROCESS_STATS_RECORD;
+
+typedef struct __WB_PROCESS_PENDING__
+{
+  struct __WB_PROCESS_PENDING__ *pNext;
+  WB_PROCESS_ID idProcess;
+  WB_PROCESS_STATS_RECORD *pRecord;
+  WB_UINT64 ullStartTime;     // __WBMonotonicTime() when it was started
+} WB_PROCESS_PENDING;
+
+static pthread_mutex_t mtxProcessStats = PTHREAD_MUTEX_INITIALIZER;
+static WB_PROCESS_STATS_RECORD *apProcessStats[WB_PROCESS_STATS_TABLE_SIZE];
+static WB_PROCESS_PENDING *apProcessPending[WB_PROCESS_PENDING_TABLE_SIZE];
+static WB_PROCESS_PENDING *pProcessPendingFree = NULL;
+static volatile int bProcessStats = 0;
+
+#define WB_PROCESS_PENDING_HASH(X) (((unsigned int)(X) ^ ((unsigned int)(X) >> 8)) & (WB_PROCESS_PENDING_TABLE_SIZE - 1))
+
+static void __WBRunUsageFromRusage(WB_RUN_USAGE *pUsage, const struct rusage *pRU)
+{
+  pUsage->ullUserTime = (WB_UINT64)pRU->ru_utime.tv_sec * 1000000 + pRU->ru_utime.tv_usec;
+  pUsage->ullSystemTime = (WB_UINT64)pRU->ru_stime.tv_sec * 1000000 + pRU->ru_stime.tv_usec;
+  pUsage->ullMaxRSS = (WB_UINT64)pRU->ru_maxrss; // kilobytes on Linux and the BSDs
+  pUsage->ullMinorFaults = (WB_UINT64)pRU->ru_minflt;
+  pUsage->ullMajorFaults = (WB_UINT64)pRU->ru_majflt;
+  pUsage->ullInBlocks = (WB_UINT64)pRU->ru_inblock;
+  pUsage->ullOutBlocks = (WB_UINT64)pRU->ru_oublock;
+  pUsage->ullVolCtxSwitches = (WB_UINT64)pRU->ru_nvcsw;
+  pUsage->ullInvolCtxSwitches = (WB_UINT64)pRU->ru_nivcsw;
+}
+
+// the program name is the last element of the path, so '/usr/bin/cc' and 'cc' are the same program
+
+static const char * __WBProcessStatsName(const char *szPath)
+{
+const char *p1 = strrchr(szPath, '/');
+
+  return p1 ? p1 + 1 : szPath;
+}
+
+// NOTE:  'mtxProcessStats' must be locked by the caller
+
+static WB_PROCESS_STATS_RECORD * __WBProcessStatsRecord(const char *szName, int bCreate)
+{
+WB_PROCESS_STATS_RECORD *pR;
+unsigned int uiHash = __WBPathCacheHash(szName) & (WB_PROCESS_STATS_TABLE_SIZE - 1);
+
+
+  for(pR = apProcessStats[uiHash]; pR; pR = pR->pNext)
+  {
+    if(!strcmp(pR->szName, szName))
+    {
+      return pR;
+    }
+  }
+
+  if(!bCreate)
+  {
+    return NULL;
+  }
+
+  pR = (WB_PROCESS_STATS_RECORD *)WBAlloc(sizeof(*pR) + strlen(szName));
+
+  if(pR)
+  {
+    memset(&(pR->xStats), 0, sizeof(pR->xStats));
+    strcpy(pR->szName, szName);
+
+    pR->pNext = apProcessStats[uiHash];
+    apProcessStats[uiHash] = pR;
+  }
+
+  return pR;
+}
+
+// a process was started.  If a stale entry with the same process ID is still pending (it was
+// reaped by something else, like 'waitpid'), it's re-used without counting it
+
+static void __WBProcessStatsStart(WB_PROCESS_ID idProcess, const char *szPath)
+{
+WB_PROCESS_PENDING *pP;
+WB_PROCESS_STATS_RECORD *pR;
+unsigned int uiHash = WB_PROCESS_PENDING_HASH(idProcess);
+
+
+  pthread_mutex_lock(&mtxProcessStats);
+
+  pR = __WBProcessStatsRecord(__WBProcessStatsName(szPath), 1);
+
+  if(pR)
+  {
+    pR->xStats.ullStarted++;
+
+    for(pP = apProcessPending[uiHash]; pP; pP = pP->pNext)
+    {
+      if(pP->idProcess == idProcess)
+      {
+        break;
+      }
+    }
+
+    if(!pP)
+    {
+      pP = pProcessPendingFree;
+
+      if(pP)
+      {
+        pProcessPendingFree = pP->pNext;
+      }
+      else
+      {
+        pP = (WB_PROCESS_PENDING *)WBAlloc(sizeof(*pP));
+      }
+
+      if(pP)
+      {
+        pP->idProcess = idProcess;
+        pP->pNext = apProcessPending[uiHash];
+        apProcessPending[uiHash] = pP;
+      }
+    }
+
+    if(pP)
+    {
+      pP->pRecord = pR;
+      pP->ullStartTime = __WBMonotonicTime();
+    }
+  }
+
+  pthread_mutex_unlock(&mtxProcessStats);
+}
+
+// a process was reaped - add its resource usage to the totals for its program
+
+static void __WBProcessStatsEnd(WB_PROCESS_ID idProcess, int iStatus, const struct rusage *pUsage)
+{
+WB_PROCESS_PENDING *pP, **ppP;
+WB_PROCESS_STATS *pS;
+WB_RUN_USAGE xUsage;
+WB_UINT64 ullNow;
+
+
+  if(!bProcessStats && !apProcessPending[WB_PROCESS_PENDING_HASH(idProcess)]) // quick check without the lock
+  {
+    return;
+  }
+
+  ullNow = __WBMonotonicTime();
+
+  __WBRunUsageFromRusage(&xUsage, pUsage);
+
+  pthread_mutex_lock(&mtxProcessStats);
+
+  for(ppP = &(apProcessPending[WB_PROCESS_PENDING_HASH(idProcess)]); *ppP; ppP = &((*ppP)->pNext))
+  {
+    if((*ppP)->idProcess == idProcess)
+    {
+      break;
+    }
+  }
+
+  pP = *ppP;
+
+  if(pP)
+  {
+    *ppP = pP->pNext;
+
+    pS = &(pP->pRecord->xStats);
+
+    pS->ullReaped++;
+
+    if(WIFSIGNALED(iStatus))
+    {
+      pS->ullSignaled++;
+    }
+    else if(!WIFEXITED(iStatus) || WEXITSTATUS(iStatus))
+    {
+      pS->ullFailed++;
+    }
+
+    pS->ullWallTime += ullNow - pP->ullStartTime;
+
+    pS->xUsage.ullUserTime += xUsage.ullUserTime;
+    pS->xUsage.ullSystemTime += xUsage.ullSystemTime;
+
+    if(xUsage.ullMaxRSS > pS->xUsage.ullMaxRSS)
+    {
+      pS->xUsage.ullMaxRSS = xUsage.ullMaxRSS; // the largest, not the total
+    }
+
+    pS->xUsage.ullMinorFaults += xUsage.ullMinorFaults;
+    pS->xUsage.ullMajorFaults += xUsage.ullMajorFaults;
+    pS->xUsage.ullInBlocks += xUsage.ullInBlocks;
+    pS->xUsage.ullOutBlocks += xUsage.ullOutBlocks;
+    pS->xUsage.ullVolCtxSwitches += xUsage.ullVolCtxSwitches;
+    pS->xUsage.ullInvolCtxSwitches += xUsage.ullInvolCtxSwitches;
+
+    pP->pNext = pProcessPendingFree;
+    pProcessPendingFree = pP;
+  }
+
+  pthread_mutex_unlock(&mtxProcessStats);
+}
+
+int WBProcessStatsEnable(int bEnable)
+{
+int iRval = bProcessStats;
+
+  bProcessStats = bEnable ? 1 : 0;
+
+  return iRval;
+}
+
+int WBProcessStatsGet(const char *szProgram, WB_PROCESS_STATS *pStats)
+{
+WB_PROCESS_STATS_RECORD *pR;
+
+
+  pthread_mutex_lock(&mtxProcessStats);
+
+  pR = __WBProcessStatsRecord(__WBProcessStatsName(szProgram), 0);
+
+  if(pR)
+  {
+    *pStats = pR->xStats;
+  }
+
+  pthread_mutex_unlock(&mtxProcessStats);
+
+  if(!pR)
+  {
+    memset(pStats, 0, sizeof(*pStats));
+    return -1;
+  }
+
+  return 0;
+}
+
+int WBProcessStatsEnum(WB_PROCESS_STATS_CALLBACK pCallback, void *pUserData)
+{
+WB_PROCESS_STATS_RECORD *pR;
+int i1, iRval = 0;
+
+
+  // NOTE:  the callback is called with the lock held, so it must not start or reap processes
+
+  pthread_mutex_lock(&mtxProcessStats);
+
+  for(i1=0; !iRval && i1 < WB_PROCESS_STATS_TABLE_SIZE; i1++)
+  {
+    for(pR = apProcessStats[i1]; !iRval && pR; pR = pR->pNext)
+    {
+      if(pR->xStats.ullStarted || pR->xStats.ullReaped)
+      {
+        iRval = pCallback(pUserData, pR->szName, &(pR->xStats));
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&mtxProcessStats);
+
+  return iRval;
+}
+
+void WBProcessStatsReset(void)
+{
+WB_PROCESS_STATS_RECORD *pR;
+int i1;
+
+
+  pthread_mutex_lock(&mtxProcessStats);
+
+  for(i1=0; i1 < WB_PROCESS_STATS_TABLE_SIZE; i1++)
+  {
+    for(pR = apProcessStats[i1]; pR; pR = pR->pNext)
+    {
+      memset(&(pR->xStats), 0, sizeof(pR->xStats)); // the records can't be freed, pending processes point to them
+    }
+  }
+
+  pthread_mutex_unlock(&mtxProcessStats);
+}
+
+
+// PROCESS TABLE - optional pidfd-backed tracking of spawned processes
+//
+// When enabled with WBProcessUsePidFD(), every process created by WBRunAsyncPipeV() gets a pidfd,
+// which is kept in a hash table keyed by the process ID.  As long as the pidfd is open and the
+// process has not been reaped, its process ID can't be re-used, so waiting and signalling through
+// the pidfd is race-free.  Once the process has been reaped, its status is cached here until it
+// has been returned to the caller by WBGetProcessState() or WBWaitProcess().
+//
+// Only one thread at a time reaps a process ('bReaping').  Any other thread that needs its status
+// waits on that entry's own condition variable, so an exit only wakes the threads that are waiting
+// for that particular process.  That's what makes the reaper thread (see WBReaperStart) scale.
+
+#define WB_PROCESS_TABLE_SIZE 256 /* must be a power of 2 */
+
+typedef struct __WB_PROCESS_ENTRY__
+{
+  struct __WB_PROCESS_ENTRY__ *pNext;
+  WB_PROCESS_ID idProcess;
+  WB_FILE_HANDLE hPidFD;  // closed once the process has been reaped (or when it's removed)
+  int bServer;            // started by the fork server, 'hPidFD' is its reply socket
+  int bCapture;           // started by the capture engine, which removes it when it's done
+  int bReaper;            // 'hPidFD' is registered with the reaper thread
+  int bReaping;           // a thread is reaping it (without holding the lock)
+  int bReaped;            // non-zero once 'iStatus' is valid
+  int bRemoved;           // removed from the table while threads were waiting (the last one frees it)
+  int nWaiters;           // the number of threads waiting on 'pCond'
+  pthread_cond_t *pCond;  // broadcast when 'bReaping' or 'bReaped' changes (allocated by the first waiter)
+  int iStatus;            // raw 'wait' status
+  struct rusage xUsage;   // resource usage, valid when 'bReaped' is non-zero
+} WB_PROCESS_ENTRY;
+
+static pthread_mutex_t mtxProcessTable = PTHREAD_MUTEX_INITIALIZER;
+static WB_PROCESS_ENTRY *apProcessTable[WB_PROCESS_TABLE_SIZE];
+static volatile int bProcessUsePidFD = 0;
+static WB_FILE_HANDLE hReaperEpoll = WB_INVALID_FILE_HANDLE; // assigned while 'mtxProcessTable' is locked
+
+#define WB_PROCESS_TABLE_HASH(X) (((unsigned int)(X) ^ ((unsigned int)(X) >> 8)) & (WB_PROCESS_TABLE_SIZE - 1))
+
+// NOTE:  'mtxProcessTable' must be locked by the caller
+
+static WB_PROCESS_ENTRY * __WBProcessLookup(WB_PROCESS_ID idProcess)
+{
+WB_PROCESS_ENTRY *pE;
+
+  for(pE = apProcessTable[WB_PROCESS_TABLE_HASH(idProcess)]; pE; pE = pE->pNext)
+  {
+    if(pE->idProcess == idProcess)
+    {
+      return pE;
+    }
+  }
+
+  return NULL;
+}
+
+// add a tracked process to the reaper thread's epoll set.  EPOLLONESHOT means that it's reported
+// exactly once, and never again even though the pidfd stays readable until it's closed.
+// NOTE:  'mtxProcessTable' must be locked by the caller
+
+static void __WBProcessReaperAdd(WB_PROCESS_ENTRY *pE)
+{
+#ifdef __linux__
+struct epoll_event xEvent;
+
+
+  if(hReaperEpoll == WB_INVALID_FILE_HANDLE || pE->hPidFD == WB_INVALID_FILE_HANDLE ||
+     pE->bReaped || pE->bReaper)
+  {
+    return;
+  }
+
+  memset(&xEvent, 0, sizeof(xEvent));
+  xEvent.events = EPOLLIN | EPOLLONESHOT;
+  xEvent.data.u64 = (WB_UINT64)(WB_UINT32)pE->idProcess; // zero is reserved for the 'stop' eventfd
+
+  if(!epoll_ctl(hReaperEpoll, EPOLL_CTL_ADD, pE->hPidFD, &xEvent))
+  {
+    pE->bReaper = 1;
+  }
+#endif // __linux__
+}
+
+static void __WBProcessRegister(WB_PROCESS_ID idProcess, WB_FILE_HANDLE hPidFD, int bServer, int bCapture)
+{
+WB_PROCESS_ENTRY *pE = (WB_PROCESS_ENTRY *)WBAlloc(sizeof(*pE));
+unsigned int uiHash = WB_PROCESS_TABLE_HASH(idProcess);
+
+
+  if(!pE)
+  {
+    close(hPidFD); // untracked, so it falls back to the plain pid methods
+    return;
+  }
+
+  memset(pE, 0, sizeof(*pE));
+
+  pE->idProcess = idProcess;
+  pE->hPidFD = hPidFD;
+  pE->bServer = bServer;
+  pE->bCapture = bCapture;
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  pE->pNext = apProcessTable[uiHash];
+  apProcessTable[uiHash] = pE;
+
+  __WBProcessReaperAdd(pE); // after it's in the table, so the reaper can find it
+
+  pthread_mutex_unlock(&mtxProcessTable);
+}
+
+static void __WBProcessEntryFree(WB_PROCESS_ENTRY *pE)
+{
+  if(pE->hPidFD != WB_INVALID_FILE_HANDLE)
+  {
+    close(pE->hPidFD); // this also removes it from the reaper's epoll set
+  }
+
+  if(pE->pCond)
+  {
+    pthread_cond_destroy(pE->pCond);
+    WBFree(pE->pCond);
+  }
+
+  WBFree(pE);
+}
+
+// wait for another thread to change 'bReaping' or 'bReaped' for a process.  'ullDeadline' is an
+// absolute __WBMonotonicTime() value, or zero for no timeout.  Returns zero when signaled (or on
+// a spurious wakeup), ETIMEDOUT, or -1 if the entry has been removed (it's no longer valid).
+// NOTE:  'mtxProcessTable' must be locked by the caller
+
+static int __WBProcessEntryWait(WB_PROCESS_ENTRY *pE, WB_UINT64 ullDeadline)
+{
+pthread_condattr_t xAttr;
+struct timespec ts;
+int iRval;
+
+
+  if(!pE->pCond)
+  {
+    pE->pCond = (pthread_cond_t *)WBAlloc(sizeof(*(pE->pCond)));
+
+    if(!pE->pCond) // unlikely, so just let the caller try again a bit later
+    {
+      pthread_mutex_unlock(&mtxProcessTable);
+      WBDelay(1000);
+      pthread_mutex_lock(&mtxProcessTable);
+
+      return 0;
+    }
+
+    pthread_condattr_init(&xAttr);
+    pthread_condattr_setclock(&xAttr, CLOCK_MONOTONIC); // same clock as __WBMonotonicTime()
+    pthread_cond_init(pE->pCond, &xAttr);
+    pthread_condattr_destroy(&xAttr);
+  }
+
+  pE->nWaiters++;
+
+  if(ullDeadline)
+  {
+    ts.tv_sec = ullDeadline / 1000000;
+    ts.tv_nsec = (ullDeadline % 1000000) * 1000;
+
+    iRval = pthread_cond_timedwait(pE->pCond, &mtxProcessTable, &ts);
+  }
+  else
+  {
+    iRval = pthread_cond_wait(pE->pCond, &mtxProcessTable);
+  }
+
+  pE->nWaiters--;
+
+  if(pE->bRemoved)
+  {
+    if(!pE->nWaiters)
+    {
+      __WBProcessEntryFree(pE);
+    }
+
+    return -1;
+  }
+
+  return iRval == ETIMEDOUT ? ETIMEDOUT : 0;
+}
+
+// remove a process from the table, closing its pidfd.  returns non-zero if it was there
+
+static int __WBProcessRemove(WB_PROCESS_ID idProcess)
+{
+WB_PROCESS_ENTRY *pE, **ppE;
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  for(ppE = &(apProcessTable[WB_PROCESS_TABLE_HASH(idProcess)]); *ppE; ppE = &((*ppE)->pNext))
+  {
+    if((*ppE)->idProcess == idProcess)
+    {
+      break;
+    }
+  }
+
+  pE = *ppE;
+
+  if(pE)
+  {
+    *ppE = pE->pNext;
+
+    if(pE->nWaiters) // the last waiter frees it
+    {
+      pE->bRemoved = 1;
+      pthread_cond_broadcast(pE->pCond);
+
+      pE = (WB_PROCESS_ENTRY *)1; // non-NULL, but not to be freed
+    }
+  }
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  if(!pE)
+  {
+    return 0;
+  }
+
+  if(pE != (WB_PROCESS_ENTRY *)1)
+  {
+    __WBProcessEntryFree(pE);
+  }
+
+  return 1;
+}
+
+// return the pidfd for a tracked (and not yet reaped) process, or WB_INVALID_FILE_HANDLE.
+// the pidfd belongs to the process table and must not be closed by the caller.
+
+static WB_FILE_HANDLE __WBProcessPidFD(WB_PROCESS_ID idProcess)
+{
+WB_PROCESS_ENTRY *pE;
+WB_FILE_HANDLE hRval = WB_INVALID_FILE_HANDLE;
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  pE = __WBProcessLookup(idProcess);
+
+  if(pE)
+  {
+    hRval = pE->hPidFD;
+  }
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  return hRval;
+}
+
+// return a copy of the pidfd for a tracked (and not yet reaped) process, or WB_INVALID_FILE_HANDLE.
+// the copy is made while the table is locked, so that it can't be closed by another thread reaping
+// the process (and the descriptor number re-used) in between.  The caller must close it.
+
+static WB_FILE_HANDLE __WBProcessPidFDDup(WB_PROCESS_ID idProcess)
+{
+WB_PROCESS_ENTRY *pE;
+WB_FILE_HANDLE hRval = WB_INVALID_FILE_HANDLE;
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  pE = __WBProcessLookup(idProcess);
+
+  if(pE && pE->hPidFD != WB_INVALID_FILE_HANDLE)
+  {
+    hRval = fcntl(pE->hPidFD, F_DUPFD_CLOEXEC, 3);
+  }
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  return hRval;
+}
+
+// returns non-zero if the process is in the process table (whether or not it's been reaped)
+
+static int __WBProcessTracked(WB_PROCESS_ID idProcess)
+{
+int bRval;
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  bRval = __WBProcessLookup(idProcess) != NULL;
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  return bRval;
+}
+
+// reap a process, caching its status and resource usage if it's in the process table.
+// returns 1 if it has exited (and assigns *piStatus and, if not NULL, *pUsage), 0 if still
+// running (only when 'bBlock' is zero), or -1 on error (ECHILD if SIGCHLD is being ignored)
+
+static int __WBProcessReap(WB_PROCESS_ID idProcess, int *piStatus, struct rusage *pUsage, int bBlock)
+{
+WB_PROCESS_ENTRY *pE;
+WB_FILE_HANDLE hReply = WB_INVALID_FILE_HANDLE;
+struct rusage xUsage;
+int iStat = 0, iRval, iErr;
+pid_t pid;
+
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  pE = __WBProcessLookup(idProcess);
+
+  while(pE && pE->bReaping && !pE->bReaped) // another thread is reaping it (the reaper thread, most likely)
+  {
+    if(!bBlock)
+    {
+      pthread_mutex_unlock(&mtxProcessTable);
+      return 0; // as far as I know, it's still running
+    }
+
+    if(__WBProcessEntryWait(pE, 0) < 0)
+    {
+      pE = __WBProcessLookup(idProcess); // it was removed
+    }
+  }
+
+  if(pE && pE->bReaped)
+  {
+    *piStatus = pE->iStatus;
+
+    if(pUsage)
+    {
+      *pUsage = pE->xUsage;
+    }
+
+    pthread_mutex_unlock(&mtxProcessTable);
+    return 1;
+  }
+
+  if(pE)
+  {
+    pE->bReaping = 1;
+
+    if(pE->bServer)
+    {
+      hReply = pE->hPidFD; // the fork server is its parent, and sends me the status
+    }
+  }
+
+  pthread_mutex_unlock(&mtxProcessTable); // don't hold the lock while blocked in 'wait4'
+
+  memset(&xUsage, 0, sizeof(xUsage));
+
+  if(hReply != WB_INVALID_FILE_HANDLE)
+  {
+    iRval = __WBForkServerStatus(hReply, &iStat, &xUsage, bBlock);
+  }
+  else
+  {
+    do
+    {
+      pid = wait4(idProcess, &iStat, bBlock ? 0 : WNOHANG, &xUsage); // like 'waitpid' but with resource usage
+    } while(pid < 0 && errno == EINTR);
+
+    iRval = pid > 0 ? 1 : pid; // 0 if still running, -1 on error
+  }
+
+  iErr = errno;
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  pE = __WBProcessLookup(idProcess);
+
+  if(pE)
+  {
+    pE->bReaping = 0;
+
+    if(iRval > 0)
+    {
+      pE->bReaped = 1;
+      pE->iStatus = iStat;
+      pE->xUsage = xUsage;
+
+      if(pE->hPidFD != WB_INVALID_FILE_HANDLE)
+      {
+#ifdef __linux__
+        if(pE->bReaper && hReaperEpoll != WB_INVALID_FILE_HANDLE)
+        {
+          // a copy of the pidfd (see __WBProcessPidFDDup) would keep it registered after it's closed
+
+          epoll_ctl(hReaperEpoll, EPOLL_CTL_DEL, pE->hPidFD, NULL);
+        }
+#endif // __linux__
+
+        close(pE->hPidFD); // no longer needed, the status is cached
+        pE->hPidFD = WB_INVALID_FILE_HANDLE;
+        pE->bReaper = 0;
+      }
+    }
+
+    if(pE->nWaiters)
+    {
+      pthread_cond_broadcast(pE->pCond); // whether or not it worked, somebody else can try
+    }
+  }
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  if(iRval <= 0)
+  {
+    errno = iErr;
+    return iRval;
+  }
+
+  __WBProcessStatsEnd(idProcess, iStat, &xUsage);
+
+  *piStatus = iStat;
+
+  if(pUsage)
+  {
+    *pUsage = xUsage;
+  }
+
+  return 1;
+}
+
+// convert a raw 'wait' status into an exit code.  -1 indicates abnormal termination (signal, etc.)
+
+static WB_INT32 __WBExitCodeFromStatus(int iStatus)
+{
+  if(!WIFEXITED(iStatus))
+  {
+    return -1;
+  }
+
+  return (WB_INT32)WEXITSTATUS(iStatus);
+}
+
+int WBProcessUsePidFD(int bEnable)
+{
+int iRval;
+WB_FILE_HANDLE hTemp;
+
+
+  if(bEnable)
+  {
+    // verify that the kernel supports pidfds by opening one for myself
+
+    hTemp = __WBPidfdOpen(getpid());
+
+    if(hTemp == WB_INVALID_FILE_HANDLE)
+    {
+      return -1;
+    }
+
+    close(hTemp);
+  }
+
+  iRval = bProcessUsePidFD;
+  bProcessUsePidFD = bEnable ? 1 : 0;
+
+  return iRval;
+}
+
+WB_FILE_HANDLE WBGetProcessFD(WB_PROCESS_ID idProcess)
+{
+  return __WBProcessPidFD(idProcess);
+}
+
+void WBReleaseProcess(WB_PROCESS_ID idProcess)
+{
+  __WBProcessRemove(idProcess);
+}
+
+int WBKillProcess(WB_PROCESS_ID idProcess, int iSignal)
+{
+WB_PROCESS_ENTRY *pE;
+int iRval;
+
+
+  if(WB_PROCESS_ID_INVALID(idProcess) || idProcess <= 0)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  pE = __WBProcessLookup(idProcess);
+
+  if(pE)
+  {
+    if(pE->bReaped) // its pid may already belong to a different process
+    {
+      pthread_mutex_unlock(&mtxProcessTable);
+
+      errno = ESRCH;
+      return -1;
+    }
+
+#if defined(__linux__) && defined(SYS_pidfd_send_signal)
+    if(pE->hPidFD != WB_INVALID_FILE_HANDLE && !pE->bServer) // the fork server's reply socket is not a pidfd
+    {
+      // NOTE:  holding the lock keeps the pidfd from being closed while I use it
+
+      iRval = (int)syscall(SYS_pidfd_send_signal, pE->hPidFD, iSignal, NULL, 0);
+
+      pthread_mutex_unlock(&mtxProcessTable);
+
+      return iRval < 0 ? -1 : 0;
+    }
+#endif // __linux__, SYS_pidfd_send_signal
+  }
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  iRval = kill(idProcess, iSignal);
+
+  return iRval < 0 ? -1 : 0;
+}
+
+int WBWaitProcess(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode, int nTimeout)
+{
+  return WBWaitProcessEx(idProcess, pExitCode, NULL, nTimeout);
+}
+
+int WBWaitProcessEx(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode, WB_RUN_USAGE *pUsage, int nTimeout)
+{
+WB_FILE_HANDLE hPidFD;
+struct rusage xUsage;
+struct pollfd xPoll;
+WB_UINT64 ullDeadline;
+uint32_t uiDelay;
+int iStat = 0, iRval;
+
+
+  if(WB_PROCESS_ID_INVALID(idProcess))
+  {
+    return -1;
+  }
+
+  if(nTimeout >= 0)
+  {
+    ullDeadline = __WBMonotonicTime() + (WB_UINT64)nTimeout;
+  }
+  else
+  {
+    ullDeadline = 0; // not used
+  }
+
+  // a copy of the pidfd, since another thread could consume the status (and close the original)
+  // while I'm waiting on it.  A zero timeout is a plain non-blocking check, and doesn't need one.
+
+  hPidFD = nTimeout != 0 ? __WBProcessPidFDDup(idProcess) : WB_INVALID_FILE_HANDLE;
+
+  if(hPidFD != WB_INVALID_FILE_HANDLE)
+  {
+    // sleep in the kernel until the process exits or the time runs out
+
+    while(1)
+    {
+      xPoll.fd = hPidFD;
+      xPoll.events = POLLIN;
+      xPoll.revents = 0;
+
+#ifdef __linux__
+      if(nTimeout >= 0)
+      {
+        struct timespec ts;
+        WB_UINT64 ullNow = __WBMonotonicTime();
+        WB_UINT64 ullRemain = ullNow < ullDeadline ? ullDeadline - ullNow : 0;
+
+        ts.tv_sec = ullRemain / 1000000;
+        ts.tv_nsec = (ullRemain % 1000000) * 1000;
+
+        iRval = ppoll(&xPoll, 1, &ts, NULL); // microsecond resolution
+      }
+      else
+      {
+        iRval = ppoll(&xPoll, 1, NULL, NULL);
+      }
+#else // __linux__
+      iRval = poll(&xPoll, 1, nTimeout >= 0 ? (nTimeout + 999) / 1000 : -1);
+#endif // __linux__
+
+      if(iRval >= 0 || errno != EINTR)
+      {
+        break;
+      }
+    }
+
+    close(hPidFD); // only needed for the wait (the handle value is still used as a flag below)
+
+    if(!iRval)
+    {
+      return 1; // timed out
+    }
+  }
+
+  // at this point, either the process has exited or I have to check the old-fashioned way
+
+  if(hPidFD != WB_INVALID_FILE_HANDLE || nTimeout < 0)
+  {
+    iRval = __WBProcessReap(idProcess, &iStat, &xUsage, 1);
+  }
+  else
+  {
+    uiDelay = 100; // back off from 0.1 msec up to 10 msec
+
+    while(1)
+    {
+      iRval = __WBProcessReap(idProcess, &iStat, &xUsage, 0);
+
+      if(iRval || __WBMonotonicTime() >= ullDeadline)
+      {
+        break;
+      }
+
+      WBDelay(uiDelay);
+
+      if(uiDelay < 10000)
+      {
+        uiDelay *= 2;
+      }
+    }
+
+    if(!iRval)
+    {
+      return 1; // timed out
+    }
+  }
+
+  __WBProcessRemove(idProcess); // status has been consumed
+
+  if(iRval < 0)
+  {
+    return -1;
+  }
+
+  if(pExitCode)
+  {
+    *pExitCode = __WBExitCodeFromStatus(iStat);
+  }
+
+  if(pUsage)
+  {
+    __WBRunUsageFromRusage(pUsage, &xUsage);
+  }
+
+  return 0;
+}
+
+// PROCESS TREE TERMINATION - a process and its process group are sent SIGTERM, and anything still
+// running when the grace period ends is sent SIGKILL.  On Linux, '/proc' is scanned to find the
+// members of the process group (so that they can be checked during the grace period, and reported)
+// and with WB_TERMINATE_TREE, the process's descendants and everything else in its session.  That
+// includes grandchildren that were orphaned (and re-parented to 'init') or that moved to a process
+// group of their own, which is how they end up holding a capture pipe open after the process exits.
+
+#define WB_TERMINATE_MAX_PASSES 8     /* SIGKILL passes, to catch anything forked during the one before */
+#define WB_TERMINATE_MAX_DELAY  20000 /* maximum interval (microseconds) for checking them during the grace period */
+
+typedef struct __WB_TERMINATE_PROC__
+{
+  pid_t idProcess;
+  pid_t idParent;
+  pid_t idGroup;
+  pid_t idSession;
+  char cState;                // from '/proc/<pid>/stat' - 'Z' (zombie) and 'X' (dead) have already exited
+  int bMatch;
+} WB_TERMINATE_PROC;
+
+typedef struct __WB_TERMINATE__
+{
+  int iFlags;                 // WB_TERMINATE_xxx
+  int nRoots;
+  const WB_PROCESS_ID *paidRoot; // the processes (and process groups) being terminated
+  const int *pabReaped;       // non-zero if that process has been reaped (its process group may not be empty)
+  WB_TERMINATE_PROC *pProc;   // the last '/proc' scan (WBAlloc'd)
+  int nProc, nProcMax;
+  pid_t *paidSignaled;        // every process that was signaled, and the last signal it got (WBAlloc'd)
+  int *paiSignal;
+  int nSignaled, nSignaledMax, nKilled;
+  const ino_t *paPipe;        // pipes (by inode) whose holders are terminated as well, or NULL
+  int nPipes;
+} WB_TERMINATE;
+
+#ifdef __linux__
+static int __WBTerminateReadStat(pid_t idProcess, WB_TERMINATE_PROC *pProc)
+{
+char tbuf[512], *p1;
+int hFile, i1;
+
+
+  snprintf(tbuf, sizeof(tbuf), "/proc/%d/stat", (int)idProcess);
+
+  hFile = open(tbuf, O_RDONLY | O_CLOEXEC);
+
+  if(hFile < 0)
+  {
+    return -1;
+  }
+
+  i1 = read(hFile, tbuf, sizeof(tbuf) - 1);
+
+  close(hFile);
+
+  if(i1 <= 0)
+  {
+    return -1;
+  }
+
+  tbuf[i1] = 0;
+
+  p1 = strrchr(tbuf, ')'); // the command name is in parentheses, and may contain anything
+
+  if(!p1)
+  {
+    return -1;
+  }
+
+  // after the name, it's 'state ppid pgrp session ...'
+
+  pProc->idProcess = idProcess;
+  pProc->bMatch = 0;
+
+  if(4 != sscanf(p1 + 1, " %c %d %d %d", &(pProc->cState), &(pProc->idParent), &(pProc->idGroup), &(pProc->idSession)))
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+// returns non-zero if the process has one of 'paPipe' open.  Something that left the session, and
+// was re-parented, can only be found this way.
+
+static int __WBTerminateHoldsPipe(const WB_TERMINATE *pT, pid_t idProcess)
+{
+DIR *pDir;
+struct dirent *pEnt;
+char tbuf[sizeof(pEnt->d_name) + 32], tbuf2[64];
+unsigned long long ullIno;
+int i1, iRval = 0;
+
+
+  snprintf(tbuf, sizeof(tbuf), "/proc/%d/fd", (int)idProcess);
+
+  pDir = opendir(tbuf); // fails for other users' processes, which can't be holding them anyway
+
+  if(!pDir)
+  {
+    return 0;
+  }
+
+  while(!iRval && (pEnt = readdir(pDir)) != NULL)
+  {
+    if(pEnt->d_name[0] < '0' || pEnt->d_name[0] > '9')
+    {
+      continue;
+    }
+
+    snprintf(tbuf, sizeof(tbuf), "/proc/%d/fd/%s", (int)idProcess, pEnt->d_name);
+
+    i1 = readlink(tbuf, tbuf2, sizeof(tbuf2) - 1);
+
+    if(i1 <= 0)
+    {
+      continue;
+    }
+
+    tbuf2[i1] = 0;
+
+    if(1 != sscanf(tbuf2, "pipe:[%llu]", &ullIno))
+    {
+      continue;
+    }
+
+    for(i1=0; i1 < pT->nPipes; i1++)
+    {
+      if((unsigned long long)pT->paPipe[i1] == ullIno)
+      {
+        iRval = 1;
+        break;
+      }
+    }
+  }
+
+  closedir(pDir);
+
+  return iRval;
+}
+#endif // __linux__
+
+// returns the index of 'idProcess' in 'paidRoot', or -1
+
+static int __WBTerminateRoot(const WB_TERMINATE *pT, pid_t idProcess)
+{
+int i1;
+
+  for(i1=0; i1 < pT->nRoots; i1++)
+  {
+    if((pid_t)pT->paidRoot[i1] == idProcess)
+    {
+      return i1;
+    }
+  }
+
+  return -1;
+}
+
+// scan '/proc' for the processes (other than the roots) that are still running, and belong to one of
+// the roots.  returns the number found, or -1 if '/proc' can't be read
+
+static int __WBTerminateScan(WB_TERMINATE *pT)
+{
+#ifdef __linux__
+DIR *pDir;
+struct dirent *pEnt;
+WB_TERMINATE_PROC xProc, *pNew;
+char *p1;
+long lPid;
+int i1, i2, iRoot, bChanged, nRval;
+
+
+  pT->nProc = 0;
+
+  pDir = opendir("/proc");
+
+  if(!pDir)
+  {
+    return -1;
+  }
+
+  while((pEnt = readdir(pDir)) != NULL)
+  {
+    if(pEnt->d_name[0] < '1' || pEnt->d_name[0] > '9')
+    {
+      continue;
+    }
+
+    lPid = strtol(pEnt->d_name, &p1, 10);
+
+    if(*p1 || lPid <= 0 || __WBTerminateRoot(pT, (pid_t)lPid) >= 0 || // the roots are checked separately
+       __WBTerminateReadStat((pid_t)lPid, &xProc) || // it's gone already
+       xProc.cState == 'Z' || xProc.cState == 'X')
+    {
+      continue;
+    }
+
+    iRoot = __WBTerminateRoot(pT, xProc.idGroup);
+
+    if(iRoot < 0 && (pT->iFlags & WB_TERMINATE_TREE))
+    {
+      iRoot = __WBTerminateRoot(pT, xProc.idSession);
+
+      if(iRoot < 0)
+      {
+        iRoot = __WBTerminateRoot(pT, xProc.idParent);
+
+        if(iRoot >= 0 && pT->pabReaped[iRoot]) // it was re-parented, so its parent ID is a coincidence
+        {
+          iRoot = -1;
+        }
+      }
+    }
+
+    xProc.bMatch = iRoot >= 0 ||
+                   (pT->nPipes && xProc.idProcess != getpid() && // I have the read ends
+                    __WBTerminateHoldsPipe(pT, xProc.idProcess));
+
+    if(!xProc.bMatch && !(pT->iFlags & WB_TERMINATE_TREE))
+    {
+      continue; // without WB_TERMINATE_TREE, only the process groups matter
+    }
+
+    if(pT->nProc >= pT->nProcMax)
+    {
+      pNew = (WB_TERMINATE_PROC *)(pT->pProc ? WBReAlloc(pT->pProc, (pT->nProcMax + 256) * sizeof(*pNew))
+                                             : WBAlloc((pT->nProcMax + 256) * sizeof(*pNew)));
+      if(!pNew)
+      {
+        break; // work with what I have
+      }
+
+      pT->pProc = pNew;
+      pT->nProcMax += 256;
+    }
+
+    pT->pProc[pT->nProc++] = xProc;
+  }
+
+  closedir(pDir);
+
+  // descendants of the ones that matched, by parent ID.  the list is small, so just repeat until it's stable
+
+  do
+  {
+    bChanged = 0;
+
+    for(i1=0; i1 < pT->nProc; i1++)
+    {
+      if(pT->pProc[i1].bMatch)
+      {
+        continue;
+      }
+
+      for(i2=0; i2 < pT->nProc; i2++)
+      {
+        if(pT->pProc[i2].bMatch && pT->pProc[i2].idProcess == pT->pProc[i1].idParent)
+        {
+          pT->pProc[i1].bMatch = 1;
+          bChanged = 1;
+          break;
+        }
+      }
+    }
+  } while(bChanged);
+
+  for(i1=0, nRval=0; i1 < pT->nProc; i1++)
+  {
+    if(pT->pProc[i1].bMatch)
+    {
+      pT->pProc[nRval++] = pT->pProc[i1];
+    }
+  }
+
+  pT->nProc = nRval;
+
+  return nRval;
+#else // __linux__
+
+  pT->nProc = 0;
+
+  return -1;
+#endif // __linux__
+}
+
+// returns non-zero if a root process hasn't exited yet (a zombie has)
+
+static int __WBTerminateRootAlive(const WB_TERMINATE *pT, int iRoot)
+{
+#ifdef __linux__
+WB_TERMINATE_PROC xProc;
+#endif // __linux__
+
+  if(pT->pabReaped[iRoot])
+  {
+    return 0;
+  }
+
+#ifdef __linux__
+  if(!__WBTerminateReadStat((pid_t)pT->paidRoot[iRoot], &xProc))
+  {
+    return xProc.cState != 'Z' && xProc.cState != 'X';
+  }
+#endif // __linux__
+
+  return !kill((pid_t)pT->paidRoot[iRoot], 0); // a zombie still counts, but it's the best I can do
+}
+
+static void __WBTerminateRecord(WB_TERMINATE *pT, pid_t idProcess, int iSignal)
+{
+int i1;
+pid_t *paidNew;
+int *paiNew;
+
+
+  for(i1=0; i1 < pT->nSignaled; i1++)
+  {
+    if(pT->paidSignaled[i1] == idProcess)
+    {
+      break;
+    }
+  }
+
+  if(i1 >= pT->nSignaled)
+  {
+    if(pT->nSignaled >= pT->nSignaledMax)
+    {
+      paidNew = (pid_t *)(pT->paidSignaled ? WBReAlloc(pT->paidSignaled, (pT->nSignaledMax + 64) * sizeof(*paidNew))
+                                           : WBAlloc((pT->nSignaledMax + 64) * sizeof(*paidNew)));
+      if(paidNew)
+      {
+        pT->paidSignaled = paidNew;
+      }
+
+      paiNew = (int *)(pT->paiSignal ? WBReAlloc(pT->paiSignal, (pT->nSignaledMax + 64) * sizeof(*paiNew))
+                                     : WBAlloc((pT->nSignaledMax + 64) * sizeof(*paiNew)));
+      if(paiNew)
+      {
+        pT->paiSignal = paiNew;
+      }
+
+      if(!paidNew || !paiNew)
+      {
+        return; // it's only the report
+      }
+
+      pT->nSignaledMax += 64;
+    }
+
+    pT->paidSignaled[i1] = idProcess;
+    pT->paiSignal[i1] = 0;
+    pT->nSignaled++;
+  }
+
+  if(iSignal == SIGKILL && pT->paiSignal[i1] != SIGKILL)
+  {
+    pT->nKilled++;
+  }
+
+  pT->paiSignal[i1] = iSignal;
+}
+
+// returns non-zero if a root's process group can be signaled.  Until the root is reaped, its process
+// ID (which is also the process group ID) can't be re-used.  Once it has been, the ID is only safe
+// while the group still has members, so one of them has to have been found by the last scan.
+
+static int __WBTerminateGroupValid(const WB_TERMINATE *pT, int iRoot)
+{
+int i1;
+
+
+  if(!pT->pabReaped[iRoot])
+  {
+    return 1;
+  }
+
+  for(i1=0; i1 < pT->nProc; i1++)
+  {
+    if(pT->pProc[i1].idGroup == (pid_t)pT->paidRoot[iRoot])
+    {
+      return 1;
+    }
+  }
+
+  return 0; // it's empty, or there's no '/proc' to tell, and the ID could belong to someone else now
+}
+
+// send 'iSignal' to the roots that are still running, their process groups, and whatever the last
+// scan found.  returns the number of processes that were signaled
+
+static int __WBTerminateSignal(WB_TERMINATE *pT, int iSignal)
+{
+int i1, nRval = 0;
+
+
+  for(i1=0; i1 < pT->nRoots; i1++)
+  {
+    if(__WBTerminateRootAlive(pT, i1) && !WBKillProcess(pT->paidRoot[i1], iSignal))
+    {
+      __WBTerminateRecord(pT, (pid_t)pT->paidRoot[i1], iSignal);
+      nRval++;
+    }
+
+    // this gets the members that were started since the scan, or all of them when '/proc' can't be read
+    // (in which case only the groups of roots that haven't been reaped are known to be theirs)
+
+    if(__WBTerminateGroupValid(pT, i1))
+    {
+      kill(-(pid_t)pT->paidRoot[i1], iSignal);
+    }
+  }
+
+  for(i1=0; i1 < pT->nProc; i1++)
+  {
+    if(!kill(pT->pProc[i1].idProcess, iSignal))
+    {
+      __WBTerminateRecord(pT, pT->pProc[i1].idProcess, iSignal);
+      nRval++;
+    }
+  }
+
+  return nRval;
+}
+
+// returns the number of processes that are still running (or -1 when '/proc' can't be read, and none of the roots are)
+
+static int __WBTerminateCount(WB_TERMINATE *pT)
+{
+int i1, nRval;
+
+
+  nRval = __WBTerminateScan(pT);
+
+  for(i1=0; i1 < pT->nRoots; i1++)
+  {
+    if(__WBTerminateRootAlive(pT, i1))
+    {
+      nRval = nRval < 0 ? 1 : nRval + 1;
+    }
+  }
+
+  return nRval;
+}
+
+// terminate processes, their process groups, and (with WB_TERMINATE_TREE) their sessions and descendants,
+// and anything that has one of 'paPipe' open.  none of them are reaped.  The results are added to 'pReport' (when it's not NULL), which the caller
+// must initialize.  returns the number of processes that were signaled.
+
+static int __WBTerminate(const WB_PROCESS_ID *paidRoot, const int *pabReaped, int nRoots, int iFlags,
+                         const ino_t *paPipe, int nPipes, WB_UINT64 ullGrace, WB_TERMINATE_REPORT *pReport)
+{
+WB_TERMINATE xT;
+WB_UINT64 ullNow, ullDeadline;
+uint32_t uiDelay;
+int i1, i2, nAlive;
+
+
+  memset(&xT, 0, sizeof(xT));
+
+  xT.iFlags = iFlags;
+  xT.nRoots = nRoots;
+  xT.paidRoot = paidRoot;
+  xT.pabReaped = pabReaped;
+  xT.paPipe = paPipe;
+  xT.nPipes = nPipes;
+
+  if(ullGrace)
+  {
+    if(__WBTerminateCount(&xT) != 0)
+    {
+      __WBTerminateSignal(&xT, SIGTERM);
+
+      // only the processes found by a scan get SIGCONT, because a stopped process can't act on SIGTERM
+
+      for(i1=0; i1 < xT.nProc; i1++)
+      {
+        kill(xT.pProc[i1].idProcess, SIGCONT);
+      }
+
+      for(i1=0; i1 < nRoots; i1++)
+      {
+        if(__WBTerminateGroupValid(&xT, i1))
+        {
+          kill(-(pid_t)paidRoot[i1], SIGCONT);
+        }
+      }
+
+      ullDeadline = __WBMonotonicTime() + ullGrace;
+      uiDelay = 1000; // back off from 1 msec up to WB_TERMINATE_MAX_DELAY
+
+      while(1)
+      {
+        ullNow = __WBMonotonicTime();
+
+        if(ullNow >= ullDeadline)
+        {
+          break;
+        }
+
+        WBDelay(ullDeadline - ullNow < uiDelay ? (uint32_t)(ullDeadline - ullNow) : uiDelay);
+
+        if(uiDelay < WB_TERMINATE_MAX_DELAY)
+        {
+          uiDelay *= 2;
+        }
+
+        if(__WBTerminateCount(&xT) <= 0) // all gone (or without '/proc', the roots are)
+        {
+          break;
+        }
+      }
+    }
+  }
+
+  // whatever is left gets SIGKILL.  Something that forks while I do that is caught by the next pass.
+
+  for(i1=0; i1 < WB_TERMINATE_MAX_PASSES; i1++)
+  {
+    nAlive = __WBTerminateCount(&xT);
+
+    if(nAlive <= 0)
+    {
+      if(nAlive < 0 && !i1)
+      {
+        __WBTerminateSignal(&xT, SIGKILL); // no '/proc' so the process groups are all I can do
+      }
+
+      break;
+    }
+
+    __WBTerminateSignal(&xT, SIGKILL);
+
+    WBDelay(1000); // let them die, so the next scan doesn't find them again
+  }
+
+  if(pReport)
+  {
+    pReport->nSignaled += xT.nSignaled;
+    pReport->nKilled += xT.nKilled;
+
+    for(i1=0; i1 < xT.nSignaled; i1++)
+    {
+      for(i2=0; i2 < pReport->nReported; i2++)
+      {
+        if(pReport->aidProcess[i2] == (WB_PROCESS_ID)xT.paidSignaled[i1])
+        {
+          pReport->nSignaled--; // already reported by an earlier call
+          break;
+        }
+      }
+
+      if(i2 >= pReport->nReported)
+      {
+        if(pReport->nReported >= WB_TERMINATE_MAX_REPORT)
+        {
+          continue;
+        }
+
+        pReport->nReported++;
+      }
+
+      pReport->aidProcess[i2] = (WB_PROCESS_ID)xT.paidSignaled[i1];
+      pReport->aiSignal[i2] = xT.paiSignal[i1];
+    }
+  }
+
+  if(xT.pProc)
+  {
+    WBFree(xT.pProc);
+  }
+
+  if(xT.paidSignaled)
+  {
+    WBFree(xT.paidSignaled);
+  }
+
+  if(xT.paiSignal)
+  {
+    WBFree(xT.paiSignal);
+  }
+
+  return xT.nSignaled;
+}
+
+int WBTerminateProcessTree(WB_PROCESS_ID idProcess, int iFlags, int nGrace, WB_TERMINATE_REPORT *pReport)
+{
+int bReaped = 0;
+
+
+  if(pReport)
+  {
+    memset(pReport, 0, sizeof(*pReport));
+  }
+
+  if(WB_PROCESS_ID_INVALID(idProcess) || idProcess <= 0)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return __WBTerminate(&idProcess, &bReaped, 1, iFlags, NULL, 0, nGrace > 0 ? (WB_UINT64)nGrace : 0, pReport);
+}
+
+// WAIT FOR MANY PROCESSES - the pidfds (or fork server reply sockets) of the processes that are still
+// running go into a temporary epoll set, so the calling thread sleeps in the kernel until one of
+// them exits.  Processes without a pidfd are checked periodically, as WBWaitProcessEx() does.
+
+#define WB_WAIT_MANY_EVENTS 64 /* maximum number of events from each 'epoll_wait' */
+
+// check one process (without blocking, unless it's known to have exited).  returns 1 and fills in
+// 'pCompletion' if it has exited, or can't be waited on.  returns 0 if it's still running.
+
+static int __WBWaitManyCheck(WB_PROCESS_ID idProcess, WB_PROCESS_COMPLETION *pCompletion, int bBlock)
+{
+struct rusage xUsage;
+int iStat = 0, iRval;
+pid_t pid;
+
+
+  memset(&xUsage, 0, sizeof(xUsage));
+
+  if(__WBProcessTracked(idProcess))
+  {
+    iRval = __WBProcessReap(idProcess, &iStat, &xUsage, bBlock);
+
+    if(!iRval)
+    {
+      return 0; // still running
+    }
+
+    __WBProcessRemove(idProcess); // status has been consumed
+  }
+  else
+  {
+    do
+    {
+      pid = wait4(idProcess, &iStat, bBlock ? 0 : WNOHANG, &xUsage);
+    } while(pid < 0 && errno == EINTR);
+
+    if(!pid)
+    {
+      return 0; // still running
+    }
+
+    iRval = pid > 0 ? 1 : -1;
+
+    if(iRval > 0)
+    {
+      __WBProcessStatsEnd(idProcess, iStat, &xUsage);
+    }
+  }
+
+  memset(pCompletion, 0, sizeof(*pCompletion));
+  pCompletion->idProcess = idProcess;
+
+  if(iRval < 0) // not my child, or it was already reaped
+  {
+    pCompletion->iStatus = -1;
+    pCompletion->iExitCode = -1;
+
+    return 1;
+  }
+
+  pCompletion->iStatus = iStat;
+  pCompletion->iExitCode = __WBExitCodeFromStatus(iStat);
+  pCompletion->iSignal = WIFSIGNALED(iStat) ? WTERMSIG(iStat) : 0;
+
+  __WBRunUsageFromRusage(&(pCompletion->xUsage), &xUsage);
+
+  return 1;
+}
+
+static int __WBWaitMany(const WB_PROCESS_ID *paidProcess, int nProcesses, WB_PROCESS_COMPLETION *pCompletions,
+                        int nTimeout, int bAll)
+{
+WB_FILE_HANDLE *pahPidFD = NULL;
+WB_FILE_HANDLE hEpoll = WB_INVALID_FILE_HANDLE;
+WB_UINT64 ullDeadline = 0, ullNow;
+uint32_t uiDelay = 100; // back off from 0.1 msec up to 10 msec, for processes without a pidfd
+int i1, i2, nDone = 0, nPending = 0, nSlow = 0, nWait;
+#ifdef __linux__
+struct epoll_event aEvents[WB_WAIT_MANY_EVENTS], xEvent;
+#endif // __linux__
+
+
+  if(!paidProcess || !pCompletions || nProcesses < 0)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if(nTimeout > 0)
+  {
+    ullDeadline = __WBMonotonicTime() + (WB_UINT64)nTimeout;
+  }
+
+  pahPidFD = (WB_FILE_HANDLE *)WBAlloc((nProcesses ? nProcesses : 1) * sizeof(WB_FILE_HANDLE));
+
+  if(!pahPidFD)
+  {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  // FIRST, check every process without blocking, and set up the epoll set for the ones still running
+
+  for(i1=0; i1 < nProcesses; i1++)
+  {
+    pahPidFD[i1] = WB_INVALID_FILE_HANDLE;
+    pCompletions[i1].idProcess = WB_INVALID_PROCESS_ID;
+
+    if(WB_PROCESS_ID_INVALID(paidProcess[i1])) // an empty slot
+    {
+      continue;
+    }
+
+    if(__WBWaitManyCheck(paidProcess[i1], &(pCompletions[i1]), 0))
+    {
+      nDone++;
+      continue;
+    }
+
+    nPending++;
+
+#ifdef __linux__
+    if(nTimeout != 0)
+    {
+      // a copy of the pidfd, in case another thread consumes the status (and closes the original)
+
+      pahPidFD[i1] = __WBProcessPidFDDup(paidProcess[i1]);
+
+      if(pahPidFD[i1] != WB_INVALID_FILE_HANDLE && hEpoll == WB_INVALID_FILE_HANDLE)
+      {
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+      }
+
+      if(pahPidFD[i1] != WB_INVALID_FILE_HANDLE && hEpoll != WB_INVALID_FILE_HANDLE)
+      {
+        memset(&xEvent, 0, sizeof(xEvent));
+        xEvent.events = EPOLLIN;
+        xEvent.data.u32 = (uint32_t)i1;
+
+        if(!epoll_ctl(hEpoll, EPOLL_CTL_ADD, pahPidFD[i1], &xEvent))
+        {
+          continue;
+        }
+      }
+
+      if(pahPidFD[i1] != WB_INVALID_FILE_HANDLE)
+      {
+        close(pahPidFD[i1]);
+        pahPidFD[i1] = WB_INVALID_FILE_HANDLE;
+      }
+    }
+#endif // __linux__
+
+    nSlow++; // no pidfd, so it's checked periodically
+  }
+
+  // NEXT, sleep until enough of them have exited, or the time runs out
+
+  while(nPending > 0 && (bAll || !nDone) && nTimeout != 0)
+  {
+    nWait = -1; // milliseconds
+
+    if(nTimeout > 0)
+    {
+      ullNow = __WBMonotonicTime();
+
+      if(ullNow >= ullDeadline)
+      {
+        break;
+      }
+
+      nWait = (int)((ullDeadline - ullNow + 999) / 1000);
+    }
+
+    if(nSlow && (nWait < 0 || nWait > (int)(uiDelay + 999) / 1000))
+    {
+      nWait = (int)(uiDelay + 999) / 1000;
+    }
+
+#ifdef __linux__
+    if(hEpoll != WB_INVALID_FILE_HANDLE && nPending > nSlow)
+    {
+      i2 = epoll_wait(hEpoll, aEvents, WB_WAIT_MANY_EVENTS, nWait);
+
+      if(i2 < 0 && errno != EINTR)
+      {
+        WB_ERROR_PRINT("ERROR:  %s - epoll_wait failed, errno=%d\n", __FUNCTION__, errno);
+        break;
+      }
+
+      for(i1=0; i1 < i2; i1++)
+      {
+        int iIndex = (int)aEvents[i1].data.u32;
+
+        if(pahPidFD[iIndex] == WB_INVALID_FILE_HANDLE) // already done
+        {
+          continue;
+        }
+
+        epoll_ctl(hEpoll, EPOLL_CTL_DEL, pahPidFD[iIndex], NULL);
+        close(pahPidFD[iIndex]);
+        pahPidFD[iIndex] = WB_INVALID_FILE_HANDLE;
+
+        nPending--;
+
+        if(__WBWaitManyCheck(paidProcess[iIndex], &(pCompletions[iIndex]), 1)) // it exited, so this won't block for long
+        {
+          nDone++;
+        }
+        else
+        {
+          nSlow++; // the pidfd is gone (released by another thread?) so fall back to checking it
+          nPending++;
+        }
+      }
+    }
+    else
+#endif // __linux__
+    {
+      WBDelay(uiDelay);
+    }
+
+    if(nSlow)
+    {
+      for(i1=0; i1 < nProcesses; i1++)
+      {
+        if(!WB_PROCESS_ID_INVALID(paidProcess[i1]) && WB_PROCESS_ID_INVALID(pCompletions[i1].idProcess) &&
+           pahPidFD[i1] == WB_INVALID_FILE_HANDLE &&
+           __WBWaitManyCheck(paidProcess[i1], &(pCompletions[i1]), 0))
+        {
+          nDone++;
+          nPending--;
+          nSlow--;
+        }
+      }
+
+      if(uiDelay < 10000)
+      {
+        uiDelay *= 2;
+      }
+    }
+  }
+
+  for(i1=0; i1 < nProcesses; i1++)
+  {
+    if(pahPidFD[i1] != WB_INVALID_FILE_HANDLE)
+    {
+      close(pahPidFD[i1]);
+    }
+  }
+
+  if(hEpoll != WB_INVALID_FILE_HANDLE)
+  {
+    close(hEpoll);
+  }
+
+  WBFree(pahPidFD);
+
+  return nDone;
+}
+
+int WBWaitAny(const WB_PROCESS_ID *paidProcess, int nProcesses, WB_PROCESS_COMPLETION *pCompletions, int nTimeout)
+{
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+  return __WBWaitMany(paidProcess, nProcesses, pCompletions, nTimeout, 0);
+#endif // WIN32
+}
+
+int WBWaitAll(const WB_PROCESS_ID *paidProcess, int nProcesses, WB_PROCESS_COMPLETION *pCompletions, int nTimeout)
+{
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+  return __WBWaitMany(paidProcess, nProcesses, pCompletions, nTimeout, 1);
+#endif // WIN32
+}
+
+// REAPER THREAD - one thread that reaps every tracked process as soon as it exits
+//
+// The thread sleeps in 'epoll_wait()' on the pidfds (and fork server reply sockets) of all of the
+// processes in the process table.  When one becomes readable, the process is reaped through the
+// process table, which caches its status (so WBGetProcessState() and WBWaitProcess() return it
+// right away) and wakes only the threads waiting for that process.  With the completion queue
+// enabled, the status is also posted to a queue that WBReaperGetCompletion() reads.  The reaper
+// thread pushes onto the queue with a compare-and-swap, without a lock.  A consumer takes the whole
+// list at once, and reverses it onto a FIFO list that only the consumers use.
+
+#ifdef __linux__
+
+typedef struct __WB_REAPER_ITEM__
+{
+  struct __WB_REAPER_ITEM__ *pNext;
+  WB_PROCESS_COMPLETION xCompletion;
+} WB_REAPER_ITEM;
+
+static pthread_mutex_t mtxReaperControl = PTHREAD_MUTEX_INITIALIZER; // WBReaperStart and WBReaperStop
+static pthread_mutex_t mtxReaper = PTHREAD_MUTEX_INITIALIZER;        // the consumer side of the queue
+static pthread_cond_t condReaper;                  // signaled when something is posted, if there are waiters
+static int bReaperCondInit = 0;
+static WB_REAPER_ITEM * volatile pReaperIncoming = NULL; // pushed by the reaper thread (LIFO)
+static WB_REAPER_ITEM *pReaperHead = NULL, *pReaperTail = NULL; // FIFO, 'mtxReaper' must be locked
+static volatile WB_UINT32 nReaperWaiters = 0;
+static volatile int bReaperRunning = 0, bReaperQueue = 0;
+static WB_THREAD thrdReaper;
+static WB_FILE_HANDLE hReaperStop = WB_INVALID_FILE_HANDLE; // an eventfd that tells the thread to exit
+
+// post a completion to the queue.  This removes the process from the process table, since the
+// status now belongs to whoever reads the queue.
+
+static void __WBReaperPost(WB_PROCESS_ID idProcess, int iStatus, const struct rusage *pUsage)
+{
+WB_PROCESS_ENTRY *pE;
+WB_REAPER_ITEM *pItem;
+int bPost;
+
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  pE = __WBProcessLookup(idProcess);
+  bPost = pE && !pE->bCapture; // the capture engine's processes are not the caller's business
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  if(!bPost)
+  {
+    return;
+  }
+
+  pItem = (WB_REAPER_ITEM *)WBAlloc(sizeof(*pItem));
+
+  if(!pItem)
+  {
+    return; // the status stays in the process table, so WBWaitProcess() can still get it
+  }
+
+  pItem->xCompletion.idProcess = idProcess;
+  pItem->xCompletion.iStatus = iStatus;
+  pItem->xCompletion.iExitCode = __WBExitCodeFromStatus(iStatus);
+  pItem->xCompletion.iSignal = WIFSIGNALED(iStatus) ? WTERMSIG(iStatus) : 0;
+
+  __WBRunUsageFromRusage(&(pItem->xCompletion.xUsage), pUsage);
+
+  __WBProcessRemove(idProcess);
+
+  do
+  {
+    pItem->pNext = pReaperIncoming;
+  } while(!__sync_bool_compare_and_swap(&pReaperIncoming, pItem->pNext, pItem));
+
+  // a consumer increments 'nReaperWaiters' before it checks 'pReaperIncoming' for the last time,
+  // and both of these are full barriers, so either it sees my item or I see that it's waiting
+
+  if(WBInterlockedRead(&nReaperWaiters))
+  {
+    pthread_mutex_lock(&mtxReaper);
+    pthread_cond_signal(&condReaper);
+    pthread_mutex_unlock(&mtxReaper);
+  }
+}
+
+// move everything that's been posted onto the FIFO list.  'mtxReaper' must be locked
+
+static void __WBReaperTakeIncoming(void)
+{
+WB_REAPER_ITEM *pList, *pNext, *pReversed = NULL, *pLast;
+
+
+  do
+  {
+    pList = pReaperIncoming;
+  } while(pList && !__sync_bool_compare_and_swap(&pReaperIncoming, pList, NULL));
+
+  pLast = pList; // the oldest one, once it's reversed
+
+  while(pList)
+  {
+    pNext = pList->pNext;
+    pList->pNext = pReversed;
+    pReversed = pList;
+    pList = pNext;
+  }
+
+  if(!pReversed)
+  {
+    return;
+  }
+
+  if(pReaperTail)
+  {
+    pReaperTail->pNext = pReversed;
+  }
+  else
+  {
+    pReaperHead = pReversed;
+  }
+
+  pReaperTail = pLast;
+}
+
+static void * __WBReaperThread(void *pParam)
+{
+struct epoll_event aEvents[64];
+struct rusage xUsage;
+WB_PROCESS_ID idProcess;
+int i1, nEvents, iStat;
+
+
+  (void)pParam; // not used
+
+  while(1)
+  {
+    nEvents = epoll_wait(hReaperEpoll, aEvents, sizeof(aEvents) / sizeof(aEvents[0]), -1);
+
+    if(nEvents < 0)
+    {
+      if(errno == EINTR)
+      {
+        continue;
+      }
+
+      WB_ERROR_PRINT("ERROR:  %s - epoll_wait failed, errno=%d\n", __FUNCTION__, errno);
+      break;
+    }
+
+    for(i1=0; i1 < nEvents; i1++)
+    {
+      if(!aEvents[i1].data.u64) // the 'stop' eventfd
+      {
+        return NULL;
+      }
+
+      idProcess = (WB_PROCESS_ID)aEvents[i1].data.u64;
+
+      // if another thread is reaping it, this returns zero and that thread posts nothing.
+      // that's fine - the status is cached in the process table either way.
+
+      if(__WBProcessReap(idProcess, &iStat, &xUsage, 0) > 0 && bReaperQueue)
+      {
+        __WBReaperPost(idProcess, iStat, &xUsage);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+#endif // __linux__
+
+int WBReaperStart(int iFlags)
+{
+#ifdef __linux__
+pthread_condattr_t xAttr;
+struct epoll_event xEvent;
+WB_PROCESS_ENTRY *pE;
+WB_FILE_HANDLE hEpoll, hStop;
+int i1;
+
+
+  pthread_mutex_lock(&mtxReaperControl);
+
+  if(bReaperRunning)
+  {
+    bReaperQueue = (iFlags & WB_REAPER_COMPLETION_QUEUE) ? 1 : 0;
+
+    pthread_mutex_unlock(&mtxReaperControl);
+    return 0;
+  }
+
+  if(WBProcessUsePidFD(1) < 0) // the reaper only knows about tracked processes
+  {
+    pthread_mutex_unlock(&mtxReaperControl);
+
+    errno = ENOSYS;
+    return -1;
+  }
+
+  if(!bReaperCondInit)
+  {
+    pthread_condattr_init(&xAttr);
+    pthread_condattr_setclock(&xAttr, CLOCK_MONOTONIC); // same clock as __WBMonotonicTime()
+    pthread_cond_init(&condReaper, &xAttr);
+    pthread_condattr_destroy(&xAttr);
+
+    bReaperCondInit = 1;
+  }
+
+  hEpoll = epoll_create1(EPOLL_CLOEXEC);
+  hStop = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  memset(&xEvent, 0, sizeof(xEvent));
+  xEvent.events = EPOLLIN;
+  xEvent.data.u64 = 0;
+
+  if(hEpoll < 0 || hStop < 0 || epoll_ctl(hEpoll, EPOLL_CTL_ADD, hStop, &xEvent))
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to create the epoll set, errno=%d\n", __FUNCTION__, errno);
+
+    goto start_error;
+  }
+
+  bReaperQueue = (iFlags & WB_REAPER_COMPLETION_QUEUE) ? 1 : 0;
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  hReaperEpoll = hEpoll;
+
+  for(i1=0; i1 < WB_PROCESS_TABLE_SIZE; i1++) // anything that was already being tracked
+  {
+    for(pE = apProcessTable[i1]; pE; pE = pE->pNext)
+    {
+      __WBProcessReaperAdd(pE);
+    }
+  }
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  hReaperStop = hStop;
+  thrdReaper = WBThreadCreate(__WBReaperThread, NULL);
+
+  if(thrdReaper == (WB_THREAD)INVALID_HANDLE_VALUE)
+  {
+    pthread_mutex_lock(&mtxProcessTable);
+    hReaperEpoll = WB_INVALID_FILE_HANDLE; // entries that were added close their pidfd when they're reaped
+    pthread_mutex_unlock(&mtxProcessTable);
+
+    hReaperStop = WB_INVALID_FILE_HANDLE;
+    bReaperQueue = 0;
+
+    goto start_error;
+  }
+
+  bReaperRunning = 1;
+
+  pthread_mutex_unlock(&mtxReaperControl);
+
+  return 0;
+
+start_error:
+
+  if(hEpoll >= 0)
+  {
+    close(hEpoll);
+  }
+
+  if(hStop >= 0)
+  {
+    close(hStop);
+  }
+
+  pthread_mutex_unlock(&mtxReaperControl);
+
+  return -1;
+
+#else // __linux__
+
+  errno = ENOSYS;
+  return -1;
+
+#endif // __linux__
+}
+
+void WBReaperStop(void)
+{
+#ifdef __linux__
+WB_FILE_HANDLE hEpoll;
+WB_UINT64 ullOne = 1;
+
+
+  pthread_mutex_lock(&mtxReaperControl);
+
+  if(!bReaperRunning)
+  {
+    pthread_mutex_unlock(&mtxReaperControl);
+    return;
+  }
+
+  while(write(hReaperStop, &ullOne, sizeof(ullOne)) < 0 && errno == EINTR)
+  {
+    // just try again
+  }
+
+  WBThreadWait(thrdReaper);
+
+  pthread_mutex_lock(&mtxProcessTable);
+
+  hEpoll = hReaperEpoll;
+  hReaperEpoll = WB_INVALID_FILE_HANDLE;
+
+  pthread_mutex_unlock(&mtxProcessTable);
+
+  close(hEpoll);
+  close(hReaperStop);
+  hReaperStop = WB_INVALID_FILE_HANDLE;
+
+  pthread_mutex_lock(&mtxReaper);
+
+  bReaperRunning = 0;
+  bReaperQueue = 0;
+
+  pthread_cond_broadcast(&condReaper); // anyone waiting for a completion gives up
+
+  pthread_mutex_unlock(&mtxReaper);
+
+  pthread_mutex_unlock(&mtxReaperControl);
+#endif // __linux__
+}
+
+int WBReaperGetCompletion(WB_PROCESS_COMPLETION *pCompletion, int nTimeout)
+{
+#ifdef __linux__
+WB_REAPER_ITEM *pItem;
+WB_UINT64 ullDeadline = 0;
+struct timespec ts;
+int iErr = 0;
+
+
+  if(nTimeout > 0)
+  {
+    ullDeadline = __WBMonotonicTime() + (WB_UINT64)nTimeout;
+
+    ts.tv_sec = ullDeadline / 1000000;
+    ts.tv_nsec = (ullDeadline % 1000000) * 1000;
+  }
+
+  pthread_mutex_lock(&mtxReaper);
+
+  while(1)
+  {
+    if(!pReaperHead)
+    {
+      __WBReaperTakeIncoming();
+    }
+
+    if(pReaperHead)
+    {
+      pItem = pReaperHead;
+      pReaperHead = pItem->pNext;
+
+      if(!pReaperHead)
+      {
+        pReaperTail = NULL;
+      }
+
+      pthread_mutex_unlock(&mtxReaper);
+
+      *pCompletion = pItem->xCompletion;
+      WBFree(pItem);
+
+      return 0;
+    }
+
+    if(!bReaperQueue)
+    {
+      pthread_mutex_unlock(&mtxReaper);
+
+      errno = EINVAL; // nothing will ever be posted
+      return -1;
+    }
+
+    if(!nTimeout || iErr == ETIMEDOUT)
+    {
+      pthread_mutex_unlock(&mtxReaper);
+      return 1;
+    }
+
+    WBInterlockedIncrement(&nReaperWaiters);
+
+    if(!pReaperIncoming) // the last check, after I've said that I'm waiting
+    {
+      iErr = nTimeout > 0 ? pthread_cond_timedwait(&condReaper, &mtxReaper, &ts)
+                          : pthread_cond_wait(&condReaper, &mtxReaper);
+    }
+
+    WBInterlockedDecrement(&nReaperWaiters);
+  }
+
+#else // __linux__
+
+  errno = ENOSYS;
+  return -1;
+
+#endif // __linux__
+}
+
+
+#endif // !WIN32
+
+// the arguments for the program, from one of three sources, so that the va_list and the array-based
+// functions can share the same code.  Exactly one of 'pva', 'ppArgs', or 'ppArgv' is used.
+
+typedef struct __WB_RUN_ARGS__
+{
+  va_list *pva;               // a va_list of parameters (not including argv[0]), NULL terminated
+  const char * const *ppArgs; // an array of parameters (not including argv[0]), NULL terminated
+  char * const *ppArgv;       // a complete 'argv' array (including argv[0]), passed as-is
+  char * const *envp;         // the environment for the process, or NULL for the caller's environment
+  const struct __WB_SPAWN_SETUP__ *pSetup; // resource limits and cgroup for the child, or NULL
+  int bCapture;               // started by the capture engine (which reaps it and removes it from the process table)
+  WB_EXECUTABLE *pExecutable; // the program to run (instead of looking up the application name), or NULL
+} WB_RUN_ARGS;
+
+#define WB_RUN_ARGS_STACK_SIZE 2048 /* 'argv' blocks up to this size don't need to be allocated */
+
+#ifndef WIN32
+
+// the copies of the stdin/stdout/stderr handles that are passed to the child are close-on-exec, so
+// that a process started by another thread at the same time doesn't inherit them.  They're never 0,
+// 1 or 2, so the 'dup2' in the child always creates a new descriptor (which clears FD_CLOEXEC).
+
+static WB_FILE_HANDLE __WBOpenDevNull(int iFlags)
+{
+WB_FILE_HANDLE hRval, h2;
+
+
+  hRval = open("/dev/null", iFlags | O_CLOEXEC, 0);
+
+  if(hRval >= 0 && hRval <= 2) // stdin, stdout, or stderr was closed
+  {
+    h2 = fcntl(hRval, F_DUPFD_CLOEXEC, 3);
+    close(hRval);
+
+    hRval = h2;
+  }
+
+  return hRval;
+}
+
+#endif // !WIN32
+
+// EXECUTABLE HANDLES - a program that is located once, and opened with O_PATH, so that each process
+// can be started with 'execveat()' on the descriptor instead of searching PATH and resolving the path
+// again.  The descriptor and the file's identity (device, inode, and modification time) make up an
+// 'image'.  Every WB_EXECUTABLE_RECHECK microseconds, one spawn re-checks the path with 'stat()', and
+// if it has been replaced or modified, a new image is opened.  A spawn holds a reference to the image
+// it uses, so an old image's descriptor stays open until the last process using it has been started.
+
+#define WB_EXECUTABLE_RECHECK WB_PATH_CACHE_RECHECK /* microseconds between checks of the path */
+
+#ifdef WIN32
+#error executable handles not yet implemented for WIN32
+#else // !WIN32
+
+typedef struct __WB_EXECUTABLE_IMAGE__
+{
+  volatile WB_UINT32 nRefs;
+  WB_FILE_HANDLE hFD;         // O_PATH (or O_RDONLY) descriptor, close-on-exec and never 0, 1, or 2
+  dev_t idDev;
+  ino_t idIno;
+  struct timespec tsMTime;
+  int bScript;                // a '#!' script, which can't be run from a close-on-exec descriptor
+} WB_EXECUTABLE_IMAGE;
+
+struct __WB_EXECUTABLE__
+{
+  volatile WB_UINT32 nRefs;
+  pthread_mutex_t mtxImage;   // protects 'pImage' and 'ullNextCheck'
+  WB_EXECUTABLE_IMAGE *pImage; // NULL when the file can't be opened (the path is used instead)
+  WB_UINT64 ullNextCheck;     // __WBMonotonicTime() for the next check of the path
+  char szPath[1];             // the full path (the rest of the allocation)
+};
+
+static void __WBExecutableImageRelease(WB_EXECUTABLE_IMAGE *pImage)
+{
+  if(pImage && !WBInterlockedDecrement(&(pImage->nRefs)))
+  {
+    close(pImage->hFD);
+    WBFree(pImage);
+  }
+}
+
+// open an image of 'szPath', which 'stat()' says is 'pStat'.  returns NULL on error
+
+static WB_EXECUTABLE_IMAGE * __WBExecutableImageOpen(const char *szPath, const struct stat *pStat)
+{
+WB_EXECUTABLE_IMAGE *pRval;
+WB_FILE_HANDLE hFD, h2;
+struct stat sF;
+char tbuf[2];
+
+
+  if(!S_ISREG(pStat->st_mode))
+  {
+    errno = EACCES;
+    return NULL;
+  }
+
+#ifdef O_PATH
+  hFD = open(szPath, O_PATH | O_CLOEXEC);
+#else // O_PATH
+  hFD = open(szPath, O_RDONLY | O_CLOEXEC); // for 'fexecve'
+#endif // O_PATH
+
+  if(hFD < 0)
+  {
+    return NULL;
+  }
+
+  if(hFD <= 2) // stdin, stdout, or stderr was closed, and the child's 'dup2' would replace it
+  {
+    h2 = fcntl(hFD, F_DUPFD_CLOEXEC, 3);
+    close(hFD);
+
+    if(h2 < 0)
+    {
+      return NULL;
+    }
+
+    hFD = h2;
+  }
+
+  if(fstat(hFD, &sF) || sF.st_dev != pStat->st_dev || sF.st_ino != pStat->st_ino) // replaced in between
+  {
+    close(hFD);
+    errno = EAGAIN;
+    return NULL;
+  }
+
+  pRval = (WB_EXECUTABLE_IMAGE *)WBAlloc(sizeof(*pRval));
+
+  if(!pRval)
+  {
+    close(hFD);
+    return NULL;
+  }
+
+  pRval->nRefs = 1;
+  pRval->hFD = hFD;
+  pRval->idDev = sF.st_dev;
+  pRval->idIno = sF.st_ino;
+  pRval->tsMTime = sF.st_mtim;
+  pRval->bScript = 0;
+
+  // the kernel runs a script's interpreter with '/dev/fd/N' as the script, which no longer exists
+  // after the 'exec' when N is close-on-exec.  Those are run by their path.  A program that can't
+  // be read (execute permission only) isn't a script.
+
+  h2 = open(szPath, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+
+  if(h2 >= 0)
+  {
+    pRval->bScript = read(h2, tbuf, 2) == 2 && tbuf[0] == '#' && tbuf[1] == '!';
+
+    close(h2);
+  }
+
+  return pRval;
+}
+
+// return a reference to the current image, re-checking the path when it's time to.  The return
+// value (which may be NULL) must be released with __WBExecutableImageRelease()
+
+static WB_EXECUTABLE_IMAGE * __WBExecutableImageGet(WB_EXECUTABLE *pExe)
+{
+WB_EXECUTABLE_IMAGE *pRval, *pOld;
+struct stat sF;
+WB_UINT64 ullNow;
+
+
+  ullNow = __WBMonotonicTime();
+
+  pthread_mutex_lock(&(pExe->mtxImage));
+
+  if(WB_UNLIKELY(ullNow >= pExe->ullNextCheck))
+  {
+    pOld = pExe->pImage;
+
+    if(stat(pExe->szPath, &sF)) // it's gone, so the path is used (and 'execve' reports the error)
+    {
+      pExe->pImage = NULL;
+    }
+    else if(!pOld || pOld->idDev != sF.st_dev || pOld->idIno != sF.st_ino ||
+            pOld->tsMTime.tv_sec != sF.st_mtim.tv_sec || pOld->tsMTime.tv_nsec != sF.st_mtim.tv_nsec)
+    {
+      pExe->pImage = __WBExecutableImageOpen(pExe->szPath, &sF); // NULL on error, which uses the path
+    }
+    else
+    {
+      pOld = NULL; // unchanged
+    }
+
+    if(pOld)
+    {
+      __WBExecutableImageRelease(pOld); // processes being started with it still hold a reference
+    }
+
+    pExe->ullNextCheck = ullNow + WB_EXECUTABLE_RECHECK;
+  }
+
+  pRval = pExe->pImage;
+
+  if(pRval)
+  {
+    WBInterlockedIncrement(&(pRval->nRefs));
+  }
+
+  pthread_mutex_unlock(&(pExe->mtxImage));
+
+  return pRval;
+}
+
+WB_EXECUTABLE * WBExecutableOpen(const char *szAppName)
+{
+WB_EXECUTABLE *pRval;
+const char *pPath;
+char szBuf[PATH_MAX];
+
+
+  if(!szAppName || !*szAppName)
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  pPath = __WBSearchPathInternal(szAppName, szBuf);
+
+  if(!pPath)
+  {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  pRval = (WB_EXECUTABLE *)WBAlloc(sizeof(*pRval) + strlen(pPath));
+
+  if(!pRval)
+  {
+    return NULL;
+  }
+
+  memset(pRval, 0, sizeof(*pRval));
+  strcpy(pRval->szPath, pPath);
+
+  pRval->nRefs = 1;
+  pthread_mutex_init(&(pRval->mtxImage), NULL);
+
+  __WBExecutableImageRelease(__WBExecutableImageGet(pRval)); // opens the first image (ullNextCheck is zero)
+
+  if(!pRval->pImage)
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to open \"%s\", errno=%d\n", __FUNCTION__, pRval->szPath, errno);
+
+    WBExecutableRelease(pRval);
+    return NULL;
+  }
+
+  return pRval;
+}
+
+WB_EXECUTABLE * WBExecutableAddRef(WB_EXECUTABLE *pExe)
+{
+  if(pExe)
+  {
+    WBInterlockedIncrement(&(pExe->nRefs));
+  }
+
+  return pExe;
+}
+
+void WBExecutableRelease(WB_EXECUTABLE *pExe)
+{
+  if(pExe && !WBInterlockedDecrement(&(pExe->nRefs)))
+  {
+    __WBExecutableImageRelease(pExe->pImage);
+
+    pthread_mutex_destroy(&(pExe->mtxImage));
+    WBFree(pExe);
+  }
+}
+
+const char * WBExecutablePath(const WB_EXECUTABLE *pExe)
+{
+  return pExe ? pExe->szPath : NULL;
+}
+
+#endif // WIN32
+
+static WB_PROCESS_ID __WBRunAsyncPipeInternal(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
+                                              const char *szAppName, const WB_RUN_ARGS *pArgs)
+{
+const char *pArg;//, *pPath;
+const char *pAppName;
+char *pCur, *p1;
+char szPathBuf[PATH_MAX]; // for PATH search results that aren't cached
+#ifdef WIN32
+STARTUPINFO si;
+PROCESS_INFORMATION pi;
+int i1;
+#else // !WIN32
+extern char **environ; // this is what the man page says to do (it's part of libc)
+char **argv;
+char * const *envp;
+int i1, nItems, cbItems;
+va_list va2;
+union
+{
+  char *apArgs[1];
+  char cBuf[WB_RUN_ARGS_STACK_SIZE];
+} uArgBuf;
+#endif // WIN32
+WB_PROCESS_ID hRval = WB_INVALID_PROCESS_ID;
+WB_FILE_HANDLE hIn, hOut, hErr;
+WB_TRACE_DECLARE(ullTraceSearch)
+WB_TRACE_DECLARE(ullTraceSetup)
+
+
+  // NOTE:  to avoid zombies, must assign SIGCHLD to 'SIG_IGN' or process them correctly
+  //        (this is done in 'WBInit')
+
+  hIn = hOut = hErr = WB_INVALID_FILE_HANDLE; // by convention (WIN32 needs this anyway)
+
+  // FIRST, locate 'szAppName' (unless an executable handle already did)
+
+  WB_TRACE_STAMP(ullTraceSearch);
+
+#ifndef WIN32
+  if(pArgs->pExecutable)
+  {
+    pAppName = pArgs->pExecutable->szPath;
+  }
+  else
+#endif // !WIN32
+  {
+    pAppName = __WBSearchPathInternal(szAppName, szPathBuf); // does not need to be free'd
+  }
+
+  WB_TRACE_STAMP(ullTraceSetup);
+  WB_TRACE_RECORD(WB_SPAWN_PHASE_SEARCH, ullTraceSearch, ullTraceSetup);
+
+  if(hStdIn == WB_INVALID_FILE_HANDLE) // re-dir to/from /dev/null
+  {
+#ifndef WIN32
+    hIn = __WBOpenDevNull(O_RDONLY);
+#else // WIN32
+    SECURITY_DESCRIPTOR *pSD = (SECURITY_DESCRIPTOR *)WBAlloc(SECURITY_DESCRIPTOR_MIN_LENGTH);
+
+    if(pSD)
+    {
+      SECURITY_ATTRIBUTES sa;
+
+      InitializeSecurityDescriptor(pSD,SECURITY_DESCRIPTOR_REVISION);
+
+      sa.nLength = sizeof(sa);
+      sa.lpSecurityDescriptor = pSD;
+      sa.bInheritHandle = TRUE; // what a pain
+
+      hIn = CreateFile("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                       &sa, OPEN_EXISTING, NULL, NULL);
+      WBFree(pSD);
+    }
+#endif // WIN32
+  }
+  else
+  {
+#ifndef WIN32
+    hIn = fcntl(hStdIn, F_DUPFD_CLOEXEC, 3); // see __WBOpenDevNull
+#else // WIN32
+    if(!DuplicateHandle(GetCurrentProcess(), hStdIn,
+                        GetCurrentProcess(), &hIn, GENERIC_READ,
+                        TRUE, 0))
+    {
+      hIn = WB_INVALID_FILE_HANDLE;
+    }
+#endif // WIN32
+  }
+
+  if(hStdOut == WB_INVALID_FILE_HANDLE) // re-dir to/from /dev/null
+  {
+#ifndef WIN32
+    hOut = __WBOpenDevNull(O_WRONLY);
+#else // WIN32
+    SECURITY_DESCRIPTOR *pSD = (SECURITY_DESCRIPTOR *)WBAlloc(SECURITY_DESCRIPTOR_MIN_LENGTH);
+
+    if(pSD)
+    {
+      SECURITY_ATTRIBUTES sa;
+
+      InitializeSecurityDescriptor(pSD,SECURITY_DESCRIPTOR_REVISION);
+
+      sa.nLength = sizeof(sa);
+      sa.lpSecurityDescriptor = pSD;
+      sa.bInheritHandle = TRUE; // what a pain
+
+      hOut = CreateFile("NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        &sa, OPEN_EXISTING, NULL, NULL);
+      WBFree(pSD);
+    }
+#endif // WIN32
+  }
+  else
+  {
+#ifndef WIN32
+    hOut = fcntl(hStdOut, F_DUPFD_CLOEXEC, 3); // see __WBOpenDevNull
+#else // WIN32
+    if(!DuplicateHandle(GetCurrentProcess(), hStdOut,
+                        GetCurrentProcess(), &hOut, GENERIC_WRITE,
+                        TRUE, 0))
+    {
+      hOut = WB_INVALID_FILE_HANDLE;
+    }
+#endif // WIN32
+  }
+
+  if(hStdErr == WB_INVALID_FILE_HANDLE) // re-dir to/from /dev/null
+  {
+#ifndef WIN32
+    hErr = __WBOpenDevNull(O_WRONLY);
+#else // WIN32
+    SECURITY_DESCRIPTOR *pSD = (SECURITY_DESCRIPTOR *)WBAlloc(SECURITY_DESCRIPTOR_MIN_LENGTH);
+
+    if(pSD)
+    {
+      SECURITY_ATTRIBUTES sa;
+
+      InitializeSecurityDescriptor(pSD,SECURITY_DESCRIPTOR_REVISION);
+
+      sa.nLength = sizeof(sa);
+      sa.lpSecurityDescriptor = pSD;
+      sa.bInheritHandle = TRUE; // what a pain
+
+      hErr = CreateFile("NUL", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                        &sa, OPEN_EXISTING, NULL, NULL);
+      WBFree(pSD);
+    }
+#endif // WIN32
+  }
+  else
+  {
+#ifndef WIN32
+    hErr = fcntl(hStdErr, F_DUPFD_CLOEXEC, 3); // see __WBOpenDevNull
+#else // WIN32
+    if(!DuplicateHandle(GetCurrentProcess(), hStdErr,
+                        GetCurrentProcess(), &hErr, GENERIC_WRITE,
+                        TRUE, 0))
+    {
+      hErr = WB_INVALID_FILE_HANDLE;
+    }
+#endif // WIN32
+  }
+
+  // if file handle duplication fails, exit now with an error
+
+  if(hIn == WB_INVALID_FILE_HANDLE ||
+     hOut == WB_INVALID_FILE_HANDLE ||
+     hErr == WB_INVALID_FILE_HANDLE)
+  {
+//    WB_ERROR_PRINT("TEMPORARY:  %s hIn=%d hOut=%d hErr=%d\n", __FUNCTION__, hIn, hOut, hErr);
+
+    if(hIn != WB_INVALID_FILE_HANDLE)
+    {
+#ifndef WIN32
+      close(hIn);
+#else // WIN32
+      CloseHandle(hIn);
+#endif // WIN32
+    }
+    if(hOut != WB_INVALID_FILE_HANDLE)
+    {
+#ifndef WIN32
+      close(hOut);
+#else // WIN32
+      CloseHandle(hOut);
+#endif // WIN32
+    }
+    if(hErr != WB_INVALID_FILE_HANDLE)
+    {
+#ifndef WIN32
+      close(hErr);
+#else // WIN32
+      CloseHandle(hErr);
+#endif // WIN32
+    }
+
+    return WB_INVALID_FILE_HANDLE;
+  }
+
+#ifdef WIN32
+
+  memset(&si, 0, sizeof(si));
+  memset(&pi, 0, sizeof(pi));
+
+  si.cb = sizeof(si);
+
+  si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+  si.hStdInput = hIn;
+  si.hStdOutput = hOut;
+  si.hStdError = hErr;
+
+  // make sure it is hidden
+  si.wShowWindow = SW_HIDE;
+
+
+  // get application name from path
+
+  p1 = _tcsrchr((TCHAR *)pAppName, '\\');
+  if(p1)
+  {
+    pCur = CopyString(p1 + 1); // just the name
+  }
+  else
+  {
+    pCur = CopyString(pAppName);
+  }
+
+  // build the command line
+
+  for(i1=0; ; i1++)
+  {
+    pArg = pArgs->ppArgv ? pArgs->ppArgv[i1 + 1] :
+           pArgs->ppArgs ? pArgs->ppArgs[i1] : va_arg(*(pArgs->pva), const TCHAR *);
+    if(!pArg)
+    {
+      break;
+    }
+
+    CatString(&pCur, _T(" "));
+    CatString(&pCur, pArg); // caller must add quotes as needed
+  }
+
+  if(CreateProcess(pAppName, pCur, NULL, NULL, TRUE, NORMAL_PRIORITY_CLASS,
+                    NULL, NULL, &si, &pi))  // it worked?
+  {
+      // wait for process to complete before continuing...
+
+//        SetCursor(LoadCursor(NULL, IDC_WAIT));
+    hRval.uiProcessID = pi.dwProcessId;
+    hRval.hProcess = pi.hProcess;
+    hRval.iCachedExitCode = -1;
+
+    WaitForInputIdle(pi.hProcess, 1000); // wait up to 1 sec to help it run
+  }
+  else
+  {
+    hRval = INVALID_PROCESS_ID;
+  }
+
+  free(pCur);
+  pCur = NULL;
+
+  CloseHandle(hIn);
+  CloseHandle(hOut);
+  CloseHandle(hErr);
+
+#else // WIN32
+
+  if(pArgs->ppArgv) // a complete 'argv' array, so there's nothing to build
+  {
+    argv = (char **)pArgs->ppArgv;
+    goto have_argv;
+  }
+
+  // count arguments, determine memory requirement
+
+  nItems = 0;
+  cbItems = 2 * sizeof(char *) + strlen(szAppName) + 1;
+
+  if(pArgs->ppArgs)
+  {
+    while(pArgs->ppArgs[nItems])
+    {
+      cbItems += strlen(pArgs->ppArgs[nItems]) + 1 + sizeof(char *);
+      nItems++;
+    }
+  }
+  else
+  {
+    va_copy(va2, *(pArgs->pva));
+
+    while(1)
+    {
+      pArg = va_arg(va2, const char *);
+      if(!pArg)
+      {
+        break;
+      }
+
+      cbItems += strlen(pArg) + 1 + sizeof(char *);
+      nItems++;
+    }
+
+    va_end(va2);
+  }
+
+  if(64 + cbItems <= (int)sizeof(uArgBuf)) // small enough for the stack
+  {
+    argv = uArgBuf.apArgs;
+  }
+  else
+  {
+    argv = (char **)WBAlloc(64 + cbItems);
+  }
+
+  if(!argv)
+  {
+    close(hIn);
+    close(hOut);
+    close(hErr);
+
+//    WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (1)\n", __FUNCTION__);
+    return WB_INVALID_FILE_HANDLE;
+  }
+
+  pCur = (char *)(argv + nItems + 2); // enough room for argument pointers
+
+  p1 = strrchr(szAppName, '/');
+  if(p1)
+  {
+    strcpy(pCur, p1 + 1); // just the name
+  }
+  else
+  {
+    strcpy(pCur, szAppName);
+  }
+
+  argv[0] = pCur;
+  pCur += strlen(pCur) + 1;
+
+  for(i1=1; i1 <= nItems; i1++)
+  {
+    pArg = pArgs->ppArgs ? pArgs->ppArgs[i1 - 1] : va_arg(*(pArgs->pva), const char *);
+
+    strcpy(pCur, pArg);
+    argv[i1] = pCur;
+    pCur += strlen(pCur) + 1;
+  }
+
+  argv[nItems + 1] = NULL;
+
+have_argv:
+
+  envp = pArgs->envp ? pArgs->envp : environ;
+
+  // now that I have a valid 'argv' I can spawn the process.
+  // I will return the PID so that the caller can wait on it
+
+  {
+    WB_FILE_HANDLE hPidFD, hExec = WB_INVALID_FILE_HANDLE;
+    WB_EXECUTABLE_IMAGE *pImage = NULL;
+
+    if(pArgs->pExecutable)
+    {
+      pImage = __WBExecutableImageGet(pArgs->pExecutable); // holds the descriptor open until the child has it
+
+      if(pImage && !pImage->bScript)
+      {
+        hExec = pImage->hFD;
+      }
+    }
+
+    WB_TRACE_SPAWN_BEGIN(ullTraceSearch); // re-use it for the start of the spawn
+    WB_TRACE_RECORD(WB_SPAWN_PHASE_SETUP, ullTraceSetup, ullTraceSearch);
+
+    hRval = WB_INVALID_PROCESS_ID;
+    errno = ENOSYS;
+
+    if(pAppName && hForkServer != WB_INVALID_FILE_HANDLE && !pArgs->pExecutable &&
+       (!pArgs->pSetup || !pArgs->pSetup->nKeepFDs)) // the fork server doesn't have the caller's descriptors
+    {
+      // the fork server is the parent, so it MUST be tracked - only the reply socket has its status
+
+      hRval = __WBForkServerSpawn(pAppName, argv, envp, hIn, hOut, hErr, &hPidFD, pArgs->pSetup);
+
+      if(!WB_PROCESS_ID_INVALID(hRval))
+      {
+        __WBProcessRegister(hRval, hPidFD, 1, pArgs->bCapture);
+      }
+    }
+
+    if(WB_PROCESS_ID_INVALID(hRval) && errno == ENOSYS) // no fork server, or it's gone away
+    {
+      if(bProcessUsePidFD)
+      {
+        hRval = __WBSpawnProcess(pAppName, hExec, argv, envp, hIn, hOut, hErr, &hPidFD, pArgs->pSetup);
+
+        if(!WB_PROCESS_ID_INVALID(hRval) && hPidFD != WB_INVALID_FILE_HANDLE)
+        {
+          __WBProcessRegister(hRval, hPidFD, 0, pArgs->bCapture);
+        }
+      }
+      else
+      {
+        hRval = __WBSpawnProcess(pAppName, hExec, argv, envp, hIn, hOut, hErr, NULL, pArgs->pSetup);
+      }
+    }
+
+    WB_TRACE_SPAWN_END(ullTraceSearch, !WB_PROCESS_ID_INVALID(hRval));
+
+    __WBExecutableImageRelease(pImage);
+
+    if(bProcessStats && !WB_PROCESS_ID_INVALID(hRval))
+    {
+      __WBProcessStatsStart(hRval, pAppName);
+    }
+  }
+
+  // once I've forked, I don't have to worry about copied memory or shared memory
+  // and it's safe to free the allocated 'argv' array.
+
+  if(argv != uArgBuf.apArgs && argv != (char **)pArgs->ppArgv)
+  {
+    WBFree(argv);
+  }
+
+  close(hIn);
+  close(hOut);
+  close(hErr);
+
+#endif // WIN32
+
+  return hRval;
+}
+
+
+WB_PROCESS_ID WBRunAsyncPipeV(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
+                              const char *szAppName, va_list va)
+{
+WB_PROCESS_ID idRval;
+WB_RUN_ARGS xArgs;
+va_list va2;
+
+
+  va_copy(va2, va); // so I can pass it by reference
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.pva = &va2;
+
+  idRval = __WBRunAsyncPipeInternal(hStdIn, hStdOut, hStdErr, szAppName, &xArgs);
+
+  va_end(va2);
+
+  return idRval;
+}
+
+WB_PROCESS_ID WBRunAsync(const char *szAppName, ...)
+{
+WB_PROCESS_ID idRval;
+va_list va;
+
+  va_start(va, szAppName);
+
+  idRval = WBRunAsyncPipeV(WB_INVALID_FILE_HANDLE, WB_INVALID_FILE_HANDLE,
+                           WB_INVALID_FILE_HANDLE, szAppName, va);
+
+  va_end(va);
+
+  if(idRval == WB_INVALID_FILE_HANDLE)
+  {
+    WB_ERROR_PRINT("Unable to run '%s'\n", szAppName);
+  }
+//  else
+//  {
+//    WB_ERROR_PRINT("Running '%s' - pid=%d\n", szAppName, idRval);
+//  }
+
+  return idRval;
+}
+
+WB_PROCESS_ID WBRunAsyncPipe(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
+                             const char *szAppName, ...)
+{
+WB_PROCESS_ID idRval;
+va_list va;
+
+  va_start(va, szAppName);
+
+  idRval = WBRunAsyncPipeV(hStdIn, hStdOut, hStdErr, szAppName, va);
+
+  va_end(va);
+
+  return idRval;
+}
+
+WB_PROCESS_ID WBRunAsyncPipeArgv(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
+                                 const char *szAppName, char * const *argv, char * const *envp)
+{
+WB_RUN_ARGS xArgs;
+
+
+  if(!argv || !argv[0])
+  {
+    errno = EINVAL;
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.ppArgv = argv;
+  xArgs.envp = envp;
+
+  return __WBRunAsyncPipeInternal(hStdIn, hStdOut, hStdErr, szAppName ? szAppName : argv[0], &xArgs);
+}
+
+WB_PROCESS_ID WBRunExecutableAsyncPipeArgv(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
+                                           WB_EXECUTABLE *pExe, char * const *argv, char * const *envp)
+{
+WB_RUN_ARGS xArgs;
+
+
+  if(!pExe || !argv || !argv[0])
+  {
+    errno = EINVAL;
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.ppArgv = argv;
+  xArgs.envp = envp;
+  xArgs.pExecutable = pExe;
+
+  return __WBRunAsyncPipeInternal(hStdIn, hStdOut, hStdErr, argv[0], &xArgs);
+}
+
+
+// ARGUMENT ARENAS - re-usable memory for building 'argv' arrays.  The strings are stored by offset
+// so that the buffer can grow, and the pointer array is filled in by WBArgArenaArgv()
+
+static int __WBArgArenaGrow(WB_ARG_ARENA *pArena, size_t cbArg)
+{
+size_t cbNew;
+int nNew;
+void *p1;
+
+
+  if(pArena->nArgs + 2 > pArena->nMax) // room for one more, plus the NULL
+  {
+    nNew = pArena->nMax ? pArena->nMax * 2 : 16;
+
+    p1 = WBReAlloc(pArena->pOffsets, nNew * sizeof(size_t));
+    if(!p1)
+    {
+      return -1;
+    }
+
+    pArena->pOffsets = (size_t *)p1;
+
+    p1 = WBReAlloc(pArena->ppArgv, nNew * sizeof(char *));
+    if(!p1)
+    {
+      return -1;
+    }
+
+    pArena->ppArgv = (char **)p1;
+    pArena->nMax = nNew;
+  }
+
+  if(pArena->cbUsed + cbArg > pArena->cbBuf)
+  {
+    cbNew = pArena->cbBuf ? pArena->cbBuf * 2 : 1024;
+
+    while(cbNew < pArena->cbUsed + cbArg)
+    {
+      cbNew *= 2;
+    }
+
+    p1 = WBReAlloc(pArena->pBuf, cbNew);
+    if(!p1)
+    {
+      return -1;
+    }
+
+    pArena->pBuf = (char *)p1;
+    pArena->cbBuf = cbNew;
+  }
+
+  return 0;
+}
+
+void WBArgArenaInit(WB_ARG_ARENA *pArena)
+{
+  memset(pArena, 0, sizeof(*pArena));
+}
+
+void WBArgArenaFree(WB_ARG_ARENA *pArena)
+{
+  if(pArena->pBuf)
+  {
+    WBFree(pArena->pBuf);
+  }
+
+  if(pArena->pOffsets)
+  {
+    WBFree(pArena->pOffsets);
+  }
+
+  if(pArena->ppArgv)
+  {
+    WBFree(pArena->ppArgv);
+  }
+
+  memset(pArena, 0, sizeof(*pArena));
+}
+
+void WBArgArenaReset(WB_ARG_ARENA *pArena, int nKeep)
+{
+  if(nKeep < 0)
+  {
+    nKeep = 0;
+  }
+
+  if(nKeep < pArena->nArgs)
+  {
+    pArena->cbUsed = pArena->pOffsets[nKeep]; // everything after this is discarded
+    pArena->nArgs = nKeep;
+  }
+}
+
+int WBArgArenaAdd(WB_ARG_ARENA *pArena, const char *szArg)
+{
+size_t cbArg = strlen(szArg) + 1;
+
+
+  if(__WBArgArenaGrow(pArena, cbArg))
+  {
+    return -1;
+  }
+
+  memcpy(pArena->pBuf + pArena->cbUsed, szArg, cbArg);
+
+  pArena->pOffsets[pArena->nArgs++] = pArena->cbUsed;
+  pArena->cbUsed += cbArg;
+
+  return 0;
+}
+
+char * const * WBArgArenaArgv(WB_ARG_ARENA *pArena)
+{
+int i1;
+
+
+  if(__WBArgArenaGrow(pArena, 0)) // the first time, the pointer array might not exist yet
+  {
+    return NULL;
+  }
+
+  for(i1=0; i1 < pArena->nArgs; i1++)
+  {
+    pArena->ppArgv[i1] = pArena->pBuf + pArena->pOffsets[i1];
+  }
+
+  pArena->ppArgv[i1] = NULL;
+
+  return pArena->ppArgv;
+}
+
+
+// ENVIRONMENT SNAPSHOTS - read-only, reference counted copies of an environment.  The snapshot
+// of 'environ' is cached along with a copy of the 'environ' pointer array it was made from, and
+// re-used for as long as those pointers don't change (setenv, unsetenv, and putenv all change them).
+
+struct __WB_ENV_SNAPSHOT__
+{
+  volatile WB_UINT32 nRefs;
+  int nVars;
+  char **envp;  // NULL terminated, points into the same allocation (as do the strings)
+};
+
+static pthread_mutex_t mtxEnvSnapshot = PTHREAD_MUTEX_INITIALIZER;
+static WB_ENV_SNAPSHOT *pEnvSnapshot = NULL; // the cached snapshot of 'environ' (which holds a reference)
+static char **ppEnvSnapshotSource = NULL;    // a copy of the 'environ' pointers it was made from
+static int nEnvSnapshotSource = 0;
+
+// compare the variable names (up to the '=') of two 'NAME=VALUE' strings
+
+static int __WBEnvNameMatch(const char *p1, const char *p2)
+{
+  while(*p1 && *p1 != '=' && *p1 == *p2)
+  {
+    p1++;
+    p2++;
+  }
+
+  return (!*p1 || *p1 == '=') && (!*p2 || *p2 == '=');
+}
+
+// build a snapshot from 'nBase' strings in 'ppBase', with the (optional) overrides in 'ppVars'
+
+static WB_ENV_SNAPSHOT * __WBEnvSnapshotBuild(char * const *ppBase, int nBase, const char * const *ppVars)
+{
+WB_ENV_SNAPSHOT *pRval;
+size_t cbTotal;
+int i1, i2, nVars;
+char *p1;
+
+
+  // a variable in 'ppVars' replaces (or removes) the one in 'ppBase', and when 'ppVars'
+  // has the same name more than once, the last one wins.  The first pass measures, the
+  // second one copies.
+
+  pRval = NULL;
+  p1 = NULL;
+  cbTotal = 0;
+  nVars = 0;
+
+  while(1)
+  {
+    for(i1=0; i1 < nBase; i1++)
+    {
+      for(i2=0; ppVars && ppVars[i2]; i2++)
+      {
+        if(__WBEnvNameMatch(ppBase[i1], ppVars[i2]))
+        {
+          break;
+        }
+      }
+
+      if(ppVars && ppVars[i2]) // overridden
+      {
+        continue;
+      }
+
+      if(pRval)
+      {
+        pRval->envp[pRval->nVars++] = p1;
+        strcpy(p1, ppBase[i1]);
+        p1 += strlen(p1) + 1;
+      }
+      else
+      {
+        cbTotal += strlen(ppBase[i1]) + 1;
+        nVars++;
+      }
+    }
+
+    for(i1=0; ppVars && ppVars[i1]; i1++)
+    {
+      if(!strchr(ppVars[i1], '=')) // 'NAME' by itself means 'remove it'
+      {
+        continue;
+      }
+
+      for(i2=i1 + 1; ppVars[i2]; i2++)
+      {
+        if(__WBEnvNameMatch(ppVars[i1], ppVars[i2]))
+        {
+          break;
+        }
+      }
+
+      if(ppVars[i2]) // a later one replaces it
+      {
+        continue;
+      }
+
+      if(pRval)
+      {
+        pRval->envp[pRval->nVars++] = p1;
+        strcpy(p1, ppVars[i1]);
+        p1 += strlen(p1) + 1;
+      }
+      else
+      {
+        cbTotal += strlen(ppVars[i1]) + 1;
+        nVars++;
+      }
+    }
+
+    if(pRval) // second pass is done
+    {
+      pRval->envp[pRval->nVars] = NULL;
+      break;
+    }
+
+    pRval = (WB_ENV_SNAPSHOT *)WBAlloc(sizeof(*pRval) + (nVars + 1) * sizeof(char *) + cbTotal);
+
+    if(!pRval)
+    {
+      return NULL;
+    }
+
+    pRval->nRefs = 1;
+    pRval->nVars = 0;
+    pRval->envp = (char **)(pRval + 1);
+
+    p1 = (char *)(pRval->envp + nVars + 1);
+  }
+
+  return pRval;
+}
+
+WB_ENV_SNAPSHOT * WBEnvSnapshot(void)
+{
+extern char **environ;
+WB_ENV_SNAPSHOT *pRval;
+char **ppNew;
+int nVars;
+
+
+  pthread_mutex_lock(&mtxEnvSnapshot);
+
+  for(nVars=0; environ && environ[nVars]; nVars++)
+  {
+  }
+
+  if(pEnvSnapshot && nVars == nEnvSnapshotSource &&
+     (!nVars || !memcmp(environ, ppEnvSnapshotSource, nVars * sizeof(char *))))
+  {
+    pRval = WBEnvSnapshotAddRef(pEnvSnapshot); // nothing has changed
+
+    pthread_mutex_unlock(&mtxEnvSnapshot);
+
+    return pRval;
+  }
+
+  pRval = __WBEnvSnapshotBuild(environ, nVars, NULL);
+  ppNew = (char **)WBReAlloc(ppEnvSnapshotSource, (nVars + 1) * sizeof(char *));
+
+  if(!ppNew)
+  {
+    if(pRval)
+    {
+      WBEnvSnapshotRelease(pRval); // not cached, so don't return it either (the caller can retry)
+      pRval = NULL;
+    }
+  }
+  else
+  {
+    ppEnvSnapshotSource = ppNew;
+  }
+
+  if(pRval)
+  {
+    memcpy(ppEnvSnapshotSource, environ, nVars * sizeof(char *));
+    nEnvSnapshotSource = nVars;
+
+    if(pEnvSnapshot)
+    {
+      WBEnvSnapshotRelease(pEnvSnapshot); // any remaining references keep it alive
+    }
+
+    pEnvSnapshot = pRval; // the cache keeps the initial reference
+    WBEnvSnapshotAddRef(pRval);
+  }
+
+  pthread_mutex_unlock(&mtxEnvSnapshot);
+
+  return pRval;
+}
+
+WB_ENV_SNAPSHOT * WBEnvSnapshotOverride(WB_ENV_SNAPSHOT *pBase, const char * const *ppVars)
+{
+WB_ENV_SNAPSHOT *pRval, *pTemp = NULL;
+
+
+  if(!pBase)
+  {
+    pBase = pTemp = WBEnvSnapshot();
+
+    if(!pBase)
+    {
+      return NULL;
+    }
+  }
+
+  pRval = __WBEnvSnapshotBuild(pBase->envp, pBase->nVars, ppVars);
+
+  if(pTemp)
+  {
+    WBEnvSnapshotRelease(pTemp);
+  }
+
+  return pRval;
+}
+
+char * const * WBEnvSnapshotEnvp(const WB_ENV_SNAPSHOT *pEnv)
+{
+  return pEnv ? pEnv->envp : NULL;
+}
+
+WB_ENV_SNAPSHOT * WBEnvSnapshotAddRef(WB_ENV_SNAPSHOT *pEnv)
+{
+  if(pEnv)
+  {
+    WBInterlockedIncrement(&(pEnv->nRefs));
+  }
+
+  return pEnv;
+}
+
+void WBEnvSnapshotRelease(WB_ENV_SNAPSHOT *pEnv)
+{
+  if(pEnv && !WBInterlockedDecrement(&(pEnv->nRefs)))
+  {
+    WBFree(pEnv);
+  }
+}
+
+
+#define WBRUNRESULT_BUFFER_MINSIZE 65536
+#define WBRUNRESULT_BYTES_TO_READ 256
+#define WBRUNRESULT_MIN_READ 4096 /* grow the buffer when there's less than this much room for the next read */
+#define WBRUNSTREAM_CHUNK_SIZE 65536 /* maximum size of each chunk passed to a WB_RUN_STREAM_CALLBACK */
+#define WBRUNRESULT_STDIN_CHUNK 1048576 /* maximum number of bytes written to the 'stdin' pipe at one time */
+
+#ifdef WIN32
+
+static char * WBRunResultInternal(WB_FILE_HANDLE hStdIn, WB_INT32 *pExitCode, const char *szAppName, va_list va)
+{
+WB_PROCESS_ID idRval;
+DWORD cb1;
+WB_FILE_HANDLE hP[2]; // [0] is read end, [1] is write end
+char *p1, *p2, *pRval;
+int i2, iRunning;
+/*unsigned*/ int cbBuf;
+
+
+  cbBuf = WBRUNRESULT_BUFFER_MINSIZE;
+  pRval = WBAlloc(cbBuf);
+
+  if(!pRval)
+  {
+    return NULL;
+  }
+
+  // use WBRunAsyncPipeV to create a process, with all stdout piped to a char * buffer capture
+  // stdin and stderr still piped to/from /dev/null
+
+  hP[0] = hP[1] = WB_INVALID_FILE_HANDLE;
+
+  if(!CreatePipe(&(hP[0]), &(hP[1]), NULL, 0))
+  {
+    WBFree(pRval);
+    return NULL;
+  }
+
+  SetHandleInformation(hP[1], HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+
+  idRval = WBRunAsyncPipeV(hStdIn, hP[1], // the 'write' end is passed as stdout
+                           WB_INVALID_FILE_HANDLE, szAppName, va);
+
+  if(WB_PROCESS_ID_INVALID(idRval))
+  {
+    CloseHandle(hP[0]);
+    CloseHandle(hP[1]);
+
+    WBFree(pRval);
+
+    return NULL;
+  }
+
+  // so long as the process is alive, read data from the pipe and stuff it into the output buffer
+  // (the buffer will need to be reallocated periodically if it fills up)
+
+  p1 = pRval;
+  *p1 = 0;       // always do this
+  iRunning = 1;  // iRunning will be used as a flag to indicate the process exited.
+
+  while(1)
+  {
+    i2 = WBRUNRESULT_BYTES_TO_READ; // number of bytes to read at one time
+    if((p1 - pRval) + i2 >= cbBuf) // enough room for it?
+    {
+      i2 = cbBuf - (p1 - pRval);
+      if(i2 < WBRUNRESULT_BYTES_TO_READ / 8) // time to re-allocate
+      {
+        p2 = WBReAlloc(pRval, cbBuf + WBRUNRESULT_BUFFER_MINSIZE / 2);
+        if(!p2)
+        {
+          WBFree(pRval);
+          pRval = NULL;
+
+//          WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (4)\n", __FUNCTION__);
+          break;
+        }
+
+        cbBuf += WBRUNRESULT_BUFFER_MINSIZE / 2;
+        p1 = p2 + (p1 - pRval);
+        pRval = p2;
+        i2 = WBRUNRESULT_BYTES_TO_READ;
+      }
+    }
+
+    // if no data available I'll return immediately
+    cb1 = 0;
+
+    if(!PeekNamedPipe(hP[0], NULL, 0, NULL, &cb1, NULL))
+    {
+      DWORD dwErr;
+check_pipe_no_data_avail:
+
+      dwErr = GetLastError();
+
+      if(!iRunning)
+      {
+        break; // assume end of file, process ended, bail out now
+      }
+
+      if(dwErr == ERROR_MORE_DATA || dwErr == ERROR_PIPE_BUSY || dwErr == ERROR_IO_PENDING
+         || dwErr == ERROR_NO_MORE_ITEMS/* EAGAIN */ )
+      {
+        Sleep(10); // wait 1/2 msec
+      }
+      else
+      {
+        break; // an error of some kind, so bail out [pipe closed?]
+      }
+    }
+    else if(!cb1)
+    {
+      if(!iRunning)
+        break; // end of file
+    }
+    else if(!ReadFile(hP[0], p1, i2, &cb1, NULL))
+    {
+      goto check_pipe_no_data_avail;
+    }
+    else if(!cb1)  // this just might be an error
+    {
+      if(!iRunning)
+        break; // end of file
+    }
+    else
+    {
+      p1 += cb1; // point past the # of bytes I just read in
+      *p1 = 0; // by convention [to make sure the string is ALWAYS terminated with a 0-byte]
+    }
+
+    if(iRunning) // only if "still running"
+    {
+      // for waitpid(), if WNOHANG is specified and there are no stopped, continued or exited children, 0 is returned
+
+      if(GetProcessState(idRval, pExitCode) <= 0) // ended or error
+      {
+        iRunning = 0; // my flag that it's not running
+      }
+
+      Sleep(10); // so I don't 'spin' and IO completes at end of process
+    }
+  }
+
+  // always kill the process at this point (in case there was an error)
+
+  Sleep(10); // wait 10 msec - prevents certain problems
+
+  if(hP[1] != INVALID_HANDLE_VALUE)
+    CloseHandle(hP[1]); // done with the pipes - close them now
+  if(hP[0] != INVALID_HANDLE_VALUE)
+    CloseHandle(hP[0]);
+
+  return pRval;
+}
+
+#else // !WIN32 - everybody else
+
+// CAPTURE ENGINE
+//
+// The child's stdout (and optionally stderr) are connected to pipes, and a single 'poll()' loop
+// reads whichever one has data, along with the child's pidfd (when supported) to find out when it
+// exits.  If there is an input buffer for 'stdin', it is written to a third pipe by the same loop
+// whenever that pipe has room, so neither side can deadlock waiting for the other.
+//
+// Each stream has a 'sink' that determines what happens to the data:  it can be collected into a
+// single growing buffer (WBRunResult and friends), or passed in fixed-size chunks to a caller
+// supplied callback (WBRunStream), which never needs more than one chunk of memory, or moved into
+// a file (a memfd, normally) with 'splice()' so that it never passes through user space at all.
+
+#define WB_CAPTURE_SINK_NONE     0 /* not captured, re-directed to /dev/null */
+#define WB_CAPTURE_SINK_BUFFER   1 /* collect into one growing WBAlloc'd buffer */
+#define WB_CAPTURE_SINK_CALLBACK 2 /* pass each chunk to a WB_RUN_STREAM_CALLBACK */
+#define WB_CAPTURE_SINK_FILE     3 /* splice into 'hFile' */
+#define WB_CAPTURE_SINK_RING     4 /* keep the first 'cbHead' bytes, and the last 'cbTail' bytes in a ring buffer */
+
+#define WB_CAPTURE_SPLICE_SIZE 0x100000 /* maximum number of bytes moved by each 'splice' call */
+#define WB_CAPTURE_PIPE_SIZE 0x100000   /* requested pipe buffer size for SINK_FILE, so the child blocks less often */
+
+#define WB_CAPTURE_STDOUT 0 /* index into 'aStream' */
+#define WB_CAPTURE_STDERR 1
+
+#define WB_CAPTURE_CPU_CHECK_INTERVAL 50000 /* microseconds between checks of the process's CPU time */
+#define WB_CAPTURE_REAP_INTERVAL 10000 /* microseconds between 'wait' checks, when limits apply and there's no pidfd */
+
+typedef struct __WB_LINE_INDEX__
+{
+  WB_RUN_LINE *paLines;   // WBAlloc'd, or NULL
+  size_t nLines, nMax;
+  size_t cbLineStart;     // the offset of the line that hasn't ended yet
+} WB_LINE_INDEX;
+
+typedef struct __WB_CAPTURE_STREAM__
+{
+  WB_FILE_HANDLE hPipe;   // read end of the pipe, WB_INVALID_FILE_HANDLE once it reaches EOF
+  int iSink;              // WB_CAPTURE_SINK_xxx
+  char *pBuf;             // the buffer (growing for SINK_BUFFER, one chunk for SINK_CALLBACK)
+  size_t cbBuf, cbData;   // allocated size, and bytes currently in 'pBuf' (or written to 'hFile')
+  WB_FILE_HANDLE hFile;   // SINK_FILE - where the data goes (it belongs to the caller)
+  WB_UINT64 ullFileOffset; // SINK_FILE - the offset in 'hFile' where the data starts
+  int bNoSplice;          // SINK_FILE - 'splice' doesn't work with 'hFile', so use 'read' and 'pwrite'
+  WB_FILE_HANDLE hTee;    // a copy of the data is also written here (it belongs to the caller), or WB_INVALID_FILE_HANDLE
+  int bTeeWrite;          // 'hTee' isn't a pipe, so 'tee' doesn't work with it.  'write' a copy instead.
+  WB_UINT64 ullTeeTotal;  // the total number of bytes copied to 'hTee'
+  size_t cbHead, cbTail;  // SINK_RING - the sizes of the head and the ring (which follows it in 'pBuf')
+  WB_UINT64 ullRing;      // SINK_RING - the total number of bytes written to the ring
+  WB_UINT64 ullTotal;     // the total number of bytes read from the pipe
+  WB_UINT64 ullLines;     // the number of newlines read from the pipe (not counted for SINK_FILE)
+  int bLineIndex;         // SINK_BUFFER - build 'xLines' as the data arrives
+  WB_LINE_INDEX xLines;   // the offset and length of each line in 'pBuf' (it belongs to the caller once the capture is done)
+} WB_CAPTURE_STREAM;
+
+typedef struct __WB_CAPTURE__
+{
+  WB_PROCESS_ID idProcess;
+  WB_FILE_HANDLE hPidFD;      // pidfd for the process (may be WB_INVALID_FILE_HANDLE)
+  WB_FILE_HANDLE hOwnPidFD;   // non-negative if I opened 'hPidFD' myself (and need to close it)
+  int bRunning;               // non-zero until the process has been reaped
+  int bReaped;                // non-zero if 'iStatus' is valid
+  int iStatus;                // raw 'wait' status
+  struct rusage xUsage;       // resource usage, valid when 'bReaped' is non-zero
+  WB_UINT64 ullStartTime;     // __WBMonotonicTime() just before the process was started
+  WB_UINT64 ullEndTime;       // __WBMonotonicTime() when the process was found to have exited
+  WB_UINT64 ullWallLimit;     // elapsed time limit in microseconds, or zero for none
+  WB_UINT64 ullWallDeadline;  // __WBMonotonicTime() when 'ullWallLimit' expires (assigned when the process starts)
+  WB_UINT64 ullCPULimit;      // CPU time limit in microseconds, or zero for none
+  WB_UINT64 ullNextCPUCheck;  // __WBMonotonicTime() for the next check of the process's CPU time
+  clockid_t idCPUClock;       // the process's CPU time clock, valid when 'bCPUClock' is non-zero
+  int bCPUClock;
+  int iLimitHit;              // WB_RUN_LIMIT_HIT_xxx, when a limit ended the process
+  int bAborted;               // the callback asked me to stop, an allocation failed, or a limit was reached
+  WB_RUN_STREAM_CALLBACK pCallback;
+  void *pUserData;
+  WB_CAPTURE_STREAM aStream[2]; // stdout, stderr
+  WB_FILE_HANDLE hStdinPipe;  // write end of the 'stdin' pipe, WB_INVALID_FILE_HANDLE when done
+  const char *pStdin;         // data to write to 'stdin' (may contain zero bytes)
+  size_t cbStdin, cbStdinDone; // total length, and bytes written so far
+  int bKeepStderr;            // keep the write end of the 'stderr' pipe, for other pipeline stages
+  WB_FILE_HANDLE hStderrWrite; // the write end of the 'stderr' pipe when 'bKeepStderr' is non-zero
+  WB_UINT64 ullKillGrace;     // time from SIGTERM to SIGKILL when the process is terminated, or zero for SIGKILL right away
+  int iKillFlags;             // WB_TERMINATE_xxx flags for terminating the process
+  int bKillOrphans;           // when the process exits with a pipe still open, terminate what's left of its session
+  const WB_PROCESS_ID *paidOther; // other pipeline stages (not yet reaped) that are terminated along with the process
+  int nOther;
+  WB_TERMINATE_REPORT xTerminated; // what was signaled when the process (or its orphans) were terminated
+#ifdef WB_SPAWN_TRACE
+  WB_UINT64 ullTraceStart;    // __WBTraceTime() when the capture started
+  WB_UINT64 ullTraceSpawned;  // __WBTraceTime() when the process was started
+  WB_UINT64 ullTraceOutput;   // __WBTraceTime() when the first output arrived, or zero
+  WB_UINT64 ullTraceEOF;      // __WBTraceTime() when every output pipe was closed, if the process was still running
+#endif // WB_SPAWN_TRACE
+} WB_CAPTURE;
+
+static void __WBCaptureInit(WB_CAPTURE *pCtx)
+{
+int i1;
+
+  memset(pCtx, 0, sizeof(*pCtx));
+
+  pCtx->idProcess = WB_INVALID_PROCESS_ID;
+  pCtx->hPidFD = pCtx->hOwnPidFD = WB_INVALID_FILE_HANDLE;
+  pCtx->hStdinPipe = WB_INVALID_FILE_HANDLE;
+  pCtx->hStderrWrite = WB_INVALID_FILE_HANDLE;
+
+  for(i1=0; i1 < 2; i1++)
+  {
+    pCtx->aStream[i1].hPipe = WB_INVALID_FILE_HANDLE;
+    pCtx->aStream[i1].iSink = WB_CAPTURE_SINK_NONE;
+    pCtx->aStream[i1].hTee = WB_INVALID_FILE_HANDLE;
+  }
+}
+
+// free everything except the data buffers, which belong to the caller once the capture is done
+
+static void __WBCaptureCleanup(WB_CAPTURE *pCtx)
+{
+int i1;
+
+  for(i1=0; i1 < 2; i1++)
+  {
+    if(pCtx->aStream[i1].hPipe != WB_INVALID_FILE_HANDLE)
+    {
+      close(pCtx->aStream[i1].hPipe);
+      pCtx->aStream[i1].hPipe = WB_INVALID_FILE_HANDLE;
+    }
+
+    if(pCtx->aStream[i1].iSink == WB_CAPTURE_SINK_CALLBACK && pCtx->aStream[i1].pBuf)
+    {
+      WBFree(pCtx->aStream[i1].pBuf);
+      pCtx->aStream[i1].pBuf = NULL;
+    }
+  }
+
+  if(pCtx->hStdinPipe != WB_INVALID_FILE_HANDLE)
+  {
+    close(pCtx->hStdinPipe);
+    pCtx->hStdinPipe = WB_INVALID_FILE_HANDLE;
+  }
+
+  if(pCtx->hStderrWrite != WB_INVALID_FILE_HANDLE)
+  {
+    close(pCtx->hStderrWrite);
+    pCtx->hStderrWrite = WB_INVALID_FILE_HANDLE;
+  }
+
+  if(pCtx->hOwnPidFD != WB_INVALID_FILE_HANDLE)
+  {
+    close(pCtx->hOwnPidFD);
+  }
+
+  pCtx->hPidFD = pCtx->hOwnPidFD = WB_INVALID_FILE_HANDLE;
+}
+
+// allocate the stream buffers, create the pipes, and start the process.  if 'pCtx->pStdin' is
+// not NULL, 'stdin' is connected to a pipe that the capture loop writes it to; otherwise 'hStdIn'
+// is used.  returns zero on success
+
+static int __WBCaptureStart(WB_CAPTURE *pCtx, WB_FILE_HANDLE hStdIn, const char *szAppName,
+                            const WB_RUN_ARGS *pArgs)
+{
+WB_FILE_HANDLE ahWrite[2], hStdinRead = WB_INVALID_FILE_HANDLE;
+WB_RUN_ARGS xArgs;
+int i1;
+
+
+  if(pCtx->pStdin)
+  {
+    WB_FILE_HANDLE hP[2];
+
+    if(0 > pipe2(hP, O_CLOEXEC)) // otherwise the child inherits the write end, and never sees EOF
+    {
+      return -1;
+    }
+
+    hStdIn = hStdinRead = hP[0];
+    pCtx->hStdinPipe = hP[1];
+    pCtx->cbStdinDone = 0;
+
+    fcntl(hP[1], F_SETFL, O_NONBLOCK); // writes must never block the capture loop
+  }
+
+  for(i1=0; i1 < 2; i1++)
+  {
+    WB_CAPTURE_STREAM *pS = &(pCtx->aStream[i1]);
+    WB_FILE_HANDLE hP[2];
+
+    ahWrite[i1] = WB_INVALID_FILE_HANDLE;
+
+    if(pS->iSink == WB_CAPTURE_SINK_NONE)
+    {
+      continue;
+    }
+
+    pS->cbData = 0;
+
+    pS->ullRing = pS->ullTotal = pS->ullLines = 0;
+
+    if(pS->iSink == WB_CAPTURE_SINK_FILE) // no buffer
+    {
+      pS->cbBuf = 0;
+      pS->pBuf = NULL;
+    }
+    else
+    {
+      pS->cbBuf = pS->iSink == WB_CAPTURE_SINK_BUFFER ? WBRUNRESULT_BUFFER_MINSIZE :
+                  pS->iSink == WB_CAPTURE_SINK_RING ? pS->cbHead + pS->cbTail + 1 : // and it never grows
+                  WBRUNSTREAM_CHUNK_SIZE;
+      pS->pBuf = WBAlloc(pS->cbBuf);
+
+      if(!pS->pBuf)
+      {
+        goto start_error;
+      }
+
+      *(pS->pBuf) = 0; // always do this
+    }
+
+    if(0 > pipe2(hP, O_CLOEXEC)) // the child gets its own copy of the write end, via 'dup2'
+    {
+      goto start_error;
+    }
+
+    pS->hPipe = hP[0];
+    ahWrite[i1] = hP[1];
+
+    fcntl(hP[0], F_SETFL, O_NONBLOCK); // set non-blocking I/O
+
+#ifdef F_SETPIPE_SZ
+    if(pS->iSink == WB_CAPTURE_SINK_FILE)
+    {
+      fcntl(hP[0], F_SETPIPE_SZ, WB_CAPTURE_PIPE_SIZE); // if it fails, the default size still works
+    }
+#endif // F_SETPIPE_SZ
+  }
+
+  WB_TRACE_STAMP(pCtx->ullTraceStart);
+
+  pCtx->ullStartTime = __WBMonotonicTime();
+
+  xArgs = *pArgs; // a copy (the va_list is passed by reference, so that still works)
+  xArgs.bCapture = 1;
+
+  pCtx->idProcess = __WBRunAsyncPipeInternal(hStdIn, ahWrite[WB_CAPTURE_STDOUT], ahWrite[WB_CAPTURE_STDERR],
+                                             szAppName, &xArgs);
+
+  WB_TRACE_STAMP(pCtx->ullTraceSpawned);
+
+  if(hStdinRead != WB_INVALID_FILE_HANDLE)
+  {
+    close(hStdinRead); // the child has its own copy now
+    hStdinRead = WB_INVALID_FILE_HANDLE;
+  }
+
+  for(i1=0; i1 < 2; i1++)
+  {
+    if(ahWrite[i1] != WB_INVALID_FILE_HANDLE)
+    {
+      if(i1 == WB_CAPTURE_STDERR && pCtx->bKeepStderr && !WB_PROCESS_ID_INVALID(pCtx->idProcess))
+      {
+        pCtx->hStderrWrite = ahWrite[i1]; // the caller closes it after starting the other stages
+      }
+      else
+      {
+        close(ahWrite[i1]); // by convention, this will 'widow' the read end of the pipe once the process is done with it
+      }
+
+      ahWrite[i1] = WB_INVALID_FILE_HANDLE;
+    }
+  }
+
+  if(WB_PROCESS_ID_INVALID(pCtx->idProcess))
+  {
+    goto start_error;
+  }
+
+  pCtx->bRunning = 1;
+
+  // the pidfd (when the kernel supports it) tells me when the process exits without polling.
+  // otherwise, the process is reaped after the pipes reach EOF.  If the process table is
+  // tracking this process, I use its pidfd; otherwise I open my own.
+
+  pCtx->hPidFD = __WBProcessPidFD(pCtx->idProcess);
+
+  if(pCtx->hPidFD == WB_INVALID_FILE_HANDLE)
+  {
+    pCtx->hPidFD = pCtx->hOwnPidFD = __WBPidfdOpen(pCtx->idProcess);
+  }
+
+  if(pCtx->ullWallLimit)
+  {
+    pCtx->ullWallDeadline = pCtx->ullStartTime + pCtx->ullWallLimit;
+  }
+
+  if(pCtx->ullCPULimit)
+  {
+    // Linux lets me read any process's CPU time clock, even when it's not my child (the fork server)
+
+    if(!clock_getcpuclockid((pid_t)pCtx->idProcess, &(pCtx->idCPUClock)))
+    {
+      pCtx->bCPUClock = 1;
+      pCtx->ullNextCPUCheck = pCtx->ullStartTime; // check right away
+    }
+    else
+    {
+      WB_ERROR_PRINT("ERROR:  %s - unable to get the CPU clock for process %d, CPU time limit ignored\n",
+                     __FUNCTION__, (int)pCtx->idProcess);
+    }
+  }
+
+  return 0;
+
+start_error:
+
+  if(hStdinRead != WB_INVALID_FILE_HANDLE)
+  {
+    close(hStdinRead);
+  }
+
+  for(i1=0; i1 < 2; i1++)
+  {
+    if(ahWrite[i1] != WB_INVALID_FILE_HANDLE)
+    {
+      close(ahWrite[i1]);
+    }
+
+    if(pCtx->aStream[i1].pBuf)
+    {
+      WBFree(pCtx->aStream[i1].pBuf);
+      pCtx->aStream[i1].pBuf = NULL;
+    }
+  }
+
+  __WBCaptureCleanup(pCtx);
+
+  return -1;
+}
+
+// SIGPIPE is blocked for the calling thread while writing to a pipe whose reader may have gone away,
+// so that the write fails with EPIPE rather than a signal that kills the caller.  The SIGPIPE that
+// the write caused is discarded before the signal mask is restored.
+
+typedef struct __WB_SIGPIPE_STATE__
+{
+  sigset_t sigPipe, sigOld;
+  int bWasPending;
+} WB_SIGPIPE_STATE;
+
+static void __WBSigPipeBlock(WB_SIGPIPE_STATE *pState)
+{
+sigset_t sigPending;
+
+
+  sigemptyset(&(pState->sigPipe));
+  sigaddset(&(pState->sigPipe), SIGPIPE);
+
+  sigpending(&sigPending);
+  pState->bWasPending = sigismember(&sigPending, SIGPIPE);
+
+  pthread_sigmask(SIG_BLOCK, &(pState->sigPipe), &(pState->sigOld));
+}
+
+static void __WBSigPipeRestore(WB_SIGPIPE_STATE *pState, int bEPIPE)
+{
+struct timespec tsZero;
+int iErr = errno;
+
+
+  if(bEPIPE && !pState->bWasPending)
+  {
+    // discard the SIGPIPE that I just caused, so it's not delivered when the mask is restored
+
+    tsZero.tv_sec = 0;
+    tsZero.tv_nsec = 0;
+
+    while(sigtimedwait(&(pState->sigPipe), NULL, &tsZero) < 0 && errno == EINTR)
+    { }
+  }
+
+  pthread_sigmask(SIG_SETMASK, &(pState->sigOld), NULL);
+
+  errno = iErr;
+}
+
+// after an EAGAIN from 'tee' or 'write', wait for room in 'hTee' if it's a full non-blocking pipe
+// or socket.  Returns non-zero if it was full (and now has room), so the caller should try again, or
+// zero if it wasn't full (the EAGAIN came from the capture pipe being empty).
+
+static int __WBCaptureTeeWait(WB_CAPTURE_STREAM *pS)
+{
+struct pollfd xPoll;
+int iRval, nTimeout = 0;
+
+
+  while(1)
+  {
+    xPoll.fd = pS->hTee;
+    xPoll.events = POLLOUT;
+    xPoll.revents = 0;
+
+    iRval = poll(&xPoll, 1, nTimeout);
+
+    if(iRval < 0 && errno == EINTR)
+    {
+      continue;
+    }
+
+    if(iRval != 0) // room (or an error, which the next attempt reports)
+    {
+      return nTimeout != 0;
+    }
+
+    nTimeout = -1; // it's full, so wait for the reader (this throttles the child, like 'tee(1)' does)
+  }
+}
+
+// copy whatever is waiting in a stream's pipe to its 'hTee' handle.  'tee' duplicates the pipe's
+// pages without consuming them, and the caller then consumes no more than that many bytes, so the
+// copy and the capture see the same data.  Returns the maximum number of bytes to consume.  If
+// 'hTee' isn't a pipe, 'bTeeWrite' is set, and the caller uses __WBCaptureTeeWrite afterwards.
+
+static size_t __WBCaptureTee(WB_CAPTURE_STREAM *pS, size_t cbMax)
+{
+#ifdef SPLICE_F_MOVE
+WB_SIGPIPE_STATE xSig;
+ssize_t cbTee;
+
+
+  if(pS->hTee == WB_INVALID_FILE_HANDLE || pS->bTeeWrite)
+  {
+    return cbMax;
+  }
+
+  // NOTE:  this is only called when 'poll' says the pipe is readable, so it won't block waiting for
+  //        data.  It DOES block when 'hTee' is full, which throttles the child (like 'tee(1)' does).
+  //        That includes a non-blocking 'hTee', which would otherwise lose whatever didn't fit.
+
+  __WBSigPipeBlock(&xSig);
+
+  do
+  {
+    cbTee = tee(pS->hPipe, pS->hTee, cbMax, 0);
+  } while(cbTee < 0 && (errno == EINTR || (errno == EAGAIN && __WBCaptureTeeWait(pS))));
+
+  __WBSigPipeRestore(&xSig, cbTee < 0 && errno == EPIPE);
+
+  if(cbTee > 0)
+  {
+    pS->ullTeeTotal += cbTee;
+
+    return (size_t)cbTee;
+  }
+
+  if(cbTee < 0 && errno == EINVAL) // not a pipe
+  {
+    pS->bTeeWrite = 1;
+  }
+  else if(cbTee < 0 && errno != EAGAIN)
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to copy output, errno=%d (no more copies will be made)\n", __FUNCTION__, errno);
+
+    pS->hTee = WB_INVALID_FILE_HANDLE;
+  }
+
+  return cbMax; // the 'read' sees EOF (or EAGAIN) just like 'tee' did
+#else // !SPLICE_F_MOVE
+  pS->bTeeWrite = 1;
+
+  return cbMax;
+#endif // SPLICE_F_MOVE
+}
+
+static void __WBCaptureTeeWrite(WB_CAPTURE_STREAM *pS, const char *pData, size_t cbData)
+{
+WB_SIGPIPE_STATE xSig;
+ssize_t cbDone;
+
+
+  if(pS->hTee == WB_INVALID_FILE_HANDLE || !pS->bTeeWrite)
+  {
+    return;
+  }
+
+  __WBSigPipeBlock(&xSig);
+
+  while(cbData > 0)
+  {
+    cbDone = write(pS->hTee, pData, cbData);
+
+    if(cbDone > 0)
+    {
+      pData += cbDone;
+      cbData -= cbDone;
+      pS->ullTeeTotal += cbDone;
+    }
+    else if(cbDone < 0 && errno == EAGAIN) // a non-blocking 'hTee' that's full
+    {
+      __WBCaptureTeeWait(pS);
+    }
+    else if(cbDone < 0 && errno != EINTR)
+    {
+      WB_ERROR_PRINT("ERROR:  %s - unable to copy output, errno=%d (no more copies will be made)\n", __FUNCTION__, errno);
+
+      pS->hTee = WB_INVALID_FILE_HANDLE;
+      break;
+    }
+  }
+
+  __WBSigPipeRestore(&xSig, pS->hTee == WB_INVALID_FILE_HANDLE && errno == EPIPE);
+}
+
+// NEWLINE SCAN - a bit mask of the newlines in each 64 byte block, so that the cost doesn't depend on
+// how long the lines are (a 'memchr' for each line is slow for short lines).  Bit 'n' is set when
+// byte 'n' is a newline.  SSE2 compares 16 bytes at a time; otherwise it's done 8 bytes at a time.
+
+static WB_UINT64 __WBNewlineMask64(const char *pData)
+{
+WB_UINT64 ullRval;
+#ifdef __SSE2__
+const __m128i xNL = _mm_set1_epi8('\n');
+
+
+  ullRval = (WB_UINT64)(WB_UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)pData), xNL))
+          | ((WB_UINT64)(WB_UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pData + 16)), xNL)) << 16)
+          | ((WB_UINT64)(WB_UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pData + 32)), xNL)) << 32)
+          | ((WB_UINT64)(WB_UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pData + 48)), xNL)) << 48);
+
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+WB_UINT64 ullW;
+int i1;
+
+
+  for(i1=0, ullRval=0; i1 < 64; i1 += 8)
+  {
+    memcpy(&ullW, pData + i1, 8); // no alignment assumptions
+
+    ullW ^= 0x0a0a0a0a0a0a0a0aULL; // a newline is now a zero byte
+
+    // the high bit of each zero byte, exactly (no borrow from one byte into the next)
+
+    ullW = ~(((ullW & 0x7f7f7f7f7f7f7f7fULL) + 0x7f7f7f7f7f7f7f7fULL) | ullW | 0x7f7f7f7f7f7f7f7fULL);
+
+    // gather the 8 high bits into the low byte, in byte order
+
+    ullRval |= (((ullW >> 7) * 0x0102040810204080ULL) >> 56) << i1;
+  }
+
+#else // neither
+int i1;
+
+
+  for(i1=0, ullRval=0; i1 < 64; i1++)
+  {
+    if(pData[i1] == '\n')
+    {
+      ullRval |= (WB_UINT64)1 << i1;
+    }
+  }
+
+#endif // __SSE2__
+
+  return ullRval;
+}
+
+static WB_UINT64 __WBNewlineCount(const char *pData, size_t cbData)
+{
+WB_UINT64 ullRval = 0;
+
+
+  for(; cbData >= 64; pData += 64, cbData -= 64)
+  {
+    ullRval += __builtin_popcountll(__WBNewlineMask64(pData));
+  }
+
+  for(; cbData > 0; pData++, cbData--)
+  {
+    ullRval += *pData == '\n';
+  }
+
+  return ullRval;
+}
+
+static int __WBLineIndexGrow(WB_LINE_INDEX *pIdx)
+{
+size_t nNew = pIdx->nMax ? pIdx->nMax * 2 : 1024;
+void *p1;
+
+
+  p1 = WBReAlloc(pIdx->paLines, nNew * sizeof(WB_RUN_LINE));
+
+  if(!p1)
+  {
+    return -1;
+  }
+
+  pIdx->paLines = (WB_RUN_LINE *)p1;
+  pIdx->nMax = nNew;
+
+  return 0;
+}
+
+// add the lines that end in 'pData' (which is at offset 'cbOffset' in the buffer) to the index.
+// returns zero on success, or -1 if the index can't grow.  NOTE:  the index is kept in local variables
+// while scanning, since every store into 'paLines' could otherwise change 'pIdx' as far as the compiler knows
+
+static int __WBLineIndexScan(WB_LINE_INDEX *pIdx, const char *pData, size_t cbOffset, size_t cbData)
+{
+WB_RUN_LINE *paLines = pIdx->paLines;
+size_t nLines = pIdx->nLines, nMax = pIdx->nMax, cbLineStart = pIdx->cbLineStart;
+WB_UINT64 ullMask;
+size_t cbPos, cbEnd;
+int iRval = 0;
+
+
+  for(cbPos=0; cbPos < cbData; cbPos += 64)
+  {
+    if(cbData - cbPos >= 64)
+    {
+      ullMask = __WBNewlineMask64(pData + cbPos);
+    }
+    else
+    {
+      for(ullMask=0, cbEnd=cbPos; cbEnd < cbData; cbEnd++)
+      {
+        if(pData[cbEnd] == '\n')
+        {
+          ullMask |= (WB_UINT64)1 << (cbEnd - cbPos);
+        }
+      }
+    }
+
+    for(; ullMask; ullMask &= ullMask - 1)
+    {
+      if(nLines >= nMax)
+      {
+        pIdx->nLines = nLines;
+
+        if(__WBLineIndexGrow(pIdx))
+        {
+          iRval = -1;
+          goto exit_point;
+        }
+
+        paLines = pIdx->paLines;
+        nMax = pIdx->nMax;
+      }
+
+      cbEnd = cbOffset + cbPos + __builtin_ctzll(ullMask); // the newline's offset
+
+      paLines[nLines].cbOffset = cbLineStart;
+      paLines[nLines].cbLength = cbEnd - cbLineStart;
+      nLines++;
+
+      cbLineStart = cbEnd + 1;
+    }
+  }
+
+exit_point:
+
+  pIdx->nLines = nLines;
+  pIdx->cbLineStart = cbLineStart;
+
+  return iRval;
+}
+
+// add the last line, if it doesn't end with a newline.  'cbTotal' is the size of the data
+
+static int __WBLineIndexFinish(WB_LINE_INDEX *pIdx, size_t cbTotal)
+{
+  if(cbTotal > pIdx->cbLineStart)
+  {
+    if(pIdx->nLines >= pIdx->nMax && __WBLineIndexGrow(pIdx))
+    {
+      return -1;
+    }
+
+    pIdx->paLines[pIdx->nLines].cbOffset = pIdx->cbLineStart;
+    pIdx->paLines[pIdx->nLines].cbLength = cbTotal - pIdx->cbLineStart;
+    pIdx->nLines++;
+
+    pIdx->cbLineStart = cbTotal;
+  }
+
+  return 0;
+}
+
+static void __WBLineIndexFree(WB_LINE_INDEX *pIdx)
+{
+  if(pIdx->paLines)
+  {
+    WBFree(pIdx->paLines);
+  }
+
+  memset(pIdx, 0, sizeof(*pIdx));
+}
+
+// count the bytes and lines that were read from a stream's pipe.  With 'bLineIndex' (SINK_BUFFER
+// only) 'pData' is at offset 'cbData' in 'pBuf', and each line is added to the index as it's counted.
+// returns zero on success, or -1 if the index can't grow
+
+static int __WBCaptureCount(WB_CAPTURE_STREAM *pS, const char *pData, size_t cbData)
+{
+size_t nLines;
+
+
+  pS->ullTotal += cbData;
+
+  if(pS->bLineIndex)
+  {
+    nLines = pS->xLines.nLines;
+
+    if(__WBLineIndexScan(&(pS->xLines), pData, pS->cbData, cbData))
+    {
+      return -1;
+    }
+
+    pS->ullLines += pS->xLines.nLines - nLines;
+  }
+  else
+  {
+    pS->ullLines += __WBNewlineCount(pData, cbData);
+  }
+
+  return 0;
+}
+
+// read whatever is available on a SINK_RING stream.  The first 'cbHead' bytes go into the head,
+// and everything after that goes into the ring, which overwrites the oldest data when it wraps.
+// Memory use doesn't depend on how much the process writes.
+
+static void __WBCaptureReadRing(WB_CAPTURE_STREAM *pS)
+{
+char cBuf[16384];
+const char *pData;
+char *pRing;
+ssize_t cbRead;
+size_t cb1, cbPos;
+
+
+  cbRead = read(pS->hPipe, cBuf, __WBCaptureTee(pS, sizeof(cBuf)));
+
+  if(cbRead <= 0)
+  {
+    if(!cbRead || (errno != EAGAIN && errno != EINTR)) // end of file (or an error), so I'm done with the pipe
+    {
+      close(pS->hPipe);
+      pS->hPipe = WB_INVALID_FILE_HANDLE;
+    }
+
+    return;
+  }
+
+  __WBCaptureTeeWrite(pS, cBuf, (size_t)cbRead);
+  __WBCaptureCount(pS, cBuf, (size_t)cbRead);
+
+  pData = cBuf;
+
+  if(pS->cbData < pS->cbHead) // still filling the head
+  {
+    cb1 = pS->cbHead - pS->cbData;
+
+    if(cb1 > (size_t)cbRead)
+    {
+      cb1 = (size_t)cbRead;
+    }
+
+    memcpy(pS->pBuf + pS->cbData, pData, cb1);
+
+    pS->cbData += cb1;
+    pData += cb1;
+    cbRead -= cb1;
+  }
+
+  if(!cbRead || !pS->cbTail)
+  {
+    return;
+  }
+
+  pRing = pS->pBuf + pS->cbHead;
+
+  if((size_t)cbRead >= pS->cbTail) // only the last 'cbTail' bytes survive
+  {
+    pData += cbRead - pS->cbTail;
+    pS->ullRing += cbRead - pS->cbTail;
+    cbRead = pS->cbTail;
+  }
+
+  cbPos = (size_t)(pS->ullRing % pS->cbTail);
+  cb1 = pS->cbTail - cbPos; // room before the ring wraps
+
+  if(cb1 > (size_t)cbRead)
+  {
+    cb1 = (size_t)cbRead;
+  }
+
+  memcpy(pRing + cbPos, pData, cb1);
+
+  if((size_t)cbRead > cb1)
+  {
+    memcpy(pRing, pData + cb1, cbRead - cb1);
+  }
+
+  pS->ullRing += cbRead;
+}
+
+static void __WBReverseBytes(char *pStart, char *pEnd)
+{
+char c1;
+
+  while(pStart < --pEnd)
+  {
+    c1 = *pStart;
+    *(pStart++) = *pEnd;
+    *pEnd = c1;
+  }
+}
+
+// when the capture is done, rotate the ring so that its oldest byte comes right after the head.
+// Then 'pBuf' holds the head followed by the tail, zero byte terminated, in 'cbData' bytes.
+
+static void __WBCaptureRingFinish(WB_CAPTURE_STREAM *pS)
+{
+char *pRing;
+size_t cbRing, cbPos;
+
+
+  if(!pS->pBuf)
+  {
+    return;
+  }
+
+  pRing = pS->pBuf + pS->cbData; // the head is full whenever the ring has anything in it
+  cbRing = pS->ullRing < pS->cbTail ? (size_t)pS->ullRing : pS->cbTail;
+
+  if(pS->ullRing > pS->cbTail) // it wrapped, so rotate it in place
+  {
+    cbPos = (size_t)(pS->ullRing % pS->cbTail);
+
+    __WBReverseBytes(pRing, pRing + cbPos);
+    __WBReverseBytes(pRing + cbPos, pRing + cbRing);
+    __WBReverseBytes(pRing, pRing + cbRing);
+  }
+
+  pS->cbData += cbRing;
+  pS->pBuf[pS->cbData] = 0; // by convention
+}
+
+// move whatever is available on a SINK_FILE stream into its file.  'splice' moves the pages from
+// the pipe to the file without copying them through user space.  It doesn't work for every kind
+// of file (for example, one opened with O_APPEND) so in that case, I fall back to 'read' and 'pwrite'.
+
+static void __WBCaptureReadFile(WB_CAPTURE *pCtx, WB_CAPTURE_STREAM *pS)
+{
+char cBuf[16384];
+ssize_t cbRead, cb1, cb2;
+off_t llOffset;
+size_t cbMax;
+
+
+  llOffset = (off_t)(pS->ullFileOffset + pS->cbData);
+
+  cbMax = __WBCaptureTee(pS, WB_CAPTURE_SPLICE_SIZE);
+
+#ifdef SPLICE_F_MOVE
+  if(!pS->bNoSplice && !pS->bTeeWrite) // a 'write' copy needs the data in user space
+  {
+    loff_t llSpliceOffset = llOffset;
+
+    cbRead = splice(pS->hPipe, NULL, pS->hFile, &llSpliceOffset, cbMax,
+                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+    if(cbRead >= 0 || (errno != EINVAL && errno != ENOSYS))
+    {
+      goto have_result;
+    }
+
+    pS->bNoSplice = 1; // and fall through
+  }
+#endif // SPLICE_F_MOVE
+
+  cbRead = read(pS->hPipe, cBuf, cbMax < sizeof(cBuf) ? cbMax : sizeof(cBuf));
+
+  if(cbRead > 0)
+  {
+    __WBCaptureTeeWrite(pS, cBuf, (size_t)cbRead);
+  }
+
+  for(cb1=0; cb1 < cbRead; cb1 += cb2)
+  {
+    cb2 = pwrite(pS->hFile, cBuf + cb1, cbRead - cb1, llOffset + cb1);
+
+    if(cb2 <= 0)
+    {
+      if(cb2 < 0 && errno == EINTR)
+      {
+        cb2 = 0;
+        continue;
+      }
+
+      cbRead = -1; // ENOSPC, most likely
+      break;
+    }
+  }
+
+#ifdef SPLICE_F_MOVE
+have_result:
+#endif // SPLICE_F_MOVE
+
+  if(cbRead > 0)
+  {
+    pS->cbData += cbRead;
+    pS->ullTotal += cbRead;
+  }
+  else if(!cbRead) // end of file, so I'm done with the pipe
+  {
+    close(pS->hPipe);
+    pS->hPipe = WB_INVALID_FILE_HANDLE;
+  }
+  else if(errno != EAGAIN && errno != EINTR) // the file can't be written, so the output is incomplete
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to write captured output, errno=%d\n", __FUNCTION__, errno);
+
+    pCtx->bAborted = 1;
+  }
+}
+
+// read whatever is available on one stream, and pass it to its sink
+
+static void __WBCaptureRead(WB_CAPTURE *pCtx, int iIndex)
+{
+WB_CAPTURE_STREAM *pS = &(pCtx->aStream[iIndex]);
+ssize_t cbRead;
+
+
+  if(pS->iSink == WB_CAPTURE_SINK_FILE)
+  {
+    __WBCaptureReadFile(pCtx, pS);
+    return;
+  }
+  else if(pS->iSink == WB_CAPTURE_SINK_RING)
+  {
+    __WBCaptureReadRing(pS);
+    return;
+  }
+
+  if(pS->iSink == WB_CAPTURE_SINK_BUFFER &&
+     pS->cbData + WBRUNRESULT_MIN_READ >= pS->cbBuf) // time to re-allocate
+  {
+    char *p2 = WBReAlloc(pS->pBuf, pS->cbBuf * 2);
+
+    if(!p2)
+    {
+      pCtx->bAborted = 1;
+      return;
+    }
+
+    pS->pBuf = p2;
+    pS->cbBuf *= 2;
+  }
+
+  // each read fills as much of the buffer as is available.  the buffer doubles when it fills up,
+  // so large outputs are read in large chunks and the number of 'realloc' copies stays small.
+
+  cbRead = read(pS->hPipe, pS->pBuf + pS->cbData,
+                __WBCaptureTee(pS, pS->cbBuf - pS->cbData - 1)); // leave room for a zero byte
+
+  if(cbRead > 0)
+  {
+    __WBCaptureTeeWrite(pS, pS->pBuf + pS->cbData, (size_t)cbRead);
+
+    if(__WBCaptureCount(pS, pS->pBuf + pS->cbData, (size_t)cbRead))
+    {
+      pCtx->bAborted = 1; // out of memory for the line index
+    }
+
+    if(pS->iSink == WB_CAPTURE_SINK_CALLBACK)
+    {
+      pS->pBuf[cbRead] = 0; // by convention
+
+      // NOTE:  while the callback runs, nothing reads the pipe.  When the pipe fills up, the
+      //        child blocks on 'write', so a slow callback naturally throttles the child.
+
+      if(pCtx->pCallback(pCtx->pUserData, iIndex + 1, pS->pBuf, (size_t)cbRead))
+      {
+        pCtx->bAborted = 1;
+      }
+    }
+    else
+    {
+      pS->cbData += cbRead;
+      pS->pBuf[pS->cbData] = 0; // by convention [to make sure the string is ALWAYS terminated with a 0-byte]
+    }
+  }
+  else if(!cbRead || (errno != EAGAIN && errno != EINTR)) // end of file (or an error), so I'm done with the pipe
+  {
+    close(pS->hPipe);
+    pS->hPipe = WB_INVALID_FILE_HANDLE;
+  }
+}
+
+// write as much of the 'stdin' data as the pipe will take without blocking.  'SIGPIPE' is blocked
+// while writing, so a child that exits without reading all of its input results in EPIPE (and the
+// pipe being closed) rather than a signal that kills the caller.
+
+static void __WBCaptureWrite(WB_CAPTURE *pCtx)
+{
+WB_SIGPIPE_STATE xSig;
+size_t cbWrite;
+ssize_t cbDone;
+
+
+  __WBSigPipeBlock(&xSig);
+
+  cbWrite = pCtx->cbStdin - pCtx->cbStdinDone;
+
+  if(cbWrite > WBRUNRESULT_STDIN_CHUNK)
+  {
+    cbWrite = WBRUNRESULT_STDIN_CHUNK;
+  }
+
+  cbDone = write(pCtx->hStdinPipe, pCtx->pStdin + pCtx->cbStdinDone, cbWrite);
+
+  if(cbDone > 0)
+  {
+    pCtx->cbStdinDone += cbDone;
+  }
+
+  __WBSigPipeRestore(&xSig, cbDone < 0 && errno == EPIPE);
+
+  if((cbDone < 0 && errno != EAGAIN && errno != EINTR) || // the child closed 'stdin' (or an error)
+     pCtx->cbStdinDone >= pCtx->cbStdin)                  // or everything has been written
+  {
+    close(pCtx->hStdinPipe); // EOF for the child
+    pCtx->hStdinPipe = WB_INVALID_FILE_HANDLE;
+  }
+}
+
+// the 'poll()' timeout (in milliseconds) for the next limit check, or -1 if there's nothing to check
+
+static int __WBCaptureTimeout(WB_CAPTURE *pCtx, int bPollExit)
+{
+WB_UINT64 ullNow, ullNext = 0;
+
+
+  if(!pCtx->ullWallDeadline && !pCtx->bCPUClock)
+  {
+    return -1;
+  }
+
+  ullNow = __WBMonotonicTime();
+
+  if(pCtx->ullWallDeadline)
+  {
+    ullNext = pCtx->ullWallDeadline;
+  }
+
+  if(pCtx->bCPUClock && pCtx->bRunning && (!ullNext || pCtx->ullNextCPUCheck < ullNext))
+  {
+    ullNext = pCtx->ullNextCPUCheck;
+  }
+
+  if(bPollExit && (!ullNext || ullNow + WB_CAPTURE_REAP_INTERVAL < ullNext))
+  {
+    ullNext = ullNow + WB_CAPTURE_REAP_INTERVAL;
+  }
+
+  if(!ullNext)
+  {
+    return -1;
+  }
+
+  if(ullNext <= ullNow)
+  {
+    return 0;
+  }
+
+  return (int)((ullNext - ullNow + 999) / 1000); // round up, so I don't wake up early
+}
+
+// check the wall time and CPU time limits.  returns non-zero (and assigns 'iLimitHit') if one was reached
+
+static int __WBCaptureCheckLimits(WB_CAPTURE *pCtx)
+{
+WB_UINT64 ullNow, ullCPU;
+struct timespec ts;
+
+
+  if(!pCtx->ullWallDeadline && !pCtx->bCPUClock)
+  {
+    return 0;
+  }
+
+  ullNow = __WBMonotonicTime();
+
+  if(pCtx->ullWallDeadline && ullNow >= pCtx->ullWallDeadline)
+  {
+    pCtx->iLimitHit = WB_RUN_LIMIT_HIT_WALLTIME;
+    return 1;
+  }
+
+  if(pCtx->bCPUClock && pCtx->bRunning && ullNow >= pCtx->ullNextCPUCheck)
+  {
+    if(clock_gettime(pCtx->idCPUClock, &ts)) // it's gone (a zombie still has a clock, so this is rare)
+    {
+      pCtx->bCPUClock = 0;
+      return 0;
+    }
+
+    ullCPU = (WB_UINT64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+    if(ullCPU >= pCtx->ullCPULimit)
+    {
+      pCtx->iLimitHit = WB_RUN_LIMIT_HIT_CPUTIME;
+      return 1;
+    }
+
+    // a single thread can't use more CPU time than elapsed time, so there's no point in
+    // checking again before the rest of it could have been used
+
+    ullCPU = pCtx->ullCPULimit - ullCPU;
+
+    pCtx->ullNextCPUCheck = ullNow + (ullCPU < WB_CAPTURE_CPU_CHECK_INTERVAL ? ullCPU : WB_CAPTURE_CPU_CHECK_INTERVAL);
+  }
+
+  return 0;
+}
+
+// terminate the process (unless it was reaped) along with its process group, and the other pipeline
+// stages.  With 'bOrphans', it's what is left of its session after the process exited, and whatever
+// is still holding one of the pipes open.
+
+static void __WBCaptureTerminate(WB_CAPTURE *pCtx, int bOrphans)
+{
+WB_PROCESS_ID aidRoot[WB_RUN_MAX_STAGES];
+int abReaped[WB_RUN_MAX_STAGES];
+ino_t aPipe[2];
+struct stat sb;
+int i1, nRoots, nPipes = 0;
+
+
+  aidRoot[0] = pCtx->idProcess;
+  abReaped[0] = !pCtx->bRunning; // its process ID may belong to something else, but its process group ID can't
+  nRoots = 1;
+
+  for(i1=0; !bOrphans && i1 < pCtx->nOther && nRoots < WB_RUN_MAX_STAGES; i1++)
+  {
+    if(!WB_PROCESS_ID_INVALID(pCtx->paidOther[i1]))
+    {
+      aidRoot[nRoots] = pCtx->paidOther[i1];
+      abReaped[nRoots++] = 0;
+    }
+  }
+
+  for(i1=0; bOrphans && i1 < 2; i1++)
+  {
+    if(pCtx->aStream[i1].hPipe != WB_INVALID_FILE_HANDLE && !fstat(pCtx->aStream[i1].hPipe, &sb))
+    {
+      aPipe[nPipes++] = sb.st_ino;
+    }
+  }
+
+  __WBTerminate(aidRoot, abReaped, nRoots, bOrphans ? pCtx->iKillFlags | WB_TERMINATE_TREE : pCtx->iKillFlags,
+                aPipe, nPipes, pCtx->ullKillGrace, &(pCtx->xTerminated));
+}
+
+// so long as any pipe is open, sleep in 'poll()' until there is data, EOF, or the process exits.
+// on return, all of the pipes are closed and the process has been reaped (or killed and reaped).
+// When there are time limits, the loop also wakes up to check them, and keeps going until the
+// process exits (even after the pipes are closed) so that it can't run past them.  With 'bKillOrphans'
+// it watches for the process to exit, so that its orphans can be terminated if they hold a pipe open.
+
+#ifdef WB_SPAWN_TRACE
+
+// time the first output, and the end of the output (the process exiting is timed from there)
+
+static void __WBCaptureTrace(WB_CAPTURE *pCtx)
+{
+  if(!pCtx->ullTraceOutput && (pCtx->aStream[0].ullTotal || pCtx->aStream[1].ullTotal))
+  {
+    WB_TRACE_STAMP(pCtx->ullTraceOutput);
+    WB_TRACE_RECORD(WB_SPAWN_PHASE_FIRST_OUTPUT, pCtx->ullTraceSpawned, pCtx->ullTraceOutput);
+  }
+
+  if(!pCtx->ullTraceEOF && pCtx->bRunning &&
+     pCtx->aStream[0].hPipe == WB_INVALID_FILE_HANDLE &&
+     pCtx->aStream[1].hPipe == WB_INVALID_FILE_HANDLE)
+  {
+    WB_TRACE_STAMP(pCtx->ullTraceEOF);
+  }
+}
+
+static void __WBCaptureTraceReaped(WB_CAPTURE *pCtx)
+{
+  if(pCtx->ullTraceEOF) // only when the output ended first
+  {
+    WB_TRACE_RECORD(WB_SPAWN_PHASE_EXIT, pCtx->ullTraceEOF, __WBTraceTime());
+  }
+}
+
+#endif // WB_SPAWN_TRACE
+
+static void __WBCaptureLoop(WB_CAPTURE *pCtx)
+{
+struct pollfd aPoll[4];
+int i1, nPoll, iPidIndex, iStdinIndex, aiIndex[4], bWatch, bPollExit;
+
+
+  if(pCtx->hStdinPipe != WB_INVALID_FILE_HANDLE && !pCtx->cbStdin)
+  {
+    close(pCtx->hStdinPipe); // nothing to write, so it's EOF right away
+    pCtx->hStdinPipe = WB_INVALID_FILE_HANDLE;
+  }
+
+  while(!pCtx->bAborted)
+  {
+    nPoll = 0;
+    iPidIndex = -1;
+    iStdinIndex = -1;
+
+    for(i1=0; i1 < 2; i1++)
+    {
+      if(pCtx->aStream[i1].hPipe != WB_INVALID_FILE_HANDLE)
+      {
+        aPoll[nPoll].fd = pCtx->aStream[i1].hPipe;
+        aPoll[nPoll].events = POLLIN;
+        aPoll[nPoll].revents = 0;
+        aiIndex[nPoll++] = i1;
+      }
+    }
+
+    bWatch = pCtx->bRunning && (pCtx->ullWallDeadline || pCtx->bCPUClock);
+
+    if(!nPoll && (!pCtx->bRunning || (pCtx->hStdinPipe == WB_INVALID_FILE_HANDLE && !bWatch)))
+    {
+      break; // all of the pipes are closed (or there's nobody left to read 'stdin')
+    }
+
+    if(pCtx->hStdinPipe != WB_INVALID_FILE_HANDLE)
+    {
+      aPoll[nPoll].fd = pCtx->hStdinPipe;
+      aPoll[nPoll].events = POLLOUT;
+      aPoll[nPoll].revents = 0;
+      iStdinIndex = nPoll++;
+    }
+
+    if(pCtx->bRunning && pCtx->hPidFD != WB_INVALID_FILE_HANDLE)
+    {
+      // NOTE:  a tracked pidfd stays open until the process is reaped, and only I reap it
+
+      aPoll[nPoll].fd = pCtx->hPidFD;
+      aPoll[nPoll].events = POLLIN;
+      aPoll[nPoll].revents = 0;
+      iPidIndex = nPoll++;
+    }
+
+    bPollExit = (bWatch || (pCtx->bRunning && pCtx->bKillOrphans)) &&
+                pCtx->hPidFD == WB_INVALID_FILE_HANDLE; // no pidfd, so check for it periodically
+
+    i1 = poll(aPoll, nPoll, __WBCaptureTimeout(pCtx, bPollExit));
+
+    if(i1 < 0)
+    {
+      if(errno == EINTR)
+      {
+        continue;
+      }
+
+      pCtx->bAborted = 1; // an error of some kind, so bail out
+      break;
+    }
+
+    if(bPollExit || (iPidIndex >= 0 && aPoll[iPidIndex].revents))
+    {
+      i1 = __WBProcessReap(pCtx->idProcess, &(pCtx->iStatus), &(pCtx->xUsage), 0);
+
+      if(i1) // it exited (or can't be waited on)
+      {
+        pCtx->bRunning = 0; // my flag that it's not running
+        pCtx->bReaped = i1 > 0;
+        pCtx->ullEndTime = __WBMonotonicTime();
+
+        WB_TRACE_CAPTURE_REAPED(pCtx);
+
+        if(pCtx->bKillOrphans && nPoll > (iPidIndex >= 0) + (iStdinIndex >= 0))
+        {
+          __WBCaptureTerminate(pCtx, 1); // something it started still has a pipe open
+        }
+      }
+    }
+
+    if(iStdinIndex >= 0 && aPoll[iStdinIndex].revents)
+    {
+      __WBCaptureWrite(pCtx);
+    }
+
+    for(i1=0; i1 < nPoll; i1++)
+    {
+      if(i1 != iPidIndex && i1 != iStdinIndex && aPoll[i1].revents && !pCtx->bAborted)
+      {
+        __WBCaptureRead(pCtx, aiIndex[i1]);
+      }
+    }
+
+    WB_TRACE_CAPTURE(pCtx);
+
+    if(!pCtx->bAborted && __WBCaptureCheckLimits(pCtx))
+    {
+      pCtx->bAborted = 1;
+    }
+  }
+
+  if(pCtx->hStdinPipe != WB_INVALID_FILE_HANDLE)
+  {
+    close(pCtx->hStdinPipe);
+    pCtx->hStdinPipe = WB_INVALID_FILE_HANDLE;
+  }
+
+  for(i1=0; i1 < 2; i1++)
+  {
+    if(pCtx->aStream[i1].hPipe != WB_INVALID_FILE_HANDLE) // error exit - done with the pipe
+    {
+      close(pCtx->aStream[i1].hPipe);
+      pCtx->aStream[i1].hPipe = WB_INVALID_FILE_HANDLE;
+    }
+
+    if(pCtx->aStream[i1].iSink == WB_CAPTURE_SINK_RING)
+    {
+      __WBCaptureRingFinish(&(pCtx->aStream[i1]));
+    }
+  }
+
+  if(pCtx->bAborted)
+  {
+    // the process is its own process group leader (it called 'setsid') so this also gets
+    // anything it started, which may be holding a pipe open, or still running after it exits
+
+    __WBCaptureTerminate(pCtx, 0);
+  }
+
+  if(pCtx->bRunning)
+  {
+    // the pipes are closed, so wait for the process to exit
+
+    i1 = __WBProcessReap(pCtx->idProcess, &(pCtx->iStatus), &(pCtx->xUsage), 1);
+
+    pCtx->bRunning = 0;
+    pCtx->bReaped = i1 > 0;
+    pCtx->ullEndTime = __WBMonotonicTime();
+
+    WB_TRACE_CAPTURE_REAPED(pCtx);
+  }
+
+  WB_TRACE_RECORD(WB_SPAWN_PHASE_TOTAL, pCtx->ullTraceStart, __WBTraceTime());
+
+  __WBCaptureCleanup(pCtx);
+
+  __WBProcessRemove(pCtx->idProcess); // the caller never sees the process ID, so it's not needed any more
+}
+
+static WB_INT32 __WBCaptureExitCode(const WB_CAPTURE *pCtx)
+{
+  if(!pCtx->bReaped) // SIGCHLD is being ignored, and the status is lost
+  {
+    return -1;
+  }
+
+  return __WBExitCodeFromStatus(pCtx->iStatus);
+}
+
+// RESULT CACHE - an opt-in cache of WBRunResult() output for programs that always produce the same
+// output for the same input.  The key holds the resolved path, the arguments, a hash of the stdin
+// data and of the environment, and the program file's identity (device, inode, size, and modification
+// time), so replacing the program or changing its input is a miss.  Entries are kept in least-recently
+// used order, and the oldest ones are evicted to stay within the size limit.  With a directory for the
+// disk store, every result is also written to a file named for the key (without the file identity, so
+// that a new version of the program replaces its old results) and a memory miss checks there first.
+
+#define WB_RUN_CACHE_BUCKETS 256 /* must be a power of 2 */
+#define WB_RUN_CACHE_MAX_FRACTION 8 /* a result larger than 1/8 of the cache size is not cached */
+
+static const char szRunCacheMagic[8] = "WBRC0001"; // disk store file header
+
+typedef struct __WB_RUN_CACHE_IDENTITY__
+{
+  WB_UINT64 ullDev, ullIno, ullSize, ullMTimeSec, ullMTimeNSec; // the program file
+} WB_RUN_CACHE_IDENTITY;
+
+typedef struct __WB_RUN_CACHE_KEY__
+{
+  char *pKey;                 // identity, stdin length and hash, environment hash, path, then arguments (WBAlloc'd)
+  size_t cbKey;
+  WB_UINT64 ullHash;          // hash of the entire key
+  WB_UINT64 ullNameHash;      // hash of the key without the identity (the disk store's file name)
+} WB_RUN_CACHE_KEY;
+
+typedef struct __WB_RUN_CACHE_ENTRY__
+{
+  struct __WB_RUN_CACHE_ENTRY__ *pNext;   // hash bucket chain
+  struct __WB_RUN_CACHE_ENTRY__ *pNewer, *pOlder; // LRU list
+  WB_UINT64 ullHash;
+  size_t cbKey, cbOutput, cbTotal;
+  WB_INT32 iExitCode;
+  char *pOutput;              // zero byte terminated (the key follows it, in the same allocation)
+  char aKey[1];
+} WB_RUN_CACHE_ENTRY;
+
+typedef struct __WB_RUN_CACHE_FILE_HEADER__
+{
+  char szMagic[8];
+  WB_UINT64 cbKey;
+  WB_UINT64 cbOutput;
+  WB_INT32 iExitCode;
+  WB_INT32 iReserved;
+} WB_RUN_CACHE_FILE_HEADER;
+
+static pthread_mutex_t mtxRunCache = PTHREAD_MUTEX_INITIALIZER;
+static volatile int bRunCache = 0;
+static size_t cbRunCacheMax = 0, cbRunCacheUsed = 0;
+static char *szRunCacheDir = NULL; // WBAlloc'd, or NULL for no disk store
+static WB_RUN_CACHE_ENTRY *apRunCache[WB_RUN_CACHE_BUCKETS];
+static WB_RUN_CACHE_ENTRY *pRunCacheNewest = NULL, *pRunCacheOldest = NULL;
+static WB_RUN_CACHE_STATS xRunCacheStats;
+
+// a fast 64-bit hash (not a cryptographic one) that reads 8 bytes at a time
+
+static WB_UINT64 __WBHash64(const void *pData, size_t cbData, WB_UINT64 ullSeed)
+{
+const unsigned char *p1 = (const unsigned char *)pData;
+WB_UINT64 ullRval, ullW;
+
+
+  ullRval = ullSeed ^ ((WB_UINT64)cbData * 0x9e3779b97f4a7c15ULL);
+
+  while(cbData >= 8)
+  {
+    memcpy(&ullW, p1, 8); // no alignment assumptions
+
+    ullW *= 0x87c37b91114253d5ULL;
+    ullW ^= ullW >> 31;
+    ullRval = (ullRval ^ ullW) * 0x4cf5ad432745937fULL;
+
+    p1 += 8;
+    cbData -= 8;
+  }
+
+  if(cbData)
+  {
+    ullW = 0;
+    memcpy(&ullW, p1, cbData);
+
+    ullRval = (ullRval ^ (ullW * 0x87c37b91114253d5ULL)) * 0x4cf5ad432745937fULL;
+  }
+
+  ullRval ^= ullRval >> 33; // final mix, so that every input bit affects every output bit
+  ullRval *= 0xff51afd7ed558ccdULL;
+  ullRval ^= ullRval >> 33;
+
+  return ullRval;
+}
+
+// copy the 'argv' that 'pArgs' produces into 'pDest' (when not NULL) as a sequence of zero byte
+// terminated strings, and return its size.  argv[0] is derived the way __WBRunAsyncPipeInternal does it.
+
+static size_t __WBRunCacheKeyArgs(char *pDest, const char *szAppName, const WB_RUN_ARGS *pArgs)
+{
+const char *pArg;
+size_t cbRval = 0, cb;
+va_list va2;
+int i1;
+
+
+  if(!pArgs->ppArgv)
+  {
+    pArg = strrchr(szAppName, '/');
+    pArg = pArg ? pArg + 1 : szAppName;
+  }
+  else
+  {
+    pArg = pArgs->ppArgv[0];
+  }
+
+  if(pArgs->pva && !pArgs->ppArgv)
+  {
+    va_copy(va2, *(pArgs->pva));
+  }
+
+  for(i1=1; pArg; i1++)
+  {
+    cb = strlen(pArg) + 1;
+
+    if(pDest)
+    {
+      memcpy(pDest + cbRval, pArg, cb);
+    }
+
+    cbRval += cb;
+
+    if(pArgs->ppArgv)
+    {
+      pArg = pArgs->ppArgv[i1];
+    }
+    else if(pArgs->ppArgs)
+    {
+      pArg = pArgs->ppArgs[i1 - 1];
+    }
+    else
+    {
+      pArg = va_arg(va2, const char *);
+    }
+  }
+
+  if(pArgs->pva && !pArgs->ppArgv)
+  {
+    va_end(va2);
+  }
+
+  return cbRval;
+}
+
+// build the key for running 'szAppName' with 'pArgs' and the given input, in the current directory.
+// returns zero on success, or non-zero if the result can't be cached (the program can't be found,
+// the current directory can't be read, or no memory)
+
+static int __WBRunCacheKey(WB_RUN_CACHE_KEY *pKey, const void *pStdin, size_t cbStdin,
+                           const char *szAppName, const WB_RUN_ARGS *pArgs)
+{
+extern char **environ;
+WB_RUN_CACHE_IDENTITY xID;
+WB_UINT64 aullInput[3];
+char szBuf[PATH_MAX], szCwd[PATH_MAX];
+struct stat sF;
+const char *pPath;
+char * const *ppEnv;
+size_t cbPath, cbCwd, cbArgs;
+
+
+  memset(pKey, 0, sizeof(*pKey));
+
+  pPath = __WBSearchPathInternal(szAppName, szBuf);
+
+  if(!pPath || stat(pPath, &sF))
+  {
+    return -1;
+  }
+
+  // relative paths in the arguments (and the program's own idea of where it is) depend on it
+
+  if(!getcwd(szCwd, sizeof(szCwd)))
+  {
+    return -1;
+  }
+
+  memset(&xID, 0, sizeof(xID));
+  xID.ullDev = (WB_UINT64)sF.st_dev;
+  xID.ullIno = (WB_UINT64)sF.st_ino;
+  xID.ullSize = (WB_UINT64)sF.st_size;
+  xID.ullMTimeSec = (WB_UINT64)sF.st_mtim.tv_sec;
+  xID.ullMTimeNSec = (WB_UINT64)sF.st_mtim.tv_nsec;
+
+  aullInput[0] = pStdin ? (WB_UINT64)cbStdin : 0;
+  aullInput[1] = pStdin ? __WBHash64(pStdin, cbStdin, 0) : 0;
+  aullInput[2] = 0;
+
+  for(ppEnv = pArgs->envp ? pArgs->envp : environ; ppEnv && *ppEnv; ppEnv++)
+  {
+    aullInput[2] = __WBHash64(*ppEnv, strlen(*ppEnv) + 1, aullInput[2]);
+  }
+
+  cbPath = strlen(pPath) + 1;
+  cbCwd = strlen(szCwd) + 1;
+  cbArgs = __WBRunCacheKeyArgs(NULL, szAppName, pArgs);
+
+  pKey->cbKey = sizeof(xID) + sizeof(aullInput) + cbPath + cbCwd + cbArgs;
+  pKey->pKey = (char *)WBAlloc(pKey->cbKey);
+
+  if(!pKey->pKey)
+  {
+    return -1;
+  }
+
+  memcpy(pKey->pKey, &xID, sizeof(xID));
+  memcpy(pKey->pKey + sizeof(xID), aullInput, sizeof(aullInput));
+  memcpy(pKey->pKey + sizeof(xID) + sizeof(aullInput), pPath, cbPath);
+  memcpy(pKey->pKey + sizeof(xID) + sizeof(aullInput) + cbPath, szCwd, cbCwd);
+
+  __WBRunCacheKeyArgs(pKey->pKey + sizeof(xID) + sizeof(aullInput) + cbPath + cbCwd, szAppName, pArgs);
+
+  pKey->ullNameHash = __WBHash64(pKey->pKey + sizeof(xID), pKey->cbKey - sizeof(xID), 0);
+  pKey->ullHash = __WBHash64(pKey->pKey, sizeof(xID), pKey->ullNameHash);
+
+  return 0;
+}
+
+// read or write exactly 'cbData' bytes of a disk store file, retrying on EINTR.  returns zero on success
+
+static int __WBRunCacheFileIO(WB_FILE_HANDLE hFile, void *pData, size_t cbData, int bWrite)
+{
+char *p1 = (char *)pData;
+ssize_t cb;
+
+
+  while(cbData > 0)
+  {
+    cb = bWrite ? write(hFile, p1, cbData) : read(hFile, p1, cbData);
+
+    if(cb < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else if(cb <= 0)
+    {
+      return -1; // includes a short file
+    }
+
+    p1 += cb;
+    cbData -= cb;
+  }
+
+  return 0;
+}
+
+// NOTE:  'mtxRunCache' must be locked by the caller for the functions that manage entries
+
+static void __WBRunCacheUnlink(WB_RUN_CACHE_ENTRY *pE)
+{
+WB_RUN_CACHE_ENTRY **ppE;
+
+
+  for(ppE = &(apRunCache[pE->ullHash & (WB_RUN_CACHE_BUCKETS - 1)]); *ppE; ppE = &((*ppE)->pNext))
+  {
+    if(*ppE == pE)
+    {
+      *ppE = pE->pNext;
+      break;
+    }
+  }
+
+  if(pE->pNewer)
+  {
+    pE->pNewer->pOlder = pE->pOlder;
+  }
+  else
+  {
+    pRunCacheNewest = pE->pOlder;
+  }
+
+  if(pE->pOlder)
+  {
+    pE->pOlder->pNewer = pE->pNewer;
+  }
+  else
+  {
+    pRunCacheOldest = pE->pNewer;
+  }
+
+  cbRunCacheUsed -= pE->cbTotal;
+  xRunCacheStats.nEntries--;
+}
+
+static void __WBRunCacheMakeNewest(WB_RUN_CACHE_ENTRY *pE)
+{
+  if(pE == pRunCacheNewest)
+  {
+    return;
+  }
+
+  // take it out of the list (it can't be the newest, so 'pNewer' is not NULL)
+
+  pE->pNewer->pOlder = pE->pOlder;
+
+  if(pE->pOlder)
+  {
+    pE->pOlder->pNewer = pE->pNewer;
+  }
+  else
+  {
+    pRunCacheOldest = pE->pNewer;
+  }
+
+  pE->pOlder = pRunCacheNewest;
+  pE->pNewer = NULL;
+  pRunCacheNewest->pNewer = pE;
+  pRunCacheNewest = pE;
+}
+
+static WB_RUN_CACHE_ENTRY * __WBRunCacheFind(const WB_RUN_CACHE_KEY *pKey)
+{
+WB_RUN_CACHE_ENTRY *pE;
+
+
+  for(pE = apRunCache[pKey->ullHash & (WB_RUN_CACHE_BUCKETS - 1)]; pE; pE = pE->pNext)
+  {
+    if(pE->ullHash == pKey->ullHash && pE->cbKey == pKey->cbKey &&
+       !memcmp(pE->aKey, pKey->pKey, pKey->cbKey))
+    {
+      return pE;
+    }
+  }
+
+  return NULL;
+}
+
+// add a result to the cache (replacing one with the same key), evicting the oldest entries to make room
+
+static void __WBRunCacheInsert(const WB_RUN_CACHE_KEY *pKey, const char *pOutput, size_t cbOutput, WB_INT32 iExitCode)
+{
+WB_RUN_CACHE_ENTRY *pE;
+size_t cbTotal;
+
+
+  cbTotal = sizeof(*pE) + pKey->cbKey + cbOutput + 1;
+
+  if(!bRunCache || cbTotal > cbRunCacheMax / WB_RUN_CACHE_MAX_FRACTION)
+  {
+    return;
+  }
+
+  pE = __WBRunCacheFind(pKey);
+
+  if(pE)
+  {
+    __WBRunCacheUnlink(pE);
+    WBFree(pE);
+  }
+
+  while(pRunCacheOldest && cbRunCacheUsed + cbTotal > cbRunCacheMax)
+  {
+    pE = pRunCacheOldest;
+
+    __WBRunCacheUnlink(pE);
+    WBFree(pE);
+
+    xRunCacheStats.ullEvictions++;
+  }
+
+  pE = (WB_RUN_CACHE_ENTRY *)WBAlloc(cbTotal);
+
+  if(!pE)
+  {
+    return;
+  }
+
+  pE->ullHash = pKey->ullHash;
+  pE->cbKey = pKey->cbKey;
+  pE->cbOutput = cbOutput;
+  pE->cbTotal = cbTotal;
+  pE->iExitCode = iExitCode;
+
+  memcpy(pE->aKey, pKey->pKey, pKey->cbKey);
+
+  pE->pOutput = pE->aKey + pKey->cbKey;
+
+  if(cbOutput)
+  {
+    memcpy(pE->pOutput, pOutput, cbOutput);
+  }
+
+  pE->pOutput[cbOutput] = 0;
+
+  pE->pNext = apRunCache[pKey->ullHash & (WB_RUN_CACHE_BUCKETS - 1)];
+  apRunCache[pKey->ullHash & (WB_RUN_CACHE_BUCKETS - 1)] = pE;
+
+  pE->pNewer = NULL;
+  pE->pOlder = pRunCacheNewest;
+
+  if(pRunCacheNewest)
+  {
+    pRunCacheNewest->pNewer = pE;
+  }
+  else
+  {
+    pRunCacheOldest = pE;
+  }
+
+  pRunCacheNewest = pE;
+
+  cbRunCacheUsed += cbTotal;
+  xRunCacheStats.nEntries++;
+}
+
+static void __WBRunCacheFreeAll(void)
+{
+WB_RUN_CACHE_ENTRY *pE;
+
+
+  while((pE = pRunCacheOldest) != NULL)
+  {
+    __WBRunCacheUnlink(pE);
+    WBFree(pE);
+  }
+}
+
+// the disk store's file for 'pKey' (WBAlloc'd), or NULL.  NOTE:  'mtxRunCache' must be locked
+
+static char * __WBRunCacheFileName(const WB_RUN_CACHE_KEY *pKey)
+{
+char *pRval;
+size_t cb;
+
+
+  if(!szRunCacheDir)
+  {
+    return NULL;
+  }
+
+  cb = strlen(szRunCacheDir) + 32;
+
+  pRval = (char *)WBAlloc(cb);
+
+  if(pRval)
+  {
+    snprintf(pRval, cb, "%s/%016llx.wbrc", szRunCacheDir, (unsigned long long)pKey->ullNameHash);
+  }
+
+  return pRval;
+}
+
+// read a result from the disk store.  returns a WBAlloc'd copy of the output, or NULL if there isn't
+// one for this key (the file may hold the results for a different version of the program)
+
+static char * __WBRunCacheReadFile(const char *szFile, const WB_RUN_CACHE_KEY *pKey,
+                                   size_t *pcbOutput, WB_INT32 *piExitCode)
+{
+WB_RUN_CACHE_FILE_HEADER xHdr;
+WB_FILE_HANDLE hFile;
+char *pKeyBuf = NULL, *pRval = NULL;
+
+
+  hFile = open(szFile, O_RDONLY | O_CLOEXEC);
+
+  if(hFile < 0)
+  {
+    return NULL;
+  }
+
+  if(__WBRunCacheFileIO(hFile, &xHdr, sizeof(xHdr), 0) ||
+     memcmp(xHdr.szMagic, szRunCacheMagic, sizeof(xHdr.szMagic)) ||
+     xHdr.cbKey != pKey->cbKey || xHdr.cbOutput >= (WB_UINT64)SSIZE_MAX)
+  {
+    goto exit_point;
+  }
+
+  pKeyBuf = (char *)WBAlloc(pKey->cbKey);
+
+  if(!pKeyBuf || __WBRunCacheFileIO(hFile, pKeyBuf, pKey->cbKey, 0) || memcmp(pKeyBuf, pKey->pKey, pKey->cbKey))
+  {
+    goto exit_point;
+  }
+
+  pRval = (char *)WBAlloc((size_t)xHdr.cbOutput + 1);
+
+  if(pRval && __WBRunCacheFileIO(hFile, pRval, (size_t)xHdr.cbOutput, 0))
+  {
+    WBFree(pRval);
+    pRval = NULL;
+  }
+
+  if(pRval)
+  {
+    pRval[xHdr.cbOutput] = 0;
+
+    *pcbOutput = (size_t)xHdr.cbOutput;
+    *piExitCode = xHdr.iExitCode;
+  }
+
+exit_point:
+
+  if(pKeyBuf)
+  {
+    WBFree(pKeyBuf);
+  }
+
+  close(hFile);
+
+  return pRval;
+}
+
+// write a result to the disk store.  It's written to a temporary file that is renamed, so that
+// another process reading the same entry never sees a partial one.
+
+static void __WBRunCacheWriteFile(const char *szFile, const WB_RUN_CACHE_KEY *pKey,
+                                  const char *pOutput, size_t cbOutput, WB_INT32 iExitCode)
+{
+WB_RUN_CACHE_FILE_HEADER xHdr;
+WB_FILE_HANDLE hFile;
+char *pTemp;
+size_t cb;
+
+
+  cb = strlen(szFile) + 8;
+
+  pTemp = (char *)WBAlloc(cb);
+
+  if(!pTemp)
+  {
+    return;
+  }
+
+  snprintf(pTemp, cb, "%s.XXXXXX", szFile);
+
+  hFile = mkostemp(pTemp, O_CLOEXEC);
+
+  if(hFile < 0)
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to create \"%s\", errno=%d\n", __FUNCTION__, pTemp, errno);
+
+    WBFree(pTemp);
+    return;
+  }
+
+  memset(&xHdr, 0, sizeof(xHdr));
+  memcpy(xHdr.szMagic, szRunCacheMagic, sizeof(xHdr.szMagic));
+  xHdr.cbKey = pKey->cbKey;
+  xHdr.cbOutput = cbOutput;
+  xHdr.iExitCode = iExitCode;
+
+  if(__WBRunCacheFileIO(hFile, &xHdr, sizeof(xHdr), 1) || __WBRunCacheFileIO(hFile, pKey->pKey, pKey->cbKey, 1) ||
+     (cbOutput && __WBRunCacheFileIO(hFile, (void *)pOutput, cbOutput, 1)))
+  {
+    close(hFile);
+    hFile = WB_INVALID_FILE_HANDLE;
+  }
+
+  if(hFile == WB_INVALID_FILE_HANDLE || close(hFile) || rename(pTemp, szFile))
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to write \"%s\", errno=%d\n", __FUNCTION__, szFile, errno);
+
+    unlink(pTemp);
+  }
+
+  WBFree(pTemp);
+}
+
+// look for a cached result.  returns a WBAlloc'd copy of the output (zero byte terminated), or NULL on a miss
+
+static char * __WBRunCacheLookup(const WB_RUN_CACHE_KEY *pKey, size_t *pcbOutput, WB_INT32 *piExitCode)
+{
+WB_RUN_CACHE_ENTRY *pE;
+char *pRval = NULL, *szFile;
+
+
+  pthread_mutex_lock(&mtxRunCache);
+
+  pE = __WBRunCacheFind(pKey);
+
+  if(pE)
+  {
+    __WBRunCacheMakeNewest(pE);
+
+    pRval = (char *)WBAlloc(pE->cbOutput + 1);
+
+    if(pRval)
+    {
+      memcpy(pRval, pE->pOutput, pE->cbOutput + 1);
+
+      *pcbOutput = pE->cbOutput;
+      *piExitCode = pE->iExitCode;
+
+      xRunCacheStats.ullHits++;
+    }
+
+    pthread_mutex_unlock(&mtxRunCache);
+
+    return pRval;
+  }
+
+  szFile = __WBRunCacheFileName(pKey);
+
+  pthread_mutex_unlock(&mtxRunCache);
+
+  if(szFile)
+  {
+    pRval = __WBRunCacheReadFile(szFile, pKey, pcbOutput, piExitCode);
+
+    WBFree(szFile);
+  }
+
+  pthread_mutex_lock(&mtxRunCache);
+
+  if(pRval)
+  {
+    __WBRunCacheInsert(pKey, pRval, *pcbOutput, *piExitCode);
+
+    xRunCacheStats.ullDiskHits++;
+  }
+  else
+  {
+    xRunCacheStats.ullMisses++;
+  }
+
+  pthread_mutex_unlock(&mtxRunCache);
+
+  return pRval;
+}
+
+static void __WBRunCacheStore(const WB_RUN_CACHE_KEY *pKey, const char *pOutput, size_t cbOutput, WB_INT32 iExitCode)
+{
+char *szFile;
+
+
+  pthread_mutex_lock(&mtxRunCache);
+
+  __WBRunCacheInsert(pKey, pOutput, cbOutput, iExitCode);
+
+  szFile = __WBRunCacheFileName(pKey);
+
+  pthread_mutex_unlock(&mtxRunCache);
+
+  if(szFile)
+  {
+    __WBRunCacheWriteFile(szFile, pKey, pOutput, cbOutput, iExitCode);
+
+    WBFree(szFile);
+  }
+}
+
+int WBRunCacheEnable(size_t cbMax, const char *szDir)
+{
+char *pDir = NULL;
+
+
+  if(szDir && *szDir)
+  {
+    if(WBStat(szDir, NULL) && WBMkDir(szDir, 0700))
+    {
+      WB_ERROR_PRINT("ERROR:  %s - unable to create \"%s\", errno=%d\n", __FUNCTION__, szDir, errno);
+      return -1;
+    }
+
+    pDir = WBCopyString(szDir);
+
+    if(!pDir)
+    {
+      return -1;
+    }
+  }
+
+  pthread_mutex_lock(&mtxRunCache);
+
+  if(szRunCacheDir)
+  {
+    WBFree(szRunCacheDir);
+  }
+
+  szRunCacheDir = pDir;
+  cbRunCacheMax = cbMax;
+  bRunCache = cbMax > 0 || pDir; // with only a disk store, nothing is kept in memory
+
+  while(pRunCacheOldest && cbRunCacheUsed > cbRunCacheMax)
+  {
+    WB_RUN_CACHE_ENTRY *pE = pRunCacheOldest;
+
+    __WBRunCacheUnlink(pE);
+    WBFree(pE);
+
+    xRunCacheStats.ullEvictions++;
+  }
+
+  pthread_mutex_unlock(&mtxRunCache);
+
+  return 0;
+}
+
+void WBRunCacheDisable(void)
+{
+  pthread_mutex_lock(&mtxRunCache);
+
+  bRunCache = 0;
+  cbRunCacheMax = 0;
+
+  if(szRunCacheDir)
+  {
+    WBFree(szRunCacheDir);
+    szRunCacheDir = NULL;
+  }
+
+  __WBRunCacheFreeAll();
+
+  pthread_mutex_unlock(&mtxRunCache);
+}
+
+void WBRunCacheClear(void)
+{
+  pthread_mutex_lock(&mtxRunCache);
+
+  __WBRunCacheFreeAll(); // the disk store is left alone
+
+  pthread_mutex_unlock(&mtxRunCache);
+}
+
+void WBRunCacheGetStats(WB_RUN_CACHE_STATS *pStats)
+{
+  if(!pStats)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&mtxRunCache);
+
+  *pStats = xRunCacheStats;
+  pStats->cbUsed = cbRunCacheUsed;
+
+  pthread_mutex_unlock(&mtxRunCache);
+}
+
+// run a process, supplying 'pStdin' (if not NULL) as its input, and capture its stdout.
+// the arguments come from 'pArgs' (see __WBRunAsyncPipeInternal)
+
+static char * __WBRunResultCapture(const void *pStdin, size_t cbStdin, WB_INT32 *pExitCode, size_t *pcbOutput,
+                                   const char *szAppName, const WB_RUN_ARGS *pArgs)
+{
+WB_CAPTURE xCtx;
+WB_RUN_CACHE_KEY xKey;
+WB_INT32 iExitCode;
+size_t cbOutput;
+char *pRval;
+
+
+  memset(&xKey, 0, sizeof(xKey));
+
+  if(bRunCache && !pArgs->pExecutable && !pArgs->pSetup &&
+     !__WBRunCacheKey(&xKey, pStdin, cbStdin, szAppName, pArgs))
+  {
+    pRval = __WBRunCacheLookup(&xKey, &cbOutput, &iExitCode);
+
+    if(pRval)
+    {
+      WBFree(xKey.pKey);
+
+      if(pExitCode)
+      {
+        *pExitCode = iExitCode;
+      }
+
+      if(pcbOutput)
+      {
+        *pcbOutput = cbOutput;
+      }
+
+      return pRval;
+    }
+  }
+
+  // use WBRunAsyncPipeV to create a process, with all stdout piped to a char * buffer capture
+  // stdin is written from 'pStdin' (or /dev/null) and stderr is piped to /dev/null
+
+  __WBCaptureInit(&xCtx);
+
+  xCtx.aStream[WB_CAPTURE_STDOUT].iSink = WB_CAPTURE_SINK_BUFFER;
+  xCtx.pStdin = (const char *)pStdin;
+  xCtx.cbStdin = pStdin ? cbStdin : 0;
+
+  if(__WBCaptureStart(&xCtx, WB_INVALID_FILE_HANDLE, szAppName, pArgs))
+  {
+//    WB_ERROR_PRINT("TEMPORARY:  %s failed to run \"%s\" errno=%d\n", __FUNCTION__, szAppName, errno);
+    if(xKey.pKey)
+    {
+      WBFree(xKey.pKey);
+    }
+
+    return NULL;
+  }
+
+  __WBCaptureLoop(&xCtx);
+
+  if(xCtx.bAborted) // out of memory, etc.
+  {
+    WBFree(xCtx.aStream[WB_CAPTURE_STDOUT].pBuf);
+
+    if(xKey.pKey)
+    {
+      WBFree(xKey.pKey);
+    }
+
+    return NULL;
+  }
+
+  if(xKey.pKey)
+  {
+    // only a normal exit is cached; a process killed by a signal may not have finished its output
+
+    if(xCtx.bReaped && WIFEXITED(xCtx.iStatus) && xCtx.aStream[WB_CAPTURE_STDOUT].pBuf)
+    {
+      __WBRunCacheStore(&xKey, xCtx.aStream[WB_CAPTURE_STDOUT].pBuf, xCtx.aStream[WB_CAPTURE_STDOUT].cbData,
+                        __WBCaptureExitCode(&xCtx));
+    }
+
+    WBFree(xKey.pKey);
+  }
+
+  if(pExitCode)
+  {
+    *pExitCode = __WBCaptureExitCode(&xCtx);
+  }
+
+  if(pcbOutput)
+  {
+    *pcbOutput = xCtx.aStream[WB_CAPTURE_STDOUT].cbData;
+  }
+
+  return xCtx.aStream[WB_CAPTURE_STDOUT].pBuf;
+}
+
+static char * __WBRunResultWithInputV(const void *pStdin, size_t cbStdin, WB_INT32 *pExitCode,
+                                      const char *szAppName, va_list va)
+{
+char *pRval;
+WB_RUN_ARGS xArgs;
+va_list va2;
+
+
+  va_copy(va2, va); // so I can pass it by reference
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.pva = &va2;
+
+  pRval = __WBRunResultCapture(pStdin, cbStdin, pExitCode, NULL, szAppName, &xArgs);
+
+  va_end(va2);
+
+  return pRval;
+}
+
+static char * WBRunResultInternal(WB_FILE_HANDLE hStdIn, WB_INT32 *pExitCode, const char *szAppName, va_list va)
+{
+  (void)hStdIn; // always WB_INVALID_FILE_HANDLE on POSIX systems; input is supplied as a buffer instead
+
+  return __WBRunResultWithInputV(NULL, 0, pExitCode, szAppName, va);
+}
+
+#endif // WIN32
+
+int WBRunStreamV(WB_RUN_STREAM_CALLBACK pCallback, void *pUserData, int iFlags,
+                 WB_INT32 *pExitCode, const char *szAppName, va_list va)
+{
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+WB_CAPTURE xCtx;
+WB_RUN_ARGS xArgs;
+va_list va2;
+int iErr;
+
+
+  if(!pCallback)
+  {
+    return -1;
+  }
+
+  __WBCaptureInit(&xCtx);
+
+  xCtx.pCallback = pCallback;
+  xCtx.pUserData = pUserData;
+  xCtx.aStream[WB_CAPTURE_STDOUT].iSink = WB_CAPTURE_SINK_CALLBACK;
+
+  if(iFlags & WB_RUN_STREAM_STDERR)
+  {
+    xCtx.aStream[WB_CAPTURE_STDERR].iSink = WB_CAPTURE_SINK_CALLBACK;
+  }
+
+  va_copy(va2, va); // so I can pass it by reference
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.pva = &va2;
+
+  iErr = __WBCaptureStart(&xCtx, WB_INVALID_FILE_HANDLE, szAppName, &xArgs);
+
+  va_end(va2);
+
+  if(iErr)
+  {
+    return -1;
+  }
+
+  __WBCaptureLoop(&xCtx);
+
+  if(pExitCode)
+  {
+    *pExitCode = __WBCaptureExitCode(&xCtx);
+  }
+
+  return xCtx.bAborted ? 1 : 0;
+#endif // WIN32
+}
+
+int WBRunStream(WB_RUN_STREAM_CALLBACK pCallback, void *pUserData, int iFlags,
+                WB_INT32 *pExitCode, const char *szAppName, ...)
+{
+int iRval;
+va_list va;
+
+
+  va_start(va, szAppName);
+
+  iRval = WBRunStreamV(pCallback, pUserData, iFlags, pExitCode, szAppName, va);
+
+  va_end(va);
+
+  return iRval;
+}
+
+int WBGetProcessState(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode)
+{
+#ifdef WIN32
+  int iRval = -1;
+  HANDLE hProcess = idProcess.hProcess; //OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, idProcess);
+  DWORD dwWait, dwTemp = -1;
+
+  if(pExitCode)
+    *pExitCode = -1;;
+
+  if(hProcess == INVALID_HANDLE_VALUE)
+  {
+    if(idProcess.uiProcessID != 0) // for now this indicates valid.  process 0 is inaccessible
+      return idProcess.iCachedExitCode; // return cached value
+
+    return -1;
+  }
+
+  dwWait = WaitForMultipleObjects(1, &hProcess, FALSE, 10);
+
+  if(dwWait == WAIT_TIMEOUT)
+  {
+    iRval = 1; // still running
+  }
+  else if(dwWait == WAIT_OBJECT_0) // process has stopped
+  {
+    iRval = 0;
+  }
+  else // if(dwWait == WAIT_ABANDONED_0)
+  {
+    iRval = -1;  // like 'quit' baby, quit!
+  }
+
+  if(!iRval)
+  {
+    if(GetExitCodeProcess(hProcess, &dwTemp))
+    {
+      if(pExitCode)
+        *pExitCode = dwTemp;
+      idProcess.iCachedExitCode = dwTemp;
+    }
+    else
+    {
+      iRval = -1; // oops
+    }
+
+    CloseHandle(idProcess.hProcess); // clean up
+    idProcess.hProcess = INVALID_HANDLE_VALUE; //  because I closed it
+  }
+
+//  CloseHandle(hProcess);
+  return iRval;
+
+#else // WIN32
+
+  return WBGetProcessStateEx(idProcess, pExitCode, NULL);
+
+#endif // WIN32
+}
+
+int WBGetProcessStateEx(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode, WB_RUN_USAGE *pUsage)
+{
+#ifdef WIN32
+#error not yet implemented
+#else // WIN32
+  struct rusage xUsage;
+  int iStat, iRval;
+
+  // processes in the process table are reaped (and their status cached) through the table.
+  // the reaper thread leaves them there once they're reaped, so this returns right away
+
+  if((int)idProcess > 0 && __WBProcessTracked(idProcess))
+  {
+    iRval = __WBProcessReap(idProcess, &iStat, &xUsage, 0);
+
+    if(!iRval)
+    {
+      return 1; // still running
+    }
+
+    __WBProcessRemove(idProcess); // status has been consumed
+
+    if(iRval < 0)
+    {
+      return -1; // error
+    }
+
+    if(pExitCode)
+    {
+      *pExitCode = __WBExitCodeFromStatus(iStat);
+    }
+
+    if(pUsage)
+    {
+      __WBRunUsageFromRusage(pUsage, &xUsage);
+    }
+
+    return 0; // not running
+  }
+
+  // for wait4() [like waitpid()], if WNOHANG is specified and there are no stopped, continued or exited children, 0 is returned
+
+  iStat = 0;
+  iRval = wait4(idProcess, &iStat, WNOHANG, &xUsage); // note this might return non-zero for stopped or continued processes
+
+  if(iRval > 0 && (iRval == (int)idProcess || (int)idProcess == -1 || (int)idProcess == 0))
+  {
+    if(WIFEXITED(iStat) || WIFSIGNALED(iStat)) // test if process exits also.
+    {
+      __WBProcessStatsEnd(iRval, iStat, &xUsage);
+
+      if(pExitCode)
+      {
+        *pExitCode = __WBExitCodeFromStatus(iStat);
+      }
+
+      if(pUsage)
+      {
+        __WBRunUsageFromRusage(pUsage, &xUsage);
+      }
+
+      return 0; // not running
+    }
+
+    return 1; // still running
+  }
+
+  if(iRval == 0)
+  {
+    return 1; // still running
+  }
+
+  if(iRval > 0)
+  {
+    WB_ERROR_PRINT("ERROR:  %s - wait4 returns %d, but does not match %d\n",
+                   __FUNCTION__, iRval, (int)idProcess);
+  }
+
+  return -1; // error
+#endif // WIN32
+}
+
+char *WBRunResult(const char *szAppName, ...)
+{
+char *pRval;
+va_list va;
+
+
+  va_start(va, szAppName);
+
+  pRval = WBRunResultInternal(WB_INVALID_FILE_HANDLE, NULL, szAppName, va);
+
+  va_end(va);
+
+  return pRval;
+}
+
+char *WBRunResult2(const char *szAppName, ...)
+{
+char *pRval;
+int32_t nExitCode;
+va_list va;
+
+
+  va_start(va, szAppName);
+
+  pRval = WBRunResultInternal(INVALID_HANDLE_VALUE, &nExitCode, szAppName, va);
+
+  if(pRval && nExitCode)
+  {
+//    fprintf(stderr, "%s - %s ended with error code %d\n", __FUNCTION__, szAppName, nExitCode);
+//    fflush(stderr);
+
+    free(pRval);
+    pRval = NULL;
+  }
+
+  va_end(va);
+
+  return pRval;
+}
+
+#ifdef WIN32
+struct __RunResult3_worker_thread_params
+{
+  volatile HANDLE hStdin[2];  // pipe for STDIN
+  const void * pStdin;
+  int cbStdin;
+  volatile HANDLE hThread;
+  volatile unsigned int dwThreadID;
+  volatile int bStateFlag; // 0 = not running, 1 = running, -1 force stop
+};
+
+static unsigned int __stdcall __RunResult3_worker_thread(void *pData)
+{
+int i2;
+const BYTE *p1;
+DWORD cb1, cbData;
+HANDLE hTemp;
+struct __RunResult3_worker_thread_params *pParams = (struct __RunResult3_worker_thread_params *)pData;
+
+  // so long as the process is alive, write data to the pipe
+#define RUNRESULT3_BUFFER_LENGTH 256
+  pParams->bStateFlag = 1; // indicates I'm running
+
+  p1 = (const BYTE *)pParams->pStdin;
+  cbData = pParams->cbStdin;
+
+  while(cbData && pParams->dwThreadID)
+  {
+    cb1 = 0;
+     // if buffer empty, fill it
+#if 0
+    if(!PeekNamedPipe(pParams->hStdin[0], NULL, 0, NULL, &cb1, NULL))
+    {
+      goto check_pipe_io_error;
+    }
+    else if(cb1 > RUNRESULT3_BUFFER_LENGTH / 2)
+    {
+      Sleep(20);
+    }
+    else
+#endif // 0
+    {
+      i2 = RUNRESULT3_BUFFER_LENGTH - cb1; // available write space
+      if(i2 > (int)cbData)
+        i2 = cbData;
+
+      if(!WriteFile(pParams->hStdin[1], p1, i2, &cb1, NULL))
+      {
+        DWORD dwErr;
+check_pipe_io_error:
+
+        dwErr = GetLastError();
+
+        if(dwErr == ERROR_MORE_DATA || dwErr == ERROR_PIPE_BUSY || dwErr == ERROR_IO_PENDING
+           || dwErr == ERROR_NO_MORE_ITEMS/* EAGAIN */ )
+        {
+          Sleep(10); // wait 1/2 msec
+        }
+        else
+        {
+          break; // an error of some kind, so bail out [pipe closed?]
+        }
+      }
+      else if(!cb1)  // this just might be an error
+      {
+        // TODO: anything?
+        Sleep(50);
+      }
+      else
+      {
+        p1 += cb1; // point past the # of bytes I just read in
+        cbData -= cb1;
+      }
+    }
+  }
+
+  Sleep(10); // wait 10 msec
+
+  // close my end of the pipe
+  hTemp = pParams->hStdin[1];
+  pParams->hStdin[1] = INVALID_HANDLE_VALUE;
+  CloseHandle(hTemp);
+
+  hTemp = pParams->hStdin[0];
+  pParams->hStdin[0] = INVALID_HANDLE_VALUE;
+  CloseHandle(hTemp);
+
+  // mark as 'exited'
+  pParams->bStateFlag = -1; // indicates I'm ending
+  _endthreadex(0);
+  return 0;
+}
+#endif // WIN32
+
+
+char *WBRunResult3(const void *pStdin, int cbStdin, const char *szAppName, ...)
+{
+#ifdef WIN32
+char *pRval;
+INT32 nExitCode;
+va_list va;
+struct __RunResult3_worker_thread_params xParams = {{INVALID_HANDLE_VALUE,INVALID_HANDLE_VALUE},
+                                                    NULL, 0, INVALID_HANDLE_VALUE, 0, 0 };
+
+
+  va_start(va, szAppName);
+
+  // create a pipe and worker thread for stdin using pStdin and cbStdin
+
+  if(!CreatePipe((HANDLE *)&(xParams.hStdin[0]), (HANDLE *)&(xParams.hStdin[1]), NULL, 0))
+  {
+//    WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (2)\n", __FUNCTION__);
+    return NULL;
+  }
+
+  SetHandleInformation(xParams.hStdin[0], HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+
+  // start worker thread
+  xParams.hThread = (HANDLE)_beginthreadex(NULL, 65536, __RunResult3_worker_thread,
+                                           &xParams, 0,//CREATE_SUSPENDED,
+                                           (unsigned int *)&xParams.dwThreadID);
+
+  if(xParams.hThread == WB_INVALID_HANDLE_VALUE)
+  {
+//    WB_ERROR_PRINT("* ERROR * - unable to create thread, %d (%x) (a)\n",
+//                   GetLastError(), GetLastError());
+    goto error_exit;
+  }
+
+  xParams.pStdin = pStdin;
+  xParams.cbStdin = cbStdin;
+
+  //ResumeThread(xParams.hThread);
+
+  pRval = RunResultInternal(xParams.hStdin[0], &nExitCode, szAppName, va);
+
+  // wait for worker thread close
+
+  if(pRval && nExitCode)
+  {
+#ifdef _DEBUG
+    {
+      char tbuf[1024];
+      _sntprintf(tbuf, sizeof(tbuf), "%s ended with error code %d\n", szAppName, nExitCode);
+      ::MessageBox(NULL, tbuf, "** EXTERNAL APPLICATION ERROR **", MB_OK |  MB_ICONERROR);
+      OutputDebugString(pRval);
+    }
+#endif _DEBUG
+
+    free(pRval);
+    pRval = NULL;
+  }
+
+  va_end(va);
+
+error_exit:
+
+  xParams.dwThreadID = 0; // tells thread to exit
+
+  if(xParams.hThread != INVALID_HANDLE_VALUE)
+  {
+    while(xParams.bStateFlag > 0)
+      Sleep(10); // wait for it to end
+
+    CloseHandle(xParams.hThread);
+  }
+
+  if(xParams.hStdin[1] != INVALID_HANDLE_VALUE)
+    CloseHandle(xParams.hStdin[1]);
+
+  if(xParams.hStdin[0] != INVALID_HANDLE_VALUE)
+    CloseHandle(xParams.hStdin[0]);
+
+  return pRval;
+
+#else // WIN32
+
+char *pRval;
+va_list va;
+
+
+  va_start(va, szAppName);
+
+  // the input is written to a pipe by the capture loop, so binary data (including zero bytes) is fine
+
+  pRval = __WBRunResultWithInputV(cbStdin > 0 ? pStdin : NULL, cbStdin > 0 ? (size_t)cbStdin : 0,
+                                  NULL, szAppName, va);
+
+  va_end(va);
+
+  return pRval;
+
+#endif // WIN32
+}
+
+
+
+char *WBRunResultWithInput(const char *szStdInBuf, const char *szAppName, ...)
+{
+char *pRval;
+va_list va;
+
+
+  va_start(va, szAppName);
+
+#ifdef WIN32
+#error not yet implemented
+#else // WIN32
+  pRval = __WBRunResultWithInputV(szStdInBuf && *szStdInBuf ? szStdInBuf : NULL,
+                                  szStdInBuf ? strlen(szStdInBuf) : 0,
+                                  NULL, szAppName, va);
+#endif // WIN32
+
+  va_end(va);
+
+  return pRval;
+}
+
+char * WBRunResultArgv(WB_INT32 *pExitCode, const char *szAppName, char * const *argv, char * const *envp)
+{
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+WB_RUN_ARGS xArgs;
+
+
+  if(!argv || !argv[0])
+  {
+    return NULL;
+  }
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.ppArgv = argv;
+  xArgs.envp = envp;
+
+  return __WBRunResultCapture(NULL, 0, pExitCode, NULL, szAppName ? szAppName : argv[0], &xArgs);
+#endif // WIN32
+}
+
+
+// STRUCTURED RESULTS - stdout and stderr captured into separate buffers by the same capture loop,
+// along with the exit status, elapsed time, and resource usage
+
+#ifndef WIN32
+
+// build the child's setup from the resource limits, cgroup and kept descriptors in 'pOptions'.  returns 1 if
+// there's something for the child to do, 0 if not, or -1 on error.  If the return value is 1,
+// the caller must close 'pSetup->hCgroupProcs' once the process has started.
+
+static int __WBRunSetupFromOptions(WB_SPAWN_SETUP *pSetup, const WB_RUN_OPTIONS *pOptions)
+{
+char *pPath;
+int i1;
+
+
+  pSetup->nLimits = 0;
+  pSetup->hCgroupProcs = WB_INVALID_FILE_HANDLE;
+  pSetup->nKeepFDs = 0;
+  pSetup->bCaller = 0;
+
+  if(!pOptions || ((!pOptions->pLimits || pOptions->nLimits <= 0) && !pOptions->szCgroup &&
+                   (!pOptions->pKeepFDs || pOptions->nKeepFDs <= 0)))
+  {
+    return 0;
+  }
+
+  if(pOptions->pKeepFDs && pOptions->nKeepFDs > 0)
+  {
+    if(pOptions->nKeepFDs > WB_RUN_MAX_KEEP_FDS)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+    for(i1=0; i1 < pOptions->nKeepFDs; i1++) // insertion sort, ignoring stdin/stdout/stderr and duplicates
+    {
+      WB_FILE_HANDLE hFD = pOptions->pKeepFDs[i1];
+      int i2;
+
+      if(hFD <= 2)
+      {
+        continue;
+      }
+
+      for(i2=pSetup->nKeepFDs; i2 > 0 && pSetup->ahKeepFD[i2 - 1] > hFD; i2--)
+      { }
+
+      if(i2 > 0 && pSetup->ahKeepFD[i2 - 1] == hFD)
+      {
+        continue;
+      }
+
+      memmove(pSetup->ahKeepFD + i2 + 1, pSetup->ahKeepFD + i2, (pSetup->nKeepFDs - i2) * sizeof(WB_FILE_HANDLE));
+
+      pSetup->ahKeepFD[i2] = hFD;
+      pSetup->nKeepFDs++;
+    }
+  }
+
+  if(pOptions->pLimits && pOptions->nLimits > 0)
+  {
+    if(pOptions->nLimits > WB_RUN_MAX_LIMITS)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+    for(i1=0; i1 < pOptions->nLimits; i1++)
+    {
+      pSetup->aiResource[i1] = pOptions->pLimits[i1].iResource;
+      pSetup->aLimits[i1].rlim_cur = pOptions->pLimits[i1].ullSoft == WB_RUN_LIMIT_INFINITY
+                                   ? RLIM_INFINITY : (rlim_t)pOptions->pLimits[i1].ullSoft;
+      pSetup->aLimits[i1].rlim_max = pOptions->pLimits[i1].ullHard == WB_RUN_LIMIT_INFINITY
+                                   ? RLIM_INFINITY : (rlim_t)pOptions->pLimits[i1].ullHard;
+    }
+
+    pSetup->nLimits = pOptions->nLimits;
+  }
+
+  if(pOptions->szCgroup)
+  {
+    pPath = WBAlloc(strlen(pOptions->szCgroup) + sizeof("/cgroup.procs"));
+
+    if(!pPath)
+    {
+      errno = ENOMEM;
+      return -1;
+    }
+
+    strcpy(pPath, pOptions->szCgroup);
+    strcat(pPath, "/cgroup.procs");
+
+    pSetup->hCgroupProcs = open(pPath, O_WRONLY | O_CLOEXEC); // the child writes to it before 'execve'
+
+    if(pSetup->hCgroupProcs < 0)
+    {
+      WB_ERROR_PRINT("ERROR:  %s - unable to open \"%s\", errno=%d\n", __FUNCTION__, pPath, errno);
+
+      i1 = errno;
+      WBFree(pPath);
+      errno = i1;
+
+      pSetup->hCgroupProcs = WB_INVALID_FILE_HANDLE;
+      return -1;
+    }
+
+    WBFree(pPath);
+  }
+
+  return 1;
+}
+
+// an anonymous file for WB_RUN_OPTION_STDOUT_MMAP.  A 'memfd' lives in memory (or swap) and needs
+// no file system, but if the kernel doesn't have 'memfd_create' I use an unlinked temporary file.
+
+static WB_FILE_HANDLE __WBRunCreateMemFile(void)
+{
+WB_FILE_HANDLE hRval;
+const char *szTmp;
+char *pPath;
+
+
+#ifdef MFD_CLOEXEC
+  hRval = memfd_create("ForkMe-stdout", MFD_CLOEXEC);
+
+  if(hRval >= 0 || errno != ENOSYS)
+  {
+    return hRval;
+  }
+#endif // MFD_CLOEXEC
+
+  szTmp = getenv("TMPDIR");
+
+  if(!szTmp || !*szTmp)
+  {
+    szTmp = "/tmp";
+  }
+
+  pPath = WBAlloc(strlen(szTmp) + sizeof("/ForkMe-stdout.XXXXXX"));
+
+  if(!pPath)
+  {
+    errno = ENOMEM;
+    return WB_INVALID_FILE_HANDLE;
+  }
+
+  strcpy(pPath, szTmp);
+  strcat(pPath, "/ForkMe-stdout.XXXXXX");
+
+  hRval = mkostemp(pPath, O_CLOEXEC);
+
+  if(hRval >= 0)
+  {
+    unlink(pPath); // it goes away when the last reference (the mapping, eventually) does
+  }
+
+  WBFree(pPath);
+
+  return hRval;
+}
+
+// map the data that a SINK_FILE stream wrote, as a read-only view.  The mapping has to start on a
+// page boundary, so 'pStdout' points past the part of the first page that precedes the data.
+
+static int __WBRunMapStdout(WB_RUN_RESULT *pResult, const WB_CAPTURE_STREAM *pS)
+{
+WB_UINT64 ullPage, ullBase;
+void *pMap;
+
+
+  if(!pS->cbData) // nothing to map
+  {
+    return 0;
+  }
+
+  ullPage = (WB_UINT64)sysconf(_SC_PAGESIZE);
+  ullBase = pS->ullFileOffset - pS->ullFileOffset % ullPage;
+
+  pMap = mmap(NULL, (size_t)(pS->ullFileOffset - ullBase) + pS->cbData, PROT_READ, MAP_SHARED,
+              pS->hFile, (off_t)ullBase);
+
+  if(pMap == MAP_FAILED)
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to map captured output, errno=%d\n", __FUNCTION__, errno);
+    return -1;
+  }
+
+  pResult->pStdoutMap = pMap;
+  pResult->cbStdoutMap = (size_t)(pS->ullFileOffset - ullBase) + pS->cbData;
+  pResult->pStdout = (char *)pMap + (pS->ullFileOffset - ullBase);
+  pResult->cbStdout = pS->cbData;
+
+  return 0;
+}
+
+// PIPELINES - the last stage is run by the capture engine, exactly like WBRunResultEx.  The other
+// stages are started after it, connected by pipes.  Every stage writes to the same 'stderr' pipe.
+
+typedef struct __WB_RUN_PIPELINE__
+{
+  const char * const * const *papArgv; // every stage's 'argv' (the last one is run by the capture engine)
+  int nStages;                         // the total number of stages
+  WB_RUN_STAGE_RESULT *pStages;        // receives each stage's result, or NULL
+  WB_PROCESS_ID aidProcess[WB_RUN_MAX_STAGES]; // the stages before the last one
+  WB_FILE_HANDLE ahRead[WB_RUN_MAX_STAGES];    // pipe [n] connects stage n to stage n + 1
+  WB_FILE_HANDLE ahWrite[WB_RUN_MAX_STAGES];
+  WB_FILE_HANDLE hStdinRead, hStdinWrite;      // the pipe for WB_RUN_OPTIONS 'pStdin', which goes to the first stage
+  const char *pStdin;
+  size_t cbStdin;
+} WB_RUN_PIPELINE;
+
+static void __WBRunPipelineClose(WB_RUN_PIPELINE *pPipe)
+{
+int i1;
+
+  for(i1=0; i1 < pPipe->nStages - 1; i1++)
+  {
+    if(pPipe->ahRead[i1] != WB_INVALID_FILE_HANDLE)
+    {
+      close(pPipe->ahRead[i1]);
+      pPipe->ahRead[i1] = WB_INVALID_FILE_HANDLE;
+    }
+
+    if(pPipe->ahWrite[i1] != WB_INVALID_FILE_HANDLE)
+    {
+      close(pPipe->ahWrite[i1]);
+      pPipe->ahWrite[i1] = WB_INVALID_FILE_HANDLE;
+    }
+  }
+
+  if(pPipe->hStdinRead != WB_INVALID_FILE_HANDLE)
+  {
+    close(pPipe->hStdinRead);
+    pPipe->hStdinRead = WB_INVALID_FILE_HANDLE;
+  }
+
+  if(pPipe->hStdinWrite != WB_INVALID_FILE_HANDLE)
+  {
+    close(pPipe->hStdinWrite);
+    pPipe->hStdinWrite = WB_INVALID_FILE_HANDLE;
+  }
+}
+
+// create the pipes between the stages.  They're created with O_CLOEXEC, so that a process started
+// by another thread in the meantime can't inherit one (and keep it open).  If there's 'stdin'
+// data, it goes to the first stage, so the capture engine's own 'stdin' pipe is not used.
+
+static int __WBRunPipelineCreate(WB_RUN_PIPELINE *pPipe, WB_CAPTURE *pCtx)
+{
+WB_FILE_HANDLE hP[2];
+int i1;
+
+
+  pPipe->hStdinRead = pPipe->hStdinWrite = WB_INVALID_FILE_HANDLE;
+
+  for(i1=0; i1 < pPipe->nStages - 1; i1++)
+  {
+    pPipe->aidProcess[i1] = WB_INVALID_PROCESS_ID;
+    pPipe->ahRead[i1] = pPipe->ahWrite[i1] = WB_INVALID_FILE_HANDLE;
+  }
+
+  for(i1=0; i1 < pPipe->nStages - 1; i1++)
+  {
+    if(0 > pipe2(hP, O_CLOEXEC))
+    {
+      goto error_exit;
+    }
+
+    pPipe->ahRead[i1] = hP[0];
+    pPipe->ahWrite[i1] = hP[1];
+  }
+
+  pPipe->pStdin = pCtx->pStdin;
+  pPipe->cbStdin = pCtx->cbStdin;
+
+  if(pPipe->pStdin)
+  {
+    if(0 > pipe2(hP, O_CLOEXEC))
+    {
+      goto error_exit;
+    }
+
+    pPipe->hStdinRead = hP[0];
+    pPipe->hStdinWrite = hP[1];
+
+    fcntl(hP[1], F_SETFL, O_NONBLOCK); // writes must never block the capture loop
+
+    pCtx->pStdin = NULL; // until the other stages have started
+    pCtx->cbStdin = 0;
+  }
+
+  pCtx->bKeepStderr = 1; // the other stages write to it, too
+
+  return 0;
+
+error_exit:
+
+  WB_ERROR_PRINT("ERROR:  %s - unable to create pipe, errno=%d\n", __FUNCTION__, errno);
+
+  i1 = errno;
+  __WBRunPipelineClose(pPipe);
+  errno = i1;
+
+  return -1;
+}
+
+// start the stages before the last one (which is already running).  If one of them can't be
+// started, the capture is aborted, which kills the ones that did start.
+
+static void __WBRunPipelineStart(WB_RUN_PIPELINE *pPipe, WB_CAPTURE *pCtx, const WB_RUN_ARGS *pArgs)
+{
+WB_RUN_ARGS xArgs;
+const char * const *ppArgv;
+int i1;
+
+
+  for(i1=0; i1 < pPipe->nStages - 1 && !pCtx->bAborted; i1++)
+  {
+    ppArgv = pPipe->papArgv[i1];
+
+    memset(&xArgs, 0, sizeof(xArgs));
+    xArgs.ppArgs = ppArgv + 1;
+    xArgs.envp = pArgs->envp;
+    xArgs.pSetup = pArgs->pSetup;
+    xArgs.bCapture = 1; // I reap it myself
+
+    pPipe->aidProcess[i1] = __WBRunAsyncPipeInternal(i1 ? pPipe->ahRead[i1 - 1] : pPipe->hStdinRead,
+                                                     pPipe->ahWrite[i1], pCtx->hStderrWrite,
+                                                     ppArgv[0], &xArgs);
+
+    if(WB_PROCESS_ID_INVALID(pPipe->aidProcess[i1]))
+    {
+      WB_ERROR_PRINT("ERROR:  %s - unable to start pipeline stage %d (%s)\n", __FUNCTION__, i1, ppArgv[0]);
+
+      pCtx->bAborted = 1;
+    }
+  }
+
+  if(pPipe->hStdinWrite != WB_INVALID_FILE_HANDLE)
+  {
+    pCtx->hStdinPipe = pPipe->hStdinWrite; // the capture loop writes it, and closes it
+    pCtx->pStdin = pPipe->pStdin;
+    pCtx->cbStdin = pPipe->cbStdin;
+    pCtx->cbStdinDone = 0;
+
+    pPipe->hStdinWrite = WB_INVALID_FILE_HANDLE;
+  }
+
+  __WBRunPipelineClose(pPipe); // the children have their own copies now
+
+  pCtx->paidOther = pPipe->aidProcess; // if the capture is aborted, they're terminated along with the last stage
+  pCtx->nOther = pPipe->nStages - 1;
+
+  if(pCtx->hStderrWrite != WB_INVALID_FILE_HANDLE)
+  {
+    close(pCtx->hStderrWrite); // so that the 'stderr' pipe reaches EOF when they're done with it
+    pCtx->hStderrWrite = WB_INVALID_FILE_HANDLE;
+  }
+}
+
+static void __WBRunStageResult(WB_RUN_STAGE_RESULT *pStage, int bReaped, int iStatus, const struct rusage *pUsage)
+{
+  memset(pStage, 0, sizeof(*pStage));
+  pStage->iExitCode = -1;
+
+  if(bReaped)
+  {
+    pStage->bStatusValid = 1;
+    pStage->iStatus = iStatus;
+    pStage->iExitCode = __WBExitCodeFromStatus(iStatus);
+
+    if(WIFSIGNALED(iStatus))
+    {
+      pStage->iSignal = WTERMSIG(iStatus);
+    }
+
+    __WBRunUsageFromRusage(&(pStage->xUsage), pUsage);
+  }
+}
+
+// wait for the stages before the last one.  When the last stage was terminated (because of a limit,
+// or an error), the capture loop terminated the others as well, so that I don't wait for something
+// like 'sleep' that isn't writing anything.
+
+static void __WBRunPipelineFinish(WB_RUN_PIPELINE *pPipe)
+{
+struct rusage xUsage;
+int i1, iStatus, iReaped;
+
+
+  for(i1=0; i1 < pPipe->nStages - 1; i1++)
+  {
+    iStatus = 0;
+    iReaped = 0;
+
+    memset(&xUsage, 0, sizeof(xUsage));
+
+    if(!WB_PROCESS_ID_INVALID(pPipe->aidProcess[i1]))
+    {
+      iReaped = __WBProcessReap(pPipe->aidProcess[i1], &iStatus, &xUsage, 1) > 0;
+
+      __WBProcessRemove(pPipe->aidProcess[i1]);
+    }
+
+    if(pPipe->pStages)
+    {
+      __WBRunStageResult(&(pPipe->pStages[i1]), iReaped, iStatus, &xUsage);
+    }
+  }
+}
+
+static int __WBRunResultEx(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions,
+                           const char *szAppName, WB_RUN_ARGS *pArgs, WB_RUN_PIPELINE *pPipe)
+{
+WB_CAPTURE xCtx;
+WB_SPAWN_SETUP xSetup;
+WB_FILE_HANDLE hMemFile;
+WB_CAPTURE_STREAM *pS;
+WB_RUN_STAGE_RESULT *pStages;
+off_t llOffset;
+int iSetup, iErr, i1;
+
+
+  memset(pResult, 0, sizeof(*pResult));
+  pResult->iExitCode = -1;
+
+  __WBCaptureInit(&xCtx);
+
+  pStages = pPipe ? pPipe->pStages : NULL;
+
+  if(pPipe && pPipe->nStages < 2) // a single stage has nothing to connect
+  {
+    pPipe = NULL;
+  }
+
+  pS = &(xCtx.aStream[WB_CAPTURE_STDOUT]);
+  pS->iSink = WB_CAPTURE_SINK_BUFFER;
+
+  hMemFile = WB_INVALID_FILE_HANDLE;
+
+  if(pOptions && (pOptions->iFlags & WB_RUN_OPTION_STDOUT_FILE))
+  {
+    llOffset = lseek(pOptions->hStdoutFile, 0, SEEK_CUR);
+
+    if(llOffset < 0)
+    {
+      WB_ERROR_PRINT("ERROR:  %s - invalid stdout file, errno=%d\n", __FUNCTION__, errno);
+      return -1;
+    }
+
+    pS->iSink = WB_CAPTURE_SINK_FILE;
+    pS->hFile = pOptions->hStdoutFile;
+    pS->ullFileOffset = (WB_UINT64)llOffset;
+  }
+  else if(pOptions && (pOptions->iFlags & WB_RUN_OPTION_STDOUT_MMAP))
+  {
+    hMemFile = __WBRunCreateMemFile();
+
+    if(hMemFile < 0)
+    {
+      WB_ERROR_PRINT("ERROR:  %s - unable to create memory file, errno=%d\n", __FUNCTION__, errno);
+      return -1;
+    }
+
+    pS->iSink = WB_CAPTURE_SINK_FILE;
+    pS->hFile = hMemFile;
+    pS->ullFileOffset = 0;
+  }
+
+  iSetup = __WBRunSetupFromOptions(&xSetup, pOptions);
+
+  if(iSetup < 0)
+  {
+    goto error_exit;
+  }
+
+  if(!pOptions || !(pOptions->iFlags & WB_RUN_OPTION_DISCARD_STDERR))
+  {
+    xCtx.aStream[WB_CAPTURE_STDERR].iSink = WB_CAPTURE_SINK_BUFFER;
+  }
+
+  for(i1=0; pOptions && i1 < 2; i1++) // head and tail only (the stdout file options take precedence)
+  {
+    if(xCtx.aStream[i1].iSink == WB_CAPTURE_SINK_BUFFER &&
+       (pOptions->iFlags & (i1 == WB_CAPTURE_STDOUT ? WB_RUN_OPTION_STDOUT_TAIL : WB_RUN_OPTION_STDERR_TAIL)))
+    {
+      xCtx.aStream[i1].iSink = WB_CAPTURE_SINK_RING;
+      xCtx.aStream[i1].cbHead = pOptions->cbHead;
+      xCtx.aStream[i1].cbTail = pOptions->cbTail;
+    }
+  }
+
+  if(pOptions)
+  {
+    pArgs->envp = pOptions->envp;
+    pArgs->pExecutable = pPipe ? NULL : pOptions->pExecutable; // the stages are named by their 'argv' arrays
+
+    if(pOptions->pStdin)
+    {
+      xCtx.pStdin = (const char *)pOptions->pStdin;
+      xCtx.cbStdin = pOptions->cbStdin;
+    }
+
+    xCtx.ullWallLimit = pOptions->ullWallTimeLimit;
+    xCtx.ullCPULimit = pOptions->ullCPUTimeLimit;
+    xCtx.ullKillGrace = pOptions->ullKillGrace;
+    xCtx.iKillFlags = (pOptions->iFlags & WB_RUN_OPTION_KILL_TREE) ? WB_TERMINATE_TREE : 0;
+    xCtx.bKillOrphans = (pOptions->iFlags & WB_RUN_OPTION_KILL_ORPHANS) != 0;
+
+    if(pOptions->iFlags & WB_RUN_OPTION_STDOUT_TEE)
+    {
+      pS->hTee = pOptions->hStdoutTee;
+    }
+
+    // the index is built as the data arrives.  a file is indexed after the capture (from its mapping)
+
+    pS->bLineIndex = pS->iSink == WB_CAPTURE_SINK_BUFFER && (pOptions->iFlags & WB_RUN_OPTION_LINE_INDEX);
+  }
+
+  if(iSetup > 0)
+  {
+    pArgs->pSetup = &xSetup;
+  }
+
+  if(pPipe && __WBRunPipelineCreate(pPipe, &xCtx))
+  {
+    iErr = -1;
+  }
+  else
+  {
+    iErr = __WBCaptureStart(&xCtx, pPipe ? pPipe->ahRead[pPipe->nStages - 2] : WB_INVALID_FILE_HANDLE,
+                            szAppName, pArgs);
+
+    if(pPipe)
+    {
+      if(iErr)
+      {
+        __WBRunPipelineClose(pPipe);
+      }
+      else
+      {
+        __WBRunPipelineStart(pPipe, &xCtx, pArgs);
+      }
+    }
+  }
+
+  if(xSetup.hCgroupProcs != WB_INVALID_FILE_HANDLE)
+  {
+    i1 = errno;
+    close(xSetup.hCgroupProcs); // the children have already used it
+    errno = i1;
+  }
+
+  if(iErr)
+  {
+    goto error_exit;
+  }
+
+  __WBCaptureLoop(&xCtx);
+
+  if(pPipe)
+  {
+    __WBRunPipelineFinish(pPipe);
+  }
+
+  if((xCtx.bAborted && !xCtx.iLimitHit) || // out of memory, etc.
+     (pS->iSink == WB_CAPTURE_SINK_FILE && __WBRunMapStdout(pResult, pS)))
+  {
+    if(xCtx.aStream[WB_CAPTURE_STDOUT].pBuf)
+    {
+      WBFree(xCtx.aStream[WB_CAPTURE_STDOUT].pBuf);
+    }
+
+    if(xCtx.aStream[WB_CAPTURE_STDERR].pBuf)
+    {
+      WBFree(xCtx.aStream[WB_CAPTURE_STDERR].pBuf);
+    }
+
+    __WBLineIndexFree(&(pS->xLines));
+
+    pResult->pStdout = NULL; // in case the mapping succeeded, but there was some other error
+    pResult->cbStdout = 0;
+
+    if(pResult->pStdoutMap)
+    {
+      munmap(pResult->pStdoutMap, pResult->cbStdoutMap);
+      pResult->pStdoutMap = NULL;
+      pResult->cbStdoutMap = 0;
+    }
+
+    goto error_exit;
+  }
+
+  if(hMemFile != WB_INVALID_FILE_HANDLE)
+  {
+    close(hMemFile); // the mapping keeps it alive
+  }
+
+  if(pS->iSink != WB_CAPTURE_SINK_FILE)
+  {
+    pResult->pStdout = pS->pBuf;
+    pResult->cbStdout = pS->cbData;
+  }
+  else if(pOptions->iFlags & WB_RUN_OPTION_STDOUT_FILE)
+  {
+    lseek(pS->hFile, (off_t)(pS->ullFileOffset + pS->cbData), SEEK_SET); // as if it had been written normally
+  }
+
+  pResult->pStderr = xCtx.aStream[WB_CAPTURE_STDERR].pBuf;
+  pResult->cbStderr = xCtx.aStream[WB_CAPTURE_STDERR].cbData;
+
+  pResult->ullStdoutTotal = pS->ullTotal;
+  pResult->ullStdoutLines = pS->ullLines;
+  pResult->ullStderrTotal = xCtx.aStream[WB_CAPTURE_STDERR].ullTotal;
+  pResult->ullStderrLines = xCtx.aStream[WB_CAPTURE_STDERR].ullLines;
+
+  if(pOptions && (pOptions->iFlags & WB_RUN_OPTION_STDOUT_TEE) && pS->ullTotal > pS->ullTeeTotal)
+  {
+    pResult->ullStdoutTeeLost = pS->ullTotal - pS->ullTeeTotal; // copies stopped after an error
+  }
+
+  if(pS->iSink == WB_CAPTURE_SINK_RING)
+  {
+    pResult->cbStdoutHead = pS->cbData < pS->cbHead ? pS->cbData : pS->cbHead;
+  }
+  else if(pS->iSink == WB_CAPTURE_SINK_FILE && pResult->pStdout) // 'splice' never saw the data, so count the lines now
+  {
+    if(pOptions->iFlags & WB_RUN_OPTION_LINE_INDEX)
+    {
+      pS->bLineIndex = 1;
+
+      if(__WBLineIndexScan(&(pS->xLines), pResult->pStdout, 0, pResult->cbStdout))
+      {
+        goto index_error;
+      }
+
+      pResult->ullStdoutLines = pS->xLines.nLines;
+    }
+    else
+    {
+      __WBCaptureCount(pS, pResult->pStdout, pResult->cbStdout);
+
+      pResult->ullStdoutLines = pS->ullLines;
+    }
+  }
+
+  if(pS->bLineIndex)
+  {
+    if(__WBLineIndexFinish(&(pS->xLines), pResult->cbStdout))
+    {
+      goto index_error;
+    }
+
+    pResult->paStdoutLines = pS->xLines.paLines; // the caller owns it now
+    pResult->nStdoutLines = pS->xLines.nLines;
+  }
+
+  if(xCtx.aStream[WB_CAPTURE_STDERR].iSink == WB_CAPTURE_SINK_RING)
+  {
+    pResult->cbStderrHead = pResult->cbStderr < xCtx.aStream[WB_CAPTURE_STDERR].cbHead
+                          ? pResult->cbStderr : xCtx.aStream[WB_CAPTURE_STDERR].cbHead;
+  }
+
+  pResult->ullWallTime = xCtx.ullEndTime - xCtx.ullStartTime;
+
+  if(xCtx.bReaped)
+  {
+    pResult->bStatusValid = 1;
+    pResult->iStatus = xCtx.iStatus;
+    pResult->iExitCode = __WBExitCodeFromStatus(xCtx.iStatus);
+
+    if(WIFSIGNALED(xCtx.iStatus))
+    {
+      pResult->iSignal = WTERMSIG(xCtx.iStatus);
+    }
+
+    __WBRunUsageFromRusage(&(pResult->xUsage), &(xCtx.xUsage));
+  }
+
+  pResult->iLimitHit = xCtx.iLimitHit;
+  pResult->xTerminated = xCtx.xTerminated;
+
+  if(!pResult->iLimitHit && xSetup.nLimits > 0 &&
+     (pResult->iSignal == SIGXCPU || pResult->iSignal == SIGXFSZ)) // the default action for an exceeded 'rlimit'
+  {
+    pResult->iLimitHit = WB_RUN_LIMIT_HIT_RLIMIT;
+  }
+
+  if(pStages) // the last stage's result is the same as the pipeline's
+  {
+    __WBRunStageResult(&(pStages[pPipe ? pPipe->nStages - 1 : 0]), xCtx.bReaped, xCtx.iStatus, &(xCtx.xUsage));
+  }
+
+  return 0;
+
+index_error: // out of memory for the line index, after the process has been reaped
+
+  WB_ERROR_PRINT("ERROR:  %s - unable to allocate the line index\n", __FUNCTION__);
+
+  __WBLineIndexFree(&(pS->xLines));
+  WBRunResultFree(pResult);
+
+  errno = ENOMEM;
+  return -1;
+
+error_exit:
+
+  if(hMemFile != WB_INVALID_FILE_HANDLE)
+  {
+    i1 = errno;
+    close(hMemFile);
+    errno = i1;
+  }
+
+  return -1;
+}
+
+#endif // !WIN32
+
+int WBRunResultExV(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions, const char *szAppName, va_list va)
+{
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+WB_RUN_ARGS xArgs;
+va_list va2;
+int iRval;
+
+
+  va_copy(va2, va); // so I can pass it by reference
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.pva = &va2;
+
+  iRval = __WBRunResultEx(pResult, pOptions, szAppName, &xArgs, NULL);
+
+  va_end(va2);
+
+  return iRval;
+#endif // WIN32
+}
+
+int WBRunResultEx(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions, const char *szAppName, ...)
+{
+int iRval;
+va_list va;
+
+
+  va_start(va, szAppName);
+
+  iRval = WBRunResultExV(pResult, pOptions, szAppName, va);
+
+  va_end(va);
+
+  return iRval;
+}
+
+int WBRunResultExArgv(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions, const char *szAppName,
+                      char * const *argv)
+{
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+WB_RUN_ARGS xArgs;
+
+
+  if(!argv || !argv[0])
+  {
+    memset(pResult, 0, sizeof(*pResult));
+    pResult->iExitCode = -1;
+
+    return -1;
+  }
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.ppArgv = argv;
+
+  return __WBRunResultEx(pResult, pOptions, szAppName ? szAppName : argv[0], &xArgs, NULL);
+#endif // WIN32
+}
+
+int WBRunPipeline(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions,
+                  const char * const * const *papArgv, int nStages, WB_RUN_STAGE_RESULT *pStages)
+{
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+WB_RUN_PIPELINE xPipe;
+WB_RUN_ARGS xArgs;
+int i1;
+
+
+  memset(pResult, 0, sizeof(*pResult));
+  pResult->iExitCode = -1;
+
+  if(!papArgv || nStages < 1 || nStages > WB_RUN_MAX_STAGES)
+  {
+    return -1;
+  }
+
+  for(i1=0; i1 < nStages; i1++)
+  {
+    if(!papArgv[i1] || !papArgv[i1][0])
+    {
+      return -1;
+    }
+  }
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.ppArgs = papArgv[nStages - 1] + 1;
+
+  xPipe.papArgv = papArgv;
+  xPipe.nStages = nStages;
+  xPipe.pStages = pStages;
+
+  return __WBRunResultEx(pResult, pOptions, papArgv[nStages - 1][0], &xArgs, &xPipe);
+#endif // WIN32
+}
+
+void WBRunResultFree(WB_RUN_RESULT *pResult)
+{
+  if(pResult->pStdoutMap) // 'pStdout' points into it
+  {
+    munmap(pResult->pStdoutMap, pResult->cbStdoutMap);
+
+    pResult->pStdoutMap = NULL;
+    pResult->cbStdoutMap = 0;
+  }
+  else if(pResult->pStdout)
+  {
+    WBFree(pResult->pStdout);
+  }
+
+  if(pResult->pStderr)
+  {
+    WBFree(pResult->pStderr);
+  }
+
+  if(pResult->paStdoutLines)
+  {
+    WBFree(pResult->paStdoutLines);
+  }
+
+  pResult->pStdout = pResult->pStderr = NULL;
+  pResult->cbStdout = pResult->cbStderr = 0;
+  pResult->paStdoutLines = NULL;
+  pResult->nStdoutLines = 0;
+}
+
+WB_RUN_LINE * WBRunLineIndex(const char *pData, size_t cbData, size_t *pnLines)
+{
+WB_LINE_INDEX xIdx;
+
+
+  memset(&xIdx, 0, sizeof(xIdx));
+
+  if(pnLines)
+  {
+    *pnLines = 0;
+  }
+
+  if(!pData && cbData)
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  if(__WBLineIndexScan(&xIdx, pData, 0, cbData) || __WBLineIndexFinish(&xIdx, cbData) ||
+     (!xIdx.paLines && __WBLineIndexGrow(&xIdx))) // an empty index is not NULL
+  {
+    __WBLineIndexFree(&xIdx);
+    return NULL;
+  }
+
+  if(pnLines)
+  {
+    *pnLines = xIdx.nLines;
+  }
+
+  return xIdx.paLines;
+}
+
+
+// BATCH EXECUTION - run many commands concurrently, using a pool of worker threads.  Each worker
+// takes the next command from the list, runs it with the normal capture engine, and stores the
+// result either at the command's own index or at the next 'completion' slot.
+
+typedef struct __WB_BATCH__
+{
+  const char * const * const *papArgv;
+  int nCommands;
+  int iFlags;
+  WB_RUN_BATCH_RESULT *pResults;
+  volatile WB_UINT32 nNext;      // index of the next command to start
+  volatile WB_UINT32 nCompleted; // number of commands that have completed
+} WB_BATCH;
+
+static void * __WBBatchWorker(void *pData)
+{
+WB_BATCH *pBatch = (WB_BATCH *)pData;
+WB_RUN_BATCH_RESULT xResult;
+WB_RUN_ARGS xArgs;
+const char * const *ppArgv;
+WB_UINT32 uiIndex, uiSlot;
+
+
+  while(1)
+  {
+    uiIndex = WBInterlockedIncrement(&(pBatch->nNext)) - 1;
+
+    if(uiIndex >= (WB_UINT32)pBatch->nCommands)
+    {
+      break;
+    }
+
+    ppArgv = pBatch->papArgv[uiIndex];
+
+    xResult.pOutput = NULL;
+    xResult.cbOutput = 0;
+    xResult.iExitCode = -1;
+    xResult.iIndex = (int)uiIndex;
+
+    if(ppArgv && ppArgv[0])
+    {
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+      memset(&xArgs, 0, sizeof(xArgs));
+      xArgs.ppArgs = ppArgv + 1;
+
+      xResult.pOutput = __WBRunResultCapture(NULL, 0, &(xResult.iExitCode), &(xResult.cbOutput),
+                                             ppArgv[0], &xArgs);
+#endif // WIN32
+    }
+
+    if(pBatch->iFlags & WB_RUN_BATCH_COMPLETION_ORDER)
+    {
+      uiSlot = WBInterlockedIncrement(&(pBatch->nCompleted)) - 1;
+    }
+    else
+    {
+      uiSlot = uiIndex;
+    }
+
+    pBatch->pResults[uiSlot] = xResult;
+  }
+
+  return NULL;
+}
+
+int WBRunBatch(const char * const * const *papArgv, int nCommands, int nConcurrency, int iFlags,
+               WB_RUN_BATCH_RESULT *pResults)
+{
+WB_BATCH xBatch;
+WB_THREAD *pThreads;
+int i1, nThreads, iRval;
+
+
+  if(!papArgv || !pResults || nCommands < 0)
+  {
+    return -1;
+  }
+
+  if(nConcurrency <= 0)
+  {
+    long lCPU = sysconf(_SC_NPROCESSORS_ONLN);
+
+    nConcurrency = lCPU > 0 ? (int)lCPU : 1;
+  }
+
+  nThreads = nConcurrency < nCommands ? nConcurrency : nCommands;
+
+  xBatch.papArgv = papArgv;
+  xBatch.nCommands = nCommands;
+  xBatch.iFlags = iFlags;
+  xBatch.pResults = pResults;
+  xBatch.nNext = 0;
+  xBatch.nCompleted = 0;
+
+  // the calling thread is one of the workers, so I only need to create 'nThreads - 1' more
+
+  pThreads = NULL;
+
+  if(nThreads > 1)
+  {
+    pThreads = (WB_THREAD *)WBAlloc(sizeof(WB_THREAD) * (nThreads - 1));
+  }
+
+  for(i1=0; pThreads && i1 < nThreads - 1; i1++)
+  {
+    pThreads[i1] = WBThreadCreate(__WBBatchWorker, &xBatch);
+
+    if(pThreads[i1] == (WB_THREAD)INVALID_HANDLE_VALUE)
+    {
+      break; // run with the threads I have; the remaining commands are still processed
+    }
+  }
+
+  nThreads = pThreads ? i1 : 0; // the number of threads I actually created
+
+  __WBBatchWorker(&xBatch);
+
+  for(i1=0; i1 < nThreads; i1++)
+  {
+    WBThreadWait(pThreads[i1]);
+  }
+
+  if(pThreads)
+  {
+    WBFree(pThreads);
+  }
+
+  for(i1=0, iRval=0; i1 < nCommands; i1++)
+  {
+    if(pResults[i1].pOutput)
+    {
+      iRval++;
+    }
+  }
+
+  return iRval;
+}
+
+
+// COPROCESSES - a long-lived child process that handles a series of requests, with its stdin and
+// stdout connected to pipes.  Each request and response is one line, or a 4-byte (big endian) length
+// followed by that many bytes.  Several requests can be sent before their responses are read.  If the
+// child exits (or a response is late, or malformed) it is stopped, and started again by the next request.
+
+#ifdef WIN32
+#error not yet implemented
+#else // !WIN32
+
+#define WB_COPROCESS_BUFFER_MINSIZE 4096
+#define WB_COPROCESS_MAX_FRAME 0x40000000 /* a length prefix larger than this is a protocol error */
+#define WB_COPROCESS_EXIT_WAIT 100000 /* microseconds to wait for the child to exit after its stdin is closed */
+
+struct __WB_COPROCESS__
+{
+  pthread_mutex_t mtxIO;        // held for each send and receive, and for an entire WBCoprocessRequest()
+  int iFlags;
+  WB_ARG_ARENA xArgv, xEnvp;    // copies of 'argv' and 'envp', for restarting it
+  int bEnvp;                    // use 'xEnvp' (otherwise, the caller's environment at the time it starts)
+  WB_PROCESS_ID idProcess;      // WB_INVALID_PROCESS_ID when it's not running
+  WB_FILE_HANDLE hToChild, hFromChild; // non-blocking
+  unsigned int nPending;        // requests that were sent, whose responses have not been received
+  char *pBuf;                   // data read from the child.  bytes [cbPos, cbData) have not been consumed
+  size_t cbBuf, cbData, cbPos;
+  char szAppName[1];
+};
+
+struct __WB_COPROCESS_POOL__
+{
+  pthread_mutex_t mtxPool;
+  pthread_cond_t condPool;      // signaled when a coprocess is returned to the pool
+  int nCount, nIdle;
+  WB_COPROCESS **papIdle;       // the ones that aren't in use (a stack)
+  WB_COPROCESS *apAll[1];
+};
+
+static int __WBCoprocessPollTime(WB_UINT64 ullDeadline) // milliseconds for 'poll' (a deadline of zero is infinite)
+{
+WB_UINT64 ullNow;
+
+
+  if(!ullDeadline)
+  {
+    return -1;
+  }
+
+  ullNow = __WBMonotonicTime();
+
+  return ullNow < ullDeadline ? (int)((ullDeadline - ullNow + 999) / 1000) : 0;
+}
+
+// close the pipes, and wait for the child to exit.  Closing its stdin is the normal way to tell it
+// to exit, but if 'bKill' is non-zero (or it doesn't exit quickly) it is killed.  Any responses that
+// have not been received are lost.
+
+static void __WBCoprocessStop(WB_COPROCESS *pCo, int bKill)
+{
+  if(pCo->hToChild != WB_INVALID_FILE_HANDLE)
+  {
+    close(pCo->hToChild);
+    pCo->hToChild = WB_INVALID_FILE_HANDLE;
+  }
+
+  if(pCo->hFromChild != WB_INVALID_FILE_HANDLE)
+  {
+    close(pCo->hFromChild);
+    pCo->hFromChild = WB_INVALID_FILE_HANDLE;
+  }
+
+  if(!WB_PROCESS_ID_INVALID(pCo->idProcess))
+  {
+    if(bKill || WBWaitProcess(pCo->idProcess, NULL, WB_COPROCESS_EXIT_WAIT) > 0)
+    {
+      WBKillProcess(pCo->idProcess, SIGKILL);
+      WBWaitProcess(pCo->idProcess, NULL, -1);
+    }
+
+    pCo->idProcess = WB_INVALID_PROCESS_ID;
+  }
+
+  pCo->nPending = 0;
+  pCo->cbData = pCo->cbPos = 0;
+}
+
+static int __WBCoprocessStart(WB_COPROCESS *pCo)
+{
+WB_FILE_HANDLE hIn[2], hOut[2];
+WB_RUN_ARGS xArgs;
+int iErr;
+
+
+  if(0 > pipe2(hIn, O_CLOEXEC))
+  {
+    return -1;
+  }
+
+  if(0 > pipe2(hOut, O_CLOEXEC))
+  {
+    iErr = errno;
+
+    close(hIn[0]);
+    close(hIn[1]);
+
+    errno = iErr;
+    return -1;
+  }
+
+  memset(&xArgs, 0, sizeof(xArgs));
+  xArgs.ppArgv = WBArgArenaArgv(&(pCo->xArgv));
+  xArgs.envp = pCo->bEnvp ? WBArgArenaArgv(&(pCo->xEnvp)) : NULL;
+
+  if(xArgs.ppArgv && (!pCo->bEnvp || xArgs.envp))
+  {
+    pCo->idProcess = __WBRunAsyncPipeInternal(hIn[0], hOut[1],
+                                              (pCo->iFlags & WB_COPROCESS_STDERR) ? 2 : WB_INVALID_FILE_HANDLE,
+                                              pCo->szAppName, &xArgs);
+  }
+  else
+  {
+    errno = ENOMEM;
+    pCo->idProcess = WB_INVALID_PROCESS_ID;
+  }
+
+  iErr = errno;
+
+  close(hIn[0]); // the child has its own copies of these
+  close(hOut[1]);
+
+  if(WB_PROCESS_ID_INVALID(pCo->idProcess))
+  {
+    close(hIn[1]);
+    close(hOut[0]);
+
+    errno = iErr;
+    return -1;
+  }
+
+  fcntl(hIn[1], F_SETFL, O_NONBLOCK);
+  fcntl(hOut[0], F_SETFL, O_NONBLOCK);
+
+  pCo->hToChild = hIn[1];
+  pCo->hFromChild = hOut[0];
+
+  return 0;
+}
+
+// one non-blocking read from the child into 'pBuf'.  returns 1 if something was read, zero if
+// there's nothing to read yet, or -1 on EOF or error (the child has exited)
+
+static int __WBCoprocessReadSome(WB_COPROCESS *pCo)
+{
+size_t cbNew;
+ssize_t cb;
+void *p1;
+
+
+  if(pCo->cbPos) // discard what has already been consumed
+  {
+    memmove(pCo->pBuf, pCo->pBuf + pCo->cbPos, pCo->cbData - pCo->cbPos);
+
+    pCo->cbData -= pCo->cbPos;
+    pCo->cbPos = 0;
+  }
+
+  if(pCo->cbData + WB_COPROCESS_BUFFER_MINSIZE / 2 > pCo->cbBuf)
+  {
+    cbNew = pCo->cbBuf ? pCo->cbBuf * 2 : WB_COPROCESS_BUFFER_MINSIZE;
+
+    p1 = WBReAlloc(pCo->pBuf, cbNew);
+
+    if(!p1)
+    {
+      return -1;
+    }
+
+    pCo->pBuf = (char *)p1;
+    pCo->cbBuf = cbNew;
+  }
+
+  do
+  {
+    cb = read(pCo->hFromChild, pCo->pBuf + pCo->cbData, pCo->cbBuf - pCo->cbData);
+  } while(cb < 0 && errno == EINTR);
+
+  if(cb > 0)
+  {
+    pCo->cbData += cb;
+    return 1;
+  }
+
+  if(cb < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+  {
+    return 0;
+  }
+
+  return -1;
+}
+
+// write all of 'pData' to the child, reading its responses while the pipe is full so that a child
+// that writes a response before reading the next request can't cause a deadlock.  returns zero on
+// success, or -1 with errno set to EPIPE (the child has exited) or ETIMEDOUT
+
+static int __WBCoprocessWrite(WB_COPROCESS *pCo, const void *pData, size_t cbData, WB_UINT64 ullDeadline)
+{
+const char *p1 = (const char *)pData;
+WB_SIGPIPE_STATE xSig;
+struct pollfd aPoll[2];
+ssize_t cb;
+int i1;
+
+
+  while(cbData > 0)
+  {
+    __WBSigPipeBlock(&xSig);
+
+    do
+    {
+      cb = write(pCo->hToChild, p1, cbData);
+    } while(cb < 0 && errno == EINTR);
+
+    __WBSigPipeRestore(&xSig, cb < 0 && errno == EPIPE);
+
+    if(cb > 0)
+    {
+      p1 += cb;
+      cbData -= cb;
+
+      continue;
+    }
+
+    if(cb < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+      errno = EPIPE;
+      return -1;
+    }
+
+    aPoll[0].fd = pCo->hToChild;
+    aPoll[0].events = POLLOUT;
+    aPoll[1].fd = pCo->hFromChild;
+    aPoll[1].events = POLLIN;
+    aPoll[0].revents = aPoll[1].revents = 0;
+
+    i1 = poll(aPoll, 2, __WBCoprocessPollTime(ullDeadline));
+
+    if(!i1)
+    {
+      errno = ETIMEDOUT;
+      return -1;
+    }
+
+    if(i1 > 0 && aPoll[1].revents && __WBCoprocessReadSome(pCo) < 0)
+    {
+      errno = EPIPE;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+// look for a complete response at 'cbPos'.  returns 1 and assigns the data's offset and size and
+// the total size (including the framing), zero if it's incomplete, or -1 if it's malformed
+
+static int __WBCoprocessFrame(WB_COPROCESS *pCo, size_t *pcbOffset, size_t *pcbFrame, size_t *pcbTotal)
+{
+const unsigned char *pData = (const unsigned char *)pCo->pBuf + pCo->cbPos;
+size_t cbAvail = pCo->cbData - pCo->cbPos;
+const unsigned char *p1;
+WB_UINT32 uiLen;
+
+
+  if(!(pCo->iFlags & WB_COPROCESS_LENGTH))
+  {
+    p1 = cbAvail ? (const unsigned char *)memchr(pData, '\n', cbAvail) : NULL;
+
+    if(!p1)
+    {
+      return 0;
+    }
+
+    *pcbOffset = pCo->cbPos;
+    *pcbFrame = p1 - pData;
+    *pcbTotal = *pcbFrame + 1; // the newline is consumed, but not returned
+
+    return 1;
+  }
+
+  if(cbAvail < 4)
+  {
+    return 0;
+  }
+
+  uiLen = ((WB_UINT32)pData[0] << 24) | ((WB_UINT32)pData[1] << 16) | ((WB_UINT32)pData[2] << 8) | pData[3];
+
+  if(uiLen > WB_COPROCESS_MAX_FRAME)
+  {
+    return -1;
+  }
+
+  if(cbAvail - 4 < uiLen)
+  {
+    return 0;
+  }
+
+  *pcbOffset = pCo->cbPos + 4;
+  *pcbFrame = uiLen;
+  *pcbTotal = uiLen + 4;
+
+  return 1;
+}
+
+// NOTE:  'mtxIO' must be locked by the caller for these two
+
+static int __WBCoprocessSendInternal(WB_COPROCESS *pCo, const void *pData, size_t cbData, WB_UINT64 ullDeadline)
+{
+unsigned char aHeader[4];
+int iRval;
+
+
+  if((pCo->iFlags & WB_COPROCESS_LENGTH) && cbData > WB_COPROCESS_MAX_FRAME)
+  {
+    errno = EMSGSIZE;
+    return -1;
+  }
+
+  if(WB_PROCESS_ID_INVALID(pCo->idProcess) && __WBCoprocessStart(pCo))
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to start \"%s\", errno=%d\n", __FUNCTION__, pCo->szAppName, errno);
+    return -1;
+  }
+
+  if(pCo->iFlags & WB_COPROCESS_LENGTH)
+  {
+    aHeader[0] = (unsigned char)(cbData >> 24);
+    aHeader[1] = (unsigned char)(cbData >> 16);
+    aHeader[2] = (unsigned char)(cbData >> 8);
+    aHeader[3] = (unsigned char)cbData;
+
+    iRval = __WBCoprocessWrite(pCo, aHeader, 4, ullDeadline) ||
+            __WBCoprocessWrite(pCo, pData, cbData, ullDeadline);
+  }
+  else
+  {
+    iRval = __WBCoprocessWrite(pCo, pData, cbData, ullDeadline) ||
+            ((!cbData || ((const char *)pData)[cbData - 1] != '\n') &&
+             __WBCoprocessWrite(pCo, "\n", 1, ullDeadline));
+  }
+
+  if(iRval)
+  {
+    if(errno == EPIPE)
+    {
+      __WBCoprocessStop(pCo, 1);
+
+      errno = EPIPE;
+    }
+
+    return -1;
+  }
+
+  pCo->nPending++;
+
+  return 0;
+}
+
+static char * __WBCoprocessReceiveInternal(WB_COPROCESS *pCo, size_t *pcbReply, WB_UINT64 ullDeadline)
+{
+struct pollfd xPoll;
+size_t cbOffset, cbFrame, cbTotal;
+char *pRval;
+int i1;
+
+
+  if(!pCo->nPending)
+  {
+    errno = ENOMSG; // nothing to receive (or the child exited, and the responses were lost)
+    return NULL;
+  }
+
+  while(1)
+  {
+    i1 = __WBCoprocessFrame(pCo, &cbOffset, &cbFrame, &cbTotal);
+
+    if(i1 > 0)
+    {
+      break;
+    }
+
+    if(i1 < 0)
+    {
+      WB_ERROR_PRINT("ERROR:  %s - invalid response length from \"%s\"\n", __FUNCTION__, pCo->szAppName);
+
+      __WBCoprocessStop(pCo, 1);
+
+      errno = EPROTO;
+      return NULL;
+    }
+
+    i1 = __WBCoprocessReadSome(pCo);
+
+    if(!i1)
+    {
+      xPoll.fd = pCo->hFromChild;
+      xPoll.events = POLLIN;
+      xPoll.revents = 0;
+
+      i1 = poll(&xPoll, 1, __WBCoprocessPollTime(ullDeadline));
+
+      if(!i1)
+      {
+        errno = ETIMEDOUT;
+        return NULL;
+      }
+
+      continue;
+    }
+
+    if(i1 < 0)
+    {
+      __WBCoprocessStop(pCo, 1);
+
+      errno = EPIPE;
+      return NULL;
+    }
+  }
+
+  pRval = (char *)WBAlloc(cbFrame + 1);
+
+  if(!pRval)
+  {
+    return NULL; // the response is still there, to be received again
+  }
+
+  memcpy(pRval, pCo->pBuf + cbOffset, cbFrame);
+  pRval[cbFrame] = 0;
+
+  pCo->cbPos += cbTotal;
+  pCo->nPending--;
+
+  if(pcbReply)
+  {
+    *pcbReply = cbFrame;
+  }
+
+  return pRval;
+}
+
+static WB_UINT64 __WBCoprocessDeadline(int nTimeout)
+{
+  return nTimeout < 0 ? 0 : __WBMonotonicTime() + (WB_UINT64)nTimeout;
+}
+
+WB_COPROCESS * WBCoprocessOpen(const char *szAppName, char * const *argv, char * const *envp, int iFlags)
+{
+WB_COPROCESS *pRval;
+int i1;
+
+
+  if(!argv || !argv[0])
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  if(!szAppName)
+  {
+    szAppName = argv[0];
+  }
+
+  pRval = (WB_COPROCESS *)WBAlloc(sizeof(*pRval) + strlen(szAppName));
+
+  if(!pRval)
+  {
+    return NULL;
+  }
+
+  memset(pRval, 0, sizeof(*pRval));
+  strcpy(pRval->szAppName, szAppName);
+
+  pRval->iFlags = iFlags;
+  pRval->idProcess = WB_INVALID_PROCESS_ID;
+  pRval->hToChild = pRval->hFromChild = WB_INVALID_FILE_HANDLE;
+
+  pthread_mutex_init(&(pRval->mtxIO), NULL);
+
+  WBArgArenaInit(&(pRval->xArgv));
+  WBArgArenaInit(&(pRval->xEnvp));
+
+  for(i1=0; argv[i1]; i1++)
+  {
+    if(WBArgArenaAdd(&(pRval->xArgv), argv[i1]))
+    {
+      goto error_exit;
+    }
+  }
+
+  if(envp)
+  {
+    pRval->bEnvp = 1;
+
+    for(i1=0; envp[i1]; i1++)
+    {
+      if(WBArgArenaAdd(&(pRval->xEnvp), envp[i1]))
+      {
+        goto error_exit;
+      }
+    }
+  }
+
+  if(__WBCoprocessStart(pRval)) // start it now, so that a missing program is reported here
+  {
+    WB_ERROR_PRINT("ERROR:  %s - unable to start \"%s\", errno=%d\n", __FUNCTION__, szAppName, errno);
+    goto error_exit;
+  }
+
+  return pRval;
+
+error_exit:
+
+  WBCoprocessClose(pRval);
+
+  return NULL;
+}
+
+void WBCoprocessClose(WB_COPROCESS *pCo)
+{
+int iErr = errno;
+
+
+  if(!pCo)
+  {
+    return;
+  }
+
+  __WBCoprocessStop(pCo, 0);
+
+  WBArgArenaFree(&(pCo->xArgv));
+  WBArgArenaFree(&(pCo->xEnvp));
+
+  if(pCo->pBuf)
+  {
+    WBFree(pCo->pBuf);
+  }
+
+  pthread_mutex_destroy(&(pCo->mtxIO));
+
+  WBFree(pCo);
+
+  errno = iErr;
+}
+
+int WBCoprocessSend(WB_COPROCESS *pCo, const void *pData, size_t cbData)
+{
+int iRval;
+
+
+  if(!pCo || (!pData && cbData))
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  pthread_mutex_lock(&(pCo->mtxIO));
+
+  iRval = __WBCoprocessSendInternal(pCo, pData, cbData, 0);
+
+  pthread_mutex_unlock(&(pCo->mtxIO));
+
+  return iRval;
+}
+
+char * WBCoprocessReceive(WB_COPROCESS *pCo, size_t *pcbReply, int nTimeout)
+{
+char *pRval;
+
+
+  if(!pCo)
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  pthread_mutex_lock(&(pCo->mtxIO));
+
+  pRval = __WBCoprocessReceiveInternal(pCo, pcbReply, __WBCoprocessDeadline(nTimeout));
+
+  pthread_mutex_unlock(&(pCo->mtxIO));
+
+  return pRval;
+}
+
+char * WBCoprocessRequest(WB_COPROCESS *pCo, const void *pData, size_t cbData, size_t *pcbReply, int nTimeout)
+{
+WB_UINT64 ullDeadline;
+char *pRval = NULL;
+int iTry, iErr;
+
+
+  if(!pCo || (!pData && cbData))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  ullDeadline = __WBCoprocessDeadline(nTimeout);
+
+  pthread_mutex_lock(&(pCo->mtxIO));
+
+  if(pCo->nPending) // the responses to requests sent with WBCoprocessSend() must be received first
+  {
+    pthread_mutex_unlock(&(pCo->mtxIO));
+
+    errno = EBUSY;
+    return NULL;
+  }
+
+  // if the child exits before it responds, it's re-started and the request is sent again (once)
+
+  for(iTry=0; iTry < 2; iTry++)
+  {
+    if(!__WBCoprocessSendInternal(pCo, pData, cbData, ullDeadline))
+    {
+      pRval = __WBCoprocessReceiveInternal(pCo, pcbReply, ullDeadline);
+    }
+
+    if(pRval || errno != EPIPE || (pCo->iFlags & WB_COPROCESS_NO_RETRY))
+    {
+      break;
+    }
+  }
+
+  if(!pRval && (pCo->nPending || errno == ETIMEDOUT))
+  {
+    // timed out (or out of memory).  Its response would be received by the next request, so the
+    // child is stopped, and a new one is started for the next request
+
+    iErr = errno;
+
+    __WBCoprocessStop(pCo, 1);
+
+    errno = iErr;
+  }
+
+  pthread_mutex_unlock(&(pCo->mtxIO));
+
+  return pRval;
+}
+
+WB_PROCESS_ID WBCoprocessGetProcessID(WB_COPROCESS *pCo)
+{
+WB_PROCESS_ID idRval;
+
+
+  if(!pCo)
+  {
+    return WB_INVALID_PROCESS_ID;
+  }
+
+  pthread_mutex_lock(&(pCo->mtxIO));
+
+  idRval = pCo->idProcess;
+
+  pthread_mutex_unlock(&(pCo->mtxIO));
+
+  return idRval;
+}
+
+WB_COPROCESS_POOL * WBCoprocessPoolOpen(int nCount, const char *szAppName, char * const *argv,
+                                        char * const *envp, int iFlags)
+{
+WB_COPROCESS_POOL *pRval;
+int i1;
+
+
+  if(nCount <= 0)
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  pRval = (WB_COPROCESS_POOL *)WBAlloc(sizeof(*pRval) + sizeof(WB_COPROCESS *) * (nCount - 1));
+
+  if(!pRval)
+  {
+    return NULL;
+  }
+
+  memset(pRval, 0, sizeof(*pRval));
+
+  pRval->papIdle = (WB_COPROCESS **)WBAlloc(sizeof(WB_COPROCESS *) * nCount);
+
+  if(!pRval->papIdle)
+  {
+    WBFree(pRval);
+    return NULL;
+  }
+
+  pthread_mutex_init(&(pRval->mtxPool), NULL);
+  pthread_cond_init(&(pRval->condPool), NULL);
+
+  for(i1=0; i1 < nCount; i1++)
+  {
+    pRval->apAll[i1] = WBCoprocessOpen(szAppName, argv, envp, iFlags);
+
+    if(!pRval->apAll[i1])
+    {
+      WBCoprocessPoolClose(pRval);
+      return NULL;
+    }
+
+    pRval->papIdle[i1] = pRval->apAll[i1];
+    pRval->nCount = pRval->nIdle = i1 + 1;
+  }
+
+  return pRval;
+}
+
+void WBCoprocessPoolClose(WB_COPROCESS_POOL *pPool)
+{
+int i1, iErr = errno;
+
+
+  if(!pPool)
+  {
+    return;
+  }
+
+  for(i1=0; i1 < pPool->nCount; i1++)
+  {
+    WBCoprocessClose(pPool->apAll[i1]);
+  }
+
+  pthread_cond_destroy(&(pPool->condPool));
+  pthread_mutex_destroy(&(pPool->mtxPool));
+
+  WBFree(pPool->papIdle);
+  WBFree(pPool);
+
+  errno = iErr;
+}
+
+char * WBCoprocessPoolRequest(WB_COPROCESS_POOL *pPool, const void *pData, size_t cbData, size_t *pcbReply, int nTimeout)
+{
+WB_COPROCESS *pCo;
+char *pRval;
+int iErr;
+
+
+  if(!pPool)
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  pthread_mutex_lock(&(pPool->mtxPool));
+
+  while(!pPool->nIdle)
+  {
+    pthread_cond_wait(&(pPool->condPool), &(pPool->mtxPool));
+  }
+
+  pCo = pPool->papIdle[--(pPool->nIdle)];
+
+  pthread_mutex_unlock(&(pPool->mtxPool));
+
+  pRval = WBCoprocessRequest(pCo, pData, cbData, pcbReply, nTimeout);
+
+  iErr = errno;
+
+  pthread_mutex_lock(&(pPool->mtxPool));
+
+  pPool->papIdle[(pPool->nIdle)++] = pCo;
+
+  pthread_cond_signal(&(pPool->condPool));
+  pthread_mutex_unlock(&(pPool->mtxPool));
+
+  errno = iErr;
+
+  return pRval;
+}
+
+#endif // WIN32
+
+
+// SHARED LIBRARIES
+
+WB_MODULE WBLoadLibrary(const char * szModuleName)
+{
+#ifndef NO_SHARED_LIB_SUPPORT
+  return((WB_MODULE)dlopen(szModuleName, RTLD_LAZY | RTLD_LOCAL));
+#else  // NO_SHARED_LIB_SUPPORT
+  return NULL;
+#endif // NO_SHARED_LIB_SUPPORT
+}
+
+void WBFreeLibrary(WB_MODULE hModule)
+{
+#ifndef NO_SHARED_LIB_SUPPORT
+  dlclose(hModule);
+#endif // NO_SHARED_LIB_SUPPORT
+}
+
+WB_PROCADDRESS WBGetProcAddress(WB_MODULE hModule, const char *szProcName)
+{
+#ifndef NO_SHARED_LIB_SUPPORT
+// freebsd has the 'dlfunc' API, which is basically 'dlsym' cast to a function pointer
+#ifdef __FreeBSD__
+  return((WB_PROCADDRESS)dlfunc(hModule, szProcName));
+#else // other POSIX systems - TODO, check for 'dlfunc' instead of the OS
+  return((WB_PROCADDRESS)dlsym(hModule, szProcName));
+#endif // 'dlfunc' check
+#else  // NO_SHARED_LIB_SUPPORT
+  return NULL;
+#endif // NO_SHARED_LIB_SUPPORT
+}
+
+void * WBGetDataAddress(WB_MODULE hModule, const char *szDataName)
+{
+#ifndef NO_SHARED_LIB_SUPPORT
+  return((void *)dlsym(hModule, szDataName));
+#else  // NO_SHARED_LIB_SUPPORT
+  return NULL;
+#endif // NO_SHARED_LIB_SUPPORT
+}
+
+
+// THREADS
+
+WB_THREAD_KEY WBThreadAllocLocal(void)
+{
+WB_THREAD_KEY keyRval;
+  if(!pthread_key_create(&keyRval, NULL))
+  {
+    return keyRval;
+  }
+
+  return (WB_THREAD_KEY)INVALID_HANDLE_VALUE;
+}
+
+void WBThreadFreeLocal(WB_THREAD_KEY keyVal)
+{
+  pthread_key_delete(keyVal); // TODO:  check return?
+}
+
+void * WBThreadGetLocal(WB_THREAD_KEY keyVal)
+{
+  return pthread_getspecific(keyVal);
+}
+
+void WBThreadSetLocal(WB_THREAD_KEY keyVal, void *pValue)
+{
+  pthread_setspecific(keyVal, pValue);
+}
+
+WB_THREAD WBThreadGetCurrent(void)
+{
+  return pthread_self();
+}
+
+
+
+
+WB_THREAD WBThreadCreate(void *(*function)(void *), void *pParam)
+{
+  WB_THREAD thrdRval = (WB_THREAD)INVALID_HANDLE_VALUE;
+
+  // TODO:  call my own thread startup proc, passing a struct that contains
+  //        'function' and 'pParam' as the param.  use a linked list of
+  //        pre-allocated buffers for that.
+  // see possible implementation, above
+
+  if(!pthread_create(&thrdRval, NULL, function, pParam))
+  {
+    return thrdRval;
+  }
+
+  return (WB_THREAD)INVALID_HANDLE_VALUE;
+}
+
+void *WBThreadWait(WB_THREAD hThread)        // closes hThread, returns exit code, waits for thread to terminate (blocks)
+{
+void *pRval = NULL;
+
+  if(pthread_join(hThread, &pRval))
+  {
+    // TODO:  error return??
+    pRval = (void *)-1;
+  }
+
+  return pRval;
+}
+
+int WBThreadRunning(WB_THREAD hThread)        // >0 if thread is running, <0 error - use 'pthread_kill(thread,0)' which returns ESRCH if terminated i.e. 'PS_DEAD'
+{
+  int iR = pthread_kill(hThread,0);
+
+  if(!iR)
+  {
+    return 1; // no signal sent, handle is valid (and did not exit)
+  }
+
+  if(iR == ESRCH)
+  {
+    return 0; // for now, allow this to indicate 'done'
+  }
+
+  return -1;
+}
+
+void WBThreadExit(void *pRval)
+{
+  pthread_exit(pRval);
+}
+
+void WBThreadClose(WB_THREAD hThread)
+{
+  pthread_detach(hThread);
+}
+
+
+// CONDITIONS AND MUTEXES
+//
+// On Linux both of these are futexes.  A mutex is 0 (unlocked), 1 (locked) or 2 (locked, and a thread may be
+// waiting for it), as in Drepper's "Futexes Are Tricky", so locking and unlocking only enter the kernel when
+// there is a waiter.  Before it waits, a thread spins for about twice as long as it took to get the lock the
+// last few times.  That estimate is kept in a small table indexed by the mutex's address, since a WB_MUTEX
+// has no room for it.  A condition is a sequence number (the upper bits) that WBCondSignal() increments, and
+// a count of waiting threads (the lower bits), so signaling a condition that nobody waits on doesn't enter the
+// kernel either.  Timed waits use FUTEX_WAIT_BITSET, which takes an absolute CLOCK_MONOTONIC deadline, so a
+// wait that's interrupted doesn't extend the timeout.
+// Other POSIX systems use a pthread mutex, and a single pthread condition that's shared by every WB_COND.
+
+#ifdef __linux__
+
+#define WB_MUTEX_SPIN_MAX 200   /* the most times a thread spins before it waits for a mutex */
+#define WB_MUTEX_SPIN_SLOTS 64  /* the size of the spin estimate table (a power of 2) */
+
+#define WB_COND_WAITERS 0xfff   /* the waiter count in a WB_COND (more than this, and they poll) */
+#define WB_COND_SEQUENCE 0x1000 /* what WBCondSignal() adds to a WB_COND */
+
+#if defined(__SSE2__)
+#define WB_CPU_RELAX() _mm_pause()
+#elif defined(__aarch64__)
+#define WB_CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#else // other processors
+#define WB_CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif // __SSE2__, __aarch64__
+
+static int aiMutexSpin[WB_MUTEX_SPIN_SLOTS]; // recent spin counts for the mutexes that hash to each slot
+
+// returns 0 when woken (or the value didn't match, or a signal arrived), 1 on timeout, -1 on error.
+// 'ullDeadline' is a __WBMonotonicTime() value, or zero to wait indefinitely
+
+static int __WBFutexWait(WB_UINT32 *pWord, WB_UINT32 uiVal, WB_UINT64 ullDeadline)
+{
+struct timespec ts;
+
+
+  if(ullDeadline)
+  {
+    ts.tv_sec = ullDeadline / 1000000;
+    ts.tv_nsec = (ullDeadline % 1000000) * 1000;
+  }
+
+  // NOTE:  FUTEX_WAIT_BITSET uses CLOCK_MONOTONIC (unless FUTEX_CLOCK_REALTIME is given), the same as __WBMonotonicTime()
+
+  if(!syscall(SYS_futex, pWord, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, uiVal,
+              ullDeadline ? &ts : NULL, NULL, FUTEX_BITSET_MATCH_ANY))
+  {
+    return 0;
+  }
+
+  if(errno == ETIMEDOUT)
+  {
+    return 1;
+  }
+
+  if(errno == EAGAIN || errno == EINTR) // the caller checks the value again
+  {
+    return 0;
+  }
+
+  return -1;
+}
+
+static void __WBFutexWake(WB_UINT32 *pWord, int nCount)
+{
+  syscall(SYS_futex, pWord, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, nCount, NULL, NULL, 0);
+}
+
+#else // __linux__
+
+static pthread_mutex_t mtxCondShared = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t condShared;
+static pthread_once_t onceCondShared = PTHREAD_ONCE_INIT;
+
+static void __WBCondSharedInit(void)
+{
+pthread_condattr_t xAttr;
+
+
+  pthread_condattr_init(&xAttr);
+  pthread_condattr_setclock(&xAttr, CLOCK_MONOTONIC); // same clock as __WBMonotonicTime()
+  pthread_cond_init(&condShared, &xAttr);
+  pthread_condattr_destroy(&xAttr);
+}
+
+#endif // __linux__
+
+// wait for the sequence number in 'pCond' to change from the one in 'uiSnap'
+
+static int __WBCondWaitInternal(WB_COND *pCond, WB_UINT32 uiSnap, int nTimeout)
+{
+WB_UINT64 ullDeadline;
+int iRval = 0;
+#ifdef __linux__
+WB_UINT32 uiVal;
+#else // __linux__
+struct timespec ts;
+#endif // __linux__
+
+
+  ullDeadline = nTimeout > 0 ? __WBMonotonicTime() + nTimeout : 0;
+
+#ifdef __linux__
+
+  // add myself to the waiter count, unless it was signaled since 'uiSnap' was read
+
+  uiVal = __atomic_load_n(pCond, __ATOMIC_ACQUIRE);
+
+  while(1)
+  {
+    if((uiVal ^ uiSnap) & ~(WB_UINT32)WB_COND_WAITERS)
+    {
+      return 0;
+    }
+
+    if(!nTimeout)
+    {
+      return 1;
+    }
+
+    if((uiVal & WB_COND_WAITERS) == WB_COND_WAITERS) // too many to count, so poll instead
+    {
+      if(ullDeadline && __WBMonotonicTime() >= ullDeadline)
+      {
+        return 1;
+      }
+
+      WBDelay(1000);
+
+      uiVal = __atomic_load_n(pCond, __ATOMIC_ACQUIRE);
+      continue;
+    }
+
+    if(__atomic_compare_exchange_n(pCond, &uiVal, uiVal + 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+    {
+      uiVal++;
+      break;
+    }
+  }
+
+  // a signal changes the value, so if it happens before the futex wait, the wait returns right away
+
+  while(1)
+  {
+    iRval = __WBFutexWait(pCond, uiVal, ullDeadline);
+
+    uiVal = __atomic_load_n(pCond, __ATOMIC_ACQUIRE);
+
+    if((uiVal ^ uiSnap) & ~(WB_UINT32)WB_COND_WAITERS)
+    {
+      iRval = 0;
+      break;
+    }
+
+    if(iRval) // timeout or error
+    {
+      break;
+    }
+  }
+
+  __atomic_fetch_sub(pCond, 1, __ATOMIC_RELAXED);
+
+#else // __linux__
 
-  //ResumeThread(xParams.hThread);
+  pthread_once(&onceCondShared, __WBCondSharedInit);
 
-  pRval = RunResultInternal(xParams.hStdin[0], &nExitCode, szAppName, va);
+  if(ullDeadline)
+  {
+    ts.tv_sec = ullDeadline / 1000000;
+    ts.tv_nsec = (ullDeadline % 1000000) * 1000;
+  }
 
-  // wait for worker thread close
+  pthread_mutex_lock(&mtxCondShared);
 
-  if(pRval && nExitCode)
+  while(*pCond == uiSnap)
   {
-#ifdef _DEBUG
+    if(!nTimeout)
     {
-      char tbuf[1024];
-      _sntprintf(tbuf, sizeof(tbuf), "%s ended with error code %d\n", szAppName, nExitCode);
-      ::MessageBox(NULL, tbuf, "** EXTERNAL APPLICATION ERROR **", MB_OK |  MB_ICONERROR);
-      OutputDebugString(pRval);
+      iRval = 1;
+      break;
     }
-#endif _DEBUG
 
-    free(pRval);
-    pRval = NULL;
+    iRval = ullDeadline ? pthread_cond_timedwait(&condShared, &mtxCondShared, &ts)
+                        : pthread_cond_wait(&condShared, &mtxCondShared);
+
+    if(iRval == ETIMEDOUT)
+    {
+      iRval = *pCond == uiSnap ? 1 : 0;
+      break;
+    }
+    else if(iRval)
+    {
+      errno = iRval;
+      iRval = -1;
+      break;
+    }
   }
 
-  va_end(va);
+  pthread_mutex_unlock(&mtxCondShared);
 
-error_exit:
+#endif // __linux__
 
-  xParams.dwThreadID = 0; // tells thread to exit
+  return iRval;
+}
 
-  if(xParams.hThread != INVALID_HANDLE_VALUE)
+int WBCondCreate(WB_COND *pCond)
+{
+  if(!pCond)
   {
-    while(xParams.bStateFlag > 0)
-      Sleep(10); // wait for it to end
-
-    CloseHandle(xParams.hThread);
+    errno = EINVAL;
+    return -1;
   }
 
-  if(xParams.hStdin[1] != INVALID_HANDLE_VALUE)
-    CloseHandle(xParams.hStdin[1]);
+  *pCond = 0;
 
-  if(xParams.hStdin[0] != INVALID_HANDLE_VALUE)
-    CloseHandle(xParams.hStdin[0]);
+  return 0;
+}
 
-  return pRval;
+int WBMutexCreate(WB_MUTEX *pMtx)
+{
+  if(!pMtx)
+  {
+    errno = EINVAL;
+    return -1;
+  }
 
-#else // WIN32
+#ifdef __linux__
+  *pMtx = 0;
 
-char *pRval, *pTemp = NULL;
-va_list va;
-WB_FILE_HANDLE hIn = WB_INVALID_FILE_HANDLE;
+  return 0;
+#else // __linux__
+  return pthread_mutex_init(pMtx, NULL) ? -1 : 0;
+#endif // __linux__
+}
 
+void WBCondFree(WB_COND *pCond)
+{
+  (void)pCond; // nothing was allocated
+}
+
+void WBMutexFree(WB_MUTEX *pMtx)
+{
+#ifdef __linux__
+  (void)pMtx; // nothing was allocated
+#else // __linux__
+  if(pMtx)
+  {
+    pthread_mutex_destroy(pMtx);
+  }
+#endif // __linux__
+}
+
+int WBMutexLock(WB_MUTEX *pMtx, int nTimeout)
+{
+#ifdef __linux__
+WB_UINT32 uiVal = 0;
+WB_UINT64 ullDeadline = 0;
+WB_UINTPTR uiSlot;
+int i1, iRval, nSpin, nEstimate;
+#else // __linux__
+struct timespec ts;
+int iRval;
+#endif // __linux__
 
-  va_start(va, szAppName);
 
-  if(pStdin && cbStdin > 0)
+  if(!pMtx)
   {
-    unsigned int nLen = cbStdin;
-    const unsigned char *szStdInBuf = (const unsigned char *)pStdin;
+    errno = EINVAL;
+    return -1;
+  }
 
-    pTemp = WBTempFile0(".tmp");
+#ifdef __linux__
 
-    if(!pTemp)
-    {
-//      WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (1)\n", __FUNCTION__);
+  if(__atomic_compare_exchange_n(pMtx, &uiVal, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+  {
+    return 0; // not contended (the usual case)
+  }
 
-      va_end(va);
-      return NULL;
-    }
+  if(!nTimeout)
+  {
+    return 1;
+  }
 
-    hIn = open(pTemp, O_RDWR, 0);
+  // spin for a while, in case the lock is only held briefly
 
-    if(hIn < 0)
-    {
-bad_file:
-      unlink(pTemp);
-      WBFree(pTemp);
+  uiSlot = (WB_UINTPTR)pMtx;
+  uiSlot = ((uiSlot >> 2) ^ (uiSlot >> 8)) & (WB_MUTEX_SPIN_SLOTS - 1);
 
-//      WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (2)\n", __FUNCTION__);
+  nEstimate = __atomic_load_n(&(aiMutexSpin[uiSlot]), __ATOMIC_RELAXED);
+  nSpin = nEstimate * 2 + 10;
 
-      va_end(va);
-      return NULL;
-    }
+  if(nSpin > WB_MUTEX_SPIN_MAX)
+  {
+    nSpin = WB_MUTEX_SPIN_MAX;
+  }
+
+  for(i1=0; i1 < nSpin; i1++)
+  {
+    uiVal = __atomic_load_n(pMtx, __ATOMIC_RELAXED);
 
-    if(write(hIn, szStdInBuf, nLen) != (ssize_t)nLen)
+    if(!uiVal && __atomic_compare_exchange_n(pMtx, &uiVal, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
     {
-      close(hIn);
-      goto bad_file;
+      break;
     }
 
-    lseek(hIn, 0, SEEK_SET); // rewind file
-
-//    WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (3) temp file \"%s\"\n", __FUNCTION__, pTemp);
+    WB_CPU_RELAX();
   }
 
-  pRval = WBRunResultInternal(hIn, NULL, szAppName, va);
+  // the estimate moves 1/8 of the way to this result (a lost update doesn't matter)
 
-  va_end(va);
+  __atomic_store_n(&(aiMutexSpin[uiSlot]), nEstimate + (i1 - nEstimate) / 8, __ATOMIC_RELAXED);
 
-  if(pTemp)
+  if(i1 < nSpin)
   {
-    close(hIn);
-    unlink(pTemp);
-
-    WBFree(pTemp);
+    return 0;
   }
 
-  return pRval;
-
-#endif // WIN32
-}
+  if(nTimeout > 0)
+  {
+    ullDeadline = __WBMonotonicTime() + nTimeout;
+  }
 
+  // once there's been a waiter, it's locked as 2 since there may be others, so 'unlock' wakes one of them
 
+  while(__atomic_exchange_n(pMtx, 2, __ATOMIC_ACQUIRE))
+  {
+    iRval = __WBFutexWait(pMtx, 2, ullDeadline);
 
-char *WBRunResultWithInput(const char *szStdInBuf, const char *szAppName, ...)
-{
-char *pRval, *pTemp = NULL;
-va_list va;
-WB_FILE_HANDLE hIn = WB_INVALID_FILE_HANDLE;
+    if(iRval)
+    {
+      return iRval; // timeout or error
+    }
+  }
 
+  return 0;
 
-  va_start(va, szAppName);
+#else // __linux__
 
-  if(szStdInBuf && *szStdInBuf)
+  if(nTimeout < 0)
+  {
+    iRval = pthread_mutex_lock(pMtx);
+  }
+  else if(!nTimeout)
+  {
+    iRval = pthread_mutex_trylock(pMtx);
+  }
+  else
   {
-    unsigned int nLen = strlen(szStdInBuf);
+    clock_gettime(CLOCK_REALTIME, &ts); // 'pthread_mutex_timedlock' uses CLOCK_REALTIME
 
-    pTemp = WBTempFile0(".tmp");
+    ts.tv_sec += nTimeout / 1000000;
+    ts.tv_nsec += (nTimeout % 1000000) * 1000;
 
-    if(!pTemp)
+    if(ts.tv_nsec >= 1000000000)
     {
-//      WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (1)\n", __FUNCTION__);
-
-      va_end(va);
-      return NULL;
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
     }
 
-    hIn = open(pTemp, O_RDWR, 0);
+    iRval = pthread_mutex_timedlock(pMtx, &ts);
+  }
 
-    if(hIn < 0)
-    {
-bad_file:
-      unlink(pTemp);
-      WBFree(pTemp);
+  if(!iRval)
+  {
+    return 0;
+  }
 
-//      WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (2)\n", __FUNCTION__);
+  if(iRval == EBUSY || iRval == ETIMEDOUT)
+  {
+    return 1;
+  }
 
-      va_end(va);
-      return NULL;
-    }
+  errno = iRval;
+  return -1;
 
-    if(write(hIn, szStdInBuf, nLen) != (ssize_t)nLen)
-    {
-      close(hIn);
-      goto bad_file;
-    }
+#endif // __linux__
+}
+
+int WBMutexUnlock(WB_MUTEX *pMtx)
+{
+#ifdef __linux__
+WB_UINT32 uiVal;
+#endif // __linux__
 
-    lseek(hIn, 0, SEEK_SET); // rewind file
 
-//    WB_ERROR_PRINT("TEMPORARY:  %s HERE I AM (3) temp file \"%s\"\n", __FUNCTION__, pTemp);
+  if(!pMtx)
+  {
+    errno = EINVAL;
+    return -1;
   }
 
-  pRval = WBRunResultInternal(hIn, NULL, szAppName, va);
+#ifdef __linux__
 
-  va_end(va);
+  uiVal = __atomic_exchange_n(pMtx, 0, __ATOMIC_RELEASE);
 
-  if(pTemp)
+  if(!uiVal)
   {
-    close(hIn);
-    unlink(pTemp);
+    errno = EPERM; // it wasn't locked
+    return -1;
+  }
 
-    WBFree(pTemp);
+  if(uiVal == 2)
+  {
+    __WBFutexWake(pMtx, 1);
   }
 
-  return pRval;
-}
+  return 0;
 
+#else // __linux__
 
-// SHARED LIBRARIES
+  return pthread_mutex_unlock(pMtx) ? -1 : 0;
 
-WB_MODULE WBLoadLibrary(const char * szModuleName)
-{
-#ifndef NO_SHARED_LIB_SUPPORT
-  return((WB_MODULE)dlopen(szModuleName, RTLD_LAZY | RTLD_LOCAL));
-#else  // NO_SHARED_LIB_SUPPORT
-  return NULL;
-#endif // NO_SHARED_LIB_SUPPORT
+#endif // __linux__
 }
 
-void WBFreeLibrary(WB_MODULE hModule)
+int WBCondSignal(WB_COND *pCond)
 {
-#ifndef NO_SHARED_LIB_SUPPORT
-  dlclose(hModule);
-#endif // NO_SHARED_LIB_SUPPORT
-}
+#ifdef __linux__
+WB_UINT32 uiVal;
+#endif // __linux__
 
-WB_PROCADDRESS WBGetProcAddress(WB_MODULE hModule, const char *szProcName)
-{
-#ifndef NO_SHARED_LIB_SUPPORT
-// freebsd has the 'dlfunc' API, which is basically 'dlsym' cast to a function pointer
-#ifdef __FreeBSD__
-  return((WB_PROCADDRESS)dlfunc(hModule, szProcName));
-#else // other POSIX systems - TODO, check for 'dlfunc' instead of the OS
-  return((WB_PROCADDRESS)dlsym(hModule, szProcName));
-#endif // 'dlfunc' check
-#else  // NO_SHARED_LIB_SUPPORT
-  return NULL;
-#endif // NO_SHARED_LIB_SUPPORT
-}
 
-void * WBGetDataAddress(WB_MODULE hModule, const char *szDataName)
-{
-#ifndef NO_SHARED_LIB_SUPPORT
-  return((void *)dlsym(hModule, szDataName));
-#else  // NO_SHARED_LIB_SUPPORT
-  return NULL;
-#endif // NO_SHARED_LIB_SUPPORT
-}
+  if(!pCond)
+  {
+    errno = EINVAL;
+    return -1;
+  }
 
+#ifdef __linux__
 
-// THREADS
+  uiVal = __atomic_fetch_add(pCond, WB_COND_SEQUENCE, __ATOMIC_RELEASE);
 
-WB_THREAD_KEY WBThreadAllocLocal(void)
-{
-WB_THREAD_KEY keyRval;
-  if(!pthread_key_create(&keyRval, NULL))
+  if(uiVal & WB_COND_WAITERS)
   {
-    return keyRval;
+    __WBFutexWake(pCond, 1);
   }
 
-  return (WB_THREAD_KEY)INVALID_HANDLE_VALUE;
-}
-
-void WBThreadFreeLocal(WB_THREAD_KEY keyVal)
-{
-  pthread_key_delete(keyVal); // TODO:  check return?
-}
+#else // __linux__
 
-void * WBThreadGetLocal(WB_THREAD_KEY keyVal)
-{
-  return pthread_getspecific(keyVal);
-}
+  pthread_once(&onceCondShared, __WBCondSharedInit);
 
-void WBThreadSetLocal(WB_THREAD_KEY keyVal, void *pValue)
-{
-  pthread_setspecific(keyVal, pValue);
-}
+  pthread_mutex_lock(&mtxCondShared);
 
-WB_THREAD WBThreadGetCurrent(void)
-{
-  return pthread_self();
-}
+  (*pCond)++;
+  pthread_cond_broadcast(&condShared); // it's shared, so this has to wake everything
 
+  pthread_mutex_unlock(&mtxCondShared);
 
+#endif // __linux__
 
+  return 0;
+}
 
-WB_THREAD WBThreadCreate(void *(*function)(void *), void *pParam)
+int WBCondWait(WB_COND *pCond, int nTimeout)
 {
-  WB_THREAD thrdRval = (WB_THREAD)INVALID_HANDLE_VALUE;
-
-  // TODO:  call my own thread startup proc, passing a struct that contains
-  //        'function' and 'pParam' as the param.  use a linked list of
-  //        pre-allocated buffers for that.
-  // see possible implementation, above
-
-  if(!pthread_create(&thrdRval, NULL, function, pParam))
+  if(!pCond)
   {
-    return thrdRval;
+    errno = EINVAL;
+    return -1;
   }
 
-  return (WB_THREAD)INVALID_HANDLE_VALUE;
+  return __WBCondWaitInternal(pCond, __atomic_load_n(pCond, __ATOMIC_ACQUIRE), nTimeout);
 }
 
-void *WBThreadWait(WB_THREAD hThread)        // closes hThread, returns exit code, waits for thread to terminate (blocks)
+int WBCondWaitMutex(WB_COND *pCond, WB_MUTEX *pMtx, int nTimeout)
 {
-void *pRval = NULL;
+WB_UINT32 uiSnap;
+int iRval;
 
-  if(pthread_join(hThread, &pRval))
+
+  if(!pCond || !pMtx)
   {
-    // TODO:  error return??
-    pRval = (void *)-1;
+    errno = EINVAL;
+    return -1;
   }
 
-  return pRval;
-}
+  // the sequence number is read while the mutex is still locked, so a signal right after the unlock isn't missed
 
-int WBThreadRunning(WB_THREAD hThread)        // >0 if thread is running, <0 error - use 'pthread_kill(thread,0)' which returns ESRCH if terminated i.e. 'PS_DEAD'
-{
-  int iR = pthread_kill(hThread,0);
+  uiSnap = __atomic_load_n(pCond, __ATOMIC_ACQUIRE);
 
-  if(!iR)
+  if(WBMutexUnlock(pMtx))
   {
-    return 1; // no signal sent, handle is valid (and did not exit)
+    return -1;
   }
 
-  if(iR == ESRCH)
-  {
-    return 0; // for now, allow this to indicate 'done'
-  }
+  iRval = __WBCondWaitInternal(pCond, uiSnap, nTimeout);
 
-  return -1;
+  WBMutexLock(pMtx, -1);
+
+  return iRval;
 }
 
-void WBThreadExit(void *pRval)
+
+// INTERLOCKED (ATOMIC) OPERATIONS
+
+WB_UINT32 WBInterlockedDecrement(volatile WB_UINT32 *pValue)
 {
-  pthread_exit(pRval);
+  return __sync_sub_and_fetch(pValue, 1);
 }
 
-void WBThreadClose(WB_THREAD hThread)
+WB_UINT32 WBInterlockedIncrement(volatile WB_UINT32 *pValue)
 {
-  pthread_detach(hThread);
+  return __sync_add_and_fetch(pValue, 1);
+}
+
+WB_UINT32 WBInterlockedExchange(volatile WB_UINT32 *pValue, WB_UINT32 nNewVal)
+{
+  __sync_synchronize(); // '__sync_lock_test_and_set' is only an 'acquire' barrier
+
+  return __sync_lock_test_and_set(pValue, nNewVal);
+}
+
+WB_UINT32 WBInterlockedRead(volatile WB_UINT32 *pValue)
+{
+  return __sync_fetch_and_add(pValue, 0);
 }
 
 
@@ -1830,7 +11370,7 @@ int iFile, bCharMode = 0;
     iFile = STDIN_FILENO; // fcntl(STDIN_FILENO,  F_DUPFD, 0);  // dup stdin handle so I can close it later
   else
 #endif // WIN32
-    iFile = open(szFileName, O_RDONLY); // open read only (assume no locking for now)
+    iFile = open(szFileName, O_RDONLY | O_CLOEXEC); // open read only (assume no locking for now)
 
   if(iFile < 0)
   {
@@ -1951,7 +11491,7 @@ int iFile, iRval, iChunk;
     return -1;
   }
 
-  iFile = open(szFileName, O_CREAT | O_TRUNC | O_RDWR, 0666);  // always create with mode '666' (umask should apply)
+  iFile = open(szFileName, O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0666);  // always create with mode '666' (umask should apply)
 
   if(iFile < 0)
   {
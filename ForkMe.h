@@ -229,16 +229,22 @@ typedef pthread_key_t   WB_THREAD_KEY;
 
 /** \brief CONDITION HANDLE equivalent (similar to an 'event')
   *
-  * This 'typedef' refers to a CONDITION, a triggerable synchronization resource
+  * This 'typedef' refers to a CONDITION, a triggerable synchronization resource.  It is a sequence
+  * number that WBCondSignal() increments (and on Linux, a futex).  Zero is a valid initial value.
 **/
 typedef WB_UINT32 WB_COND; // defined as 'WB_UINT32' because of pthread_cond problems under Linux
 //typedef pthread_cond_t  WB_COND;
 
 /** \brief MUTEX HANDLE equivalent
   *
-  * This 'typedef' refers to a MUTEX, a lockable synchronization object
+  * This 'typedef' refers to a MUTEX, a lockable synchronization object.  On Linux it is a futex,
+  * and zero is a valid initial (unlocked) value.
 **/
+#ifdef __linux__
+typedef WB_UINT32 WB_MUTEX; // 0 unlocked, 1 locked, 2 locked with (possible) waiters
+#else // __linux__
 typedef pthread_mutex_t WB_MUTEX;
+#endif // __linux__
 
 /** \brief MODULE HANDLE equivalent
   *
@@ -266,16 +272,22 @@ typedef pthread_key_t   WB_THREAD_KEY;
 
 /** \brief CONDITION HANDLE equivalent (similar to an 'event')
   *
-  * This 'typedef' refers to a CONDITION, a triggerable synchronization resource
+  * This 'typedef' refers to a CONDITION, a triggerable synchronization resource.  It is a sequence
+  * number that WBCondSignal() increments (and on Linux, a futex).  Zero is a valid initial value.
 **/
 typedef WB_UINT32 WB_COND; // defined as 'WB_UINT32' because of pthread_cond problems under Linux
 //typedef pthread_cond_t  WB_COND;
 
 /** \brief MUTEX HANDLE equivalent
   *
-  * This 'typedef' refers to a MUTEX, a lockable synchronization object
+  * This 'typedef' refers to a MUTEX, a lockable synchronization object.  On Linux it is a futex,
+  * and zero is a valid initial (unlocked) value.
 **/
+#ifdef __linux__
+typedef WB_UINT32 WB_MUTEX; // 0 unlocked, 1 locked, 2 locked with (possible) waiters
+#else // __linux__
 typedef pthread_mutex_t WB_MUTEX;
+#endif // __linux__
 
 
 typedef char * WB_PSTR;         ///< pointer to char string - a convenience typedef
@@ -330,7 +342,10 @@ int WBMkDir(const char *szFileName, int flags);
 
 /** \brief search path for file
   *
-  * searches PATH environment var for specified file name, returns malloc'd string of canonical name
+  * searches PATH environment var for specified file name, returns malloc'd string of canonical name\n
+  * A plain program name (no '/') is looked for in PATH first, then in the current directory.  Results
+  * are cached per PATH string, and the cache is invalidated when PATH changes, or (checked about once
+  * per second) when the modification time of any PATH directory changes.
 **/
 char * WBSearchPath(const char *szFileName);
 
@@ -377,10 +392,128 @@ WB_PROCESS_ID WBRunAsync(const char *szAppName, ...);
   * within the loop to avoid 'maxing out' the CPU utilization, which would very likely use up more electricity
   * than a more efficient wait state.
   *
-  * See Also:  WBRunAsync(), WBRunAsyncPipe(), WBRunAsyncPipeV()
+  * If the process is being tracked with a pidfd (see WBProcessUsePidFD()) its exit status is cached
+  * when it is reaped, and returned by this function (or WBWaitProcess()) exactly once.  A process that
+  * was killed by a signal is reported as 'not running' with an exit code of -1.
+  *
+  * See Also:  WBRunAsync(), WBRunAsyncPipe(), WBRunAsyncPipeV(), WBWaitProcess()
 **/
 int WBGetProcessState(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode);
 
+/** \brief Enable or disable pidfd-backed tracking of processes created by WBRunAsyncPipeV()
+  *
+  * \param bEnable Non-zero to enable pidfd tracking for processes created after this call, zero to disable it
+  * \returns The previous setting (0 or 1), or a negative value if pidfds are not supported by the operating system
+  *
+  * When enabled, each process created by WBRunAsync(), WBRunAsyncPipe(), or WBRunAsyncPipeV() is associated
+  * with a 'pidfd' (Linux 5.3 or later), obtained either atomically via clone(CLONE_PIDFD) or with pidfd_open().
+  * So long as the pidfd is open, the process ID can't be re-used by another process, which makes
+  * WBKillProcess() race-free, and WBWaitProcess() can sleep in the kernel until the process exits.\n
+  * A tracked process must eventually be waited on with WBGetProcessState() or WBWaitProcess(), or released with
+  * WBReleaseProcess(), so that its resources are freed.  The WBRunResult family of functions always use a pidfd
+  * (when supported) internally, regardless of this setting.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBProcessUsePidFD(int bEnable);
+
+/** \brief Wait for a process to exit, with an optional timeout, and return its exit code
+  *
+  * \param idProcess A WB_PROCESS_ID for the running process
+  * \param pExitCode An optional pointer to a WB_INT32 to retrieve the exit code (may be NULL)
+  * \param nTimeout The timeout (in microseconds), or a value < 0 to indicate 'INFINITE'.  Zero does not block.
+  * \returns A zero value if the process has exited, a value > 0 on timeout, or a value < 0 on error
+  *
+  * Use this function to block until a process exits.  If the process is tracked with a pidfd (see WBProcessUsePidFD())
+  * the calling thread sleeps in the kernel until the process exits or the timeout expires.  Otherwise, the process
+  * state is checked periodically (with an increasing interval) until the timeout expires.  An infinite wait always
+  * blocks in the kernel.  Once the exit code has been returned, the process ID is no longer valid.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBWaitProcess(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode, int nTimeout);
+
+/** \brief Send a signal to a process, using its pidfd when it is available
+  *
+  * \param idProcess A WB_PROCESS_ID for the running process
+  * \param iSignal The signal to send (for example, SIGTERM or SIGKILL)
+  * \returns A zero value on success, or a negative value on error ('errno' contains the actual error)
+  *
+  * For a process that is tracked with a pidfd (see WBProcessUsePidFD()), the signal is sent with
+  * 'pidfd_send_signal()' so it can never be delivered to an unrelated process that re-used the same
+  * process ID.  If a tracked process has already been reaped, the function fails with ESRCH.  Otherwise
+  * this function is equivalent to 'kill()'.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBKillProcess(WB_PROCESS_ID idProcess, int iSignal);
+
+/** \brief WBTerminateProcessTree() flag - also terminate the process's descendants, and everything else in its session **/
+#define WB_TERMINATE_TREE 0x00000001
+
+/** \brief The maximum number of processes listed in a WB_TERMINATE_REPORT **/
+#define WB_TERMINATE_MAX_REPORT 64
+
+/** \struct WB_TERMINATE_REPORT
+  * \brief The processes that were terminated by WBTerminateProcessTree(), or by WBRunResultEx() and related functions
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_TERMINATE_REPORT__
+{
+  int nSignaled;          ///< the number of processes that were signaled (this may be more than 'nReported')
+  int nKilled;            ///< the number of those that were still running after the grace period, and were sent SIGKILL
+  int nReported;          ///< the number of entries in 'aidProcess' and 'aiSignal'
+  WB_PROCESS_ID aidProcess[WB_TERMINATE_MAX_REPORT]; ///< the processes that were signaled
+  int aiSignal[WB_TERMINATE_MAX_REPORT]; ///< the last signal sent to each one (SIGTERM or SIGKILL)
+} WB_TERMINATE_REPORT;
+
+/** \brief Terminate a process and its process group, with SIGTERM and then SIGKILL after a grace period
+  *
+  * \param idProcess A WB_PROCESS_ID for the running process
+  * \param iFlags Zero or more WB_TERMINATE_xxx flags
+  * \param nGrace The time (in microseconds) they have to exit after SIGTERM, or a value <= 0 for SIGKILL right away
+  * \param pReport An optional pointer to a WB_TERMINATE_REPORT that receives the processes that were signaled (may be NULL)
+  * \returns The number of processes that were signaled, or a negative value on error
+  *
+  * The process and its process group are sent SIGTERM (and SIGCONT, in case they are stopped).  Anything that
+  * is still running when all of them have exited, or the grace period ends, is sent SIGKILL.  A process
+  * started by this library is the leader of its own process group and session, so this also gets whatever it
+  * started.  On Linux, '/proc' is scanned to find the members of the process group, so that the function returns
+  * as soon as they're gone.  With WB_TERMINATE_TREE, the scan also finds the process's descendants and everything
+  * in its session, including orphaned grandchildren that left the process group (with 'setsid' or 'setpgid').\n
+  * The process itself is NOT reaped.  It must still be waited on with WBWaitProcess(), or released with WBReleaseProcess().
+  * The process is signaled with WBKillProcess(), so a tracked process can't be confused with another one, but
+  * the members of its process group and its descendants are signaled by their process IDs.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBTerminateProcessTree(WB_PROCESS_ID idProcess, int iFlags, int nGrace, WB_TERMINATE_REPORT *pReport);
+
+/** \brief Return the pidfd associated with a tracked process
+  *
+  * \param idProcess A WB_PROCESS_ID for the running process
+  * \returns A pidfd, or WB_INVALID_FILE_HANDLE if the process is not tracked or has already been reaped
+  *
+  * The returned file handle becomes readable when the process exits, and can be used with 'poll()',
+  * 'epoll()', or similar.  It belongs to the process and must NOT be closed by the caller.  It remains
+  * valid until the process is reaped by WBGetProcessState() or WBWaitProcess(), or released with WBReleaseProcess().
+  *
+  * Header File:  platform_helper.h
+**/
+WB_FILE_HANDLE WBGetProcessFD(WB_PROCESS_ID idProcess);
+
+/** \brief Stop tracking a process, freeing its pidfd and any cached status
+  *
+  * \param idProcess A WB_PROCESS_ID for the process
+  *
+  * Use this function for a tracked process that you do not intend to wait on.  It is harmless to call this
+  * for a process that is not tracked.
+  *
+  * Header File:  platform_helper.h
+**/
+void WBReleaseProcess(WB_PROCESS_ID idProcess);
+
 /** \brief Run an application synchronously, returning 'stdout' output in a character buffer.
   *
   * \param szAppName A const pointer to a character string containing the path to the application
@@ -460,6 +593,241 @@ char * WBRunResult3(const void * pStdin, int cbStdin, const char *szAppName, ...
 **/
 char * WBRunResultWithInput(const char *szStdInBuf, const char *szAppName, ...);
 
+/** \brief Callback function for WBRunStream(), receives each chunk of output as it arrives
+  *
+  * \param pUserData The 'pUserData' parameter that was passed to WBRunStream()
+  * \param iStream The stream the data came from, 1 for 'stdout' or 2 for 'stderr'
+  * \param pData A const pointer to the data.  It is followed by a zero byte, but may also contain zero bytes.
+  * \param cbData The length of the data, in bytes (never zero)
+  * \returns Zero to continue, or non-zero to stop.  When the callback returns non-zero, the process is killed.
+  *
+  * The buffer pointed to by 'pData' is re-used for the next chunk, so any data you need to keep must be copied.
+**/
+typedef int (* WB_RUN_STREAM_CALLBACK)(void *pUserData, int iStream, const char *pData, size_t cbData);
+
+/** \brief flag for WBRunStream(), pass 'stderr' output to the callback (otherwise it goes to /dev/null)
+**/
+#define WB_RUN_STREAM_STDERR 1
+
+/** \brief Run an application synchronously, passing its 'stdout' output to a callback function as it arrives
+  *
+  * \param pCallback A pointer to the WB_RUN_STREAM_CALLBACK function that receives the output
+  * \param pUserData A pointer that is passed as-is to 'pCallback'
+  * \param iFlags Zero or more flags; WB_RUN_STREAM_STDERR to also pass 'stderr' output to the callback
+  * \param pExitCode An optional pointer to a WB_INT32 that receives the exit code (-1 for abnormal termination)
+  * \param szAppName A const pointer to a character string containing the path to the application
+  * \returns Zero if the process ran to completion, a value > 0 if the callback stopped it, or a value < 0 on error
+  *
+  * Use this function to run an external process whose output is too large to collect in a single buffer.
+  * Each chunk (up to 64k bytes) is passed to the callback as soon as it has been read, and the same buffer
+  * is re-used for the next chunk, so memory use is constant regardless of how much the process writes.\n
+  * While the callback is running, nothing reads from the pipe.  If the callback is slow, the pipe fills up and
+  * the process blocks on 'write' until the callback catches up, providing natural back-pressure.\n
+  * Each additional parameter passed to this function is a parameter that is to be passed to the program.
+  * The final parameter in the list must be NULL.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBRunStream(WB_RUN_STREAM_CALLBACK pCallback, void *pUserData, int iFlags,
+                WB_INT32 *pExitCode, const char *szAppName, ...);
+
+/** \brief Identical to WBRunStream(), except that the program's parameters are passed as a va_list
+  *
+  * See WBRunStream()
+  *
+  * Header File:  platform_helper.h
+**/
+int WBRunStreamV(WB_RUN_STREAM_CALLBACK pCallback, void *pUserData, int iFlags,
+                 WB_INT32 *pExitCode, const char *szAppName, va_list va);
+
+/** \struct WB_RUN_BATCH_RESULT
+  * \brief The result of a single command run by WBRunBatch()
+  *
+  * 'pOutput' is the captured stdout (zero byte terminated), or NULL if the command could not
+  * be run.  It must be free'd with WBFree().  'iIndex' is the command's index in the original list.
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_RUN_BATCH_RESULT__
+{
+  char *pOutput;      ///< captured stdout, allocated via WBAlloc(), or NULL on error
+  size_t cbOutput;    ///< number of bytes in 'pOutput', not counting the terminating zero byte
+  WB_INT32 iExitCode; ///< the exit code of the command, or -1 on error
+  int iIndex;         ///< the index of the command within the 'papArgv' list passed to WBRunBatch()
+} WB_RUN_BATCH_RESULT;
+
+/** \brief Flag for WBRunBatch() - store results in completion order rather than in command order **/
+#define WB_RUN_BATCH_COMPLETION_ORDER 1
+
+/** \brief Run a list of commands concurrently, capturing the stdout and exit code for each of them
+  *
+  * \param papArgv An array of 'nCommands' NULL-terminated argument vectors.  Element [0] of each
+  *        vector is the application name (which is searched for in PATH); the rest are its parameters
+  * \param nCommands The number of commands in 'papArgv'
+  * \param nConcurrency The maximum number of commands to run at the same time.  If this is zero or
+  *        negative, the number of online processors is used.
+  * \param iFlags Zero, or WB_RUN_BATCH_COMPLETION_ORDER
+  * \param pResults An array of 'nCommands' WB_RUN_BATCH_RESULT structures that receives the results
+  * \returns The number of commands that ran successfully (regardless of exit code), or -1 on error
+  *
+  * Each command is run with the same capture engine as WBRunResult(), using a pool of worker threads
+  * (the calling thread is one of them).  By default, pResults[n] holds the result for papArgv[n].
+  * If WB_RUN_BATCH_COMPLETION_ORDER is specified, results are stored in the order in which the
+  * commands completed, and 'iIndex' identifies which command each result belongs to.\n
+  * The caller must free each non-NULL 'pOutput' using WBFree().
+  *
+  * Header File:  platform_helper.h
+**/
+int WBRunBatch(const char * const * const *papArgv, int nCommands, int nConcurrency, int iFlags,
+               WB_RUN_BATCH_RESULT *pResults);
+
+/** \brief An opaque handle for a long-lived child process that handles a series of requests (see WBCoprocessOpen())
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_COPROCESS__ WB_COPROCESS;
+
+/** \brief An opaque handle for a pool of identical coprocesses that is shared between threads (see WBCoprocessPoolOpen())
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_COPROCESS_POOL__ WB_COPROCESS_POOL;
+
+/** \brief Flag for WBCoprocessOpen() - each request and response is a 4-byte length (big endian) followed by the data
+  *
+  * Without this flag each request and response is one line.  A newline is added to a request that doesn't end with one,
+  * and the newline is removed from the response.
+**/
+#define WB_COPROCESS_LENGTH 1
+
+/** \brief Flag for WBCoprocessOpen() - the child's stderr is the caller's stderr (otherwise it's /dev/null) **/
+#define WB_COPROCESS_STDERR 2
+
+/** \brief Flag for WBCoprocessOpen() - don't send a request again when the child exits before it responds **/
+#define WB_COPROCESS_NO_RETRY 4
+
+/** \brief Start a long-lived child process that reads requests from its stdin, and writes a response for each to its stdout
+  *
+  * \param szAppName A const pointer to a character string containing the path to the application, or NULL to use argv[0]
+  * \param argv A NULL-terminated array of arguments, including argv[0], which is passed to the program as-is
+  * \param envp A NULL-terminated array of 'NAME=VALUE' strings for the environment, or NULL for the caller's environment
+  * \param iFlags Zero, or a combination of WB_COPROCESS_LENGTH, WB_COPROCESS_STDERR, and WB_COPROCESS_NO_RETRY
+  * \returns A WB_COPROCESS pointer, or NULL on error (including when the program can't be started).
+  *          Close it with WBCoprocessClose().
+  *
+  * This replaces starting a new process for each request (such as with WBRunResultWithInput()) for a helper program
+  * that can handle many requests.  The child must write exactly one response for each request, in order, and must
+  * not buffer its output (or must flush it after each response).\n
+  * Copies of 'argv' and 'envp' are kept, so that the child can be re-started.  If it exits, or a response times out
+  * or is malformed, it is stopped, and a new one is started by the next request.
+  *
+  * Header File:  platform_helper.h
+**/
+WB_COPROCESS * WBCoprocessOpen(const char *szAppName, char * const *argv, char * const *envp, int iFlags);
+
+/** \brief Close a coprocess, by closing its stdin and waiting briefly for it to exit (after which it is killed)
+  *
+  * \param pCo A pointer to the WB_COPROCESS, or NULL
+  *
+  * Header File:  platform_helper.h
+**/
+void WBCoprocessClose(WB_COPROCESS *pCo);
+
+/** \brief Send a request to a coprocess, without waiting for the response
+  *
+  * \param pCo A pointer to the WB_COPROCESS
+  * \param pData A const pointer to the request data
+  * \param cbData The size of the request data, in bytes
+  * \returns Zero on success, or -1 on error.  errno is EPIPE if the child exited.
+  *
+  * Several requests can be sent before the responses are received with WBCoprocessReceive().  While a request is
+  * being written, any responses that the child writes are read and kept, so the child can't block the caller by
+  * filling its stdout pipe.  If the child isn't running, it is started first.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBCoprocessSend(WB_COPROCESS *pCo, const void *pData, size_t cbData);
+
+/** \brief Receive the response to the oldest request sent with WBCoprocessSend()
+  *
+  * \param pCo A pointer to the WB_COPROCESS
+  * \param pcbReply A pointer to a size_t that receives the size of the response, or NULL
+  * \param nTimeout The timeout (in microseconds), or a value < 0 to indicate 'INFINITE'
+  * \returns A WBAlloc() pointer to the response (zero byte terminated, but it may contain zero bytes), or NULL on error.
+  *
+  * On error, errno is ETIMEDOUT if there is no response yet (and this can be called again), EPIPE if the child exited
+  * (and the responses to all of the requests that were sent are lost), EPROTO if the response was malformed, or
+  * ENOMSG if there are no requests waiting for a response.\n
+  * Any non-NULL value must be 'free'd by the caller using WBFree().
+  *
+  * Header File:  platform_helper.h
+**/
+char * WBCoprocessReceive(WB_COPROCESS *pCo, size_t *pcbReply, int nTimeout);
+
+/** \brief Send a request to a coprocess, and wait for its response
+  *
+  * \param pCo A pointer to the WB_COPROCESS
+  * \param pData A const pointer to the request data
+  * \param cbData The size of the request data, in bytes
+  * \param pcbReply A pointer to a size_t that receives the size of the response, or NULL
+  * \param nTimeout The timeout (in microseconds) for the entire request, or a value < 0 to indicate 'INFINITE'
+  * \returns A WBAlloc() pointer to the response (zero byte terminated, but it may contain zero bytes), or NULL on error.
+  *
+  * This can be called by several threads at the same time; each request and its response are handled as a unit.
+  * It fails with EBUSY if there are requests from WBCoprocessSend() that have not been received.\n
+  * If the child exits before it responds, a new one is started and the request is sent again (once), unless the
+  * WB_COPROCESS_NO_RETRY flag was specified.  If the response times out, the child is stopped, and the next request
+  * starts a new one.\n
+  * Any non-NULL value must be 'free'd by the caller using WBFree().
+  *
+  * Header File:  platform_helper.h
+**/
+char * WBCoprocessRequest(WB_COPROCESS *pCo, const void *pData, size_t cbData, size_t *pcbReply, int nTimeout);
+
+/** \brief The process ID of a coprocess's child, or WB_INVALID_PROCESS_ID if it isn't running
+  *
+  * The child belongs to the WB_COPROCESS, and must not be waited for by the caller.
+  *
+  * Header File:  platform_helper.h
+**/
+WB_PROCESS_ID WBCoprocessGetProcessID(WB_COPROCESS *pCo);
+
+/** \brief Start a pool of 'nCount' identical coprocesses, which can be shared between threads
+  *
+  * \param nCount The number of coprocesses
+  * \param szAppName The application (see WBCoprocessOpen())
+  * \param argv The arguments, including argv[0] (see WBCoprocessOpen())
+  * \param envp The environment, or NULL for the caller's environment (see WBCoprocessOpen())
+  * \param iFlags Flags for each coprocess (see WBCoprocessOpen())
+  * \returns A WB_COPROCESS_POOL pointer, or NULL on error.  Close it with WBCoprocessPoolClose().
+  *
+  * Header File:  platform_helper.h
+**/
+WB_COPROCESS_POOL * WBCoprocessPoolOpen(int nCount, const char *szAppName, char * const *argv,
+                                        char * const *envp, int iFlags);
+
+/** \brief Close all of the coprocesses in a pool.  No requests may be in progress.
+  *
+  * Header File:  platform_helper.h
+**/
+void WBCoprocessPoolClose(WB_COPROCESS_POOL *pPool);
+
+/** \brief Send a request to an idle coprocess in a pool, and wait for its response
+  *
+  * \param pPool A pointer to the WB_COPROCESS_POOL
+  * \param pData A const pointer to the request data
+  * \param cbData The size of the request data, in bytes
+  * \param pcbReply A pointer to a size_t that receives the size of the response, or NULL
+  * \param nTimeout The timeout (in microseconds) for the request, or a value < 0 to indicate 'INFINITE'.
+  *        The time spent waiting for an idle coprocess is not included.
+  * \returns A WBAlloc() pointer to the response, or NULL on error (see WBCoprocessRequest())
+  *
+  * If all of the coprocesses are busy, this waits until one of them is idle.
+  *
+  * Header File:  platform_helper.h
+**/
+char * WBCoprocessPoolRequest(WB_COPROCESS_POOL *pPool, const void *pData, size_t cbData, size_t *pcbReply, int nTimeout);
+
 /** \brief Run an application asynchronously, specifying file handles for STDIN, STDOUT, and STDERR
   *
   * \param hStdIn A WB_FILE_HANDLE for STDIN, or WB_INVALID_FILE_HANDLE
@@ -479,7 +847,8 @@ char * WBRunResultWithInput(const char *szStdInBuf, const char *szAppName, ...);
   * also possible to pass the SAME file handle for hStdIn, hStdOut, and hStdErr provided that it has
   * the correct read/write access available.  File handles passed to this function will be duplicated,
   * but not closed.  It is safe (and prudent) to close the original file handles immediately after calling this
-  * function.\n
+  * function.  The process does not inherit any other file handles; everything above STDERR is closed
+  * before the program runs.\n
   * \n
   * You can monitor 'WB_PROCESS_ID' to find out if the process is running.  Additionally, you can use
   * the output of hStdOut and hStdErr by re-directing them to anonymous pipes and monitoring their activity.
@@ -521,6 +890,850 @@ WB_PROCESS_ID WBRunAsyncPipe(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_F
 WB_PROCESS_ID WBRunAsyncPipeV(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
                               const char *szAppName, va_list va);
 
+/** \brief Run an application asynchronously with a pre-built 'argv' and (optionally) 'envp' array
+  *
+  * \param hStdIn A WB_FILE_HANDLE for STDIN, or WB_INVALID_FILE_HANDLE
+  * \param hStdOut A WB_FILE_HANDLE for STDOUT, or WB_INVALID_FILE_HANDLE
+  * \param hStdErr A WB_FILE_HANDLE for STDERR, or WB_INVALID_FILE_HANDLE
+  * \param szAppName A const pointer to a character string containing the path to the application, or NULL to use argv[0]
+  * \param argv A NULL-terminated array of arguments, including argv[0], which is passed to the program as-is
+  * \param envp A NULL-terminated array of 'NAME=VALUE' strings for the environment, or NULL for the caller's environment
+  * \returns A valid process ID or process handle, depending upon the operating system.  On error, it returns WB_INVALID_FILE_HANDLE
+  *
+  * This function is identical to WBRunAsyncPipeV() except that the arguments are passed as an array,
+  * which is used directly without being copied, and the environment can be specified.  See WBArgArenaArgv()
+  * and WBEnvSnapshotEnvp() for ways to build these arrays that can be re-used for repeated invocations.
+  *
+  * Header File:  platform_helper.h
+**/
+WB_PROCESS_ID WBRunAsyncPipeArgv(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
+                                 const char *szAppName, char * const *argv, char * const *envp);
+
+/** \brief An opaque, reference-counted handle for a program that is located and opened once (see WBExecutableOpen())
+**/
+typedef struct __WB_EXECUTABLE__ WB_EXECUTABLE;
+
+/** \brief Locate a program and open it, so that it can be run many times without looking it up again
+  *
+  * \param szAppName A const pointer to a character string containing the path or name of the application
+  * \returns A WB_EXECUTABLE pointer, or NULL on error.  Release it with WBExecutableRelease().
+  *
+  * The program is located the same way as WBRunAsyncPipeV() does it, and opened with O_PATH.  Processes
+  * started from the handle (see WBRunExecutableAsyncPipeArgv() and the 'pExecutable' member of WB_RUN_OPTIONS)
+  * are run with 'execveat()' on the descriptor, so that neither PATH nor the path itself is resolved again.
+  * Once a second (at most) the path is checked with 'stat()'.  If the file was replaced (its device or inode
+  * changed) or modified, it is opened again.  If it was removed, the path is used, and starting a process fails.\n
+  * Scripts (beginning with '#!') can't be run from a close-on-exec descriptor, so they are always run by their path.
+  * Processes started from a handle don't use the fork server, which doesn't have the descriptor.  A handle can be
+  * shared by any number of threads.
+  *
+  * Header File:  platform_helper.h
+**/
+WB_EXECUTABLE * WBExecutableOpen(const char *szAppName);
+
+/** \brief Add a reference to a WB_EXECUTABLE, returning 'pExe'
+  *
+  * Header File:  platform_helper.h
+**/
+WB_EXECUTABLE * WBExecutableAddRef(WB_EXECUTABLE *pExe);
+
+/** \brief Release a reference to a WB_EXECUTABLE, closing it when the last one is released
+  *
+  * Header File:  platform_helper.h
+**/
+void WBExecutableRelease(WB_EXECUTABLE *pExe);
+
+/** \brief Return the full path of the program a WB_EXECUTABLE refers to (valid until it is released)
+  *
+  * Header File:  platform_helper.h
+**/
+const char * WBExecutablePath(const WB_EXECUTABLE *pExe);
+
+/** \brief Identical to WBRunAsyncPipeArgv(), except that the program is run from an executable handle
+  *
+  * \param hStdIn A WB_FILE_HANDLE for STDIN, or WB_INVALID_FILE_HANDLE
+  * \param hStdOut A WB_FILE_HANDLE for STDOUT, or WB_INVALID_FILE_HANDLE
+  * \param hStdErr A WB_FILE_HANDLE for STDERR, or WB_INVALID_FILE_HANDLE
+  * \param pExe A WB_EXECUTABLE from WBExecutableOpen()
+  * \param argv A NULL-terminated array of arguments, including argv[0], which is passed to the program as-is
+  * \param envp A NULL-terminated array of 'NAME=VALUE' strings for the environment, or NULL for the caller's environment
+  * \returns A valid process ID or process handle, depending upon the operating system.  On error, it returns WB_INVALID_FILE_HANDLE
+  *
+  * Header File:  platform_helper.h
+**/
+WB_PROCESS_ID WBRunExecutableAsyncPipeArgv(WB_FILE_HANDLE hStdIn, WB_FILE_HANDLE hStdOut, WB_FILE_HANDLE hStdErr,
+                                           WB_EXECUTABLE *pExe, char * const *argv, char * const *envp);
+
+/** \brief Run an application synchronously with a pre-built 'argv' and (optionally) 'envp' array, returning its 'stdout' output
+  *
+  * \param pExitCode A pointer to a WB_INT32 that receives the exit code, or NULL
+  * \param szAppName A const pointer to a character string containing the path to the application, or NULL to use argv[0]
+  * \param argv A NULL-terminated array of arguments, including argv[0], which is passed to the program as-is
+  * \param envp A NULL-terminated array of 'NAME=VALUE' strings for the environment, or NULL for the caller's environment
+  * \returns A WBAlloc() pointer to a buffer containing the 'stdout' output from the application, or NULL on error.
+  *
+  * This function is identical to WBRunResult() except for the way the arguments are passed, and the exit code.
+  * Any non-NULL value must be 'free'd by the caller using WBFree().
+  *
+  * Header File:  platform_helper.h
+**/
+char * WBRunResultArgv(WB_INT32 *pExitCode, const char *szAppName, char * const *argv, char * const *envp);
+
+/** \struct WB_RUN_CACHE_STATS
+  * \brief Counters for the WBRunResult() result cache, see WBRunCacheEnable()
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_RUN_CACHE_STATS__
+{
+  WB_UINT64 ullHits;      ///< results returned from memory
+  WB_UINT64 ullDiskHits;  ///< results returned from the disk store (these are not included in 'ullHits')
+  WB_UINT64 ullMisses;    ///< lookups that ran the program
+  WB_UINT64 ullEvictions; ///< results removed from memory to stay within the size limit
+  size_t cbUsed;          ///< the memory currently used by cached results, in bytes
+  size_t nEntries;        ///< the number of results currently in memory
+} WB_RUN_CACHE_STATS;
+
+/** \brief Enable (or re-configure) the result cache for the WBRunResult() family of functions
+  *
+  * \param cbMax The maximum memory to use for cached results, in bytes.  Zero keeps nothing in memory.
+  * \param szDir The directory for the disk store (created if needed), or NULL for none
+  * \returns Zero on success, or -1 on error (the directory can't be created)
+  *
+  * The cache is opt-in, and global.  When enabled, WBRunResult(), WBRunResult2(), WBRunResult3(),
+  * WBRunResultWithInput(), WBRunResultArgv(), and WBRunBatch() return the output and exit code of an earlier
+  * run instead of running the program again, when all of these are the same:\n
+  * - the resolved path of the program, and its device, inode, size, and modification time
+  * - the arguments, including argv[0]
+  * - the current working directory (when it can't be read, the result isn't cached)
+  * - the stdin data (by length and a 64-bit hash)
+  * - the environment (by a 64-bit hash)
+  *
+  * It is only useful for programs whose output depends on nothing else, and that have no side effects that
+  * matter (a compiler's '--version' output, for example).  Only runs that exit normally are cached.\n
+  * Results are kept in memory in least-recently used order, and the oldest ones are removed to stay within
+  * 'cbMax'.  A single result that is larger than 1/8 of 'cbMax' is not kept in memory.\n
+  * With a disk store, each result is also written to a file in 'szDir', which is checked when a result is
+  * not in memory.  This can be shared by several processes.  A new version of the program replaces its
+  * old results rather than adding to them, but the files are otherwise never removed by this library.\n
+  * Calling this again changes the limit and the directory, but keeps the results that are in memory.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBRunCacheEnable(size_t cbMax, const char *szDir);
+
+/** \brief Disable the result cache, and free all of the results in memory (the disk store is left as-is)
+  *
+  * Header File:  platform_helper.h
+**/
+void WBRunCacheDisable(void);
+
+/** \brief Free all of the results in memory, without disabling the result cache (the disk store is left as-is)
+  *
+  * Header File:  platform_helper.h
+**/
+void WBRunCacheClear(void);
+
+/** \brief Get the result cache counters
+  *
+  * \param pStats A pointer to a WB_RUN_CACHE_STATS that receives the counters
+  *
+  * Header File:  platform_helper.h
+**/
+void WBRunCacheGetStats(WB_RUN_CACHE_STATS *pStats);
+
+/** \struct WB_RUN_USAGE
+  * \brief Resource usage for a process, as reported by the operating system when it exits
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_RUN_USAGE__
+{
+  WB_UINT64 ullUserTime;          ///< user-mode CPU time, in microseconds
+  WB_UINT64 ullSystemTime;        ///< kernel-mode CPU time, in microseconds
+  WB_UINT64 ullMaxRSS;            ///< maximum resident set size, in kilobytes
+  WB_UINT64 ullMinorFaults;       ///< page faults that did not require I/O
+  WB_UINT64 ullMajorFaults;       ///< page faults that required I/O
+  WB_UINT64 ullInBlocks;          ///< file system input operations (in 512-byte blocks on Linux)
+  WB_UINT64 ullOutBlocks;         ///< file system output operations (in 512-byte blocks on Linux)
+  WB_UINT64 ullVolCtxSwitches;    ///< voluntary context switches (usually waiting for I/O)
+  WB_UINT64 ullInvolCtxSwitches;  ///< involuntary context switches (pre-empted)
+} WB_RUN_USAGE;
+
+/** \brief Identical to WBGetProcessState(), and also returns the process's resource usage once it has exited
+  *
+  * \param idProcess A WB_PROCESS_ID for the running process
+  * \param pExitCode An optional pointer to a WB_INT32 to retrieve the exit code (may be NULL)
+  * \param pUsage An optional pointer to a WB_RUN_USAGE that receives the resource usage (may be NULL)
+  * \return A positive value if the process is still running, zero if the process has terminated, negative on error.
+  *
+  * The resource usage comes from 'wait4()' when the process is reaped, and is only assigned when the return value is zero.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBGetProcessStateEx(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode, WB_RUN_USAGE *pUsage);
+
+/** \brief Identical to WBWaitProcess(), and also returns the process's resource usage once it has exited
+  *
+  * The resource usage comes from 'wait4()' when the process is reaped, and is only assigned when the return value is zero.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBWaitProcessEx(WB_PROCESS_ID idProcess, WB_INT32 *pExitCode, WB_RUN_USAGE *pUsage, int nTimeout);
+
+/** \struct WB_PROCESS_STATS
+  * \brief Resource usage totals for all of the processes started with the same program name
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_PROCESS_STATS__
+{
+  WB_UINT64 ullStarted;   ///< the number of processes started
+  WB_UINT64 ullReaped;    ///< the number of processes that have exited (and are included in the totals)
+  WB_UINT64 ullFailed;    ///< the number of those that exited with a non-zero exit code
+  WB_UINT64 ullSignaled;  ///< the number of those that were terminated by a signal
+  WB_UINT64 ullWallTime;  ///< total elapsed time from starting each process until it was reaped, in microseconds
+  WB_RUN_USAGE xUsage;    ///< total resource usage ('ullMaxRSS' is the largest of them, not the total)
+} WB_PROCESS_STATS;
+
+/** \brief Callback for WBProcessStatsEnum().  Return zero to continue, or non-zero to stop (and have WBProcessStatsEnum() return it) **/
+typedef int (* WB_PROCESS_STATS_CALLBACK)(void *pUserData, const char *szProgram, const WB_PROCESS_STATS *pStats);
+
+/** \brief Enable or disable per-program resource usage totals
+  *
+  * \param bEnable Non-zero to enable the totals for processes started after this call, zero to disable them
+  * \returns The previous setting (0 or 1)
+  *
+  * When enabled, every process started by this library is counted under its program name (the last element
+  * of the path, so '/usr/bin/cc' and 'cc' are the same program).  When the process is reaped by any function
+  * in this library (WBGetProcessState(), WBWaitProcess(), the WBRunResult family, etc.) its 'wait4()' resource
+  * usage is added to the totals.  A process that is reaped some other way (such as 'waitpid()') is counted as
+  * started, but is not included in the totals.\n
+  * The cost is one short lock and hash table lookup when the process starts, and another when it is reaped, so
+  * it is cheap enough to leave enabled.  It is disabled by default.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBProcessStatsEnable(int bEnable);
+
+/** \brief Get the resource usage totals for a program
+  *
+  * \param szProgram The program name (or a path, in which case only the last element is used)
+  * \param pStats A pointer to a WB_PROCESS_STATS that receives the totals (all zeros if there are none)
+  * \returns Zero on success, or -1 if no processes have been counted for that program
+  *
+  * Header File:  platform_helper.h
+**/
+int WBProcessStatsGet(const char *szProgram, WB_PROCESS_STATS *pStats);
+
+/** \brief Call a function for the resource usage totals of each program
+  *
+  * \param pCallback The function to call for each program
+  * \param pUserData A pointer that is passed to the callback function
+  * \returns Zero, or the non-zero value returned by the callback that stopped the enumeration
+  *
+  * The callback is called with an internal lock held, so it must not start or reap processes.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBProcessStatsEnum(WB_PROCESS_STATS_CALLBACK pCallback, void *pUserData);
+
+/** \brief Set the resource usage totals for all programs to zero
+  *
+  * Processes that were started before this call, and reaped after it, are included in the new totals.
+  *
+  * Header File:  platform_helper.h
+**/
+void WBProcessStatsReset(void);
+
+/** \brief Phases that are timed when the library is built with WB_SPAWN_TRACE, see WBSpawnTraceGet() **/
+#define WB_SPAWN_PHASE_SEARCH        0 ///< locating the program (the PATH search, or its cache)
+#define WB_SPAWN_PHASE_SETUP         1 ///< duplicating (or opening) stdin, stdout and stderr, and building 'argv'
+#define WB_SPAWN_PHASE_FORK          2 ///< creating the child, until it calls 'execve' (posix_spawn and the fork server: until the parent resumes)
+#define WB_SPAWN_PHASE_EXEC          3 ///< from the child calling 'execve' until the parent resumes (vfork and clone only)
+#define WB_SPAWN_PHASE_FIRST_OUTPUT  4 ///< captured output - from the parent resuming until the first output arrives
+#define WB_SPAWN_PHASE_EXIT          5 ///< captured output - from the end of the output until the process is reaped
+#define WB_SPAWN_PHASE_TOTAL         6 ///< captured output - from creating the pipes until the process is reaped
+#define WB_SPAWN_PHASE_COUNT         7 ///< the number of phases
+
+/** \struct WB_SPAWN_PHASE_STATS
+  * \brief Latency statistics for one spawn phase, in nanoseconds, see WBSpawnTraceGet()
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_SPAWN_PHASE_STATS__
+{
+  WB_UINT64 ullCount;     ///< the number of times the phase was timed
+  WB_UINT64 ullTotal;     ///< the total time
+  WB_UINT64 ullP50;       ///< the median (within 1/8 of the actual value)
+  WB_UINT64 ullP99;       ///< the 99th percentile (within 1/8 of the actual value)
+  WB_UINT64 ullMax;       ///< the largest time
+} WB_SPAWN_PHASE_STATS;
+
+/** \brief Get the latency statistics for one phase of starting (and running) a process
+  *
+  * \param iPhase One of the WB_SPAWN_PHASE_xxx values
+  * \param pStats A pointer to a WB_SPAWN_PHASE_STATS that receives the statistics
+  * \returns Zero on success, or -1 (with 'errno' set to ENOSYS) if the library was built without WB_SPAWN_TRACE
+  *
+  * When the library is built with WB_SPAWN_TRACE, each phase is timed with the monotonic clock and added to a
+  * lock-free histogram for that phase.  Without it the timing code is not compiled at all.  The FORK and EXEC
+  * phases can only be separated for the vfork and clone backends; otherwise all of it is counted as FORK.
+  * The FIRST_OUTPUT, EXIT and TOTAL phases are only timed for the WBRunResult family (and anything else that
+  * captures output), and EXIT only when the output ends before the process has exited.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBSpawnTraceGet(int iPhase, WB_SPAWN_PHASE_STATS *pStats);
+
+/** \brief Set the spawn phase statistics to zero.  Times that are recorded during this call may be partly lost.
+  *
+  * Header File:  platform_helper.h
+**/
+void WBSpawnTraceReset(void);
+
+/** \brief Returns the name of a WB_SPAWN_PHASE_xxx value, or NULL if it isn't valid
+  *
+  * Header File:  platform_helper.h
+**/
+const char * WBSpawnTracePhaseName(int iPhase);
+
+/** \brief Format a table of the spawn phase statistics (count, mean, p50, p99 and max, in microseconds)
+  *
+  * \param pBuf The buffer that receives the table, terminated with a zero byte (may be NULL if 'cbBuf' is zero)
+  * \param cbBuf The size of 'pBuf'
+  * \returns The length of the complete table (like 'snprintf'), or -1 if the library was built without WB_SPAWN_TRACE
+  *
+  * Header File:  platform_helper.h
+**/
+int WBSpawnTraceDump(char *pBuf, size_t cbBuf);
+
+/** \struct WB_PROCESS_COMPLETION
+  * \brief A process that has exited, as returned by WBReaperGetCompletion(), WBWaitAny() and WBWaitAll()
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_PROCESS_COMPLETION__
+{
+  WB_PROCESS_ID idProcess;  ///< the process ID (no longer valid, the process has been reaped and released)
+  WB_INT32 iExitCode;       ///< the exit code if the process exited normally, or -1
+  int iSignal;              ///< the signal that terminated the process, or zero
+  int iStatus;              ///< the raw 'wait' status
+  WB_RUN_USAGE xUsage;      ///< the process's resource usage
+} WB_PROCESS_COMPLETION;
+
+/** \brief Wait until at least one of several processes exits, with an optional timeout
+  *
+  * \param paidProcess An array of 'nProcesses' process IDs.  Entries that are WB_INVALID_PROCESS_ID are ignored.
+  * \param nProcesses The number of entries in 'paidProcess'
+  * \param pCompletions An array of 'nProcesses' WB_PROCESS_COMPLETION structures.  For each process that
+  *        exited, the corresponding entry receives its status.  The 'idProcess' member of every other entry
+  *        is assigned WB_INVALID_PROCESS_ID.
+  * \param nTimeout The timeout (in microseconds), or a value < 0 to indicate 'INFINITE'.  Zero does not block.
+  * \returns The number of processes that exited (zero on timeout), or a value < 0 on error
+  *
+  * Every process is checked once without blocking.  If none of them has exited, the calling thread sleeps in
+  * 'epoll_wait()' on the pidfds of all of the processes that have one (see WBProcessUsePidFD()), so there is one
+  * wake-up when a process exits, no matter how many there are.  Processes without a pidfd are checked periodically
+  * (with an increasing interval), as WBWaitProcess() does.  More than one process may be reported.\n
+  * Each process that is reported has been reaped, and its process ID is no longer valid.  A convenient way
+  * to call this in a loop is to replace the reported entries in 'paidProcess' with WB_INVALID_PROCESS_ID.  A process
+  * that can't be waited on (it's not a child process, or it was already reaped) is reported with an
+  * 'iStatus' and 'iExitCode' of -1.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBWaitAny(const WB_PROCESS_ID *paidProcess, int nProcesses, WB_PROCESS_COMPLETION *pCompletions, int nTimeout);
+
+/** \brief Wait until all of several processes have exited, with an optional timeout
+  *
+  * \param paidProcess An array of 'nProcesses' process IDs.  Entries that are WB_INVALID_PROCESS_ID are ignored.
+  * \param nProcesses The number of entries in 'paidProcess'
+  * \param pCompletions An array of 'nProcesses' WB_PROCESS_COMPLETION structures (see WBWaitAny())
+  * \param nTimeout The timeout (in microseconds), or a value < 0 to indicate 'INFINITE'.  Zero does not block.
+  * \returns The number of processes that exited, or a value < 0 on error
+  *
+  * Identical to WBWaitAny(), except that it doesn't return until every process has exited, or the timeout
+  * expires.  On timeout, the processes that did exit are still reported (and have been reaped), so the
+  * return value is less than the number of valid entries in 'paidProcess'.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBWaitAll(const WB_PROCESS_ID *paidProcess, int nProcesses, WB_PROCESS_COMPLETION *pCompletions, int nTimeout);
+
+/** \brief WBReaperStart() flag - post each process that exits to the completion queue (see WBReaperGetCompletion()) **/
+#define WB_REAPER_COMPLETION_QUEUE 0x00000001
+
+/** \brief Start a thread that reaps tracked processes as soon as they exit
+  *
+  * \param iFlags Zero or more WB_REAPER_xxx flags
+  * \returns Zero on success (or if it's already running, in which case the flags are updated), or -1 on error
+  *
+  * This enables pidfd tracking (see WBProcessUsePidFD()) and starts one thread that sleeps in 'epoll_wait()' on
+  * the pidfds of every tracked process.  When a process exits, the thread reaps it and caches its status, so that
+  * WBGetProcessState() and WBWaitProcess() return it right away, and wakes only the threads that are waiting for
+  * that process.  No matter how many processes are running, each exit costs one wake-up.  Once the thread has
+  * reaped a process, its pidfd is removed from the epoll set and closed, as it is without the reaper, and only
+  * the cached status is kept until it has been returned (or the process is released).\n
+  * With WB_REAPER_COMPLETION_QUEUE, each process that exits is also released and posted to a queue that is read
+  * with WBReaperGetCompletion().  In that case, don't also wait for those processes with WBGetProcessState() or
+  * WBWaitProcess() (whichever gets there first gets the status).  Processes started by the WBRunResult family of
+  * functions are never posted.\n
+  * Linux only (it requires pidfds).
+  *
+  * Header File:  platform_helper.h
+**/
+int WBReaperStart(int iFlags);
+
+/** \brief Stop the reaper thread started by WBReaperStart()
+  *
+  * Any completions that have already been posted can still be read with WBReaperGetCompletion().
+  * Threads waiting in WBReaperGetCompletion() return once the queue is empty.
+  *
+  * Header File:  platform_helper.h
+**/
+void WBReaperStop(void);
+
+/** \brief Get the next process that has exited from the reaper's completion queue
+  *
+  * \param pCompletion A pointer to a WB_PROCESS_COMPLETION that receives the process ID, exit status, and resource usage
+  * \param nTimeout The timeout (in microseconds), or a value < 0 to indicate 'INFINITE'.  Zero does not block.
+  * \returns Zero if a completion was returned, a value > 0 on timeout, or a value < 0 if the completion queue is
+  * not enabled (see WBReaperStart()) and there is nothing left in it.
+  *
+  * Completions are returned in the order that the processes were reaped.  Any number of threads may call this.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBReaperGetCompletion(WB_PROCESS_COMPLETION *pCompletion, int nTimeout);
+
+/** \struct WB_RUN_LIMIT
+  * \brief A resource limit that is applied to a process (via 'setrlimit') before it runs the program
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_RUN_LIMIT__
+{
+  int iResource;          ///< the resource, one of the RLIMIT_xxx constants from <sys/resource.h>
+  WB_UINT64 ullSoft;      ///< the soft limit, or WB_RUN_LIMIT_INFINITY
+  WB_UINT64 ullHard;      ///< the hard limit, or WB_RUN_LIMIT_INFINITY
+} WB_RUN_LIMIT;
+
+/** \brief WB_RUN_LIMIT value for 'no limit' (RLIM_INFINITY) **/
+#define WB_RUN_LIMIT_INFINITY (~(WB_UINT64)0)
+
+/** \brief The maximum number of WB_RUN_LIMIT entries in a WB_RUN_OPTIONS structure **/
+#define WB_RUN_MAX_LIMITS 16
+
+/** \brief The maximum number of entries in a WB_RUN_OPTIONS 'pKeepFDs' array **/
+#define WB_RUN_MAX_KEEP_FDS 16
+
+/** \struct WB_RUN_OPTIONS
+  * \brief Options for WBRunResultEx() and related functions
+  *
+  * Zero-initialize this structure (using 'memset' or '= { 0 }') and assign only the members you need.
+  * A NULL WB_RUN_OPTIONS pointer is the same as one that is all zeros.
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_RUN_OPTIONS__
+{
+  const void *pStdin;       ///< data to write to the process's stdin (may contain zero bytes), or NULL for /dev/null
+  size_t cbStdin;           ///< the number of bytes in 'pStdin'
+  char * const *envp;       ///< the environment for the process ('NAME=VALUE' strings), or NULL for the caller's environment
+  int iFlags;               ///< zero or more WB_RUN_OPTION_xxx flags
+  WB_UINT64 ullWallTimeLimit; ///< elapsed time limit in microseconds, or zero for none
+  WB_UINT64 ullCPUTimeLimit;  ///< CPU time limit (user + system) in microseconds, or zero for none
+  const WB_RUN_LIMIT *pLimits; ///< resource limits applied to the process before it runs the program, or NULL
+  int nLimits;              ///< the number of entries in 'pLimits' (at most WB_RUN_MAX_LIMITS)
+  const char *szCgroup;     ///< a cgroup (v2) directory that the process is placed in before it runs the program, or NULL
+  WB_FILE_HANDLE hStdoutFile; ///< with WB_RUN_OPTION_STDOUT_FILE, the file that stdout is written to (at its current offset)
+  WB_FILE_HANDLE hStdoutTee;  ///< with WB_RUN_OPTION_STDOUT_TEE, a copy of stdout is also written here
+  const WB_FILE_HANDLE *pKeepFDs; ///< descriptors (other than stdin/stdout/stderr) that the process inherits, or NULL
+  int nKeepFDs;             ///< the number of entries in 'pKeepFDs' (at most WB_RUN_MAX_KEEP_FDS)
+  size_t cbHead;            ///< with WB_RUN_OPTION_STDOUT_TAIL or _STDERR_TAIL, the number of bytes to keep from the start of the output
+  size_t cbTail;            ///< with WB_RUN_OPTION_STDOUT_TAIL or _STDERR_TAIL, the number of bytes to keep from the end of the output
+  WB_UINT64 ullKillGrace;   ///< when the process has to be terminated, the time (in microseconds) from SIGTERM to SIGKILL, or zero for SIGKILL right away
+  WB_EXECUTABLE *pExecutable; ///< run this program (see WBExecutableOpen()) instead of locating the application, or NULL.  The application name is still argv[0]
+} WB_RUN_OPTIONS;
+
+/** \brief WB_RUN_OPTIONS flag - send stderr to /dev/null instead of capturing it **/
+#define WB_RUN_OPTION_DISCARD_STDERR 0x00000001
+/** \brief WB_RUN_OPTIONS flag - capture stdout into an anonymous memory file ('memfd'), returned as a read-only mapping **/
+#define WB_RUN_OPTION_STDOUT_MMAP    0x00000002
+/** \brief WB_RUN_OPTIONS flag - capture stdout into 'hStdoutFile', returned as a read-only mapping of what was written **/
+#define WB_RUN_OPTION_STDOUT_FILE    0x00000004
+/** \brief WB_RUN_OPTIONS flag - also write a copy of stdout to 'hStdoutTee' (using 'tee()' when it's a pipe) **/
+#define WB_RUN_OPTION_STDOUT_TEE     0x00000008
+/** \brief WB_RUN_OPTIONS flag - keep only the first 'cbHead' and the last 'cbTail' bytes of stdout **/
+#define WB_RUN_OPTION_STDOUT_TAIL    0x00000010
+/** \brief WB_RUN_OPTIONS flag - keep only the first 'cbHead' and the last 'cbTail' bytes of stderr **/
+#define WB_RUN_OPTION_STDERR_TAIL    0x00000020
+/** \brief WB_RUN_OPTIONS flag - when the process is terminated, also terminate its descendants and its session (see WB_TERMINATE_TREE) **/
+#define WB_RUN_OPTION_KILL_TREE      0x00000040
+/** \brief WB_RUN_OPTIONS flag - when the process exits, terminate anything left in its session, so that it can't hold stdout or stderr open **/
+#define WB_RUN_OPTION_KILL_ORPHANS   0x00000080
+/** \brief WB_RUN_OPTIONS flag - build an index of the lines in stdout as it's captured (see 'paStdoutLines' in WB_RUN_RESULT) **/
+#define WB_RUN_OPTION_LINE_INDEX     0x00000100
+
+/** \brief WB_RUN_RESULT 'iLimitHit' value - no limit was reached **/
+#define WB_RUN_LIMIT_HIT_NONE     0
+/** \brief WB_RUN_RESULT 'iLimitHit' value - the process was killed when 'ullWallTimeLimit' expired **/
+#define WB_RUN_LIMIT_HIT_WALLTIME 1
+/** \brief WB_RUN_RESULT 'iLimitHit' value - the process was killed when it used 'ullCPUTimeLimit' of CPU time **/
+#define WB_RUN_LIMIT_HIT_CPUTIME  2
+/** \brief WB_RUN_RESULT 'iLimitHit' value - the process was terminated by SIGXCPU or SIGXFSZ from one of 'pLimits' **/
+#define WB_RUN_LIMIT_HIT_RLIMIT   3
+
+/** \struct WB_RUN_LINE
+  * \brief The location of one line in a buffer, see WB_RUN_OPTION_LINE_INDEX and WBRunLineIndex()
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_RUN_LINE__
+{
+  size_t cbOffset;        ///< the offset of the start of the line
+  size_t cbLength;        ///< the length of the line, not including the newline
+} WB_RUN_LINE;
+
+/** \struct WB_RUN_RESULT
+  * \brief The results from WBRunResultEx() and related functions.  Free it with WBRunResultFree().
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_RUN_RESULT__
+{
+  char *pStdout;          ///< captured stdout (zero byte terminated), allocated via WBAlloc(), or a read-only view (see 'pStdoutMap')
+  size_t cbStdout;        ///< number of bytes in 'pStdout', not counting the terminating zero byte
+  char *pStderr;          ///< captured stderr (zero byte terminated), or NULL if it was discarded
+  size_t cbStderr;        ///< number of bytes in 'pStderr', not counting the terminating zero byte
+  int bStatusValid;       ///< non-zero if the exit status is known (it's lost when SIGCHLD is being ignored)
+  WB_INT32 iExitCode;     ///< the exit code if the process exited normally, or -1
+  int iSignal;            ///< the signal that terminated the process, or zero
+  int iStatus;            ///< the raw 'wait' status
+  WB_UINT64 ullWallTime;  ///< the elapsed time from starting the process until it exited, in microseconds
+  WB_RUN_USAGE xUsage;    ///< the process's resource usage (valid when 'bStatusValid' is non-zero)
+  int iLimitHit;          ///< WB_RUN_LIMIT_HIT_xxx - which limit (if any) ended the process
+  void *pStdoutMap;       ///< with WB_RUN_OPTION_STDOUT_MMAP or _FILE, the mapping that 'pStdout' points into, or NULL
+  size_t cbStdoutMap;     ///< the size of the 'pStdoutMap' mapping
+  WB_UINT64 ullStdoutTotal; ///< the total number of bytes the process wrote to stdout
+  WB_UINT64 ullStdoutLines; ///< the number of newline characters the process wrote to stdout
+  size_t cbStdoutHead;    ///< with WB_RUN_OPTION_STDOUT_TAIL, the number of bytes at the start of 'pStdout' that are the head
+  WB_UINT64 ullStderrTotal; ///< the total number of bytes the process wrote to stderr (zero if it was discarded)
+  WB_UINT64 ullStderrLines; ///< the number of newline characters the process wrote to stderr
+  size_t cbStderrHead;    ///< with WB_RUN_OPTION_STDERR_TAIL, the number of bytes at the start of 'pStderr' that are the head
+  WB_TERMINATE_REPORT xTerminated; ///< the processes that were signaled when the process was terminated, or its orphans were
+  WB_RUN_LINE *paStdoutLines; ///< with WB_RUN_OPTION_LINE_INDEX, the location of each line in 'pStdout', or NULL if there are none
+  size_t nStdoutLines;    ///< the number of entries in 'paStdoutLines'
+  WB_UINT64 ullStdoutTeeLost; ///< with WB_RUN_OPTION_STDOUT_TEE, the number of bytes that could not be copied to 'hStdoutTee'
+} WB_RUN_RESULT;
+
+/** \brief Run an application synchronously, capturing stdout and stderr separately, with structured results
+  *
+  * \param pResult A pointer to a WB_RUN_RESULT that receives the results.  Free it with WBRunResultFree()
+  * \param pOptions A pointer to a WB_RUN_OPTIONS structure, or NULL for default options
+  * \param szAppName A const pointer to a character string containing the path to the application
+  * \returns Zero if the process ran (regardless of its exit code), or -1 on error
+  *
+  * stdout and stderr are connected to separate pipes that are read by a single 'poll()' loop, so
+  * neither one can block the process while the other is being read.  The result includes both of
+  * the buffers and their lengths, the exit code or terminating signal, the elapsed time, and the
+  * process's resource usage.\n
+  * When 'pOptions' has a wall time or CPU time limit and the process reaches it, the process (and
+  * its process group) is terminated, and the result holds whatever output was captured,
+  * with 'iLimitHit' indicating which limit was reached.  The same happens when the capture fails.
+  * Termination works like WBTerminateProcessTree(), with 'ullKillGrace' as the grace period, and
+  * WB_RUN_OPTION_KILL_TREE for WB_TERMINATE_TREE.  'xTerminated' lists what was signaled.\n
+  * With WB_RUN_OPTION_KILL_ORPHANS, when the process exits while stdout or stderr is still open,
+  * anything left in its session is terminated the same way.  Otherwise a background grandchild that
+  * inherited one of them keeps the capture waiting until it exits.  Resource limits and the cgroup are applied
+  * by the child process itself, just before it runs the program.  If that fails, the program is not
+  * run, and this function returns -1 (or with the 'vfork' backend, the exit code is 127).\n
+  * With WB_RUN_OPTION_STDOUT_MMAP or WB_RUN_OPTION_STDOUT_FILE, stdout is moved from the pipe into a
+  * file using 'splice()', so that it is never copied into a growing buffer.  'pStdout' then points
+  * into a read-only mapping of the file, it is NOT zero byte terminated, and it is NULL when there was
+  * no output.  A file passed in 'hStdoutFile' must be open for reading and writing.  It still belongs
+  * to the caller, its offset is advanced past the output, and it must not be truncated while the
+  * mapping exists.\n
+  * With WB_RUN_OPTION_STDOUT_TAIL (or WB_RUN_OPTION_STDERR_TAIL) only the first 'cbHead' bytes and
+  * the last 'cbTail' bytes are kept, in a single allocation that never grows, however much the
+  * process writes.  'pStdout' holds the head ('cbStdoutHead' bytes) followed immediately by the
+  * tail.  When 'ullStdoutTotal' is larger than 'cbStdout', the bytes in between were dropped.  The
+  * byte and line counts are kept for every capture.  This is ignored for stdout when
+  * WB_RUN_OPTION_STDOUT_MMAP or WB_RUN_OPTION_STDOUT_FILE is also specified.\n
+  * The process inherits stdin, stdout and stderr, and nothing else.  Every other descriptor is
+  * closed before the program runs, except for the ones listed in 'pKeepFDs', which keep their
+  * numbers.  When 'pKeepFDs' is used, the process is started directly, not by the fork server.\n
+  * With WB_RUN_OPTION_STDOUT_TEE, everything captured from stdout is also written to 'hStdoutTee'.
+  * When that is a pipe, the data is duplicated with 'tee()' without being copied.  Writing to it
+  * blocks (like 'tee(1)'), so a slow reader throttles the process.  That's also true when it's
+  * non-blocking, in which case it's waited on with 'poll()' whenever it's full.  If it can't be
+  * written (for example, the reader closed it) no more copies are made, the capture continues, and
+  * 'ullStdoutTeeLost' is the number of bytes that were not copied.\n
+  * With WB_RUN_OPTION_LINE_INDEX, 'paStdoutLines' locates each line in 'pStdout', so the caller doesn't have to
+  * search for the newlines again.  The index is built as each block of data arrives, by the same scan that counts
+  * the lines (which looks at 64 bytes at a time, using SSE2 where it's available).  A final line without a newline
+  * is included, so 'nStdoutLines' can be one more than 'ullStdoutLines'.  The lines are not copied, and they are not
+  * zero byte terminated.  With WB_RUN_OPTION_STDOUT_MMAP or _FILE, the index is built from the mapping after the
+  * process exits.  It is not built with WB_RUN_OPTION_STDOUT_TAIL (the data isn't contiguous).\n
+  * Each additional parameter passed to this function will become a parameter that is to be passed to the program.
+  * The final parameter in the list must be NULL.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBRunResultEx(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions, const char *szAppName, ...);
+
+/** \brief Identical to WBRunResultEx(), except that the program's parameters are passed as a va_list
+  *
+  * Header File:  platform_helper.h
+**/
+int WBRunResultExV(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions, const char *szAppName, va_list va);
+
+/** \brief Identical to WBRunResultEx(), except that the arguments are passed as a complete 'argv' array
+  *
+  * 'szAppName' may be NULL, in which case argv[0] is used.  See WBRunAsyncPipeArgv().
+  *
+  * Header File:  platform_helper.h
+**/
+int WBRunResultExArgv(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions, const char *szAppName,
+                      char * const *argv);
+
+/** \brief The maximum number of stages in a WBRunPipeline() pipeline **/
+#define WB_RUN_MAX_STAGES 64
+
+/** \struct WB_RUN_STAGE_RESULT
+  * \brief The exit status of one stage of a pipeline run by WBRunPipeline()
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_RUN_STAGE_RESULT__
+{
+  int bStatusValid;       ///< non-zero if the exit status is known (zero if the stage could not be started)
+  WB_INT32 iExitCode;     ///< the exit code if the stage exited normally, or -1
+  int iSignal;            ///< the signal that terminated the stage, or zero
+  int iStatus;            ///< the raw 'wait' status
+  WB_RUN_USAGE xUsage;    ///< the stage's resource usage (valid when 'bStatusValid' is non-zero)
+} WB_RUN_STAGE_RESULT;
+
+/** \brief Run a pipeline of programs (like 'A | B | C' in a shell, without a shell), capturing the output of the last one
+  *
+  * \param pResult A pointer to a WB_RUN_RESULT that receives the results.  Free it with WBRunResultFree()
+  * \param pOptions A pointer to a WB_RUN_OPTIONS structure, or NULL for default options
+  * \param papArgv An array of 'nStages' NULL-terminated argument vectors.  Element [0] of each
+  *        vector is the application name (which is searched for in PATH); the rest are its parameters
+  * \param nStages The number of stages in 'papArgv' (from 1 to WB_RUN_MAX_STAGES)
+  * \param pStages An array of 'nStages' WB_RUN_STAGE_RESULT structures that receives each stage's exit status, or NULL
+  * \returns Zero if the pipeline ran (regardless of the exit codes), or -1 on error
+  *
+  * Each stage's stdout is connected to the next stage's stdin with a pipe.  The first stage reads
+  * the 'pStdin' data from 'pOptions' (or /dev/null), and the last stage's stdout is captured in
+  * 'pResult', exactly as it is by WBRunResultEx() (including WB_RUN_OPTION_STDOUT_MMAP and the other
+  * stdout options).  The stderr of every stage is captured together, in 'pResult'.\n
+  * The exit status, elapsed time and limits in 'pResult' apply to the last stage.  'pStages' has the
+  * exit status of every stage, so (for example) the equivalent of 'pipefail' is the last non-zero
+  * exit code in it.  When the last stage is killed because it reached a limit, the other stages are
+  * killed as well.  The function returns once every stage has exited.\n
+  * Resource limits and the cgroup in 'pOptions' apply to every stage.  The CPU time limit is only
+  * checked for the last stage.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBRunPipeline(WB_RUN_RESULT *pResult, const WB_RUN_OPTIONS *pOptions,
+                  const char * const * const *papArgv, int nStages, WB_RUN_STAGE_RESULT *pStages);
+
+/** \brief Free the buffers (and unmap the stdout view) in a WB_RUN_RESULT (the structure itself belongs to the caller)
+  *
+  * Header File:  platform_helper.h
+**/
+void WBRunResultFree(WB_RUN_RESULT *pResult);
+
+/** \brief Build an index of the lines in a buffer, such as the output from WBRunResult()
+  *
+  * \param pData A const pointer to the data (it may contain zero bytes)
+  * \param cbData The size of the data, in bytes
+  * \param pnLines A pointer to a size_t that receives the number of lines
+  * \returns A WBAlloc() array of WB_RUN_LINE, one for each line, or NULL on error.  It must be 'free'd using WBFree().
+  *
+  * This uses the same scan as WB_RUN_OPTION_LINE_INDEX.  A final line without a newline is included.
+  *
+  * Header File:  platform_helper.h
+**/
+WB_RUN_LINE * WBRunLineIndex(const char *pData, size_t cbData, size_t *pnLines);
+
+/** \struct WB_ARG_ARENA
+  * \brief A re-usable block of memory for building 'argv' arrays
+  *
+  * Initialize with WBArgArenaInit(), add arguments with WBArgArenaAdd(), and get the 'argv' array with
+  * WBArgArenaArgv().  WBArgArenaReset() removes arguments while keeping the memory, so that a command
+  * 'template' (the arguments that never change) can be built once and the rest added for each invocation
+  * without any heap allocation once the arena is large enough.  Free it with WBArgArenaFree().\n
+  * An arena must not be used by more than one thread at a time.
+  *
+  * Header File:  platform_helper.h
+**/
+typedef struct __WB_ARG_ARENA__
+{
+  char *pBuf;         ///< storage for the argument strings
+  size_t cbBuf;       ///< allocated size of 'pBuf'
+  size_t cbUsed;      ///< number of bytes of 'pBuf' in use
+  size_t *pOffsets;   ///< the offset of each argument within 'pBuf'
+  char **ppArgv;      ///< the array returned by WBArgArenaArgv()
+  int nArgs;          ///< the number of arguments
+  int nMax;           ///< the allocated size of 'pOffsets' and 'ppArgv'
+} WB_ARG_ARENA;
+
+/** \brief Initialize a WB_ARG_ARENA (no memory is allocated until it's needed)
+  *
+  * Header File:  platform_helper.h
+**/
+void WBArgArenaInit(WB_ARG_ARENA *pArena);
+
+/** \brief Free the memory that belongs to a WB_ARG_ARENA
+  *
+  * Header File:  platform_helper.h
+**/
+void WBArgArenaFree(WB_ARG_ARENA *pArena);
+
+/** \brief Remove all but the first 'nKeep' arguments from a WB_ARG_ARENA, keeping its memory for re-use
+  *
+  * Header File:  platform_helper.h
+**/
+void WBArgArenaReset(WB_ARG_ARENA *pArena, int nKeep);
+
+/** \brief Add an argument to a WB_ARG_ARENA, returning 0 on success or -1 if memory could not be allocated
+  *
+  * Header File:  platform_helper.h
+**/
+int WBArgArenaAdd(WB_ARG_ARENA *pArena, const char *szArg);
+
+/** \brief Return the NULL-terminated 'argv' array for a WB_ARG_ARENA, or NULL on error
+  *
+  * The array remains valid until the next call to any of the WBArgArena functions for this arena.
+  *
+  * Header File:  platform_helper.h
+**/
+char * const * WBArgArenaArgv(WB_ARG_ARENA *pArena);
+
+/** \brief An opaque, reference-counted, read-only copy of an environment (see WBEnvSnapshot())
+**/
+typedef struct __WB_ENV_SNAPSHOT__ WB_ENV_SNAPSHOT;
+
+/** \brief Get a snapshot of the current environment
+  *
+  * \returns A WB_ENV_SNAPSHOT pointer, or NULL on error.  Release it with WBEnvSnapshotRelease().
+  *
+  * The snapshot is cached, and the same one is returned (with another reference) until the contents
+  * of 'environ' change, as they do after 'setenv()', 'unsetenv()', or 'putenv()'.  A snapshot is never
+  * modified, so it can be shared between threads and used for any number of processes.\n
+  * NOTE:  modifying a string that was passed to 'putenv()' in place is not detected.
+  *
+  * Header File:  platform_helper.h
+**/
+WB_ENV_SNAPSHOT * WBEnvSnapshot(void);
+
+/** \brief Create a new environment snapshot from an existing one, with some variables overridden
+  *
+  * \param pBase The snapshot to start with, or NULL for the current environment
+  * \param ppVars A NULL-terminated array of strings.  'NAME=VALUE' assigns a variable, and 'NAME' (without '=') removes it.
+  * \returns A new WB_ENV_SNAPSHOT pointer, or NULL on error.  Release it with WBEnvSnapshotRelease().
+  *
+  * Header File:  platform_helper.h
+**/
+WB_ENV_SNAPSHOT * WBEnvSnapshotOverride(WB_ENV_SNAPSHOT *pBase, const char * const *ppVars);
+
+/** \brief Return the NULL-terminated 'envp' array for a WB_ENV_SNAPSHOT, suitable for WBRunAsyncPipeArgv()
+  *
+  * Header File:  platform_helper.h
+**/
+char * const * WBEnvSnapshotEnvp(const WB_ENV_SNAPSHOT *pEnv);
+
+/** \brief Add a reference to a WB_ENV_SNAPSHOT, returning 'pEnv'
+  *
+  * Header File:  platform_helper.h
+**/
+WB_ENV_SNAPSHOT * WBEnvSnapshotAddRef(WB_ENV_SNAPSHOT *pEnv);
+
+/** \brief Release a reference to a WB_ENV_SNAPSHOT, freeing it when the last one is released
+  *
+  * Header File:  platform_helper.h
+**/
+void WBEnvSnapshotRelease(WB_ENV_SNAPSHOT *pEnv);
+
+
+/** \brief Spawn 'backend' identifiers, for use with WBSetSpawnBackend()
+  *
+  * These values select the method that WBRunAsyncPipeV() (and everything built on it) uses to
+  * create the child process.  The 'vfork' method is always available, and is used as a fallback
+  * whenever one of the other methods is not supported by the operating system or C library.
+**/
+enum WB_SPAWN_BACKEND
+{
+  WB_SPAWN_BACKEND_DEFAULT     = 0, ///< use the best method available (posix_spawn, then clone, then vfork)
+  WB_SPAWN_BACKEND_VFORK       = 1, ///< 'vfork()' followed by dup2, setsid, and execve in the child (the original method)
+  WB_SPAWN_BACKEND_POSIX_SPAWN = 2, ///< 'posix_spawn()' using file actions and POSIX_SPAWN_SETSID
+  WB_SPAWN_BACKEND_CLONE       = 3  ///< (Linux only) 'clone()' with CLONE_VM|CLONE_VFORK on a small dedicated stack
+};
+
+/** \brief Select the spawn backend used by WBRunAsyncPipeV() and the functions that depend on it
+  *
+  * \param iBackend One of the WB_SPAWN_BACKEND values
+  * \returns The previously selected backend, or a negative value if 'iBackend' is not supported on this platform
+  *
+  * Use this function to choose (at run-time) the method by which child processes are created.  The
+  * default, WB_SPAWN_BACKEND_DEFAULT, picks 'posix_spawn()' when POSIX_SPAWN_SETSID is available, then
+  * 'clone()' on Linux, and finally 'vfork()'.  Large multi-threaded processes generally benefit from
+  * 'posix_spawn()' or 'clone()' since neither of them duplicates the page tables of the parent.\n
+  * If the selected backend fails at run-time because it is not supported by the kernel, the 'vfork()'
+  * method is used instead.  The setting applies to the entire process.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBSetSpawnBackend(int iBackend);
+
+/** \brief Return the spawn backend that was selected via WBSetSpawnBackend()
+  *
+  * \returns One of the WB_SPAWN_BACKEND values
+  *
+  * Header File:  platform_helper.h
+**/
+int WBGetSpawnBackend(void);
+
+/** \brief Start the fork server, a small helper process that spawns processes on behalf of the caller
+  *
+  * \returns 0 on success (or if the fork server is already running), or -1 on error
+  *
+  * Spawning a process from a very large parent has a cost that grows with the size of the parent,
+  * even with 'vfork()' or 'posix_spawn()'.  The fork server is a copy of the caller made by 'fork()'
+  * at the time this function is called, so it should be called early, while the process is still
+  * small and before any other threads have been created.  From then on, WBRunAsyncPipeV() and every
+  * function that depends on it (WBRunAsync, WBRunResult, etc.) send their requests to the fork server
+  * through a Unix socket, passing the stdin/stdout/stderr handles along with it, and the fork server
+  * reports the process ID and (later) the exit status.  Spawn latency then no longer depends on the
+  * size of the caller.\n
+  * Each request carries the caller's current working directory (as a descriptor), umask, signal mask and ignored
+  * signals, so processes start the same way they would without the fork server, even after a 'chdir()' or 'umask()'.
+  * Every other signal is SIG_DFL in the child.  The umask and ignored signals are read from /proc/self/status; if
+  * that isn't possible (or the working directory can't be opened) the process is spawned directly instead.\n
+  * The fork server is not the parent of the processes it starts, so they are always tracked in the
+  * process table (see WBProcessUsePidFD()).  Their exit status must be obtained via WBGetProcessState()
+  * or WBWaitProcess(), or the process released via WBReleaseProcess(); 'waitpid()' will not work.
+  * WBGetProcessFD() returns a handle that becomes readable when the process exits, as it does for a pidfd.\n
+  * If the fork server goes away, processes are spawned directly as before.
+  *
+  * Header File:  platform_helper.h
+**/
+int WBForkServerStart(void);
+
+/** \brief Stop using the fork server
+  *
+  * Closes the connection to the fork server.  The fork server exits once all of the processes
+  * that it started have exited, and their exit status is still reported to the caller.
+  * Processes started after this are spawned directly.
+  *
+  * Header File:  platform_helper.h
+**/
+void WBForkServerStop(void);
+
 
 
 /** \brief Loads a shared library, DLL, module, or whatever you call it on your operating system
@@ -738,7 +1951,9 @@ int WBCondCreate(WB_COND *pCond);
   * \param pMtx A pointer to the WB_MUTEX that will be created (could be a struct or just a pointer)
   * \returns A zero value if successful; non-zero on error
   *
-  * Use this function to create a 'mutex' synchronization object that can be locked by only a single thread at a time
+  * Use this function to create a 'mutex' synchronization object that can be locked by only a single thread at a time\n
+  * On Linux this is a futex, which only enters the kernel when a thread has to wait.  It can only be used within a
+  * single process (not in shared memory).
   *
   * Header File:  platform_helper.h
 **/
@@ -795,7 +2010,8 @@ int WBMutexUnlock(WB_MUTEX *pMtx);
   * \returns A zero if the signal succeeded, or non-zero on error
   *
   * This function signals a condition so that a waiting process will 'wake up'
-  * see WBCondWait() and WBCondWaitMutex()
+  * see WBCondWait() and WBCondWaitMutex().  At least one waiting thread wakes up (occasionally more than one,
+  * so check whatever was signaled).  When nobody is waiting, this does not enter the kernel.
   *
   * Header File:  platform_helper.h
 **/
@@ -0,0 +1,221 @@
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//     batch_bench.c - WBRunBatch compared with running commands one by one //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//          Copyright (c) 2019 by S.F.T. Inc. - All rights reserved         //
+//  Use, copying, and distribution of this software are licensed according  //
+//    to the GPLv2, LGPLv2, or BSD license, as appropriate (see COPYING)    //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+
+// build:  cc -O2 -I.. -o batch_bench batch_bench.c ../ForkMe.c -lpthread
+// usage:  batch_bench [count [concurrency ...]]
+//
+// Runs 'echo' and 'true' 'count' times each, first one at a time with WBRunResultArgv() (the same
+// capture engine, so the only difference is the concurrency), then with WBRunBatch() at its default
+// concurrency (the number of online processors) and at 1, 2, 4, 8 and 16, unless values are given.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "ForkMe.h"
+
+#define WBFree(X) free(X) /* as defined in ForkMe.c */
+
+void error_message(const char *szFormat, ...) // ForkMe.c expects the application to supply these
+{
+va_list va;
+
+  va_start(va, szFormat);
+  vfprintf(stderr, szFormat, va);
+  va_end(va);
+}
+
+void warning_message(const char *szFormat, ...)
+{
+va_list va;
+
+  va_start(va, szFormat);
+  vfprintf(stderr, szFormat, va);
+  va_end(va);
+}
+
+static double BenchTime(void) // microseconds
+{
+struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void BenchReport(const char *szCommand, const char *szMode, double dElapsed, int nCount,
+                        double dBaseline)
+{
+  printf("%-6s %-14s %12.1f %12.1f %8.2fx\n", szCommand, szMode, dElapsed / 1000.0,
+         dElapsed / nCount, dBaseline / dElapsed);
+  fflush(stdout);
+}
+
+static double BenchSequential(const char * const *pArgv, int nCount)
+{
+double dStart;
+WB_INT32 iExit;
+char *pOutput;
+int i1;
+
+
+  dStart = BenchTime();
+
+  for(i1=0; i1 < nCount; i1++)
+  {
+    pOutput = WBRunResultArgv(&iExit, NULL, (char * const *)pArgv, NULL);
+
+    if(!pOutput || iExit)
+    {
+      fprintf(stderr, "%s:  failed\n", pArgv[0]);
+      WBFree(pOutput);
+      return -1;
+    }
+
+    WBFree(pOutput);
+  }
+
+  return BenchTime() - dStart;
+}
+
+static double BenchBatch(const char * const * const *papArgv, int nCount, int nConcurrency)
+{
+WB_RUN_BATCH_RESULT *pResults;
+double dElapsed;
+int i1, nRan;
+
+
+  pResults = (WB_RUN_BATCH_RESULT *)malloc(nCount * sizeof(*pResults));
+
+  if(!pResults)
+  {
+    return -1;
+  }
+
+  dElapsed = BenchTime();
+
+  nRan = WBRunBatch(papArgv, nCount, nConcurrency, 0, pResults);
+
+  dElapsed = BenchTime() - dElapsed;
+
+  for(i1=0; i1 < nCount; i1++)
+  {
+    if(pResults[i1].pOutput)
+    {
+      WBFree(pResults[i1].pOutput);
+    }
+    else
+    {
+      nRan = -1;
+    }
+
+    if(pResults[i1].iExitCode)
+    {
+      nRan = -1;
+    }
+  }
+
+  free(pResults);
+
+  if(nRan != nCount)
+  {
+    fprintf(stderr, "%s:  batch failed\n", papArgv[0][0]);
+    return -1;
+  }
+
+  return dElapsed;
+}
+
+int main(int argc, char *argv[])
+{
+static const char * const aEcho[] = { "echo", "hello, world", NULL };
+static const char * const aTrue[] = { "true", NULL };
+static const char * const * const aCommands[] = { aEcho, aTrue };
+static const int aDefaultConcurrency[] = { 0, 1, 2, 4, 8, 16 };
+const char * const **papArgv;
+int i1, i2, i3, nCount, nLevels, *paConcurrency;
+double dBaseline, dElapsed;
+char szMode[32];
+
+
+  nCount = argc > 1 ? atoi(argv[1]) : 500;
+  nLevels = argc > 2 ? argc - 2 : (int)(sizeof(aDefaultConcurrency) / sizeof(aDefaultConcurrency[0]));
+
+  if(nCount <= 0)
+  {
+    fprintf(stderr, "usage:  %s [count [concurrency ...]]\n", argv[0]);
+    return 1;
+  }
+
+  paConcurrency = (int *)malloc(nLevels * sizeof(int));
+  papArgv = (const char * const **)malloc(nCount * sizeof(*papArgv));
+
+  if(!paConcurrency || !papArgv)
+  {
+    free(paConcurrency);
+    free(papArgv);
+    return 1;
+  }
+
+  for(i1=0; i1 < nLevels; i1++)
+  {
+    paConcurrency[i1] = argc > 2 ? atoi(argv[i1 + 2]) : aDefaultConcurrency[i1];
+  }
+
+  printf("%d commands per row\n\n", nCount);
+  printf("%-6s %-14s %12s %12s %9s\n", "cmd", "mode", "total msec", "usec/cmd", "speedup");
+
+  for(i1=0; i1 < (int)(sizeof(aCommands) / sizeof(aCommands[0])); i1++)
+  {
+    for(i2=0; i2 < nCount; i2++)
+    {
+      papArgv[i2] = aCommands[i1];
+    }
+
+    dBaseline = BenchSequential(aCommands[i1], nCount);
+
+    if(dBaseline <= 0)
+    {
+      continue;
+    }
+
+    BenchReport(aCommands[i1][0], "sequential", dBaseline, nCount, dBaseline);
+
+    for(i3=0; i3 < nLevels; i3++)
+    {
+      if(paConcurrency[i3] > 0)
+      {
+        snprintf(szMode, sizeof(szMode), "batch %d", paConcurrency[i3]);
+      }
+      else
+      {
+        snprintf(szMode, sizeof(szMode), "batch default");
+      }
+
+      dElapsed = BenchBatch(papArgv, nCount, paConcurrency[i3]);
+
+      if(dElapsed > 0)
+      {
+        BenchReport(aCommands[i1][0], szMode, dElapsed, nCount, dBaseline);
+      }
+    }
+
+    printf("\n");
+  }
+
+  free(papArgv);
+  free(paConcurrency);
+
+  return 0;
+}
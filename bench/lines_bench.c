@@ -0,0 +1,370 @@
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//     lines_bench.c - WBRunLineIndex compared with memchr/strchr/strtok    //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//          Copyright (c) 2019 by S.F.T. Inc. - All rights reserved         //
+//  Use, copying, and distribution of this software are licensed according  //
+//    to the GPLv2, LGPLv2, or BSD license, as appropriate (see COPYING)    //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+
+// build:  cc -O2 -I.. -o lines_bench lines_bench.c ../ForkMe.c -lpthread
+// usage:  lines_bench [MB]
+//
+// Builds a buffer (100 MB by default) of short lines (0 to 15 bytes), long lines (200 to 2000 bytes)
+// and a mix of the two (one long line in ten), then for each of them:
+//   split   - WBRunLineIndex(), a 'memchr' loop, a 'strchr' loop and 'strtok', each building the same
+//             array of WB_RUN_LINE (strtok skips empty lines, so its count is lower)
+//   capture - 'cat' the buffer with WBRunResultEx() and WB_RUN_OPTION_LINE_INDEX, and without it
+//             followed by a 'memchr' split of the output
+// Each time is the best of 3.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ForkMe.h"
+
+#define WBFree(X) free(X) /* as defined in ForkMe.c */
+
+#define BENCH_REPEAT 3
+
+void error_message(const char *szFormat, ...) // ForkMe.c expects the application to supply these
+{
+va_list va;
+
+  va_start(va, szFormat);
+  vfprintf(stderr, szFormat, va);
+  va_end(va);
+}
+
+void warning_message(const char *szFormat, ...)
+{
+va_list va;
+
+  va_start(va, szFormat);
+  vfprintf(stderr, szFormat, va);
+  va_end(va);
+}
+
+static double BenchTime(void) // microseconds
+{
+struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// fill 'pBuf' with lines.  one line in 'nLongEvery' is long (zero for none), the rest are short.
+
+static void BenchFill(char *pBuf, size_t cbBuf, int nLongEvery, int bShort)
+{
+size_t cbPos, cbLine;
+unsigned int uiSeed = 12345;
+int nLine;
+
+
+  for(cbPos=0, nLine=0; cbPos < cbBuf; cbPos += cbLine + 1, nLine++)
+  {
+    uiSeed = uiSeed * 1103515245 + 12345;
+
+    if(!bShort || (nLongEvery && !(nLine % nLongEvery)))
+    {
+      cbLine = 200 + (uiSeed >> 8) % 1801;
+    }
+    else
+    {
+      cbLine = (uiSeed >> 8) % 16;
+    }
+
+    if(cbPos + cbLine >= cbBuf)
+    {
+      cbLine = cbBuf - cbPos - 1;
+    }
+
+    memset(pBuf + cbPos, 'a' + (nLine % 26), cbLine);
+    pBuf[cbPos + cbLine] = '\n';
+  }
+}
+
+// add a line to a growing array, the way a caller splitting the output would
+
+static int BenchAdd(WB_RUN_LINE **ppaLines, size_t *pnLines, size_t *pnMax, size_t cbOffset, size_t cbLength)
+{
+WB_RUN_LINE *paNew;
+
+
+  if(*pnLines >= *pnMax)
+  {
+    paNew = (WB_RUN_LINE *)realloc(*ppaLines, (*pnMax ? *pnMax * 2 : 4096) * sizeof(*paNew));
+
+    if(!paNew)
+    {
+      return -1;
+    }
+
+    *ppaLines = paNew;
+    *pnMax = *pnMax ? *pnMax * 2 : 4096;
+  }
+
+  (*ppaLines)[*pnLines].cbOffset = cbOffset;
+  (*ppaLines)[*pnLines].cbLength = cbLength;
+  (*pnLines)++;
+
+  return 0;
+}
+
+static WB_RUN_LINE *BenchMemchr(const char *pData, size_t cbData, size_t *pnLines)
+{
+WB_RUN_LINE *paLines = NULL;
+const char *p1, *p2, *pEnd = pData + cbData;
+size_t nMax = 0;
+
+
+  *pnLines = 0;
+
+  for(p1=pData; p1 < pEnd; p1 = p2 + 1)
+  {
+    p2 = (const char *)memchr(p1, '\n', pEnd - p1);
+
+    if(!p2)
+    {
+      p2 = pEnd;
+    }
+
+    BenchAdd(&paLines, pnLines, &nMax, p1 - pData, p2 - p1);
+  }
+
+  return paLines;
+}
+
+static WB_RUN_LINE *BenchStrchr(const char *pData, size_t cbData, size_t *pnLines) // 'pData' is zero byte terminated
+{
+WB_RUN_LINE *paLines = NULL;
+const char *p1, *p2;
+size_t nMax = 0;
+
+
+  *pnLines = 0;
+
+  for(p1=pData; *p1; p1 = p2 + 1)
+  {
+    p2 = strchr(p1, '\n');
+
+    if(!p2)
+    {
+      p2 = pData + cbData;
+      BenchAdd(&paLines, pnLines, &nMax, p1 - pData, p2 - p1);
+      break;
+    }
+
+    BenchAdd(&paLines, pnLines, &nMax, p1 - pData, p2 - p1);
+  }
+
+  return paLines;
+}
+
+static WB_RUN_LINE *BenchStrtok(char *pData, size_t *pnLines) // modifies 'pData'
+{
+WB_RUN_LINE *paLines = NULL;
+char *p1, *pSave;
+size_t nMax = 0;
+
+
+  *pnLines = 0;
+
+  for(p1 = strtok_r(pData, "\n", &pSave); p1; p1 = strtok_r(NULL, "\n", &pSave))
+  {
+    BenchAdd(&paLines, pnLines, &nMax, p1 - pData, strlen(p1));
+  }
+
+  return paLines;
+}
+
+static void BenchReport(const char *szMix, const char *szMethod, double dTime, size_t cbData, size_t nLines)
+{
+  printf("%-6s %-22s %10.1f %10.1f %12lu\n", szMix, szMethod, dTime / 1000.0,
+         (double)cbData / dTime, (unsigned long)nLines); // bytes per usec is MB/sec
+  fflush(stdout);
+}
+
+static void BenchSplit(const char *szMix, const char *pBuf, size_t cbBuf, char *pCopy)
+{
+static const char * const aszMethod[] = { "WBRunLineIndex", "memchr", "strchr", "strtok" };
+WB_RUN_LINE *paLines;
+double dStart, dBest;
+size_t nLines = 0;
+int i1, iMethod;
+
+
+  for(iMethod=0; iMethod < 4; iMethod++)
+  {
+    for(i1=0, dBest=0; i1 < BENCH_REPEAT; i1++)
+    {
+      if(iMethod == 3)
+      {
+        memcpy(pCopy, pBuf, cbBuf + 1); // strtok writes zero bytes into it (not timed)
+      }
+
+      dStart = BenchTime();
+
+      if(iMethod == 0)
+      {
+        paLines = WBRunLineIndex(pBuf, cbBuf, &nLines);
+      }
+      else if(iMethod == 1)
+      {
+        paLines = BenchMemchr(pBuf, cbBuf, &nLines);
+      }
+      else if(iMethod == 2)
+      {
+        paLines = BenchStrchr(pBuf, cbBuf, &nLines);
+      }
+      else
+      {
+        paLines = BenchStrtok(pCopy, &nLines);
+      }
+
+      dStart = BenchTime() - dStart;
+
+      if(!i1 || dStart < dBest)
+      {
+        dBest = dStart;
+      }
+
+      WBFree(paLines);
+    }
+
+    BenchReport(szMix, aszMethod[iMethod], dBest, cbBuf, nLines);
+  }
+}
+
+static void BenchCapture(const char *szMix, const char *szFile, size_t cbBuf)
+{
+WB_RUN_OPTIONS xOpt;
+WB_RUN_RESULT xResult;
+WB_RUN_LINE *paLines;
+double dStart, dBest;
+size_t nLines = 0;
+int i1, bIndex;
+
+
+  for(bIndex=1; bIndex >= 0; bIndex--)
+  {
+    for(i1=0, dBest=0; i1 < BENCH_REPEAT; i1++)
+    {
+      memset(&xOpt, 0, sizeof(xOpt));
+      xOpt.iFlags = bIndex ? WB_RUN_OPTION_LINE_INDEX : 0;
+
+      dStart = BenchTime();
+
+      if(WBRunResultEx(&xResult, &xOpt, "cat", szFile, NULL) || xResult.cbStdout != cbBuf)
+      {
+        fprintf(stderr, "%s:  unable to capture 'cat %s'\n", szMix, szFile);
+        WBRunResultFree(&xResult);
+        return;
+      }
+
+      if(bIndex)
+      {
+        paLines = NULL; // WBRunResultFree() frees the index
+        nLines = xResult.nStdoutLines;
+      }
+      else
+      {
+        paLines = BenchMemchr(xResult.pStdout, xResult.cbStdout, &nLines);
+      }
+
+      dStart = BenchTime() - dStart;
+
+      if(!i1 || dStart < dBest)
+      {
+        dBest = dStart;
+      }
+
+      WBFree(paLines);
+
+      WBRunResultFree(&xResult);
+    }
+
+    BenchReport(szMix, bIndex ? "capture + LINE_INDEX" : "capture, then memchr", dBest, cbBuf, nLines);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+static const struct { const char *szName; int nLongEvery, bShort; } aMix[] =
+{
+  { "short", 0, 1 },
+  { "long", 0, 0 },
+  { "mixed", 10, 1 }
+};
+char szFile[] = "/tmp/lines_benchXXXXXX";
+char *pBuf, *pCopy;
+size_t cbBuf;
+int i1, hFile, nMB;
+
+
+  nMB = argc > 1 ? atoi(argv[1]) : 100;
+
+  if(nMB <= 0)
+  {
+    fprintf(stderr, "usage:  %s [MB]\n", argv[0]);
+    return 1;
+  }
+
+  cbBuf = (size_t)nMB << 20;
+
+  pBuf = (char *)malloc(cbBuf + 1);
+  pCopy = (char *)malloc(cbBuf + 1);
+
+  if(!pBuf || !pCopy)
+  {
+    fprintf(stderr, "unable to allocate %d MB\n", nMB);
+    free(pBuf);
+    free(pCopy);
+    return 1;
+  }
+
+  printf("%d MB per row, best of %d\n\n", nMB, BENCH_REPEAT);
+  printf("%-6s %-22s %10s %10s %12s\n", "lines", "method", "msec", "MB/sec", "lines");
+
+  for(i1=0; i1 < (int)(sizeof(aMix) / sizeof(aMix[0])); i1++)
+  {
+    BenchFill(pBuf, cbBuf, aMix[i1].nLongEvery, aMix[i1].bShort);
+    pBuf[cbBuf] = 0; // for strchr and strtok
+
+    BenchSplit(aMix[i1].szName, pBuf, cbBuf, pCopy);
+
+    strcpy(szFile, "/tmp/lines_benchXXXXXX");
+    hFile = mkstemp(szFile);
+
+    if(hFile < 0 || write(hFile, pBuf, cbBuf) != (ssize_t)cbBuf)
+    {
+      fprintf(stderr, "unable to write %s\n", szFile);
+    }
+    else
+    {
+      BenchCapture(aMix[i1].szName, szFile, cbBuf);
+    }
+
+    if(hFile >= 0)
+    {
+      close(hFile);
+      unlink(szFile);
+    }
+
+    printf("\n");
+  }
+
+  free(pBuf);
+  free(pCopy);
+
+  return 0;
+}
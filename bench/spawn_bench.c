@@ -0,0 +1,243 @@
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//      spawn_bench.c - spawn latency for each ForkMe spawn backend         //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//          Copyright (c) 2019 by S.F.T. Inc. - All rights reserved         //
+//  Use, copying, and distribution of this software are licensed according  //
+//    to the GPLv2, LGPLv2, or BSD license, as appropriate (see COPYING)    //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+
+// build:  cc -O2 -I.. -o spawn_bench spawn_bench.c ../ForkMe.c -lpthread
+// usage:  spawn_bench [count [heap MB ...]]
+//
+// Starts 'true' 'count' times with each backend (and the fork server) for each parent heap size
+// (10 MB, 100 MB, 1 GB and 10 GB unless sizes are given), and reports the time spent in WBRunAsync()
+// and the time until the process has been reaped.  The heap is touched before measuring, since the
+// cost of copying the parent's page tables is what the backends differ on.  Sizes that can't be
+// allocated (or that don't fit in free memory) are skipped.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ForkMe.h"
+
+void error_message(const char *szFormat, ...) // ForkMe.c expects the application to supply these
+{
+va_list va;
+
+  va_start(va, szFormat);
+  vfprintf(stderr, szFormat, va);
+  va_end(va);
+}
+
+void warning_message(const char *szFormat, ...)
+{
+va_list va;
+
+  va_start(va, szFormat);
+  vfprintf(stderr, szFormat, va);
+  va_end(va);
+}
+
+static double BenchTime(void) // microseconds
+{
+struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int BenchCompare(const void *p1, const void *p2)
+{
+double d1 = *(const double *)p1, d2 = *(const double *)p2;
+
+  return d1 < d2 ? -1 : d1 > d2 ? 1 : 0;
+}
+
+static void BenchPercentiles(double *pdTimes, int nCount, double *pdP50, double *pdP99)
+{
+  qsort(pdTimes, nCount, sizeof(*pdTimes), BenchCompare);
+
+  *pdP50 = pdTimes[nCount / 2];
+  *pdP99 = pdTimes[(nCount * 99) / 100];
+}
+
+static int BenchRun(int nHeapMB, const char *szName, int nCount)
+{
+double *pdSpawn, *pdTotal, dStart, dSpawn50, dSpawn99, dTotal50, dTotal99;
+WB_PROCESS_ID idProc;
+WB_INT32 iExit;
+int i1;
+
+
+  pdSpawn = (double *)malloc(2 * nCount * sizeof(double));
+
+  if(!pdSpawn)
+  {
+    return -1;
+  }
+
+  pdTotal = pdSpawn + nCount;
+
+  for(i1=0; i1 < nCount; i1++)
+  {
+    dStart = BenchTime();
+
+    idProc = WBRunAsync("true", NULL);
+
+    pdSpawn[i1] = BenchTime() - dStart;
+
+    if(WB_PROCESS_ID_INVALID(idProc) || WBWaitProcess(idProc, &iExit, -1) || iExit)
+    {
+      fprintf(stderr, "%s:  unable to run 'true'\n", szName);
+      free(pdSpawn);
+      return -1;
+    }
+
+    pdTotal[i1] = BenchTime() - dStart;
+  }
+
+  BenchPercentiles(pdSpawn, nCount, &dSpawn50, &dSpawn99);
+  BenchPercentiles(pdTotal, nCount, &dTotal50, &dTotal99);
+
+  printf("%8d  %-12s %10.1f %10.1f %10.1f %10.1f\n", nHeapMB, szName,
+         dSpawn50, dSpawn99, dTotal50, dTotal99);
+  fflush(stdout);
+
+  free(pdSpawn);
+
+  return 0;
+}
+
+static char *BenchHeap(int nHeapMB)
+{
+size_t cbHeap = (size_t)nHeapMB << 20;
+long lPages, lPageSize;
+char *pHeap;
+
+
+  // malloc() happily over-commits, and touching more than is free only gets us killed, so check first
+
+  lPages = sysconf(_SC_AVPHYS_PAGES);
+  lPageSize = sysconf(_SC_PAGESIZE);
+
+  if(lPages > 0 && lPageSize > 0 && cbHeap / lPageSize >= (size_t)lPages)
+  {
+    return NULL;
+  }
+
+  pHeap = (char *)malloc(cbHeap ? cbHeap : 1);
+
+  if(pHeap)
+  {
+    memset(pHeap, 1, cbHeap); // make sure the pages are actually mapped
+  }
+
+  return pHeap;
+}
+
+int main(int argc, char *argv[])
+{
+static const struct { int iBackend; const char *szName; } aBackends[] =
+{
+  { WB_SPAWN_BACKEND_VFORK, "vfork" },
+  { WB_SPAWN_BACKEND_POSIX_SPAWN, "posix_spawn" },
+  { WB_SPAWN_BACKEND_CLONE, "clone" }
+};
+static const int aDefaultMB[] = { 10, 100, 1024, 10240 };
+int i1, i2, nCount, nSizes, bServer, *paHeapMB;
+char *pHeap;
+
+
+  nCount = argc > 1 ? atoi(argv[1]) : 2000;
+  nSizes = argc > 2 ? argc - 2 : (int)(sizeof(aDefaultMB) / sizeof(aDefaultMB[0]));
+
+  paHeapMB = (int *)malloc(nSizes * sizeof(int));
+
+  if(!paHeapMB)
+  {
+    return 1;
+  }
+
+  for(i1=0; i1 < nSizes; i1++)
+  {
+    paHeapMB[i1] = argc > 2 ? atoi(argv[i1 + 2]) : aDefaultMB[i1];
+
+    if(paHeapMB[i1] < 0)
+    {
+      nCount = 0;
+    }
+  }
+
+  if(nCount <= 0)
+  {
+    fprintf(stderr, "usage:  %s [count [heap MB ...]]\n", argv[0]);
+    free(paHeapMB);
+    return 1;
+  }
+
+  printf("%d processes per row (usec)\n\n", nCount);
+  printf("%8s  %-12s %10s %10s %10s %10s\n", "heap MB", "backend",
+         "spawn p50", "spawn p99", "trip p50", "trip p99");
+
+  // the server has to be started while the process is still small, and it can't be restarted
+  // small once it's stopped, so every size is measured with it first, then without it
+
+  bServer = !WBForkServerStart();
+
+  for(i1=0; bServer && i1 < nSizes; i1++)
+  {
+    pHeap = BenchHeap(paHeapMB[i1]);
+
+    if(!pHeap)
+    {
+      printf("%8d  %-12s skipped (unable to allocate)\n", paHeapMB[i1], "fork server");
+      continue;
+    }
+
+    BenchRun(paHeapMB[i1], "fork server", nCount);
+
+    free(pHeap);
+  }
+
+  if(bServer)
+  {
+    WBForkServerStop();
+  }
+
+  for(i1=0; i1 < nSizes; i1++)
+  {
+    pHeap = BenchHeap(paHeapMB[i1]);
+
+    if(!pHeap)
+    {
+      printf("%8d  %-12s skipped (unable to allocate)\n", paHeapMB[i1], "(all)");
+      continue;
+    }
+
+    for(i2=0; i2 < (int)(sizeof(aBackends) / sizeof(aBackends[0])); i2++)
+    {
+      if(WBSetSpawnBackend(aBackends[i2].iBackend) < 0)
+      {
+        printf("%8d  %-12s not available\n", paHeapMB[i1], aBackends[i2].szName);
+        continue;
+      }
+
+      BenchRun(paHeapMB[i1], aBackends[i2].szName, nCount);
+    }
+
+    free(pHeap);
+  }
+
+  free(paHeapMB);
+
+  return 0;
+}
@@ -0,0 +1,325 @@
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//    sync_bench.c - WBMutex/WBCond compared with pthread_mutex/_cond       //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//          Copyright (c) 2019 by S.F.T. Inc. - All rights reserved         //
+//  Use, copying, and distribution of this software are licensed according  //
+//    to the GPLv2, LGPLv2, or BSD license, as appropriate (see COPYING)    //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+
+// build:  cc -O2 -I.. -o sync_bench sync_bench.c ../ForkMe.c -lpthread
+// usage:  sync_bench [threads [iterations]]
+//
+// Three tests, each run with the futex-based WBMutex/WBCond and then with pthread_mutex/pthread_cond:
+//   uncontended - lock and unlock from one thread (the fast path, which never enters the kernel)
+//   contended   - every thread increments one counter under one lock
+//   queue       - one producer signals a condition for each item, and the threads consume them
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "ForkMe.h"
+
+#define BENCH_MAX_THREADS 64
+
+void error_message(const char *szFormat, ...) // ForkMe.c expects the application to supply these
+{
+va_list va;
+
+  va_start(va, szFormat);
+  vfprintf(stderr, szFormat, va);
+  va_end(va);
+}
+
+void warning_message(const char *szFormat, ...)
+{
+va_list va;
+
+  va_start(va, szFormat);
+  vfprintf(stderr, szFormat, va);
+  va_end(va);
+}
+
+static WB_MUTEX mtxWB;
+static WB_COND condWB;
+static pthread_mutex_t mtxPthread = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t condPthread = PTHREAD_COND_INITIALIZER;
+
+static volatile long lCounter;
+static long lQueue;
+static int bDone, nIterations;
+
+static double BenchTime(void) // seconds
+{
+struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *BenchCounterWB(void *pParam)
+{
+int i1;
+
+  for(i1=0; i1 < nIterations; i1++)
+  {
+    WBMutexLock(&mtxWB, -1);
+    lCounter++;
+    WBMutexUnlock(&mtxWB);
+  }
+
+  return pParam;
+}
+
+static void *BenchCounterPthread(void *pParam)
+{
+int i1;
+
+  for(i1=0; i1 < nIterations; i1++)
+  {
+    pthread_mutex_lock(&mtxPthread);
+    lCounter++;
+    pthread_mutex_unlock(&mtxPthread);
+  }
+
+  return pParam;
+}
+
+static void *BenchConsumeWB(void *pParam)
+{
+long lCount = 0;
+
+  WBMutexLock(&mtxWB, -1);
+
+  while(1)
+  {
+    while(!lQueue && !bDone)
+    {
+      WBCondWaitMutex(&condWB, &mtxWB, -1);
+    }
+
+    if(!lQueue)
+    {
+      break;
+    }
+
+    lQueue--;
+    lCount++;
+  }
+
+  WBMutexUnlock(&mtxWB);
+
+  *(long *)pParam = lCount;
+
+  return NULL;
+}
+
+static void *BenchConsumePthread(void *pParam)
+{
+long lCount = 0;
+
+  pthread_mutex_lock(&mtxPthread);
+
+  while(1)
+  {
+    while(!lQueue && !bDone)
+    {
+      pthread_cond_wait(&condPthread, &mtxPthread);
+    }
+
+    if(!lQueue)
+    {
+      break;
+    }
+
+    lQueue--;
+    lCount++;
+  }
+
+  pthread_mutex_unlock(&mtxPthread);
+
+  *(long *)pParam = lCount;
+
+  return NULL;
+}
+
+static void *BenchNothing(void *pParam)
+{
+  return pParam;
+}
+
+static void BenchUncontended(void)
+{
+double dStart, dWB, dPthread;
+int i1;
+
+  dStart = BenchTime();
+
+  for(i1=0; i1 < nIterations; i1++)
+  {
+    WBMutexLock(&mtxWB, -1);
+    WBMutexUnlock(&mtxWB);
+  }
+
+  dWB = BenchTime() - dStart;
+  dStart = BenchTime();
+
+  for(i1=0; i1 < nIterations; i1++)
+  {
+    pthread_mutex_lock(&mtxPthread);
+    pthread_mutex_unlock(&mtxPthread);
+  }
+
+  dPthread = BenchTime() - dStart;
+
+  printf("%-12s %12.1f %12.1f   ns per lock/unlock\n", "uncontended",
+         dWB * 1e9 / nIterations, dPthread * 1e9 / nIterations);
+}
+
+static void BenchContended(int nThreads)
+{
+WB_THREAD aThreads[BENCH_MAX_THREADS];
+double dStart, adTime[2];
+int i1, iPass;
+
+  for(iPass=0; iPass < 2; iPass++)
+  {
+    lCounter = 0;
+    dStart = BenchTime();
+
+    for(i1=0; i1 < nThreads; i1++)
+    {
+      aThreads[i1] = WBThreadCreate(iPass ? BenchCounterPthread : BenchCounterWB, NULL);
+    }
+
+    for(i1=0; i1 < nThreads; i1++)
+    {
+      WBThreadWait(aThreads[i1]);
+    }
+
+    adTime[iPass] = BenchTime() - dStart;
+
+    if(lCounter != (long)nThreads * nIterations)
+    {
+      printf("contended:  wrong count %ld\n", lCounter);
+    }
+  }
+
+  printf("%-12s %12.1f %12.1f   ns per lock/unlock, %d threads\n", "contended",
+         adTime[0] * 1e9 / ((double)nThreads * nIterations),
+         adTime[1] * 1e9 / ((double)nThreads * nIterations), nThreads);
+}
+
+static void BenchQueue(int nThreads)
+{
+WB_THREAD aThreads[BENCH_MAX_THREADS];
+long alCount[BENCH_MAX_THREADS], lTotal;
+double dStart, adTime[2];
+int i1, iPass;
+
+  for(iPass=0; iPass < 2; iPass++)
+  {
+    lQueue = 0;
+    bDone = 0;
+    dStart = BenchTime();
+
+    for(i1=0; i1 < nThreads; i1++)
+    {
+      aThreads[i1] = WBThreadCreate(iPass ? BenchConsumePthread : BenchConsumeWB, &(alCount[i1]));
+    }
+
+    for(i1=0; i1 < nIterations; i1++)
+    {
+      if(iPass)
+      {
+        pthread_mutex_lock(&mtxPthread);
+        lQueue++;
+        pthread_cond_signal(&condPthread);
+        pthread_mutex_unlock(&mtxPthread);
+      }
+      else
+      {
+        WBMutexLock(&mtxWB, -1);
+        lQueue++;
+        WBCondSignal(&condWB);
+        WBMutexUnlock(&mtxWB);
+      }
+    }
+
+    if(iPass)
+    {
+      pthread_mutex_lock(&mtxPthread);
+      bDone = 1;
+      pthread_cond_broadcast(&condPthread);
+      pthread_mutex_unlock(&mtxPthread);
+    }
+    else
+    {
+      WBMutexLock(&mtxWB, -1);
+      bDone = 1;
+      WBMutexUnlock(&mtxWB);
+
+      for(i1=0; i1 < nThreads; i1++) // there's no 'broadcast', but each signal wakes at least one
+      {
+        WBCondSignal(&condWB);
+      }
+    }
+
+    for(i1=0, lTotal=0; i1 < nThreads; i1++)
+    {
+      WBThreadWait(aThreads[i1]);
+      lTotal += alCount[i1];
+    }
+
+    adTime[iPass] = BenchTime() - dStart;
+
+    if(lTotal != nIterations)
+    {
+      printf("queue:  wrong count %ld\n", lTotal);
+    }
+  }
+
+  printf("%-12s %12.1f %12.1f   ns per item, 1 producer, %d consumers\n", "queue",
+         adTime[0] * 1e9 / nIterations, adTime[1] * 1e9 / nIterations, nThreads);
+}
+
+int main(int argc, char *argv[])
+{
+int nThreads;
+
+
+  nThreads = argc > 1 ? atoi(argv[1]) : 4;
+  nIterations = argc > 2 ? atoi(argv[2]) : 1000000;
+
+  if(nThreads <= 0 || nThreads > BENCH_MAX_THREADS || nIterations <= 0)
+  {
+    fprintf(stderr, "usage:  %s [threads (1-%d) [iterations]]\n", argv[0], BENCH_MAX_THREADS);
+    return 1;
+  }
+
+  WBMutexCreate(&mtxWB);
+  WBCondCreate(&condWB);
+
+  // glibc's pthread_mutex skips the atomic instructions until the process has created a thread,
+  // which isn't a fair comparison, so make sure it has
+
+  WBThreadWait(WBThreadCreate(BenchNothing, NULL));
+
+  printf("%-12s %12s %12s\n", "", "WBMutex", "pthread");
+
+  BenchUncontended();
+  BenchContended(nThreads);
+  BenchQueue(nThreads);
+
+  WBCondFree(&condWB);
+  WBMutexFree(&mtxWB);
+
+  return 0;
+}